@@ -17,9 +17,16 @@ LOCAL_C_INCLUDES += \
 LOCAL_SRC_FILES := \
 	NXCameraSensor.cpp \
 	NXSensorThread.cpp \
+	NXSensorControlThread.cpp \
 	NXCommandThread.cpp \
+	NXCommandCompletion.cpp \
 	NXStream.cpp \
 	NXStreamThread.cpp \
+	NXZslRing.cpp \
+	NXFrameHandoff.cpp \
+	NXStreamFanout.cpp \
+	NXPreviewRequeue.cpp \
+	NXFrameStats.cpp \
 	NXZoomController.cpp \
 	Exif.cpp \
 	NXExifProcessor.cpp \
@@ -90,4 +97,111 @@ LOCAL_MODULE_TAGS := optional
 
 include $(BUILD_EXECUTABLE)
 
+include $(CLEAR_VARS)
+# for test
+LOCAL_SRC_FILES := test/test-zsl-ring.cpp \
+	NXZslRing.cpp \
+	NXStreamFanout.cpp \
+	NXPreviewRequeue.cpp
+LOCAL_SHARED_LIBRARIES := libcutils libutils
+LOCAL_C_INCLUDES := frameworks/native/include \
+	system/core/include \
+	$(LOCAL_PATH) \
+	$(LOCAL_PATH)/../include
+LOCAL_CFLAGS += -DLOG_TAG=\"test-zsl-ring\"
+
+LOCAL_MODULE := test_zsl_ring
+LOCAL_MODULE_TAGS := optional
+
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+# for test
+LOCAL_SRC_FILES := test/test-stream-fanout.cpp \
+	NXStreamFanout.cpp \
+	NXZslRing.cpp \
+	NXPreviewRequeue.cpp
+LOCAL_SHARED_LIBRARIES := libcutils libutils
+LOCAL_C_INCLUDES := frameworks/native/include \
+	system/core/include \
+	$(LOCAL_PATH) \
+	$(LOCAL_PATH)/../include
+LOCAL_CFLAGS += -DLOG_TAG=\"test-stream-fanout\"
+
+LOCAL_MODULE := test_stream_fanout
+LOCAL_MODULE_TAGS := optional
+
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+# for test
+LOCAL_SRC_FILES := test/test-frame-stats.cpp \
+	NXFrameStats.cpp
+LOCAL_SHARED_LIBRARIES := libcutils libutils
+LOCAL_C_INCLUDES := frameworks/native/include \
+	system/core/include \
+	$(LOCAL_PATH) \
+	$(LOCAL_PATH)/../include
+LOCAL_CFLAGS += -DLOG_TAG=\"test-frame-stats\"
+
+LOCAL_MODULE := test_frame_stats
+LOCAL_MODULE_TAGS := optional
+
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+# for test
+LOCAL_SRC_FILES := test/test-command-thread.cpp \
+	NXCommandThread.cpp \
+	NXCommandCompletion.cpp \
+	NXSensorControlThread.cpp \
+	NXCameraSensor.cpp \
+	Exif.cpp
+LOCAL_SHARED_LIBRARIES := libcutils libutils libv4l2-nexell libcamera_client libcamera_metadata
+LOCAL_C_INCLUDES := frameworks/native/include \
+	system/media/camera/include \
+	system/core/include \
+	$(LOCAL_PATH) \
+	$(LOCAL_PATH)/../include
+LOCAL_CFLAGS += -DLOG_TAG=\"test-command-thread\"
+
+LOCAL_MODULE := test_command_thread
+LOCAL_MODULE_TAGS := optional
+
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+# for test
+LOCAL_SRC_FILES := test/test-sensor-control.cpp \
+	NXSensorControlThread.cpp
+LOCAL_SHARED_LIBRARIES := libcutils libutils
+LOCAL_C_INCLUDES := frameworks/native/include \
+	system/media/camera/include \
+	system/core/include \
+	$(LOCAL_PATH) \
+	$(LOCAL_PATH)/../include
+LOCAL_CFLAGS += -DLOG_TAG=\"test-sensor-control\"
+
+LOCAL_MODULE := test_sensor_control
+LOCAL_MODULE_TAGS := optional
+
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+# for test
+LOCAL_SRC_FILES := test/test-zoom-controller.cpp \
+	ScalerZoomController.cpp \
+	NXZoomController.cpp
+LOCAL_SHARED_LIBRARIES := libcutils libutils
+LOCAL_C_INCLUDES := frameworks/native/include \
+	system/core/include \
+	$(LOCAL_PATH) \
+	$(LOCAL_PATH)/../include
+LOCAL_CFLAGS += -DLOG_TAG=\"test-zoom-controller\"
+
+LOCAL_MODULE := test_zoom_controller
+LOCAL_MODULE_TAGS := optional
+
+include $(BUILD_EXECUTABLE)
+
 endif
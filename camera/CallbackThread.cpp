@@ -25,7 +25,8 @@
 namespace android {
 
 CallbackThread::CallbackThread(int width, int height, sp<NXStreamManager> &streamManager)
-    :NXStreamThread(width, height, streamManager)
+    :NXStreamThread(width, height, streamManager),
+    LastSequence(0)
 {
 }
 
@@ -78,6 +79,7 @@ bool CallbackThread::threadLoop()
 
     int ret;
     buffer_handle_t *buf = NULL;
+    NXFrameStats::Sample sample;
 
     NXStream *stream = getActiveStream();
     if (!stream) {
@@ -85,25 +87,40 @@ bool CallbackThread::threadLoop()
         ERROR_EXIT();
     }
 
-    sp<NXStreamThread> previewThread = StreamManager->getStreamThread(STREAM_ID_PREVIEW);
-    if (previewThread == NULL || !previewThread->isRunning()) {
-        ALOGD("Preview thread is not running... wait");
+    NXStreamThread *previewThread = StreamManager->getStreamThread(STREAM_ID_PREVIEW);
+    if (previewThread == NULL) {
+        ALOGD("Preview thread is not created... wait");
         usleep(100*1000);
         return true;
     }
+
+    // sleep until preview enqueues a frame we haven't copied yet
+    NXFrameHandoff::Frame frame;
+    sp<NXFrameHandoff> handoff = previewThread->getFrameHandoff();
+    ret = handoff->take(frame, CALLBACK_FRAME_TIMEOUT);
     CHECK_AND_EXIT();
+    if (ret == DEAD_OBJECT) {
+        NXFrameHandoff::Stats stats = handoff->getStats();
+        ALOGD("preview stopped: frames published %u, delivered %u, dropped %u",
+                stats.published, stats.delivered, stats.dropped);
+        return true;
+    }
+    if (ret != NO_ERROR)
+        return true;
+    if (frame.Sequence != LastSequence + 1)
+        ALOGV("preview frame %u..%u dropped", LastSequence + 1, frame.Sequence - 1);
+    LastSequence = frame.Sequence;
+    memset(&sample, 0, sizeof(sample));
+    sample.Stage[NXFrameStats::STAGE_DQBUF] = NXFrameStats::now();
 
-    int width, height;
-    private_handle_t const *srcHandle = previewThread->getLastBuffer(width, height);
+    private_handle_t const *srcHandle = frame.Handle;
     if (!srcHandle) {
-        ALOGE("can't get preview thread last buffer... wait");
-        usleep(500*1000);
+        ALOGE("preview frame %u has no buffer", frame.Sequence);
         return true;
     }
-    CHECK_AND_EXIT();
 
-    if (Width != width || Height != height) {
-        ALOGE("preview wxh(%dx%d) is diffent from me(%dx%d)", width, height, Width, Height);
+    if (Width != frame.Width || Height != frame.Height) {
+        ALOGE("preview wxh(%dx%d) is diffent from me(%dx%d)", frame.Width, frame.Height, Width, Height);
         ERROR_EXIT();
     }
 
@@ -114,15 +131,17 @@ bool CallbackThread::threadLoop()
     }
 
     nxCsc(srcHandle, dstHandle, Width, Height);
+    sample.Stage[NXFrameStats::STAGE_PROCESS] = NXFrameStats::now();
     CHECK_AND_EXIT();
 
-    ret = stream->enqueueBuffer(systemTime(SYSTEM_TIME_MONOTONIC));
-    ALOGD("enqueueBuffer end");
+    ret = stream->enqueueBuffer(frame.Timestamp);
+    ALOGV("enqueueBuffer end(frame %u)", frame.Sequence);
 
     if (ret != NO_ERROR) {
         ALOGE("failed to enqueue_buffer");
         ERROR_EXIT();
     }
+    sample.Stage[NXFrameStats::STAGE_ENQUEUE] = NXFrameStats::now();
     CHECK_AND_EXIT();
 
     ret = stream->dequeueBuffer(&buf);
@@ -131,10 +150,11 @@ bool CallbackThread::threadLoop()
         ERROR_EXIT();
     }
     ALOGV("End dequeueBuffer()");
+    // the framework gave a buffer back
+    sample.Stage[NXFrameStats::STAGE_QBUF] = NXFrameStats::now();
+    getFrameStats()->commit(sample);
     CHECK_AND_EXIT();
 
-    usleep(50*1000); // for preview thread
-
     return true;
 }
 
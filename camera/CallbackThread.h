@@ -31,6 +31,9 @@ protected:
 
 private:
     virtual bool threadLoop();
+
+private:
+    uint32_t LastSequence; // of the last preview frame copied
 };
 
 }; // namespace
@@ -5,6 +5,7 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 #include <linux/videodev2.h>
 #include <linux/v4l2-mediabus.h>
@@ -15,15 +16,14 @@
 #include <ion-private.h>
 #include <gralloc_priv.h>
 #include <nx_camera_board.h>
+#include <cutils/properties.h>
 
 #include <fourcc.h>
 
 // if defined, use hw jpeg library
 #define USE_HW_JPEG
 
-#ifdef USE_HW_JPEG
-#include <libnxjpeghw.h>
-#else
+#ifndef USE_HW_JPEG
 #include <libnxjpeg.h>
 #endif
 
@@ -44,6 +44,18 @@ CaptureThread::CaptureThread(nxp_v4l2_id id,
     : NXStreamThread(id, width, height, zoomController, streamManager),
       FrameQueueDstOps(ops),
       CaptureBufferAllocated(false),
+      JpegQuality(NX_JPEGHW_DEFAULT_QUALITY),
+      UseZsl(false),
+      SessionActive(false),
+      UseSession(false),
+      SessionWidth(0),
+      SessionHeight(0),
+      SessionIdleTimeout(0),
+      SessionStartTime(0),
+      SessionBringUpTime(0),
+      LastShotTime(0),
+      ShotToShotTotal(0),
+      SessionShots(0),
       Exif(NULL),
       CurrentExif(NULL)
 {
@@ -58,6 +70,8 @@ void CaptureThread::init(nxp_v4l2_id id)
 
 CaptureThread::~CaptureThread()
 {
+    releaseZslFrame(ZslCaptureFrame);
+    clearShots();
     freeCaptureBuffer();
     if (CurrentExif)
         delete CurrentExif;
@@ -69,15 +83,49 @@ void CaptureThread::onCommand(int32_t streamId, camera_metadata_t *metadata)
 {
     if (streamId == STREAM_ID_CAPTURE) {
         if (metadata) {
+            nsecs_t trigger = systemTime(SYSTEM_TIME_MONOTONIC);
+
+            // burst: the session of the previous shot is still streaming, no bring-up
+            if (queueShot(metadata, trigger))
+                return;
+
+            // a session at another size must go, a one shot capture is left to finish
+            if (isSessionActive())
+                stop(true);
+            join();
+
             sp<NXStreamThread> previewThread = StreamManager->getStreamThread(STREAM_ID_PREVIEW);
             sp<NXStreamThread> recordThread = StreamManager->getStreamThread(STREAM_ID_RECORD);
+
+            releaseZslFrame(ZslCaptureFrame);
+            UseZsl = false;
+            clearShots();
             if ((recordThread == NULL  || !recordThread->isRunning()) &&
                 previewThread != NULL) {
-                ALOGD("stop preview---->");
-                previewThread->stop(true);
-                ALOGD("previewThread stopped");
+                // take the already exposed frame closest to the trigger and keep previewing
+                if (previewThread->acquireZslFrame(trigger, ZslCaptureFrame)) {
+                    // a preview sized frame is scaled to the capture size by encodeFrame()
+                    if ((ZslCaptureFrame.Width == Width && ZslCaptureFrame.Height == Height) ||
+                            ZoomController->useZoom()) {
+                        ALOGD("zsl capture, %dx%d frame %lld us from trigger", ZslCaptureFrame.Width,
+                                ZslCaptureFrame.Height, (long long)((ZslCaptureFrame.Timestamp - trigger) / 1000));
+                        UseZsl = true;
+                    } else {
+                        ALOGD("zsl frame %dx%d can't be scaled to capture %dx%d",
+                                ZslCaptureFrame.Width, ZslCaptureFrame.Height, Width, Height);
+                        releaseZslFrame(ZslCaptureFrame);
+                    }
+                }
+
+                if (!UseZsl) {
+                    ALOGD("stop preview---->");
+                    previewThread->stop(true);
+                    ALOGD("previewThread stopped");
+                }
             }
-            makeFrame(metadata);
+            CaptureTimeStamp = UseZsl ? ZslCaptureFrame.Timestamp : trigger;
+            JpegQuality = getJpegQuality(metadata);
+            makeFrame(metadata, CaptureTimeStamp);
 
             if (CurrentExif)
                 delete CurrentExif;
@@ -87,10 +135,77 @@ void CaptureThread::onCommand(int32_t streamId, camera_metadata_t *metadata)
                 ALOGD("End Set CurrentExif");
             }
 
-            start(streamId, (char *)"CaptureThread", PRIORITY_FOREGROUND);
+            if (!UseZsl) {
+                // served by the session if readyToRun brings one up
+                Mutex::Autolock l(ShotLock);
+                Shot shot = { trigger, NULL, JpegQuality };
+                PendingShots.push(shot);
+            }
+
+            if (start(streamId, (char *)"CaptureThread", PRIORITY_FOREGROUND) != NO_ERROR) {
+                releaseZslFrame(ZslCaptureFrame);
+                UseZsl = false;
+                clearShots();
+            }
         }
-        // capture thread auto stop
+        // capture thread auto stop, after SessionIdleTimeout without a shot
+    }
+}
+
+bool CaptureThread::queueShot(camera_metadata_t *metadata, nsecs_t timestamp)
+{
+    Mutex::Autolock l(ShotLock);
+    if (!SessionActive || !isRunning() || SessionWidth != Width || SessionHeight != Height)
+        return false;
+
+    makeFrame(metadata, timestamp);
+    Shot shot = { timestamp, Exif ? new exif_attribute_t(*Exif) : NULL, getJpegQuality(metadata) };
+    PendingShots.push(shot);
+    ALOGV("queue shot %d", PendingShots.size());
+    return true;
+}
+
+/* pops the next shot, ends the session when it was idle for SessionIdleTimeout */
+int CaptureThread::nextShot(Shot &shot)
+{
+    Mutex::Autolock l(ShotLock);
+    if (!PendingShots.isEmpty()) {
+        shot = PendingShots[0];
+        PendingShots.removeAt(0);
+        return SESSION_SHOT;
+    }
+    if (systemTime(SYSTEM_TIME_MONOTONIC) - LastShotTime < SessionIdleTimeout)
+        return SESSION_IDLE;
+    SessionActive = false;
+    return SESSION_END;
+}
+
+void CaptureThread::clearShots()
+{
+    Mutex::Autolock l(ShotLock);
+    if (PendingShots.size() > 0)
+        ALOGW("drop %d pending shots", PendingShots.size());
+    for (size_t i = 0; i < PendingShots.size(); i++) {
+        if (PendingShots[i].Exif)
+            delete PendingShots[i].Exif;
+    }
+    PendingShots.clear();
+}
+
+bool CaptureThread::isSessionActive()
+{
+    Mutex::Autolock l(ShotLock);
+    return SessionActive && isRunning();
+}
+
+status_t CaptureThread::stop(bool waitExit, bool streamOff)
+{
+    {
+        Mutex::Autolock l(ShotLock);
+        SessionActive = false;
     }
+    clearShots();
+    return NXStreamThread::stop(waitExit, streamOff);
 }
 
 void CaptureThread::onExifChanged(exif_attribute_t *exif)
@@ -119,8 +234,17 @@ status_t CaptureThread::readyToRun()
         return res;
     }
 
+    UseSession = false;
+    if (UseZsl) {
+        // the frame comes from the preview zsl ring, the device keeps streaming preview
+        InitialSkipCount = 0;
+        ALOGD("capture readyToRun exit(zsl)");
+        return NO_ERROR;
+    }
+
     sp<NXStreamThread> recordThread = StreamManager->getStreamThread(STREAM_ID_RECORD);
     if (!(recordThread != NULL && recordThread->isRunning())) {
+        SessionStartTime = systemTime(SYSTEM_TIME_MONOTONIC);
         if (allocCaptureBuffer(Width, Height) == false) {
             return NO_MEMORY;
         }
@@ -173,6 +297,24 @@ status_t CaptureThread::readyToRun()
             ALOGE("failed to v4l2_streamon for capture");
             return NO_INIT;
         }
+
+        char value[PROPERTY_VALUE_MAX];
+        char defaultValue[PROPERTY_VALUE_MAX];
+        sprintf(defaultValue, "%d", CAPTURE_SESSION_IDLE_MS);
+        property_get(CAPTURE_IDLE_PROPERTY, value, defaultValue);
+        SessionIdleTimeout = milliseconds_to_nanoseconds(atoi(value));
+        SessionBringUpTime = 0;
+        LastShotTime = systemTime(SYSTEM_TIME_MONOTONIC);
+        ShotToShotTotal = 0;
+        SessionShots = 0;
+        UseSession = true;
+
+        Mutex::Autolock l(ShotLock);
+        SessionWidth = Width;
+        SessionHeight = Height;
+        SessionActive = true;
+    } else {
+        clearShots();
     }
 
     InitialSkipCount = get_board_capture_skip_frame(SensorId, Width, Height);
@@ -181,7 +323,16 @@ status_t CaptureThread::readyToRun()
     return NO_ERROR;
 }
 
-bool CaptureThread::makeFrame(camera_metadata_t *srcMetadata)
+int CaptureThread::getJpegQuality(camera_metadata_t *metadata)
+{
+    camera_metadata_entry_t entry;
+    status_t res = find_camera_metadata_entry(metadata, ANDROID_JPEG_QUALITY, &entry);
+    if (res == OK && entry.count > 0 && entry.data.u8[0] > 0 && entry.data.u8[0] <= 100)
+        return entry.data.u8[0];
+    return NX_JPEGHW_DEFAULT_QUALITY;
+}
+
+bool CaptureThread::makeFrame(camera_metadata_t *srcMetadata, nsecs_t timestamp)
 {
     camera_metadata_t *dstMetadata = allocate_camera_metadata(35, 500);
     ALOGD("%s: %p", __func__, dstMetadata);
@@ -209,9 +360,7 @@ bool CaptureThread::makeFrame(camera_metadata_t *srcMetadata)
     add_camera_metadata_entry(dstMetadata, ANDROID_REQUEST_FRAME_COUNT, &int32Data, 1);
 
     // timestamp
-    nsecs_t timestamp = systemTime(SYSTEM_TIME_MONOTONIC);
     add_camera_metadata_entry(dstMetadata, ANDROID_SENSOR_TIMESTAMP, &timestamp, 1);
-    CaptureTimeStamp = timestamp;
 
     size_t numEntries = get_camera_metadata_entry_count(dstMetadata);
     size_t frameSize = get_camera_metadata_size(dstMetadata);
@@ -310,7 +459,7 @@ void CaptureThread::freeCaptureBuffer()
 
 bool CaptureThread::capture(unsigned int srcYPhys, unsigned int srcCBPhys, unsigned int srcCRPhys,
         unsigned int srcYVirt, unsigned int srcCBVirt, unsigned int srcCRVirt,
-        void *dstBase, int dstSize, int width, int height, uint32_t dstOffset)
+        void *dstBase, int dstSize, int width, int height, uint32_t dstOffset, int stride)
 {
     int jpegSize;
     int jpegBufSize;
@@ -323,16 +472,23 @@ bool CaptureThread::capture(unsigned int srcYPhys, unsigned int srcCBPhys, unsig
         return false;
 #else
         jpegSize = NX_JpegEncoding((unsigned char *)dstBase, dstSize,
-                (unsigned char const *)srcYVirt, width, height, 100, NX_PIXELFORMAT_YUYV);
+                (unsigned char const *)srcYVirt, width, height, JpegQuality, NX_PIXELFORMAT_YUYV);
 #endif
     } else {
 #ifdef USE_HW_JPEG
         ALOGV("jpeg src buf: 0x%x, 0x%x, 0x%x, dst virt 0x%x", srcYPhys, srcCBPhys, srcCRPhys, dstBase);
-        jpegSize = NX_JpegHWEncoding((void *)(((uint32_t)dstBase) + dstOffset), dstSize,
-                width, height, FOURCC_MVS0,
-                srcYPhys, srcYVirt, width,
-                srcCBPhys, srcCBVirt, width >> 1,
-                srcCRPhys, srcCRVirt, width >> 1,
+        if (JpegEncoder.open(width, height, JpegQuality) < 0) {
+            ALOGE("failed to open jpeg encoder!!!");
+            return false;
+        }
+        // the blob trailer lives at the end of the buffer
+        if (!stride)
+            stride = width;
+        jpegSize = JpegEncoder.encode((char *)dstBase + dstOffset,
+                dstSize - dstOffset - sizeof(camera2_jpeg_blob), FOURCC_MVS0,
+                srcYPhys, srcYVirt, stride,
+                srcCBPhys, srcCBVirt, stride >> 1,
+                srcCRPhys, srcCRVirt, stride >> 1,
                 dstOffset == 0);
 #else
         struct ycbcr_planar planar;
@@ -340,7 +496,7 @@ bool CaptureThread::capture(unsigned int srcYPhys, unsigned int srcCBPhys, unsig
         planar.cb = (unsigned char *)srcCBVirt;
         planar.cr = (unsigned char *)srcCRVirt;
         jpegSize = NX_JpegEncoding((unsigned char *)dstBase, dstSize,
-                (unsigned char const *)&planar, width, height, 100, NX_PIXFORMAT_YUV420);
+                (unsigned char const *)&planar, width, height, JpegQuality, NX_PIXFORMAT_YUV420);
 #endif
     }
     if (jpegSize <= 0) {
@@ -369,7 +525,7 @@ bool CaptureThread::capture(struct nxp_vid_buffer *srcBuf, private_handle_t cons
     bool captured = capture((unsigned int)srcBuf->phys[0], (unsigned int)srcBuf->phys[1], (unsigned int)srcBuf->phys[2],
             (unsigned int)srcBuf->virt[0], (unsigned int)srcBuf->virt[1], (unsigned int)srcBuf->virt[2],
             //(void *)dstHandle->base, dstHandle->size, width, height, dstOffset);
-            (void *)dstVirt, dstHandle->size, width, height, dstOffset);
+            (void *)dstVirt, dstHandle->size, width, height, dstOffset, srcBuf->stride[0]);
     releaseVirtForHandle(dstHandle, dstVirt);
     return captured;
 }
@@ -396,6 +552,148 @@ bool CaptureThread::capture(private_handle_t const *srcHandle, private_handle_t
     return captured;
 }
 
+/* one frame of the capture session: serve a pending shot or keep the sensor streaming */
+bool CaptureThread::sessionLoop(NXStream *stream)
+{
+    int dqIdx;
+    int ret;
+    int plane_num = CaptureBuffer[0].plane_num;
+
+    ALOGV("dq command to device!!!");
+    ret = v4l2_dqbuf(Id, plane_num, &dqIdx, NULL);
+    if (ret < 0) {
+        ALOGE("failed to v4l2_dqbuf for Capture id %d", Id);
+        ERROR_EXIT();
+    }
+    ALOGV("dq end");
+    CHECK_AND_EXIT();
+
+    if (InitialSkipCount) {
+        InitialSkipCount--;
+        ALOGD("Capture Skip Frame: %d, %d", InitialSkipCount, ret);
+        v4l2_qbuf(Id, plane_num, dqIdx, &CaptureBuffer[dqIdx], -1, NULL);
+        return true;
+    }
+
+    Shot shot;
+    switch (nextShot(shot)) {
+    case SESSION_IDLE:
+        // nothing to take, keep frames fresh for the next shot
+        v4l2_qbuf(Id, plane_num, dqIdx, &CaptureBuffer[dqIdx], -1, NULL);
+        return true;
+
+    case SESSION_END:
+        ALOGD("capture session end: %u shots, bring-up %lld ms, shot to shot avg %lld ms",
+                SessionShots, nanoseconds_to_milliseconds(SessionBringUpTime),
+                SessionShots > 1 ? nanoseconds_to_milliseconds(ShotToShotTotal / (SessionShots - 1)) : 0);
+        v4l2_qbuf(Id, plane_num, dqIdx, &CaptureBuffer[dqIdx], -1, NULL);
+        JpegEncoder.close();
+        ExifProcessor->releaseThumbnailEncoder();
+        stop(false);
+        return false;
+
+    default:
+        break;
+    }
+
+    if (shot.Exif) {
+        if (CurrentExif)
+            delete CurrentExif;
+        CurrentExif = shot.Exif;
+    }
+    CaptureTimeStamp = shot.Timestamp;
+    JpegQuality = shot.Quality;
+
+    if (false == encodeFrame(stream, &CaptureBuffer[dqIdx], Width, Height))
+        ERROR_EXIT();
+
+    buffer_handle_t *handle;
+    status_t res = stream->dequeueBuffer(&handle);
+    if (res != NO_ERROR || handle == NULL) {
+        ALOGE("failed to dequeue");
+    }
+
+    v4l2_qbuf(Id, plane_num, dqIdx, &CaptureBuffer[dqIdx], -1, NULL);
+
+    nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
+    if (SessionShots == 0) {
+        SessionBringUpTime = now - SessionStartTime;
+        ALOGD("capture shot 1: request to jpeg %lld ms (with bring-up)",
+                nanoseconds_to_milliseconds(now - shot.Timestamp));
+    } else {
+        ShotToShotTotal += now - LastShotTime;
+        ALOGD("capture shot %u: request to jpeg %lld ms, shot to shot %lld ms", SessionShots + 1,
+                nanoseconds_to_milliseconds(now - shot.Timestamp),
+                nanoseconds_to_milliseconds(now - LastShotTime));
+    }
+    SessionShots++;
+    LastShotTime = now;
+
+    CHECK_AND_EXIT();
+    return true;
+}
+
+/* zoom, exif and jpeg encode srcBuf(srcWidth x srcHeight) to the next buffer of stream */
+bool CaptureThread::encodeFrame(NXStream *stream, struct nxp_vid_buffer *srcBuf, int srcWidth, int srcHeight)
+{
+    ALOGD("src phys: 0x%lx, 0x%lx, 0x%lx", srcBuf->phys[0], srcBuf->phys[1], srcBuf->phys[2]);
+
+    // a zsl frame at the preview size always goes through the scaler
+    bool rescale = srcWidth != Width || srcHeight != Height;
+    if (rescale)
+        ZoomController->setSource(srcWidth, srcHeight);
+    int zoomMode = ZoomController->useZoom() ? ZoomController->getZoomMode() : NXZoomController::ZOOM_IDENTITY;
+    if (rescale)
+        zoomMode = NXZoomController::ZOOM_SCALE;
+#ifdef USE_HW_JPEG
+    // the jpeg encoder reads a pure crop in place through the source stride
+    struct nxp_vid_buffer view;
+    if (zoomMode == NXZoomController::ZOOM_CROP && ZoomController->getCropView(srcBuf, &view)) {
+        ALOGD("crop view phys: 0x%lx, 0x%lx, 0x%lx", view.phys[0], view.phys[1], view.phys[2]);
+        srcBuf = &view;
+        zoomMode = NXZoomController::ZOOM_IDENTITY;
+    }
+#endif
+    if (zoomMode != NXZoomController::ZOOM_IDENTITY) {
+        if (false == ZoomController->allocBuffer(MAX_CAPTURE_ZOOM_BUFFER, Width, Height, PIXINDEX2PIXFORMAT(PixelIndex))) {
+            ALOGE("failed to allocate capture zoom buffer");
+            if (rescale)
+                ZoomController->setSource(Width, Height);
+            return false;
+        }
+        struct nxp_vid_buffer *dstBuf = ZoomController->getBuffer(0);
+        ZoomController->handleZoom(srcBuf, dstBuf);
+        if (rescale)
+            ZoomController->setSource(Width, Height);
+        ALOGD("dst phys: 0x%lx, 0x%lx, 0x%lx", dstBuf->phys[0], dstBuf->phys[1], dstBuf->phys[2]);
+        srcBuf = dstBuf;
+    }
+
+    // the thumbnail is made while the main image encodes behind the reserved exif
+    private_handle_t const *dstHandle = stream->getNextBuffer();
+    if (false == ExifProcessor->startExif(Width, Height, srcBuf, CurrentExif, dstHandle)) {
+        ALOGE("Failed to startExif()!!!");
+    } else {
+        uint32_t reserved = ExifProcessor->getReservedSize();
+        bool captured = capture(srcBuf, dstHandle, Width, Height, reserved);
+        if (!captured)
+            ALOGE("Capture Failed!!!");
+
+        // the app1 segment ends where the main image starts
+        NXExifProcessor::ExifResult result = ExifProcessor->finishExif();
+        if (result.getSize() == 0)
+            ALOGE("Failed to finishExif()!!!");
+        ExifProcessor->clear();
+    }
+
+    status_t res = stream->enqueueBuffer(CaptureTimeStamp);
+    if (res != NO_ERROR) {
+        ALOGE("failed to enqueue!!!");
+        return false;
+    }
+    return true;
+}
+
 bool CaptureThread::threadLoop()
 {
     ALOGD("Capture threadLoop entered");
@@ -406,121 +704,86 @@ bool CaptureThread::threadLoop()
         ERROR_EXIT();
     }
 
-    sp<NXStreamThread> recordThread = StreamManager->getStreamThread(STREAM_ID_RECORD);
-    if (!(recordThread != NULL && recordThread->isRunning())) {
-        int dqIdx;
-        int ret;
-        nsecs_t timestamp;
-        int plane_num = CaptureBuffer[0].plane_num;
-
-        ALOGV("dq command to device!!!");
-        ret = v4l2_dqbuf(Id, plane_num, &dqIdx, NULL);
-        if (ret < 0) {
-            ALOGE("failed to v4l2_dqbuf for Capture id %d", Id);
+    if (UseZsl) {
+        bool encoded = encodeFrame(stream, ZslCaptureFrame.Buffer, ZslCaptureFrame.Width, ZslCaptureFrame.Height);
+        releaseZslFrame(ZslCaptureFrame);
+        UseZsl = false;
+        if (!encoded)
             ERROR_EXIT();
-        }
-        ALOGV("dq end");
-
-        if (InitialSkipCount) {
-            InitialSkipCount--;
-            ALOGD("Capture Skip Frame: %d, %d", InitialSkipCount, ret);
-            ret = v4l2_qbuf(Id, plane_num, dqIdx, &CaptureBuffer[dqIdx], -1, NULL);
-        } else {
-            struct nxp_vid_buffer *srcBuf = &CaptureBuffer[dqIdx];
-            ALOGD("src phys: 0x%lx, 0x%lx, 0x%lx", srcBuf->phys[0], srcBuf->phys[1], srcBuf->phys[2]);
 
-            if (ZoomController->useZoom() && ZoomController->isZoomAvaliable()) {
-                if (false == ZoomController->allocBuffer(MAX_CAPTURE_ZOOM_BUFFER, Width, Height, PIXINDEX2PIXFORMAT(PixelIndex))) {
-                    ALOGE("failed to allocate capture zoom buffer");
-                    ERROR_EXIT();
-                }
-                struct nxp_vid_buffer *dstBuf = ZoomController->getBuffer(0);
-                ZoomController->handleZoom(srcBuf, dstBuf);
-                ALOGD("dst phys: 0x%lx, 0x%lx, 0x%lx", dstBuf->phys[0], dstBuf->phys[1], dstBuf->phys[2]);
-                srcBuf = dstBuf;
-            }
+        buffer_handle_t *handle;
+        status_t res = stream->dequeueBuffer(&handle);
+        if (res != NO_ERROR || handle == NULL) {
+            ALOGE("failed to dequeue");
+        }
 
-            private_handle_t const *dstHandle = stream->getNextBuffer();
-            NXExifProcessor::ExifResult result = ExifProcessor->makeExif(Width, Height, srcBuf, CurrentExif, dstHandle);
-            if (result.getSize() == 0) {
-                ALOGE("Failed to makeExif()!!!");
-            } else {
-                if (false == capture(srcBuf, dstHandle, Width, Height, result.getSize()))
-                    ALOGE("Capture Failed!!!");
+        // preview owns the device, don't streamoff
+        JpegEncoder.close();
+        ExifProcessor->releaseThumbnailEncoder();
+        stop(false, false);
+        return false;
+    }
 
-                ExifProcessor->clear();
-            }
+    if (UseSession)
+        return sessionLoop(stream);
 
-            status_t res = stream->enqueueBuffer(CaptureTimeStamp);
-            if (res != NO_ERROR) {
-                ALOGE("failed to enqueue!!!");
-                ERROR_EXIT();
-            }
+    // recording, take the last record frame
+    sp<NXStreamThread> recordThread = StreamManager->getStreamThread(STREAM_ID_RECORD);
+    if (recordThread == NULL) {
+        ALOGE("record thread is gone");
+        ERROR_EXIT();
+    }
 
-            buffer_handle_t *handle;
-            res = stream->dequeueBuffer(&handle);
-            if (res != NO_ERROR || handle == NULL) {
-                ALOGE("failed to dequeue");
-            }
+    int width = 0, height = 0;
+    private_handle_t const *srcHandle = recordThread->getLastBuffer(width, height);
+    private_handle_t const *dstHandle = stream->getNextBuffer();
 
-            v4l2_qbuf(Id, plane_num, dqIdx, &CaptureBuffer[dqIdx], -1, NULL);
+    ALOGD("srcHandle %p, dstHandle %p", srcHandle, dstHandle);
 
-            stop(false);
-            return false;
-        }
-    } else {
-        int width = 0, height = 0;
-        private_handle_t const *srcHandle = recordThread->getLastBuffer(width, height);
-        private_handle_t const *dstHandle = stream->getNextBuffer();
-
-        ALOGD("srcHandle %p, dstHandle %p", srcHandle, dstHandle);
-
-        if (!srcHandle) {
-            int waitRecordingBufferCount100ms = 5;
-            while(waitRecordingBufferCount100ms--) {
-                usleep(100000);
-                srcHandle = recordThread->getLastBuffer(width, height);
-                if (srcHandle)
-                    break;
-                ALOGD("waitRecordingBufferCount: %d", waitRecordingBufferCount100ms);
-            }
+    if (!srcHandle) {
+        int waitRecordingBufferCount100ms = 5;
+        while(waitRecordingBufferCount100ms--) {
+            usleep(100000);
+            srcHandle = recordThread->getLastBuffer(width, height);
+            if (srcHandle)
+                break;
+            ALOGD("waitRecordingBufferCount: %d", waitRecordingBufferCount100ms);
         }
+    }
 
-        if (srcHandle == NULL || dstHandle == NULL) {
-            ALOGE("can't capture!!!");
+    if (srcHandle == NULL || dstHandle == NULL) {
+        ALOGE("can't capture!!!");
+        stream->cancelBuffer();
+    } else {
+        NXExifProcessor::ExifResult result = ExifProcessor->makeExif(width, height, srcHandle, CurrentExif, dstHandle);
+        if (result.getSize() == 0) {
+            ALOGE("Failed to makeExif()!!!");
             stream->cancelBuffer();
         } else {
-            NXExifProcessor::ExifResult result = ExifProcessor->makeExif(width, height, srcHandle, CurrentExif, dstHandle);
-            if (result.getSize() == 0) {
-                ALOGE("Failed to makeExif()!!!");
+            if (false == capture(srcHandle, dstHandle, width, height, result.getSize())) {
+                ALOGE("Capture Failed!!!");
                 stream->cancelBuffer();
             } else {
-                if (false == capture(srcHandle, dstHandle, width, height, result.getSize())) {
-                    ALOGE("Capture Failed!!!");
-                    stream->cancelBuffer();
-                } else {
-                    ExifProcessor->clear();
-                    status_t res = stream->enqueueBuffer(CaptureTimeStamp);
-                    if (res != NO_ERROR) {
-                        ALOGE("failed to enqueue!!!");
-                        ERROR_EXIT();
-                    }
+                ExifProcessor->clear();
+                status_t res = stream->enqueueBuffer(CaptureTimeStamp);
+                if (res != NO_ERROR) {
+                    ALOGE("failed to enqueue!!!");
+                    ERROR_EXIT();
                 }
             }
         }
+    }
 
-        buffer_handle_t *handle;
-        status_t res = stream->dequeueBuffer(&handle);
-        if (res != NO_ERROR || handle == NULL) {
-            ALOGE("failed to dequeue");
-        }
-
-        stop(false, false);
-        return false;
+    buffer_handle_t *handle;
+    status_t res = stream->dequeueBuffer(&handle);
+    if (res != NO_ERROR || handle == NULL) {
+        ALOGE("failed to dequeue");
     }
 
-    ALOGD("Capture threadLoop exit");
-    return true;
+    JpegEncoder.close();
+    ExifProcessor->releaseThumbnailEncoder();
+    stop(false, false);
+    return false;
 }
 
 }; // namespace android
@@ -5,9 +5,11 @@
 #include <camera/Camera.h>
 #include <camera/CameraParameters.h>
 #include <utils/Thread.h>
+#include <utils/Vector.h>
 #include <gralloc_priv.h>
 #include <nxp-v4l2.h>
 #include <nx_camera_board.h>
+#include <libnxjpeghw.h>
 #include "NXCommandThread.h"
 #include "NXStream.h"
 #include "NXStreamThread.h"
@@ -33,18 +35,44 @@ public:
     virtual status_t readyToRun();
     virtual void onCommand(int32_t streamId, camera_metadata_t *metadata);
     virtual void onExifChanged(exif_attribute_t *exif);
+    virtual status_t stop(bool waitExit, bool streamOff = true);
+    virtual bool isSessionActive();
+    // every request is a shot
+    virtual bool isCommandRedundant(int32_t streamId) {
+        return false;
+    }
 
 protected:
     virtual void init(nxp_v4l2_id id);
 
+private:
+    // still capture request waiting for a frame of the streaming session
+    struct Shot {
+        nsecs_t Timestamp; // request time, reported as the frame timestamp
+        exif_attribute_t *Exif; // NULL: keep CurrentExif
+        int Quality; // ANDROID_JPEG_QUALITY
+    };
+
+    enum {
+        SESSION_SHOT,
+        SESSION_IDLE,
+        SESSION_END
+    };
+
 private:
     virtual bool threadLoop();
+    bool sessionLoop(NXStream *stream);
+    bool queueShot(camera_metadata_t *metadata, nsecs_t timestamp);
+    int nextShot(Shot &shot);
+    void clearShots();
     bool capture(unsigned int srcYPhys, unsigned int srcCBPhys, unsigned int srcCRPhys,
                  unsigned int srcYVirt, unsigned int srcCBVirt, unsigned int srcCRVirt,
-                 void *dstBase, int dstSize, int width, int height, uint32_t dstOffset = 0);
+                 void *dstBase, int dstSize, int width, int height, uint32_t dstOffset = 0, int stride = 0);
     bool capture(private_handle_t const *srcHandle, private_handle_t const *dstHandle, int width, int height, uint32_t dstOffset = 0);
     bool capture(struct nxp_vid_buffer *srcBuf, private_handle_t const *dstHandle, int width, int height, uint32_t dstOffset = 0);
-    bool makeFrame(camera_metadata_t *srcMetadata);
+    bool encodeFrame(NXStream *stream, struct nxp_vid_buffer *srcBuf, int srcWidth, int srcHeight);
+    bool makeFrame(camera_metadata_t *srcMetadata, nsecs_t timestamp);
+    int getJpegQuality(camera_metadata_t *metadata);
     bool allocCaptureBuffer(int width, int height);
     void freeCaptureBuffer();
     void dumpCaptureBuffer();
@@ -57,6 +85,27 @@ private:
 
     nsecs_t CaptureTimeStamp;
 
+    NXJpegHWEncoder JpegEncoder; // stays open for the shots of a session
+    int JpegQuality;
+
+    bool UseZsl; // ZslCaptureFrame is held from the preview zsl ring
+    ZslFrame ZslCaptureFrame;
+
+    // capture session, the device stays streaming at SessionWidth x SessionHeight
+    // between shots until SessionIdleTimeout passes without a request
+    Mutex ShotLock; // for SessionActive, PendingShots
+    bool SessionActive;
+    Vector<Shot> PendingShots;
+    bool UseSession;
+    int SessionWidth;
+    int SessionHeight;
+    nsecs_t SessionIdleTimeout;
+    nsecs_t SessionStartTime;
+    nsecs_t SessionBringUpTime;
+    nsecs_t LastShotTime;
+    nsecs_t ShotToShotTotal;
+    uint32_t SessionShots;
+
     exif_attribute_t *Exif;
     exif_attribute_t *CurrentExif;
     NXExifProcessor *ExifProcessor;
@@ -28,6 +28,21 @@ enum {
 
 #define MAX_PREVIEW_INTERNAL_BUFFER 4 // for CSC(YV12 to NV21) must be same to MAX_PREVIEW_ZOOM_BUFFER
 
+#define MAX_ZSL_BUFFER              4 // preview frames kept for zero shutter lag capture
+#define ZSL_DEPTH_PROPERTY          "camera.zsl.depth" // overrides MAX_ZSL_BUFFER, 0: only with zsl stream
+#define ZSL_FRAME_TIMEOUT           (1000*1000*1000LL) // ns, preview waits this long for a capture to release its zsl frame
+#define CAPTURE_SESSION_IDLE_MS     0 // capture keeps streaming this long after a shot, 0: stop after each shot
+#define CAPTURE_IDLE_PROPERTY       "camera.capture.idle_ms" // overrides CAPTURE_SESSION_IDLE_MS, burst users set e.g. 500
+#define CALLBACK_FRAME_TIMEOUT      (100*1000*1000LL) // ns, callback wait for a preview frame
+#define MAX_FANOUT_OUTPUTS          4 // streams fed from the preview frames by NXStreamFanout
+#define FANOUT_HELD_BUFFER          2 // preview frames a fan-out output holds, pending and taken
+#define FANOUT_FRAME_TIMEOUT        (100*1000*1000LL) // ns, fan-out output wait for a preview frame
+#define RECORD_FANOUT_PROPERTY      "camera.record.fanout" // 1: record scales preview frames instead of its own path
+#define SENSOR_CTRL_FRAME_TIMEOUT   (100*1000*1000LL) // ns, sensor controls wait this long for a frame boundary
+#define COMMAND_COMPLETION_TIMEOUT  (1000*1000*1000LL) // ns, wait for the command thread to drain the request queue
+#define FRAME_TRACE_PROPERTY        "camera.stats.trace" // dump() writes the frame stage times there as a chrome trace
+
 #define DEFAULT_ZOOM_FACTOR         4.0
+#define ZOOM_SMOOTH_FRAMES          4 // preview and record step to a new zoom crop over this many frames
 
 #endif
@@ -1,5 +1,8 @@
 #define LOG_TAG "NexellCameraHAL2"
+#include <unistd.h>
 #include <utils/Log.h>
+#include <utils/String8.h>
+#include <cutils/properties.h>
 #include <ion/ion.h>
 #include <android-nxp-v4l2.h>
 #include <nxp-v4l2.h>
@@ -51,12 +54,28 @@ bool NXCameraHWInterface2::init()
 
     StreamManager = new NXStreamManager(this);
 
+    SensorControlThread = new NXSensorControlThread(Sensor->RawSensor);
+    SensorControlThread->run("NXSensorControlThread");
+    StreamManager->setSensorControl(SensorControlThread);
+
     return android_nxp_v4l2_init();
 }
 
 void NXCameraHWInterface2::release()
 {
     trace();
+    if (CommandThread != NULL) {
+        // let the last requests reach the stream threads before they go
+        if (CommandThread->waitIdle() != NO_ERROR)
+            ALOGW("release: request queue not drained");
+        CommandThread->requestExit();
+        CommandThread->join();
+    }
+    if (SensorControlThread != NULL) {
+        // writes what is still pending and exits
+        SensorControlThread->requestExit();
+        SensorControlThread->join();
+    }
     if (IonFd >= 0) {
         ion_close(IonFd);
         IonFd = -1;
@@ -73,6 +92,7 @@ int NXCameraHWInterface2::setRequestQueueSrcOps(const camera2_request_queue_src_
         return NO_MEMORY;
     }
     NXCommandThread *cthread = CommandThread.get();
+    cthread->setSensorControl(SensorControlThread);
     cthread->run();
     return 0;
 }
@@ -100,6 +120,9 @@ int NXCameraHWInterface2::setFrameQueueDstOps(const camera2_frame_queue_dst_ops_
 int NXCameraHWInterface2::getInProgressCount()
 {
     trace();
+    // the framework drains the request queue on this before it stops streams
+    if (CommandThread != NULL)
+        return CommandThread->getInProgressCount();
     return 0;
 }
 
@@ -275,6 +298,23 @@ int NXCameraHWInterface2::getMetadataVendorTagOps(vendor_tag_query_ops_t **ops)
 int NXCameraHWInterface2::dump(int fd)
 {
     trace();
+    String8 result;
+
+    result.appendFormat("NXCameraHWInterface2 camera %d\n", CameraId);
+    if (StreamManager != NULL) {
+        StreamManager->dump(result);
+
+        char path[PROPERTY_VALUE_MAX];
+        property_get(FRAME_TRACE_PROPERTY, path, "");
+        if (path[0]) {
+            if (StreamManager->writeTrace(path, CameraId) == NO_ERROR)
+                result.appendFormat("  frame trace written to %s\n", path);
+            else
+                result.appendFormat("  can't write frame trace to %s\n", path);
+        }
+    }
+
+    write(fd, result.string(), result.size());
     return 0;
 }
 
@@ -84,6 +84,7 @@ private:
 
     sp<NXCommandThread> CommandThread;
     sp<NXSensorThread> SensorThread;
+    sp<NXSensorControlThread> SensorControlThread;
 
     sp<NXStreamManager> StreamManager;
 };
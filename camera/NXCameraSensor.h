@@ -65,6 +65,19 @@ public:
         return RawSensor->setZoomCrop(left, top, width, height);
     }
 
+    // the setters called in between only collect their controls
+    void beginControls() {
+        RawSensor->beginControls();
+    }
+
+    void endControls(NXSensorControlSet &set) {
+        RawSensor->endControls(set);
+    }
+
+    int applyControls(const NXSensorControlSet &set) {
+        return RawSensor->applyControls(set);
+    }
+
 public:
     // static sensor characteristics
     static const unsigned int kResolution[2][2];
@@ -0,0 +1,98 @@
+#ifndef LOG_TAG
+#define LOG_TAG "NXCommandCompletion"
+#endif
+
+#include <string.h>
+#include <utils/Log.h>
+
+#include "NXCommandCompletion.h"
+
+namespace android {
+
+NXCommandCompletion::NXCommandCompletion()
+    : Submitted(0),
+      Started(0),
+      Completed(0),
+      Aborted(false)
+{
+    memset(&Statistics, 0, sizeof(Statistics));
+}
+
+uint32_t NXCommandCompletion::submit()
+{
+    Mutex::Autolock l(Lock);
+    Statistics.submitted++;
+    if (Submitted != Started) {
+        // the pending pass hasn't dequeued anything yet, it sees this work too
+        Statistics.coalesced++;
+        return Submitted;
+    }
+    if (++Submitted == 0)
+        Submitted = 1;
+    WorkPending.signal();
+    return Submitted;
+}
+
+uint32_t NXCommandCompletion::begin()
+{
+    Mutex::Autolock l(Lock);
+    while (!Aborted && Submitted == Started)
+        WorkPending.wait(Lock);
+    if (Aborted)
+        return 0;
+    Started = Submitted;
+    Statistics.passes++;
+    return Started;
+}
+
+void NXCommandCompletion::complete(uint32_t token)
+{
+    Mutex::Autolock l(Lock);
+    Completed = token;
+    WorkDone.broadcast();
+}
+
+void NXCommandCompletion::abort()
+{
+    Mutex::Autolock l(Lock);
+    Aborted = true;
+    WorkPending.broadcast();
+    WorkDone.broadcast();
+}
+
+status_t NXCommandCompletion::waitLocked(uint32_t token, nsecs_t timeout)
+{
+    nsecs_t deadline = systemTime(SYSTEM_TIME_MONOTONIC) + timeout;
+    while (!isDone(Completed, token)) {
+        if (Aborted)
+            return DEAD_OBJECT;
+        nsecs_t remaining = deadline - systemTime(SYSTEM_TIME_MONOTONIC);
+        if (remaining <= 0 || WorkDone.waitRelative(Lock, remaining) == TIMED_OUT) {
+            if (isDone(Completed, token))
+                break;
+            ALOGW("token %u not done in %lld ms, completed %u", token, timeout / 1000000, Completed);
+            return TIMED_OUT;
+        }
+    }
+    return NO_ERROR;
+}
+
+status_t NXCommandCompletion::waitIdle(nsecs_t timeout)
+{
+    Mutex::Autolock l(Lock);
+    return waitLocked(Submitted, timeout);
+}
+
+int NXCommandCompletion::inProgress()
+{
+    Mutex::Autolock l(Lock);
+    return (Started != Completed ? 1 : 0) + (Submitted != Started ? 1 : 0);
+}
+
+NXCommandCompletion::Stats NXCommandCompletion::getStats()
+{
+    Mutex::Autolock l(Lock);
+    return Statistics;
+}
+
+}; // namespace android
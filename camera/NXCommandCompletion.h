@@ -0,0 +1,63 @@
+#ifndef _NX_COMMAND_COMPLETION_H
+#define _NX_COMMAND_COMPLETION_H
+
+#include <utils/Mutex.h>
+#include <utils/Condition.h>
+#include <utils/Timers.h>
+
+namespace android {
+
+// Completion tokens of the command thread.
+// submit() returns the token of the pass that will see the work. A pass
+// is pending until the worker picks it up with begin(), a submission made
+// meanwhile shares the pending token, so notifications issued back to back
+// cost one pass. The worker completes the token once the request queue is
+// drained and waiters blocked in waitIdle() wake up on a condition.
+class NXCommandCompletion
+{
+public:
+    struct Stats {
+        uint32_t submitted;
+        uint32_t coalesced; // shared the token of a pending pass
+        uint32_t passes;
+    };
+
+    NXCommandCompletion();
+
+    // producer
+    uint32_t submit();
+
+    // worker, begin() blocks until a pass is pending and returns 0 once aborted
+    uint32_t begin();
+    void complete(uint32_t token);
+    void abort();
+
+    // any thread, NO_ERROR once everything submitted so far is done,
+    // TIMED_OUT or DEAD_OBJECT
+    status_t waitIdle(nsecs_t timeout);
+    // passes pending or running
+    int inProgress();
+
+    Stats getStats();
+
+private:
+    static bool isDone(uint32_t completed, uint32_t token) {
+        return (int32_t)(completed - token) >= 0;
+    }
+    status_t waitLocked(uint32_t token, nsecs_t timeout);
+
+private:
+    Mutex Lock;
+    Condition WorkPending;
+    Condition WorkDone;
+
+    uint32_t Submitted; // last token handed out, 0 is never used
+    uint32_t Started;   // last token the worker began
+    uint32_t Completed; // last token the worker completed
+    bool Aborted;
+    Stats Statistics;
+};
+
+}; // namespace android
+
+#endif
@@ -20,11 +20,13 @@ namespace android {
 
 NXCommandThread::NXCommandThread(const camera2_request_queue_src_ops_t *ops, NXCameraSensor *sensor)
     : Thread(false),
-      IsIdle(true),
-      MsgReceived(false),
+      LastStreams(0),
+      LastStreamsValid(false),
+      Coalesced(0),
       RequestQueueSrcOps(ops),
       Sensor(sensor)
 {
+    memset(ListenerMap, 0, STREAM_ID_MAX);
     CropLeft = 0;
     CropTop = 0;
     CropWidth = sensor->getSensorW();
@@ -50,40 +52,34 @@ NXCommandThread::~NXCommandThread()
 void NXCommandThread::wakeup()
 {
     trace_in();
-    Mutex::Autolock lock(SignalMutex);
-    MsgReceived = true;
-    SignalCondition.signal();
+    Completion.submit();
     trace_exit();
 }
 
-bool NXCommandThread::threadLoop()
+status_t NXCommandThread::waitIdle(nsecs_t timeout)
 {
-#if 0
-    trace_in();
-    SignalMutex.lock();
-    ALOGD("threadLoop MsgReceived %d", MsgReceived);
-    if (MsgReceived) {
-        MsgReceived = false;
-    } else {
-        IsIdle = true;
-        SignalCondition.wait(SignalMutex);
-    }
-    SignalMutex.unlock();
+    return Completion.waitIdle(timeout);
+}
 
-    IsIdle = false;
-    return processCommand();
-#else
+void NXCommandThread::requestExit()
+{
+    Thread::requestExit();
+    // wake the loop and whoever waits for it
+    Completion.abort();
+}
+
+bool NXCommandThread::threadLoop()
+{
     if (exitPending()) {
         ALOGD("exit Pending!!!");
         return false;
     }
-    SignalMutex.lock();
-    while (!MsgReceived)
-        SignalCondition.wait(SignalMutex);
-    MsgReceived = false;
-    SignalMutex.unlock();
-    return processCommand();
-#endif
+    uint32_t token = Completion.begin();
+    if (!token)
+        return false;
+    bool ret = processCommand();
+    Completion.complete(token);
+    return ret;
 }
 
 status_t NXCommandThread::checkEntry(const camera_metadata_entry_t &entry, uint8_t type, size_t count)
@@ -187,25 +183,11 @@ status_t NXCommandThread::handleRequest(camera_metadata_t *request)
                 break;
 
             case ANDROID_SCALER_CROP_REGION:
+                // zoom goes through doZoomChanged() in processCommand()
                 ret = checkEntry(curEntry, TYPE_INT32, 3);
                 if (ret == NO_ERROR)
-#if 0
                     for (i = 0; i < curEntry.count; i++)
                         ALOGV("crop %d: %d", i, curEntry.data.i32[i]);
-#else
-                {
-                    if (CropWidth != (unsigned int)curEntry.data.i32[2]) {
-                        CropWidth = curEntry.data.i32[2];
-                        int cropHeight = Sensor->getSensorH();
-                        cropHeight = (cropHeight*CropWidth)/Sensor->getSensorW();
-                        int left = curEntry.data.i32[0];
-                        int top = curEntry.data.i32[1];
-                        ALOGD("CROP===> left %d, top %d, w %d, h %d",
-                                left, top, CropWidth, cropHeight);
-                        Sensor->setZoomCrop(left, top, CropWidth, cropHeight);
-                    }
-                }
-#endif
                 break;
 
             case ANDROID_JPEG_QUALITY:
@@ -338,7 +320,7 @@ status_t NXCommandThread::handleRequest(camera_metadata_t *request)
             case ANDROID_REQUEST_ID:
                 ret = checkEntry(curEntry, TYPE_INT32, 1);
                 if (ret == NO_ERROR)
-                    ALOGV("request id: %d", curEntry.data.i32[i]);
+                    ALOGV("request id: %d", curEntry.data.i32[0]);
                 break;
 
             case ANDROID_REQUEST_METADATA_MODE:
@@ -520,7 +502,8 @@ status_t NXCommandThread::handleRequest(camera_metadata_t *request)
                 break;
 
             default:
-                ALOGE("Bad metadata tag(%s, 0x%x, type %d)", get_camera_metadata_tag_name(curEntry.tag),
+                // every request carries tags this hal ignores
+                ALOGV("unhandled metadata tag(%s, 0x%x, type %d)", get_camera_metadata_tag_name(curEntry.tag),
                         curEntry.tag, get_camera_metadata_tag_type(curEntry.tag));
                 break;
             }
@@ -531,7 +514,21 @@ status_t NXCommandThread::handleRequest(camera_metadata_t *request)
     return NO_ERROR;
 }
 
-void NXCommandThread::doListenersCallback(camera_metadata_entry_t &streams, camera_metadata_t *request)
+bool NXCommandThread::isRepeatedRequest(camera_metadata_entry_t &streams)
+{
+    uint32_t mask = 0;
+    for (uint32_t i = 0; i < streams.count; i++) {
+        int streamId = streams.data.i32[i];
+        if (streamId >= 0 && streamId < STREAM_ID_MAX)
+            mask |= 1 << streamId;
+    }
+    bool repeated = LastStreamsValid && mask == LastStreams;
+    LastStreams = mask;
+    LastStreamsValid = true;
+    return repeated;
+}
+
+void NXCommandThread::doListenersCallback(camera_metadata_entry_t &streams, camera_metadata_t *request, bool repeated)
 {
     Mutex::Autolock l(ListenerMutex);
     CommandListener *listener = NULL;
@@ -544,6 +541,11 @@ void NXCommandThread::doListenersCallback(camera_metadata_entry_t &streams, came
                 ALOGE("can't find command listener for stream id %d", streamId);
                 continue;
             }
+            // the stream already runs with this configuration and crop
+            if (repeated && listener->isCommandRedundant(streamId)) {
+                Coalesced++;
+                continue;
+            }
             listener->onCommand(streamId, request);
             if (CropLeft || CropTop)
                 listener->onZoomChanged(CropLeft, CropTop, CropWidth, CropHeight, Sensor->getSensorW(), Sensor->getSensorH());
@@ -591,16 +593,6 @@ void NXCommandThread::doExifChanged()
     }
 }
 
-void NXCommandThread::waitIdle()
-{
-    int count = 2;
-    while(IsIdle == false && count >= 0) {
-        ALOGD("waitIdle");
-        usleep(100000);
-        count--;
-    }
-}
-
 bool NXCommandThread::handleExif(camera_metadata_t *request)
 {
     bool changed = false;
@@ -734,6 +726,18 @@ bool NXCommandThread::handleExif(camera_metadata_t *request)
     return changed;
 }
 
+void NXCommandThread::submitControls()
+{
+    NXSensorControlSet set;
+    Sensor->endControls(set);
+    if (set.Count == 0)
+        return;
+    if (SensorControl != NULL)
+        SensorControl->submit(set);
+    else
+        Sensor->applyControls(set);
+}
+
 bool NXCommandThread::processCommand()
 {
     trace_in();
@@ -747,21 +751,15 @@ bool NXCommandThread::processCommand()
         if (!request) {
             ALOGE("request is NULL!!!");
             doListenersCallback();
-            IsIdle = true;
-            ALOGD("Exit processCommand");
+            LastStreamsValid = false;
+            ALOGD("Exit processCommand, %u commands coalesced", Coalesced);
             return true;
         }
 
-#if 0
-        sort_camera_metadata(request);
-        ret = handleRequest(request);
-#else
-        // camera_metadata_entry_t jpegEntry;
-        // ret = find_camera_metadata_entry(request, ANDROID_JPEG_ORIENTATION, &jpegEntry);
-        // if (ret == NO_ERROR) {
-        //     ALOGD("jpeg orientation: %d", jpegEntry.data.i32[0]);
-        // }
-#endif
+        // the setters of the request only collect their controls
+        Sensor->beginControls();
+        handleRequest(request);
+        submitControls();
 
         /* for zoom */
         camera_metadata_entry_t zoomEntry;
@@ -775,17 +773,20 @@ bool NXCommandThread::processCommand()
                     CropLeft, CropTop, CropWidth, CropHeight);
             // Sensor->setZoomCrop(left, top, CropWidth, cropHeight);
             doZoomChanged(CropLeft, CropTop, CropWidth, CropHeight, Sensor->getSensorW(), Sensor->getSensorH());
+            LastStreamsValid = false;
         }
 
-        if (handleExif(request))
+        if (handleExif(request)) {
             doExifChanged();
+            LastStreamsValid = false;
+        }
 
         camera_metadata_entry_t streams;
         ret = find_camera_metadata_entry(request, ANDROID_REQUEST_OUTPUT_STREAMS, &streams);
         if (ret != NO_ERROR)
             ALOGE("can't find streams request");
         else
-            doListenersCallback(streams, request);
+            doListenersCallback(streams, request, isRepeatedRequest(streams));
 
         RequestQueueSrcOps->free_request(RequestQueueSrcOps, request);
     }
@@ -10,6 +10,8 @@
 #include "Exif.h"
 #include "Constants.h"
 #include "NXCameraSensor.h"
+#include "NXCommandCompletion.h"
+#include "NXSensorControlThread.h"
 
 namespace android {
 
@@ -31,13 +33,31 @@ public:
         virtual void onExifChanged(exif_attribute_t *exif) {
             return;
         }
+        // true if a command repeating the previous request of the pass changes nothing
+        virtual bool isCommandRedundant(int32_t id) {
+            return false;
+        }
     };
 
     status_t registerListener(int32_t id, sp<CommandListener> listener);
     status_t removeListener(int32_t id);
 
-    void  wakeup();
-    void  waitIdle();
+    void wakeup();
+    // the request queue is drained and handed to the listeners
+    status_t waitIdle(nsecs_t timeout = COMMAND_COMPLETION_TIMEOUT);
+    int getInProgressCount() {
+        return Completion.inProgress();
+    }
+    virtual void requestExit();
+
+    NXCommandCompletion::Stats getCompletionStats() {
+        return Completion.getStats();
+    }
+
+    // writes the sensor controls of the requests, applied in place without it
+    void setSensorControl(sp<NXSensorControlThread> thread) {
+        SensorControl = thread;
+    }
 
     void  getCrop(uint32_t &cropLeft, uint32_t &cropTop, uint32_t &cropWidth, uint32_t &cropHeight, uint32_t &baseWidth, uint32_t &baseHeight) {
         cropLeft   = CropLeft;
@@ -56,21 +76,26 @@ private:
     // if exif attribute changed, return true, else return false
     bool handleExif(camera_metadata_t *request);
     bool processCommand();
-    void doListenersCallback(camera_metadata_entry_t &streams, camera_metadata_t *request);
+    // hands the controls the sensor setters collected for a request on
+    void submitControls();
+    void doListenersCallback(camera_metadata_entry_t &streams, camera_metadata_t *request, bool repeated);
+    bool isRepeatedRequest(camera_metadata_entry_t &streams);
     void doListenersCallback();
     void doZoomChanged(int left, int top, int width, int height, int baseWidth, int baseHeight);
     void doExifChanged();
 
 private:
-    Mutex  SignalMutex;
-    Condition SignalCondition;
+    NXCommandCompletion Completion;
 
-    bool IsIdle;
-    bool MsgReceived;
+    // output streams of the previous request in this pass
+    uint32_t LastStreams;
+    bool LastStreamsValid;
+    uint32_t Coalesced;
 
     // variables
     const camera2_request_queue_src_ops_t *RequestQueueSrcOps;
     NXCameraSensor *Sensor;
+    sp<NXSensorControlThread> SensorControl;
 
     Mutex ListenerMutex;
     KeyedVector<int32_t, sp<CommandListener> > CommandListeners;
@@ -1,5 +1,6 @@
 #define LOG_TAG "NXExifProcessor"
 
+#include <errno.h>
 #include <sys/types.h>
 
 #include <linux/videodev2.h>
@@ -23,6 +24,64 @@
 
 using namespace android;
 
+// app1 length is 16 bit and counts itself and the exif header
+#define EXIF_MAX_TIFF_SIZE  (0xffff - 2 - 6)
+#define EXIF_OUT_BUFFER_SIZE    (2 + 4 + 6 + EXIF_MAX_TIFF_SIZE)
+// a thumbnail over its room is encoded again this much lower, down to the minimum
+#define EXIF_THUMB_QUALITY_STEP 15
+#define EXIF_THUMB_MIN_QUALITY  30
+
+NXExifProcessor::NXExifProcessor()
+    : ZoomController(NULL),
+      ScalerSrcWidth(0),
+      ScalerSrcHeight(0),
+      ScalerDstWidth(0),
+      ScalerDstHeight(0),
+      Exif(NULL),
+      Width(0),
+      Height(0),
+      SrcBuffer(NULL),
+      SrcHandle(NULL),
+      DstHandle(NULL),
+      ScaleBuffer(NULL),
+      ScaleWidth(0),
+      ScaleHeight(0),
+      OutBuffer(NULL),
+      App1Start(NULL),
+      IfdStart(NULL),
+      NextIfdOffset(NULL),
+      ThumbLength(NULL),
+      ExifSizeExceptThumb(0),
+      ThumbOffset(0),
+      ThumbMaxSize(0),
+      ThumbnailJpegSize(0),
+      OutSize(0),
+      ReservedSize(0),
+      ThumbPending(false),
+      ThumbDone(true),
+      ThumbResult(false),
+      ThumbExit(false)
+{
+    memset(&Times, 0, sizeof(Times));
+}
+
+NXExifProcessor::~NXExifProcessor()
+{
+    if (Worker != NULL) {
+        {
+            Mutex::Autolock l(ThumbLock);
+            ThumbExit = true;
+            ThumbCondition.broadcast();
+        }
+        Worker->join();
+        Worker.clear();
+    }
+    freeOutBuffer();
+    freeScaleBuffer();
+    if (ZoomController)
+        delete ZoomController;
+}
+
 bool NXExifProcessor::preprocessExif()
 {
     // enableThumb
@@ -122,38 +181,33 @@ bool NXExifProcessor::preprocessExif()
 
 bool NXExifProcessor::allocScaleBuffer()
 {
+    if (ScaleBuffer) {
+        if (ScaleWidth == Exif->widthThumb && ScaleHeight == Exif->heightThumb)
+            return true;
+        freeScaleBuffer();
+    }
+
     ScaleBuffer = new nxp_vid_buffer;
     if (!ScaleBuffer) {
         ALOGE("can't new nxp_vid_buffer for scale!!!");
         return false;
     }
-    return allocateBuffer(ScaleBuffer, 1, Exif->widthThumb, Exif->heightThumb, PIXFORMAT_YUV420_PLANAR);
-}
-
-void NXExifProcessor::freeScaleBuffer()
-{
-    if (ScaleBuffer) {
-        freeBuffer(ScaleBuffer, 1);
+    if (!allocateBuffer(ScaleBuffer, 1, Exif->widthThumb, Exif->heightThumb, PIXFORMAT_YUV420_PLANAR)) {
         delete ScaleBuffer;
         ScaleBuffer = NULL;
-    }
-}
-
-bool NXExifProcessor::allocThumbnailBuffer()
-{
-    ThumbnailBuffer = new unsigned char[Exif->widthThumb * Exif->heightThumb * 4];
-    if (!ThumbnailBuffer) {
-        ALOGE("can't new thumbnail buffer(size %d)", Exif->widthThumb * Exif->heightThumb * 4);
         return false;
     }
+    ScaleWidth = Exif->widthThumb;
+    ScaleHeight = Exif->heightThumb;
     return true;
 }
 
-void NXExifProcessor::freeThumbnailBuffer()
+void NXExifProcessor::freeScaleBuffer()
 {
-    if (ThumbnailBuffer) {
-        delete[] ThumbnailBuffer;
-        ThumbnailBuffer = NULL;
+    if (ScaleBuffer) {
+        freeBuffer(ScaleBuffer, 1);
+        delete ScaleBuffer;
+        ScaleBuffer = NULL;
     }
 }
 
@@ -163,32 +217,58 @@ bool NXExifProcessor::scaleDown()
         ALOGE("scaleDown() : can't get SrcBuffer or SrcHandle!!!");
         return false;
     }
-    ZoomController = new ScalerZoomController(0, 0, Width, Height, Width, Height, Exif->widthThumb, Exif->heightThumb);
+
+    // the scaler context lives as long as the source and thumbnail sizes
+    if (ZoomController && (ScalerSrcWidth != Width || ScalerSrcHeight != Height ||
+                ScalerDstWidth != ScaleWidth || ScalerDstHeight != ScaleHeight)) {
+        delete ZoomController;
+        ZoomController = NULL;
+    }
     if (!ZoomController) {
-        ALOGE("can't create ZoomController");
-        return false;
+        ZoomController = new ScalerZoomController(0, 0, Width, Height, Width, Height, ScaleWidth, ScaleHeight);
+        if (!ZoomController) {
+            ALOGE("can't create ZoomController");
+            return false;
+        }
+        ZoomController->useDefault();
+        ZoomController->setFormat(PIXCODE_YUV420_PLANAR, PIXCODE_YUV420_PLANAR);
+        ScalerSrcWidth = Width;
+        ScalerSrcHeight = Height;
+        ScalerDstWidth = ScaleWidth;
+        ScalerDstHeight = ScaleHeight;
     }
-    ZoomController->useDefault();
-    ZoomController->setFormat(PIXCODE_YUV420_PLANAR, PIXCODE_YUV420_PLANAR);
-    bool ret = false;
+
     if (SrcBuffer)
-        ret =  ZoomController->handleZoom(const_cast<nxp_vid_buffer*>(SrcBuffer), ScaleBuffer);
-    else if (SrcHandle)
-        ret =  ZoomController->handleZoom(SrcHandle, ScaleBuffer);
-    delete ZoomController;
-    ZoomController = NULL;
-    return ret;
+        return ZoomController->handleZoom(const_cast<nxp_vid_buffer*>(SrcBuffer), ScaleBuffer);
+    return ZoomController->handleZoom(SrcHandle, ScaleBuffer);
 }
 
+/* encodes straight into its place behind the 1th ifd, a thumbnail too
+ * large for it is encoded again at a lower quality */
 bool NXExifProcessor::encodeThumb()
 {
-    int jpegSize = NX_JpegHWEncoding(ThumbnailBuffer, Exif->widthThumb * Exif->heightThumb * 4,
-            Exif->widthThumb, Exif->heightThumb, FOURCC_MVS0,
-            ScaleBuffer->phys[0], reinterpret_cast<unsigned int>(ScaleBuffer->virt[0]), Exif->widthThumb,
-            ScaleBuffer->phys[1], reinterpret_cast<unsigned int>(ScaleBuffer->virt[1]), Exif->widthThumb >> 1,
-            ScaleBuffer->phys[2], reinterpret_cast<unsigned int>(ScaleBuffer->virt[2]), Exif->widthThumb >> 1);
+    int quality = Exif->thumbnailQuality;
+    int jpegSize;
+    for (;;) {
+        if (ThumbEncoder.open(Exif->widthThumb, Exif->heightThumb, quality) < 0) {
+            ALOGE("encodeThumb(): failed to open jpeg encoder!!!");
+            return false;
+        }
+        jpegSize = ThumbEncoder.encode(IfdStart + ThumbOffset, ThumbMaxSize, FOURCC_MVS0,
+                ScaleBuffer->phys[0], reinterpret_cast<uintptr_t>(ScaleBuffer->virt[0]), Exif->widthThumb,
+                ScaleBuffer->phys[1], reinterpret_cast<uintptr_t>(ScaleBuffer->virt[1]), Exif->widthThumb >> 1,
+                ScaleBuffer->phys[2], reinterpret_cast<uintptr_t>(ScaleBuffer->virt[2]), Exif->widthThumb >> 1);
+        if (jpegSize != -ENOSPC || quality <= EXIF_THUMB_MIN_QUALITY)
+            break;
+        int lower = quality - EXIF_THUMB_QUALITY_STEP;
+        if (lower < EXIF_THUMB_MIN_QUALITY)
+            lower = EXIF_THUMB_MIN_QUALITY;
+        ALOGW("encodeThumb(): %dx%d thumbnail over %u bytes at quality %d, trying %d",
+                Exif->widthThumb, Exif->heightThumb, ThumbMaxSize, quality, lower);
+        quality = lower;
+    }
     if (jpegSize <= 0) {
-        ALOGE("encodeThumb(): failed to NX_JpegHWEncoding()!!!");
+        ALOGE("encodeThumb(): failed to encode thumbnail(%d)!!!", jpegSize);
         return false;
     }
     ThumbnailJpegSize = jpegSize;
@@ -196,23 +276,70 @@ bool NXExifProcessor::encodeThumb()
     return true;
 }
 
-bool NXExifProcessor::allocOutBuffer()
+void NXExifProcessor::releaseThumbnailEncoder()
+{
+    waitThumbnail();
+    ThumbEncoder.close();
+}
+
+bool NXExifProcessor::makeThumbnail()
 {
-    uint32_t outBufSize = EXIF_FILE_SIZE;
-    if (Exif->enableThumb)
-        outBufSize += ThumbnailJpegSize;
+    nsecs_t start = systemTime(SYSTEM_TIME_MONOTONIC);
+    if (!scaleDown()) {
+        ALOGE("failed to scaleDown()!!!");
+        return false;
+    }
+    nsecs_t scaled = systemTime(SYSTEM_TIME_MONOTONIC);
+    Times.scale = scaled - start;
+
+    bool ret = encodeThumb();
+    Times.thumbEncode = systemTime(SYSTEM_TIME_MONOTONIC) - scaled;
+    return ret;
+}
 
+bool NXExifProcessor::thumbnailLoop()
+{
+    ThumbLock.lock();
+    while (!ThumbPending && !ThumbExit)
+        ThumbCondition.wait(ThumbLock);
+    if (ThumbExit) {
+        ThumbLock.unlock();
+        return false;
+    }
+    ThumbPending = false;
+    ThumbLock.unlock();
+
+    bool ret = makeThumbnail();
+
+    Mutex::Autolock l(ThumbLock);
+    ThumbResult = ret;
+    ThumbDone = true;
+    ThumbCondition.broadcast();
+    return true;
+}
+
+bool NXExifProcessor::waitThumbnail()
+{
+    Mutex::Autolock l(ThumbLock);
+    while (!ThumbDone)
+        ThumbCondition.wait(ThumbLock);
+    return ThumbResult;
+}
+
+bool NXExifProcessor::allocOutBuffer()
+{
     if (!DstHandle) {
-        OutBuffer = new unsigned char[outBufSize];
+        OutBuffer = new unsigned char[EXIF_OUT_BUFFER_SIZE];
         if (!OutBuffer) {
-            ALOGE("failed to allocate Exif Out Buffer(size %u)", outBufSize);
+            ALOGE("failed to allocate Exif Out Buffer(size %u)", EXIF_OUT_BUFFER_SIZE);
             return false;
         }
     } else {
         OutBuffer = reinterpret_cast<unsigned char *>(DstHandle->base);
     }
 
-    memset(OutBuffer, 0, outBufSize);
+    // the thumbnail is written whole, only the ifd area needs clearing
+    memset(OutBuffer, 0, EXIF_FILE_SIZE);
     return true;
 }
 
@@ -226,7 +353,7 @@ void NXExifProcessor::freeOutBuffer()
 bool NXExifProcessor::processExif()
 {
     unsigned char *pCur, *pApp1Start, *pIfdStart, *pGpsIfdPtr, *pNextIfdOffset;
-    unsigned int tmp, LongerTagOffset = 0, exifSizeExceptThumb;
+    unsigned int tmp, LongerTagOffset = 0;
 
     pApp1Start = pCur = OutBuffer;
 
@@ -360,10 +487,13 @@ bool NXExifProcessor::processExif()
         pCur += OFFSET_SIZE;
     }
 
-    // 1th IFD TIFF
-    int iThumbFd = 0;
-    if (Exif->enableThumb && ThumbnailBuffer && ThumbnailJpegSize) {
-        exifSizeExceptThumb = tmp = LongerTagOffset;
+    // 1th IFD TIFF, the thumbnail and the app1 size are filled by closeExif()
+    ExifSizeExceptThumb = LongerTagOffset;
+    ThumbOffset = 0;
+    ThumbMaxSize = 0;
+    ThumbLength = NULL;
+    if (Exif->enableThumb) {
+        tmp = LongerTagOffset;
         memcpy(pNextIfdOffset, &tmp, OFFSET_SIZE);
 
         pCur = pIfdStart + LongerTagOffset;
@@ -382,38 +512,71 @@ bool NXExifProcessor::processExif()
         writeExifIfd(pCur, EXIF_TAG_Y_RESOLUTION, EXIF_TYPE_RATIONAL, 1, &Exif->y_resolution, LongerTagOffset, pIfdStart);
         writeExifIfd(pCur, EXIF_TAG_RESOLUTION_UNIT, EXIF_TYPE_SHORT, 1, Exif->resolution_unit);
         writeExifIfd(pCur, EXIF_TAG_JPEG_INTERCHANGE_FORMAT, EXIF_TYPE_LONG, 1, LongerTagOffset);
+        ThumbLength = pCur + 8; // value of the next entry
         writeExifIfd(pCur, EXIF_TAG_JPEG_INTERCHANGE_FORMAT_LEN, EXIF_TYPE_LONG, 1, ThumbnailJpegSize);
 
         tmp = 0;
         memcpy(pCur, &tmp, OFFSET_SIZE);
         pCur += OFFSET_SIZE;
 
-        memcpy(pIfdStart + LongerTagOffset, ThumbnailBuffer, ThumbnailJpegSize);
-        LongerTagOffset += ThumbnailJpegSize;
-        if (LongerTagOffset > EXIF_LIMIT_SIZE) {
-            LongerTagOffset = exifSizeExceptThumb;
-            tmp = 0;
-            memcpy(pNextIfdOffset, &tmp, OFFSET_SIZE);
+        if (LongerTagOffset < EXIF_MAX_TIFF_SIZE) {
+            ThumbOffset = LongerTagOffset;
+            ThumbMaxSize = Exif->widthThumb * Exif->heightThumb;
+            if (ThumbMaxSize > EXIF_MAX_TIFF_SIZE - ThumbOffset)
+                ThumbMaxSize = EXIF_MAX_TIFF_SIZE - ThumbOffset;
         }
     } else {
         tmp = 0;
         memcpy(pNextIfdOffset, &tmp, OFFSET_SIZE);
     }
 
+    App1Start = pApp1Start;
+    IfdStart = pIfdStart;
+    NextIfdOffset = pNextIfdOffset;
+
+    // the main image goes behind the largest thumbnail that fits
+    ReservedSize = (pIfdStart - OutBuffer) + ExifSizeExceptThumb;
+    if (ThumbOffset)
+        ReservedSize = (pIfdStart - OutBuffer) + ThumbOffset + ThumbMaxSize;
+
+    return true;
+}
+
+void NXExifProcessor::closeExif(bool toReserved)
+{
+    nsecs_t start = systemTime(SYSTEM_TIME_MONOTONIC);
+    unsigned int tmp, tiffSize = ExifSizeExceptThumb;
+    uint32_t headerSize = IfdStart - OutBuffer;
+
+    if (ThumbOffset && ThumbnailJpegSize > 0) {
+        tmp = ThumbnailJpegSize;
+        memcpy(ThumbLength, &tmp, 4);
+        tiffSize = ThumbOffset + ThumbnailJpegSize;
+    } else if (Exif->enableThumb) {
+        // no thumbnail after all, drop the 1th ifd
+        ALOGE("no thumbnail fits in %u bytes, exif without it", ThumbMaxSize);
+        tmp = 0;
+        memcpy(NextIfdOffset, &tmp, OFFSET_SIZE);
+    }
+
+    if (toReserved && headerSize + tiffSize < ReservedSize) {
+        // the main image is already behind the reservation, the rest of it
+        // stays in the segment as padding
+        memset(IfdStart + tiffSize, 0, ReservedSize - headerSize - tiffSize);
+        tiffSize = ReservedSize - headerSize;
+    }
+    OutSize = headerSize + tiffSize;
+
     // APP1 Marker
-    memcpy(pApp1Start, exif_attribute_t::kApp1Marker, 2);
-    pApp1Start += 2;
+    memcpy(App1Start, exif_attribute_t::kApp1Marker, 2);
 
-    // APP1 Data Size
-    tmp = 10 + LongerTagOffset - 2;
+    // APP1 Data Size: length field + Exif Header + TIFF
+    tmp = 2 + 6 + tiffSize;
     unsigned char app_data_size[2] = {(tmp >> 8) & 0xFF, tmp & 0xFF};
-    memcpy(pApp1Start, app_data_size, 2);
+    memcpy(App1Start + 2, app_data_size, 2);
 
-    // calc OutSize
-    OutSize = 2 + 2 + 2 + 6 + LongerTagOffset; // SOI + APP1 Marker + APP1 Size + Exif Header + TIFF
-    ALOGD("OutSize: %d, TIFF Size: %d", OutSize, LongerTagOffset);
-
-    return true;
+    Times.assemble = systemTime(SYSTEM_TIME_MONOTONIC) - start;
+    ALOGD("OutSize: %d, TIFF Size: %d", OutSize, tiffSize);
 }
 
 bool NXExifProcessor::postprocessExif()
@@ -421,67 +584,86 @@ bool NXExifProcessor::postprocessExif()
     return true;
 }
 
-NXExifProcessor::ExifResult NXExifProcessor::makeExif()
+bool NXExifProcessor::startExif()
 {
-    bool ret = true;
+    nsecs_t start = systemTime(SYSTEM_TIME_MONOTONIC);
 
-    ALOGD("makeExif() entered");
-    ret = preprocessExif();
-    if (!ret) {
+    memset(&Times, 0, sizeof(Times));
+    ThumbnailJpegSize = 0;
+
+    if (!preprocessExif()) {
         ALOGE("failed to preprocessExif()!!!");
-        return errorOut();
+        return false;
     }
 
-    if (Exif->enableThumb) {
-        ret = allocScaleBuffer();
-        if (!ret) {
-            ALOGE("failed to allocScaleBuffer()!!!");
-            return errorOut();
-        }
+    if (Exif->enableThumb && !allocScaleBuffer()) {
+        ALOGE("failed to allocScaleBuffer()!!!");
+        return false;
+    }
 
-        ret = allocThumbnailBuffer();
-        if (!ret) {
-            ALOGE("failed to allocThumbnailBuffer()!!!");
-            return errorOut();
-        }
+    if (!allocOutBuffer()) {
+        ALOGE("failed to allocOutBuffer()!!!");
+        return false;
+    }
 
-        ret = scaleDown();
-        if (!ret) {
-            ALOGE("failed to scaleDown()!!!");
-            return errorOut();
-        }
+    if (!processExif()) {
+        ALOGE("failed to processExif()!!!");
+        freeOutBuffer();
+        return false;
+    }
+    Times.layout = systemTime(SYSTEM_TIME_MONOTONIC) - start;
 
-        ret = encodeThumb();
-        if (!ret) {
-            ALOGE("failed to encodeThumb()!!!");
-            return errorOut();
+    if (ThumbOffset) {
+        if (Worker == NULL) {
+            Worker = new ThumbnailThread(this);
+            Worker->run("NXExifThumbnail");
         }
+        Mutex::Autolock l(ThumbLock);
+        ThumbDone = false;
+        ThumbPending = true;
+        ThumbCondition.broadcast();
     }
+    return true;
+}
 
-    ret = allocOutBuffer();
-    if (!ret) {
-        ALOGE("failed to allocOutBuffer()!!!");
-        return errorOut();
-    }
+bool NXExifProcessor::startExif(
+        uint32_t width,
+        uint32_t height,
+        const struct nxp_vid_buffer *srcBuffer,
+        exif_attribute_t *exif,
+        private_handle_t const *dstHandle)
+{
+    Exif = exif;
+    Width = width;
+    Height = height;
+    SrcBuffer = srcBuffer;
+    SrcHandle = NULL;
+    DstHandle = dstHandle;
+    return startExif();
+}
 
-    ret = processExif();
-    if (!ret) {
-        ALOGE("failed to processExif()!!!");
-        return errorOut();
+NXExifProcessor::ExifResult NXExifProcessor::finishExif()
+{
+    if (!OutBuffer) {
+        ALOGE("finishExif() without startExif()!!!");
+        return ExifResult(NULL, 0);
     }
 
-    ret = postprocessExif();
-    if (!ret) {
+    nsecs_t start = systemTime(SYSTEM_TIME_MONOTONIC);
+    waitThumbnail();
+    Times.wait = systemTime(SYSTEM_TIME_MONOTONIC) - start;
+
+    closeExif(true);
+
+    if (!postprocessExif()) {
         ALOGE("failed to postprocessExif()!!!");
         return errorOut();
     }
 
-    freeThumbnailBuffer();
-    freeScaleBuffer();
-
-    ALOGD("makeExif() exit");
-
-    return NXExifProcessor::ExifResult(OutBuffer, OutSize);
+    ALOGD("exif: layout %lldus, scale %lldus, thumb %lldus, wait %lldus, assemble %lldus",
+            Times.layout / 1000, Times.scale / 1000, Times.thumbEncode / 1000,
+            Times.wait / 1000, Times.assemble / 1000);
+    return ExifResult(OutBuffer, OutSize);
 }
 
 NXExifProcessor::ExifResult NXExifProcessor::makeExif(
@@ -497,7 +679,17 @@ NXExifProcessor::ExifResult NXExifProcessor::makeExif(
     SrcBuffer = srcBuffer;
     SrcHandle = NULL;
     DstHandle = dstHandle;
-    return makeExif();
+
+    if (!startExif())
+        return errorOut();
+
+    waitThumbnail();
+    closeExif();
+    if (!postprocessExif()) {
+        ALOGE("failed to postprocessExif()!!!");
+        return errorOut();
+    }
+    return ExifResult(OutBuffer, OutSize);
 }
 
 NXExifProcessor::ExifResult NXExifProcessor::makeExif(
@@ -513,5 +705,15 @@ NXExifProcessor::ExifResult NXExifProcessor::makeExif(
     SrcHandle = srcHandle;
     SrcBuffer = NULL;
     DstHandle = dstHandle;
-    return makeExif();
+
+    if (!startExif())
+        return errorOut();
+
+    waitThumbnail();
+    closeExif();
+    if (!postprocessExif()) {
+        ALOGE("failed to postprocessExif()!!!");
+        return errorOut();
+    }
+    return ExifResult(OutBuffer, OutSize);
 }
@@ -1,8 +1,13 @@
 #ifndef _NX_EXIF_PROCESSOR_H
 #define _NX_EXIF_PROCESSOR_H
 
+#include <utils/Thread.h>
+#include <utils/Mutex.h>
+#include <utils/Condition.h>
+#include <utils/Timers.h>
 #include <nxp-v4l2.h>
 #include <gralloc_priv.h>
+#include <libnxjpeghw.h>
 #include "Exif.h"
 #include "NXZoomController.h"
 
@@ -33,23 +38,17 @@ public:
             uint32_t Size;
     };
 
-    NXExifProcessor()
-        : ZoomController(NULL),
-          Exif(NULL),
-          Width(0),
-          Height(0),
-          SrcBuffer(NULL),
-          SrcHandle(NULL),
-          DstHandle(NULL),
-          ScaleBuffer(NULL),
-          ThumbnailBuffer(NULL),
-          OutBuffer(NULL),
-          ThumbnailJpegSize(0),
-          OutSize(0)
-    {
-    }
-    virtual ~NXExifProcessor() {
-    }
+    // time spent per stage of the last exif, in ns
+    struct Timing {
+        nsecs_t layout;       // ifds written
+        nsecs_t scale;        // thumbnail scale down
+        nsecs_t thumbEncode;  // thumbnail jpeg encode
+        nsecs_t wait;         // finishExif() blocked on the thumbnail
+        nsecs_t assemble;     // app1 closed
+    };
+
+    NXExifProcessor();
+    virtual ~NXExifProcessor();
 
     virtual ExifResult makeExif(
             uint32_t width,
@@ -64,6 +63,29 @@ public:
             exif_attribute_t *exif,
             private_handle_t const *dstHandle = NULL);
 
+    // two step exif: startExif() lays out the app1 segment in dstHandle and
+    // makes the thumbnail in the background, the caller encodes the main image
+    // at getReservedSize() meanwhile and finishExif() closes the segment. It
+    // always ends at getReservedSize(), what the thumbnail leaves of the
+    // reservation is padding inside app1, so the main image stays where it is
+    virtual bool startExif(
+            uint32_t width,
+            uint32_t height,
+            const struct nxp_vid_buffer *srcBuffer,
+            exif_attribute_t *exif,
+            private_handle_t const *dstHandle);
+    virtual ExifResult finishExif();
+
+    uint32_t getReservedSize() const {
+        return ReservedSize;
+    }
+    const Timing &getTiming() const {
+        return Times;
+    }
+
+    // closes the thumbnail encoder instance, reopened by the next exif
+    void releaseThumbnailEncoder();
+
     virtual void clear() {
         freeOutBuffer();
         Width = Height = 0;
@@ -71,11 +93,32 @@ public:
         SrcHandle = NULL;
         DstHandle = NULL;
         OutSize = 0;
+        ReservedSize = 0;
         ThumbnailJpegSize = 0;
     }
 
 private:
-    NXZoomController *ZoomController;
+    class ThumbnailThread : public Thread
+    {
+    public:
+        ThumbnailThread(NXExifProcessor *parent)
+            : Thread(false),
+              Parent(parent) {
+        }
+    private:
+        virtual bool threadLoop() {
+            return Parent->thumbnailLoop();
+        }
+        NXExifProcessor *Parent;
+    };
+
+private:
+    NXZoomController *ZoomController; // thumbnail scaler, kept while the sizes don't change
+    uint32_t ScalerSrcWidth;
+    uint32_t ScalerSrcHeight;
+    uint32_t ScalerDstWidth;
+    uint32_t ScalerDstHeight;
+    NXJpegHWEncoder ThumbEncoder;
 
     exif_attribute_t *Exif;
     uint32_t Width;
@@ -85,30 +128,53 @@ private:
     private_handle_t const *DstHandle;
 
     struct nxp_vid_buffer *ScaleBuffer;
-    unsigned char *ThumbnailBuffer;
+    uint32_t ScaleWidth;
+    uint32_t ScaleHeight;
     unsigned char *OutBuffer;
 
+    // layout of the app1 segment in OutBuffer
+    unsigned char *App1Start;
+    unsigned char *IfdStart;
+    unsigned char *NextIfdOffset;
+    unsigned char *ThumbLength;   // value of the 1th ifd thumbnail length tag
+    uint32_t ExifSizeExceptThumb; // from IfdStart
+    uint32_t ThumbOffset;         // from IfdStart, 0: no thumbnail
+    uint32_t ThumbMaxSize;
+
     uint32_t ThumbnailJpegSize;
     uint32_t OutSize;
+    uint32_t ReservedSize;
+
+    sp<ThumbnailThread> Worker;
+    Mutex ThumbLock; // for ThumbPending, ThumbDone, ThumbResult, ThumbExit
+    Condition ThumbCondition;
+    bool ThumbPending;
+    bool ThumbDone;
+    bool ThumbResult;
+    bool ThumbExit;
+
+    Timing Times;
 
 private:
-    virtual ExifResult makeExif();
+    virtual bool startExif();
     virtual bool preprocessExif();
     virtual bool allocScaleBuffer();
     virtual void freeScaleBuffer();
-    virtual bool allocThumbnailBuffer();
-    virtual void freeThumbnailBuffer();
     virtual bool scaleDown();
     virtual bool encodeThumb();
     virtual bool allocOutBuffer();
     virtual void freeOutBuffer();
     virtual bool processExif();
+    // toReserved: the segment runs up to ReservedSize
+    virtual void closeExif(bool toReserved = false);
     virtual bool postprocessExif();
+    bool makeThumbnail();
+    bool thumbnailLoop();
+    bool waitThumbnail();
 
     // common inline functions
     ExifResult errorOut() {
-        freeThumbnailBuffer();
-        freeScaleBuffer();
+        waitThumbnail();
         freeOutBuffer();
         return ExifResult(NULL, 0);
     }
@@ -0,0 +1,69 @@
+#define LOG_TAG "NXFrameHandoff"
+
+#include <string.h>
+#include <utils/Log.h>
+
+#include "NXFrameHandoff.h"
+
+namespace android {
+
+NXFrameHandoff::NXFrameHandoff()
+    : LastTaken(0),
+      Aborted(false)
+{
+    memset(&Pending, 0, sizeof(Pending));
+    memset(&Statistics, 0, sizeof(Statistics));
+}
+
+void NXFrameHandoff::publish(private_handle_t const *handle, int width, int height, nsecs_t timestamp)
+{
+    Mutex::Autolock l(Lock);
+    if (Pending.Sequence != LastTaken) {
+        Statistics.dropped++;
+        ALOGV("drop frame %u", Pending.Sequence);
+    }
+    Pending.Sequence++;
+    Pending.Handle = handle;
+    Pending.Width = width;
+    Pending.Height = height;
+    Pending.Timestamp = timestamp;
+    Statistics.published++;
+    Aborted = false;
+    FrameAvailable.signal();
+}
+
+status_t NXFrameHandoff::take(Frame &frame, nsecs_t timeout)
+{
+    Mutex::Autolock l(Lock);
+    while (Pending.Sequence == LastTaken && !Aborted) {
+        if (FrameAvailable.waitRelative(Lock, timeout) == TIMED_OUT)
+            return TIMED_OUT;
+    }
+    if (Aborted) {
+        Aborted = false;
+        return DEAD_OBJECT;
+    }
+    frame = Pending;
+    LastTaken = Pending.Sequence;
+    Statistics.delivered++;
+    return NO_ERROR;
+}
+
+void NXFrameHandoff::abort()
+{
+    Mutex::Autolock l(Lock);
+    if (Pending.Sequence != LastTaken) {
+        Statistics.dropped++;
+        LastTaken = Pending.Sequence;
+    }
+    Aborted = true;
+    FrameAvailable.broadcast();
+}
+
+NXFrameHandoff::Stats NXFrameHandoff::getStats()
+{
+    Mutex::Autolock l(Lock);
+    return Statistics;
+}
+
+}; // namespace
@@ -0,0 +1,58 @@
+#ifndef _NX_FRAME_HANDOFF_H
+#define _NX_FRAME_HANDOFF_H
+
+#include <utils/RefBase.h>
+#include <utils/Mutex.h>
+#include <utils/Condition.h>
+#include <utils/Timers.h>
+#include <gralloc_priv.h>
+
+namespace android {
+
+// Single slot mailbox from a producing stream thread to one consumer.
+// The producer publishes every frame it enqueues and never blocks; a frame
+// the consumer has not taken yet is replaced by the newer one and counted as
+// dropped. The consumer sleeps until a frame with a newer sequence number
+// arrives, so each frame is delivered at most once.
+class NXFrameHandoff : public virtual RefBase
+{
+public:
+    struct Frame {
+        uint32_t Sequence; // starts at 1, 0 means no frame
+        private_handle_t const *Handle;
+        int Width;
+        int Height;
+        nsecs_t Timestamp;
+    };
+
+    struct Stats {
+        uint32_t published;
+        uint32_t delivered;
+        uint32_t dropped;   // replaced before the consumer took them
+    };
+
+    NXFrameHandoff();
+    virtual ~NXFrameHandoff() {
+    }
+
+    void publish(private_handle_t const *handle, int width, int height, nsecs_t timestamp);
+    // waits for a frame newer than the last one taken
+    // returns NO_ERROR, TIMED_OUT or DEAD_OBJECT after abort()
+    status_t take(Frame &frame, nsecs_t timeout);
+    // wakes the consumer, the pending frame is dropped
+    void abort();
+
+    Stats getStats();
+
+private:
+    Mutex Lock;
+    Condition FrameAvailable;
+    Frame Pending;
+    uint32_t LastTaken;
+    bool Aborted;
+    Stats Statistics;
+};
+
+}; // namespace
+
+#endif
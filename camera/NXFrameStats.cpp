@@ -0,0 +1,181 @@
+#define LOG_TAG "NXFrameStats"
+
+#include <stdlib.h>
+#include <string.h>
+#include <utils/Log.h>
+#include <utils/Atomic.h>
+
+#include "NXFrameStats.h"
+
+#define FRAME_STATS_RING_MASK   (FRAME_STATS_RING_SIZE - 1)
+
+namespace android {
+
+static const char *StageName[NXFrameStats::STAGE_MAX] = {
+    "sensor", "dqbuf", "process", "enqueue", "qbuf"
+};
+
+NXFrameStats::NXFrameStats()
+{
+    memset(Ring, 0, sizeof(Ring));
+    WritePos = 0;
+    Frames = 0;
+    Drops = 0;
+    Skips = 0;
+    LastFrameTime = 0;
+    Interval = 0;
+    IntervalCount = 0;
+}
+
+void NXFrameStats::commit(const Sample &sample)
+{
+    int32_t pos = WritePos;
+    Slot &slot = Ring[pos & FRAME_STATS_RING_MASK];
+
+    // invalidate the slot first so a reader never mixes two frames
+    android_atomic_release_store(0, &slot.Sequence);
+    android_memory_barrier();
+    slot.Frame = sample;
+    android_atomic_release_store(pos + 1, &slot.Sequence);
+    android_atomic_release_store(pos + 1, &WritePos);
+    android_atomic_inc(&Frames);
+
+    // a gap of more than 1.5 regular intervals is frames the sensor side lost
+    nsecs_t t = sample.Stage[STAGE_SENSOR] ? sample.Stage[STAGE_SENSOR] : sample.Stage[STAGE_DQBUF];
+    if (LastFrameTime && t > LastFrameTime) {
+        nsecs_t gap = t - LastFrameTime;
+        if (IntervalCount >= 8 && gap > Interval * 3 / 2) {
+            countDrop((gap + Interval / 2) / Interval - 1);
+        } else {
+            Interval = IntervalCount ? (Interval * 7 + gap) / 8 : gap;
+            IntervalCount++;
+        }
+    }
+    LastFrameTime = t;
+}
+
+void NXFrameStats::countDrop(uint32_t frames)
+{
+    android_atomic_add(frames, &Drops);
+}
+
+void NXFrameStats::countSkip()
+{
+    android_atomic_inc(&Skips);
+    // the skipped frame isn't committed, don't take the gap for a drop
+    LastFrameTime = 0;
+}
+
+void NXFrameStats::reset()
+{
+    // a restarted stream starts a new window, the old frames would skew fps
+    android_atomic_release_store(0, &WritePos);
+    for (int i = 0; i < FRAME_STATS_RING_SIZE; i++)
+        android_atomic_release_store(0, &Ring[i].Sequence);
+    android_atomic_release_store(0, &Frames);
+    android_atomic_release_store(0, &Drops);
+    android_atomic_release_store(0, &Skips);
+    LastFrameTime = 0;
+    Interval = 0;
+    IntervalCount = 0;
+}
+
+size_t NXFrameStats::snapshot(Sample *samples, size_t maxSamples)
+{
+    int32_t head = android_atomic_acquire_load(&WritePos);
+    int32_t pos = head > FRAME_STATS_RING_SIZE ? head - FRAME_STATS_RING_SIZE : 0;
+    size_t count = 0;
+
+    for (; pos != head && count < maxSamples; pos++) {
+        Slot &slot = Ring[pos & FRAME_STATS_RING_MASK];
+        if (android_atomic_acquire_load(&slot.Sequence) != pos + 1)
+            continue; // being written or already overwritten
+        samples[count] = slot.Frame;
+        android_memory_barrier();
+        if (slot.Sequence != pos + 1)
+            continue;
+        count++;
+    }
+    return count;
+}
+
+static int compareTime(const void *a, const void *b)
+{
+    nsecs_t l = *(const nsecs_t *)a;
+    nsecs_t r = *(const nsecs_t *)b;
+    return l < r ? -1 : (l > r ? 1 : 0);
+}
+
+void NXFrameStats::dumpLatency(String8 &result, const char *label, const Sample *samples, size_t count, int from, int to)
+{
+    nsecs_t deltas[FRAME_STATS_RING_SIZE];
+    size_t n = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        nsecs_t start = samples[i].Stage[from];
+        nsecs_t end = samples[i].Stage[to];
+        if (start && end >= start)
+            deltas[n++] = end - start;
+    }
+    if (n == 0)
+        return;
+
+    qsort(deltas, n, sizeof(nsecs_t), compareTime);
+    result.appendFormat("    %-18s p50 %6.2fms  p90 %6.2fms  p99 %6.2fms  max %6.2fms\n", label,
+            deltas[n * 50 / 100] / 1000000.0, deltas[n * 90 / 100] / 1000000.0,
+            deltas[n * 99 / 100] / 1000000.0, deltas[n - 1] / 1000000.0);
+}
+
+void NXFrameStats::dump(String8 &result, const char *name)
+{
+    Sample *samples = new Sample[FRAME_STATS_RING_SIZE];
+    size_t count = snapshot(samples, FRAME_STATS_RING_SIZE);
+
+    double fps = 0;
+    if (count > 1) {
+        nsecs_t span = samples[count - 1].Stage[STAGE_DQBUF] - samples[0].Stage[STAGE_DQBUF];
+        if (span > 0)
+            fps = (count - 1) * 1000000000.0 / span;
+    }
+
+    result.appendFormat("  %s: %d frames, %.1f fps (last %u), %d dropped, %d skipped\n", name,
+            android_atomic_acquire_load(&Frames), fps, (unsigned)count,
+            android_atomic_acquire_load(&Drops), android_atomic_acquire_load(&Skips));
+    dumpLatency(result, "sensor->enqueue", samples, count, STAGE_SENSOR, STAGE_ENQUEUE);
+    dumpLatency(result, "dqbuf->process", samples, count, STAGE_DQBUF, STAGE_PROCESS);
+    dumpLatency(result, "process->enqueue", samples, count, STAGE_PROCESS, STAGE_ENQUEUE);
+    dumpLatency(result, "dqbuf->enqueue", samples, count, STAGE_DQBUF, STAGE_ENQUEUE);
+    dumpLatency(result, "enqueue->qbuf", samples, count, STAGE_ENQUEUE, STAGE_QBUF);
+
+    delete[] samples;
+}
+
+void NXFrameStats::writeTrace(FILE *fp, int pid, int tid, const char *name, bool &first)
+{
+    Sample *samples = new Sample[FRAME_STATS_RING_SIZE];
+    size_t count = snapshot(samples, FRAME_STATS_RING_SIZE);
+
+    fprintf(fp, "%s  {\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+            first ? "" : ",\n", pid, tid, name);
+    first = false;
+
+    // one slice per stage, from the previous stage the frame went through
+    for (size_t i = 0; i < count; i++) {
+        const Sample &s = samples[i];
+        int prev = -1;
+        for (int stage = STAGE_SENSOR; stage < STAGE_MAX; stage++) {
+            if (!s.Stage[stage])
+                continue;
+            if (prev >= 0 && s.Stage[stage] >= s.Stage[prev]) {
+                fprintf(fp, ",\n  {\"name\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                        StageName[stage], pid, tid, s.Stage[prev] / 1000.0,
+                        (s.Stage[stage] - s.Stage[prev]) / 1000.0);
+            }
+            prev = stage;
+        }
+    }
+
+    delete[] samples;
+}
+
+}; // namespace
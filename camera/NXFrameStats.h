@@ -0,0 +1,78 @@
+#ifndef _NX_FRAME_STATS_H
+#define _NX_FRAME_STATS_H
+
+#include <stdio.h>
+#include <utils/RefBase.h>
+#include <utils/Timers.h>
+#include <utils/String8.h>
+
+#define FRAME_STATS_RING_SIZE   256 // power of 2
+
+namespace android {
+
+// Per frame stage times of one stream thread.
+// The stream thread fills a Sample while it handles a frame and commits it
+// to a ring that readers copy without taking a lock: a slot is complete
+// when its sequence number matches its position, the writer clears the
+// sequence number before it rewrites the slot.
+class NXFrameStats : public virtual RefBase
+{
+public:
+    enum {
+        STAGE_SENSOR = 0, // driver buffer timestamp, 0 when not known
+        STAGE_DQBUF,      // v4l2_dqbuf returned, or a frame taken from preview
+        STAGE_PROCESS,    // zoom, scale or csc done
+        STAGE_ENQUEUE,    // given to the framework
+        STAGE_QBUF,       // buffer back to the driver, or from the framework
+        STAGE_MAX
+    };
+
+    struct Sample {
+        nsecs_t Stage[STAGE_MAX];
+    };
+
+    NXFrameStats();
+    virtual ~NXFrameStats() {
+    }
+
+    static nsecs_t now() {
+        return systemTime(SYSTEM_TIME_MONOTONIC);
+    }
+
+    // stream thread only
+    void commit(const Sample &sample);
+    void countDrop(uint32_t frames = 1);
+    void countSkip();
+    // clears the ring and the counters, before the thread runs
+    void reset();
+
+    // any thread
+    size_t snapshot(Sample *samples, size_t maxSamples);
+    void dump(String8 &result, const char *name);
+    // chrome trace events, one slice per stage, separated by ",\n"
+    void writeTrace(FILE *fp, int pid, int tid, const char *name, bool &first);
+
+private:
+    struct Slot {
+        volatile int32_t Sequence;
+        Sample Frame;
+    };
+
+    void dumpLatency(String8 &result, const char *label, const Sample *samples, size_t count, int from, int to);
+
+private:
+    Slot Ring[FRAME_STATS_RING_SIZE];
+    volatile int32_t WritePos;
+    volatile int32_t Frames;
+    volatile int32_t Drops;
+    volatile int32_t Skips;
+
+    // sensor side drop detection, stream thread only
+    nsecs_t LastFrameTime;
+    nsecs_t Interval;
+    uint32_t IntervalCount;
+};
+
+}; // namespace
+
+#endif
@@ -0,0 +1,22 @@
+#define LOG_TAG "NXPreviewRequeue"
+
+#include <utils/Log.h>
+
+#include "NXPreviewRequeue.h"
+
+namespace android {
+
+size_t nxPreviewRequeue(int index, NXZslRing *zslRing, nsecs_t zslTimestamp,
+        NXStreamFanout *fanout, int *indices)
+{
+    size_t count = 0;
+    int qIdx = index;
+    if (zslRing != NULL && zslTimestamp)
+        qIdx = zslRing->push(index, zslTimestamp);
+    if (qIdx >= 0 && fanout->retire(qIdx))
+        indices[count++] = qIdx;
+    count += fanout->collect(indices + count, MAX_NUM_FRAMES);
+    return count;
+}
+
+}; // namespace
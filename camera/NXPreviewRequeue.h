@@ -0,0 +1,21 @@
+#ifndef _NX_PREVIEW_REQUEUE_H
+#define _NX_PREVIEW_REQUEUE_H
+
+#include <utils/Timers.h>
+
+#include "NXZslRing.h"
+#include "NXStreamFanout.h"
+
+namespace android {
+
+// The preview buffers that go back to the driver after the frame index was
+// shown: with zsl the frame stays in the ring and the one it evicts goes
+// back, a frame a fan-out output still holds goes back once it is released.
+// zslRing may be NULL, a zslTimestamp of 0 keeps the frame out of the ring.
+// Returns the number of indices stored, at most MAX_NUM_FRAMES + 1.
+size_t nxPreviewRequeue(int index, NXZslRing *zslRing, nsecs_t zslTimestamp,
+        NXStreamFanout *fanout, int *indices);
+
+}; // namespace
+
+#endif
@@ -0,0 +1,151 @@
+#ifndef LOG_TAG
+#define LOG_TAG "NXSensorControlThread"
+#endif
+
+#include <string.h>
+#include <utils/Log.h>
+
+#include "NXSensorControlThread.h"
+
+namespace android {
+
+NXSensorControlThread::NXSensorControlThread(NXCameraBoardSensor *sensor)
+    : Thread(false),
+      Sensor(sensor),
+      SubmitTime(0),
+      SubmitFrame(0),
+      FrameCount(0),
+      Applying(false),
+      Exiting(false)
+{
+    memset(&Statistics, 0, sizeof(Statistics));
+}
+
+NXSensorControlThread::~NXSensorControlThread()
+{
+}
+
+void NXSensorControlThread::submit(const NXSensorControlSet &set)
+{
+    if (set.Count == 0)
+        return;
+
+    Mutex::Autolock l(Lock);
+    if (Pending.Count) {
+        // not written yet, the later values win
+        for (int i = 0; i < set.Count; i++) {
+            if (!Pending.add(set.Ids[i], set.Values[i]))
+                ALOGE("control set full, drop control 0x%x", set.Ids[i]);
+        }
+        Statistics.merged++;
+        return;
+    }
+    Pending = set;
+    SubmitTime = systemTime(SYSTEM_TIME_MONOTONIC);
+    SubmitFrame = FrameCount;
+    WorkSignal.signal();
+}
+
+void NXSensorControlThread::frameBoundary(nsecs_t timestamp)
+{
+    Mutex::Autolock l(Lock);
+    FrameCount++;
+    if (Pending.Count)
+        WorkSignal.signal();
+}
+
+bool NXSensorControlThread::threadLoop()
+{
+    Lock.lock();
+    while (!Exiting && Pending.Count == 0)
+        WorkSignal.wait(Lock);
+
+    // the frame after the submission has started, the sensor is between
+    // reading out one frame and the next
+    bool aligned = true;
+    nsecs_t deadline = SubmitTime + SENSOR_CTRL_FRAME_TIMEOUT;
+    while (!Exiting && Pending.Count && FrameCount == SubmitFrame) {
+        nsecs_t remaining = deadline - systemTime(SYSTEM_TIME_MONOTONIC);
+        if (remaining <= 0) {
+            aligned = false;
+            break;
+        }
+        WorkSignal.waitRelative(Lock, remaining);
+    }
+
+    // on exit the pending controls are still written
+    NXSensorControlSet set = Pending;
+    nsecs_t submitTime = SubmitTime;
+    Pending.clear();
+    Applying = set.Count > 0;
+    Lock.unlock();
+
+    int ret = 0;
+    nsecs_t start = systemTime(SYSTEM_TIME_MONOTONIC);
+    if (set.Count)
+        ret = Sensor->applyControls(set);
+    nsecs_t end = systemTime(SYSTEM_TIME_MONOTONIC);
+
+    Mutex::Autolock l(Lock);
+    if (set.Count) {
+        if (ret) {
+            ALOGE("failed to apply %d controls: %d", set.Count, ret);
+            Statistics.failed++;
+        }
+        Statistics.batches++;
+        Statistics.controls += set.Count;
+        if (!aligned)
+            Statistics.unaligned++;
+        Statistics.lastLatency = end - submitTime;
+        if (Statistics.lastLatency > Statistics.maxLatency)
+            Statistics.maxLatency = Statistics.lastLatency;
+        Statistics.lastApply = end - start;
+        if (Statistics.lastApply > Statistics.maxApply)
+            Statistics.maxApply = Statistics.lastApply;
+        ALOGV("applied %d controls, %lld us after submit", set.Count, Statistics.lastLatency / 1000);
+    }
+    Applying = false;
+    AppliedSignal.broadcast();
+    return !Exiting;
+}
+
+status_t NXSensorControlThread::waitApplied(nsecs_t timeout)
+{
+    Mutex::Autolock l(Lock);
+    nsecs_t deadline = systemTime(SYSTEM_TIME_MONOTONIC) + timeout;
+    while (Pending.Count || Applying) {
+        nsecs_t remaining = deadline - systemTime(SYSTEM_TIME_MONOTONIC);
+        if (remaining <= 0 || AppliedSignal.waitRelative(Lock, remaining) == TIMED_OUT) {
+            if (!Pending.Count && !Applying)
+                break;
+            return TIMED_OUT;
+        }
+    }
+    return NO_ERROR;
+}
+
+void NXSensorControlThread::requestExit()
+{
+    Thread::requestExit();
+    Mutex::Autolock l(Lock);
+    Exiting = true;
+    WorkSignal.signal();
+}
+
+NXSensorControlThread::Stats NXSensorControlThread::getStats()
+{
+    Mutex::Autolock l(Lock);
+    return Statistics;
+}
+
+void NXSensorControlThread::dump(String8 &result)
+{
+    Stats stats = getStats();
+    result.appendFormat("  sensor controls: %u batches, %u controls, %u merged, %u unaligned, %u failed\n",
+            stats.batches, stats.controls, stats.merged, stats.unaligned, stats.failed);
+    result.appendFormat("    submit->applied    last %6.2fms  max %6.2fms, ioctl last %6.2fms  max %6.2fms\n",
+            stats.lastLatency / 1000000.0, stats.maxLatency / 1000000.0,
+            stats.lastApply / 1000000.0, stats.maxApply / 1000000.0);
+}
+
+}; // namespace android
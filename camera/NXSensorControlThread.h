@@ -0,0 +1,74 @@
+#ifndef _NX_SENSOR_CONTROL_THREAD_H
+#define _NX_SENSOR_CONTROL_THREAD_H
+
+#include <utils/Thread.h>
+#include <utils/Mutex.h>
+#include <utils/Condition.h>
+#include <utils/Timers.h>
+#include <utils/String8.h>
+#include <nx_camera_board.h>
+
+#include "Constants.h"
+
+namespace android {
+
+// Applies the sensor controls of the requests.
+// The command thread submits the controls the setters collected for a
+// request, sets submitted before the next frame boundary are merged and
+// written as one VIDIOC_S_EXT_CTRLS batch right after the stream thread
+// dequeued a frame, so the i2c writes of a request land on one frame and
+// don't stall the command thread. Without frames, e.g. before the preview
+// started, a batch is written after SENSOR_CTRL_FRAME_TIMEOUT.
+class NXSensorControlThread : public Thread
+{
+public:
+    struct Stats {
+        uint32_t batches;
+        uint32_t controls;
+        uint32_t merged;    // sets folded into a batch not yet written
+        uint32_t unaligned; // written on timeout instead of a frame boundary
+        uint32_t failed;
+        nsecs_t lastLatency; // submit to written
+        nsecs_t maxLatency;
+        nsecs_t lastApply;   // the ioctl alone
+        nsecs_t maxApply;
+    };
+
+    NXSensorControlThread(NXCameraBoardSensor *sensor);
+    virtual ~NXSensorControlThread();
+
+    // command thread
+    void submit(const NXSensorControlSet &set);
+    // stream thread, after v4l2_dqbuf()
+    void frameBoundary(nsecs_t timestamp);
+
+    // everything submitted so far is written
+    status_t waitApplied(nsecs_t timeout);
+    virtual void requestExit();
+
+    Stats getStats();
+    void dump(String8 &result);
+
+private:
+    virtual bool threadLoop();
+
+private:
+    NXCameraBoardSensor *Sensor;
+
+    Mutex Lock;
+    Condition WorkSignal;
+    Condition AppliedSignal;
+
+    NXSensorControlSet Pending;
+    nsecs_t SubmitTime;    // first set of the pending batch
+    uint32_t SubmitFrame;  // frame count when the pending batch started
+    uint32_t FrameCount;
+    bool Applying;
+    bool Exiting;
+
+    Stats Statistics;
+};
+
+}; // namespace android
+
+#endif
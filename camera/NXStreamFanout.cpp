@@ -0,0 +1,336 @@
+#define LOG_TAG "NXStreamFanout"
+
+#include <string.h>
+#include <utils/Log.h>
+
+#include "NXStreamFanout.h"
+
+namespace android {
+
+NXStreamFanout::NXStreamFanout()
+    : ReturnedCount(0),
+      SrcWidth(0),
+      SrcHeight(0),
+      SrcFormat(0),
+      CropLeft(0),
+      CropTop(0),
+      CropWidth(0),
+      CropHeight(0),
+      BaseWidth(0),
+      BaseHeight(0),
+      Sequence(0)
+{
+    memset(Outputs, 0, sizeof(Outputs));
+    memset(Refs, 0, sizeof(Refs));
+    memset(Retired, 0, sizeof(Retired));
+    memset(&Statistics, 0, sizeof(Statistics));
+}
+
+NXStreamFanout::~NXStreamFanout()
+{
+}
+
+int NXStreamFanout::addOutput(int width, int height)
+{
+    Mutex::Autolock l(Lock);
+    for (int i = 0; i < MAX_FANOUT_OUTPUTS; i++) {
+        Output &out = Outputs[i];
+        if (!out.Used) {
+            memset(&out, 0, sizeof(out));
+            out.Used = true;
+            out.Width = width;
+            out.Height = height;
+            ALOGD("addOutput %d: %dx%d", i, width, height);
+            return i;
+        }
+    }
+    ALOGE("no free output for %dx%d", width, height);
+    return -1;
+}
+
+void NXStreamFanout::removeOutput(int output)
+{
+    Mutex::Autolock l(Lock);
+    if (!validOutput(output))
+        return;
+
+    Output &out = Outputs[output];
+    if (out.Pending.Sequence)
+        unref(out.Pending.Index);
+    if (out.Held.Sequence) {
+        ALOGW("removeOutput %d while holding frame %u", output, out.Held.Sequence);
+        unref(out.Held.Index);
+    }
+    out.Used = false;
+    // a consumer still waiting in take() sees the output gone
+    FrameAvailable.broadcast();
+    FrameReleased.broadcast();
+}
+
+bool NXStreamFanout::hasOutputs()
+{
+    Mutex::Autolock l(Lock);
+    for (int i = 0; i < MAX_FANOUT_OUTPUTS; i++) {
+        if (Outputs[i].Used)
+            return true;
+    }
+    return false;
+}
+
+bool NXStreamFanout::isUnscaled(int output)
+{
+    Mutex::Autolock l(Lock);
+    return validOutput(output) && unscaledLocked(Outputs[output]);
+}
+
+/* the output has the source size and the crop is the whole source */
+bool NXStreamFanout::unscaledLocked(const Output &out) const
+{
+    if (out.Width != SrcWidth || out.Height != SrcHeight)
+        return false;
+    if (CropWidth <= 0 || CropHeight <= 0 || BaseWidth <= 0 || BaseHeight <= 0)
+        return true;
+    return CropLeft == 0 && CropTop == 0 && CropWidth == BaseWidth && CropHeight == BaseHeight;
+}
+
+void NXStreamFanout::setSource(int width, int height, int format)
+{
+    Mutex::Autolock l(Lock);
+    SrcWidth = width;
+    SrcHeight = height;
+    SrcFormat = format;
+    for (int i = 0; i < MAX_FANOUT_OUTPUTS; i++)
+        Outputs[i].ContextValid = false;
+}
+
+void NXStreamFanout::setCrop(int left, int top, int width, int height, int baseWidth, int baseHeight)
+{
+    Mutex::Autolock l(Lock);
+    CropLeft = left;
+    CropTop = top;
+    CropWidth = width;
+    CropHeight = height;
+    BaseWidth = baseWidth;
+    BaseHeight = baseHeight;
+    for (int i = 0; i < MAX_FANOUT_OUTPUTS; i++)
+        Outputs[i].ContextValid = false;
+}
+
+void NXStreamFanout::ref(int index)
+{
+    Refs[index]++;
+}
+
+void NXStreamFanout::unref(int index)
+{
+    if (Refs[index] <= 0) {
+        ALOGE("unref: index %d is not referenced", index);
+        return;
+    }
+    if (--Refs[index] == 0 && Retired[index]) {
+        Retired[index] = false;
+        Returned[ReturnedCount++] = index;
+    }
+}
+
+void NXStreamFanout::publish(int index, struct nxp_vid_buffer *buffer, nsecs_t timestamp)
+{
+    if (index < 0 || index >= MAX_NUM_FRAMES) {
+        ALOGE("publish: invalid index %d", index);
+        return;
+    }
+
+    Mutex::Autolock l(Lock);
+    Sequence++;
+    Statistics.published++;
+    for (int i = 0; i < MAX_FANOUT_OUTPUTS; i++) {
+        Output &out = Outputs[i];
+        if (!out.Used)
+            continue;
+        if (out.Pending.Sequence) {
+            ALOGV("output %d drop frame %u", i, out.Pending.Sequence);
+            unref(out.Pending.Index);
+            Statistics.dropped++;
+        }
+        out.Pending.Sequence = Sequence;
+        out.Pending.Index = index;
+        out.Pending.Buffer = buffer;
+        out.Pending.Width = SrcWidth;
+        out.Pending.Height = SrcHeight;
+        out.Pending.Timestamp = timestamp;
+        ref(index);
+    }
+    FrameAvailable.broadcast();
+}
+
+bool NXStreamFanout::retire(int index)
+{
+    if (index < 0 || index >= MAX_NUM_FRAMES)
+        return true;
+
+    Mutex::Autolock l(Lock);
+    if (Refs[index] == 0)
+        return true;
+    Retired[index] = true;
+    Statistics.deferred++;
+    return false;
+}
+
+size_t NXStreamFanout::collect(int *indices, size_t maxIndices)
+{
+    Mutex::Autolock l(Lock);
+    size_t n = ReturnedCount < maxIndices ? ReturnedCount : maxIndices;
+    memcpy(indices, Returned, n * sizeof(int));
+    ReturnedCount -= n;
+    memmove(Returned, Returned + n, ReturnedCount * sizeof(int));
+    return n;
+}
+
+void NXStreamFanout::reset(nsecs_t timeout)
+{
+    Mutex::Autolock l(Lock);
+    for (int i = 0; i < MAX_FANOUT_OUTPUTS; i++) {
+        Output &out = Outputs[i];
+        if (out.Used && out.Pending.Sequence) {
+            unref(out.Pending.Index);
+            out.Pending.Sequence = 0;
+        }
+    }
+
+    // a consumer may still be reading a buffer the producer is about to free
+    bool held = true;
+    while (held) {
+        held = false;
+        for (int i = 0; i < MAX_FANOUT_OUTPUTS; i++) {
+            if (Outputs[i].Used && Outputs[i].Held.Sequence)
+                held = true;
+        }
+        if (held && FrameReleased.waitRelative(Lock, timeout) == TIMED_OUT) {
+            ALOGW("reset: outputs still hold frames");
+            break;
+        }
+    }
+
+    memset(Refs, 0, sizeof(Refs));
+    memset(Retired, 0, sizeof(Retired));
+    ReturnedCount = 0;
+}
+
+status_t NXStreamFanout::take(int output, Frame &frame, nsecs_t timeout)
+{
+    Mutex::Autolock l(Lock);
+    if (!validOutput(output) || Outputs[output].Held.Sequence) {
+        ALOGE("take: output %d is gone or holds a frame", output);
+        return BAD_VALUE;
+    }
+
+    while (Outputs[output].Pending.Sequence == 0) {
+        if (FrameAvailable.waitRelative(Lock, timeout) == TIMED_OUT)
+            return TIMED_OUT;
+        if (!validOutput(output))
+            return BAD_VALUE;
+    }
+
+    Output &out = Outputs[output];
+    // the reference moves from the pending slot to the consumer
+    out.Held = out.Pending;
+    out.Pending.Sequence = 0;
+    frame = out.Held;
+    return NO_ERROR;
+}
+
+void NXStreamFanout::updateContext(Output &out)
+{
+    struct scale_ctx &ctx = out.Context;
+    int left = 0, top = 0, width = SrcWidth, height = SrcHeight;
+
+    if (CropWidth > 0 && CropHeight > 0 && BaseWidth > 0 && BaseHeight > 0) {
+        left = CropLeft * SrcWidth / BaseWidth;
+        top = CropTop * SrcHeight / BaseHeight;
+        width = CropWidth * SrcWidth / BaseWidth;
+        height = CropHeight * SrcHeight / BaseHeight;
+
+        // align 32pixel for cb,cr 16pixel align
+        left = (left + 31) & (~31);
+        if (left + width > SrcWidth)
+            width = SrcWidth - left;
+        if (top + height > SrcHeight)
+            height = SrcHeight - top;
+    }
+
+    ctx.left = left;
+    ctx.top = top;
+    ctx.src_width = width;
+    ctx.src_height = height;
+    ctx.src_code = SrcFormat;
+    ctx.dst_width = out.Width;
+    ctx.dst_height = out.Height;
+    ctx.dst_code = SrcFormat;
+    out.ContextValid = true;
+}
+
+bool NXStreamFanout::lockContext(int output, const Frame &frame, struct scale_ctx &ctx)
+{
+    Mutex::Autolock l(Lock);
+    if (!validOutput(output) || Outputs[output].Held.Sequence != frame.Sequence || !frame.Sequence) {
+        ALOGE("render: output %d doesn't hold frame %u", output, frame.Sequence);
+        return false;
+    }
+    Output &out = Outputs[output];
+    if (!out.ContextValid)
+        updateContext(out);
+    ctx = out.Context;
+    if (unscaledLocked(out)) {
+        // no crop, no scale: the scaler only moves the frame into the output buffer
+        ctx.left = ctx.top = 0;
+        ctx.src_width = ctx.dst_width = SrcWidth;
+        ctx.src_height = ctx.dst_height = SrcHeight;
+        Statistics.copied++;
+    } else {
+        Statistics.scaled++;
+    }
+    return true;
+}
+
+bool NXStreamFanout::render(int output, const Frame &frame, private_handle_t const *dstHandle)
+{
+    struct scale_ctx ctx;
+    if (!lockContext(output, frame, ctx))
+        return false;
+    if (nxScalerRun(frame.Buffer, dstHandle, &ctx)) {
+        ALOGE("failed to nxScalerRun()");
+        return false;
+    }
+    return true;
+}
+
+bool NXStreamFanout::render(int output, const Frame &frame, struct nxp_vid_buffer *dstBuffer)
+{
+    struct scale_ctx ctx;
+    if (!lockContext(output, frame, ctx))
+        return false;
+    if (nxScalerRun(frame.Buffer, dstBuffer, &ctx)) {
+        ALOGE("failed to nxScalerRun()");
+        return false;
+    }
+    return true;
+}
+
+void NXStreamFanout::release(int output, Frame &frame)
+{
+    Mutex::Autolock l(Lock);
+    if (validOutput(output) && frame.Sequence && Outputs[output].Held.Sequence == frame.Sequence) {
+        unref(frame.Index);
+        Outputs[output].Held.Sequence = 0;
+        FrameReleased.broadcast();
+    }
+    frame.Sequence = 0;
+}
+
+NXStreamFanout::Stats NXStreamFanout::getStats()
+{
+    Mutex::Autolock l(Lock);
+    return Statistics;
+}
+
+}; // namespace
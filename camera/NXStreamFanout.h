@@ -0,0 +1,127 @@
+#ifndef _NX_STREAM_FANOUT_H
+#define _NX_STREAM_FANOUT_H
+
+#include <utils/RefBase.h>
+#include <utils/Mutex.h>
+#include <utils/Condition.h>
+#include <utils/Timers.h>
+#include <gralloc_priv.h>
+#include <nxp-v4l2.h>
+#include <NXScaler.h>
+
+#include "Constants.h"
+
+namespace android {
+
+// Fan-out of one source stream to several outputs.
+// The producer publishes each source buffer once and every output gets a
+// reference to it in a single slot, a frame the output has not taken yet is
+// replaced by the newer one and counted as dropped. The consumer takes the
+// frame, renders it into its own buffer, then releases it. An output of the
+// source size is still a 1:1 copy: its buffers belong to the window of the
+// framework stream, the source buffer can't be queued there too. What the
+// fan-out saves is a second capture path from the sensor.
+// A source buffer the producer retires goes back to the producer only when
+// no output holds it any more, see retire() and collect().
+class NXStreamFanout : public virtual RefBase
+{
+public:
+    struct Frame {
+        uint32_t Sequence; // starts at 1, 0 means no frame
+        int Index;         // source buffer index
+        struct nxp_vid_buffer *Buffer;
+        int Width;
+        int Height;
+        nsecs_t Timestamp;
+    };
+
+    struct Stats {
+        uint32_t published;
+        uint32_t copied;    // rendered 1:1 for an output of the source size
+        uint32_t scaled;    // rendered through a crop or scale
+        uint32_t dropped;   // replaced before the output took them
+        uint32_t deferred;  // retired while an output still held them
+    };
+
+    NXStreamFanout();
+    virtual ~NXStreamFanout();
+
+    // returns the output id or -1 when all MAX_FANOUT_OUTPUTS are in use
+    int addOutput(int width, int height);
+    // the output must not hold a frame
+    void removeOutput(int output);
+    bool hasOutputs();
+    // true when the output has the source size and no crop applies, its
+    // render() is a plain copy
+    bool isUnscaled(int output);
+
+    // producer side
+    void setSource(int width, int height, int format);
+    void setCrop(int left, int top, int width, int height, int baseWidth, int baseHeight);
+    void publish(int index, struct nxp_vid_buffer *buffer, nsecs_t timestamp);
+    // true: index can be requeued now, false: collect() returns it later
+    bool retire(int index);
+    size_t collect(int *indices, size_t maxIndices);
+    // source buffers went back to the driver, drops every reference
+    // after the outputs released the frames they hold
+    void reset(nsecs_t timeout);
+
+    // consumer side
+    // waits for a frame newer than the last one taken by the output
+    // returns NO_ERROR, TIMED_OUT or BAD_VALUE when the output is gone or
+    // still holds a frame
+    status_t take(int output, Frame &frame, nsecs_t timeout);
+    bool render(int output, const Frame &frame, private_handle_t const *dstHandle);
+    bool render(int output, const Frame &frame, struct nxp_vid_buffer *dstBuffer);
+    void release(int output, Frame &frame);
+
+    Stats getStats();
+
+private:
+    struct Output {
+        bool Used;
+        int Width;
+        int Height;
+        Frame Pending;
+        Frame Held;
+        bool ContextValid;
+        struct scale_ctx Context;
+    };
+
+    bool validOutput(int output) const {
+        return output >= 0 && output < MAX_FANOUT_OUTPUTS && Outputs[output].Used;
+    }
+    void ref(int index);
+    void unref(int index);
+    bool unscaledLocked(const Output &out) const;
+    void updateContext(Output &out);
+    bool lockContext(int output, const Frame &frame, struct scale_ctx &ctx);
+
+private:
+    Mutex Lock; // for everything below
+    Condition FrameAvailable;
+    Condition FrameReleased;
+
+    Output Outputs[MAX_FANOUT_OUTPUTS];
+    int Refs[MAX_NUM_FRAMES];
+    bool Retired[MAX_NUM_FRAMES];
+    int Returned[MAX_NUM_FRAMES];
+    size_t ReturnedCount;
+
+    int SrcWidth;
+    int SrcHeight;
+    int SrcFormat;
+    int CropLeft;
+    int CropTop;
+    int CropWidth;
+    int CropHeight;
+    int BaseWidth;
+    int BaseHeight;
+
+    uint32_t Sequence;
+    Stats Statistics;
+};
+
+}; // namespace
+
+#endif
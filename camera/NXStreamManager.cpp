@@ -1,5 +1,6 @@
 #define LOG_TAG "NXStreamManager"
 
+#include <stdio.h>
 #include <utils/Log.h>
 
 #include "NXCameraHWInterface2.h"
@@ -159,6 +160,66 @@ int NXStreamManager::allocateStream(uint32_t width, uint32_t height, int format,
     return NO_ERROR;
 }
 
+static const char *getStreamName(int32_t streamId)
+{
+    switch (streamId) {
+    case STREAM_ID_PREVIEW:
+        return "preview";
+    case STREAM_ID_CAPTURE:
+        return "capture";
+    case STREAM_ID_RECORD:
+        return "record";
+    case STREAM_ID_CALLBACK:
+        return "callback";
+    case STREAM_ID_ZSL:
+        return "zsl";
+    default:
+        return "unknown";
+    }
+}
+
+/* the zsl stream shares the preview thread, list each thread once */
+static bool isSharedThread(const KeyedVector<int32_t, sp<NXStreamThread> > &threads, size_t index)
+{
+    for (size_t i = 0; i < index; i++) {
+        if (threads.valueAt(i) == threads.valueAt(index))
+            return true;
+    }
+    return false;
+}
+
+void NXStreamManager::dump(String8 &result)
+{
+    for (size_t i = 0; i < StreamThreads.size(); i++) {
+        if (isSharedThread(StreamThreads, i))
+            continue;
+        StreamThreads.valueAt(i)->getFrameStats()->dump(result, getStreamName(StreamThreads.keyAt(i)));
+    }
+    if (SensorControl != NULL)
+        SensorControl->dump(result);
+}
+
+status_t NXStreamManager::writeTrace(const char *path, int pid)
+{
+    FILE *fp = fopen(path, "w");
+    if (!fp) {
+        ALOGE("can't open %s", path);
+        return NO_INIT;
+    }
+
+    bool first = true;
+    fprintf(fp, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    for (size_t i = 0; i < StreamThreads.size(); i++) {
+        if (isSharedThread(StreamThreads, i))
+            continue;
+        int32_t streamId = StreamThreads.keyAt(i);
+        StreamThreads.valueAt(i)->getFrameStats()->writeTrace(fp, pid, streamId, getStreamName(streamId), first);
+    }
+    fprintf(fp, "\n]}\n");
+    fclose(fp);
+    return NO_ERROR;
+}
+
 int NXStreamManager::removeStream(uint32_t streamId)
 {
     if (StreamThreads.indexOfKey(streamId) < 0) {
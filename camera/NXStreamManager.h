@@ -7,8 +7,10 @@
 #include <utils/List.h>
 #include <utils/RefBase.h>
 #include <utils/KeyedVector.h>
+#include <utils/String8.h>
 
 #include "Constants.h"
+#include "NXSensorControlThread.h"
 
 namespace android {
 
@@ -29,15 +31,28 @@ public:
             uint32_t *streamId, uint32_t *formatActual, uint32_t *usage, uint32_t *maxBuffers, bool useSensorZoom);
     int removeStream(uint32_t streamId);
 
+    // frame stage times of every stream thread
+    void dump(String8 &result);
+    status_t writeTrace(const char *path, int pid);
+
     NXStreamThread *getStreamThread(uint32_t streamId) {
         if(StreamThreads.indexOfKey(streamId) >= 0)
             return StreamThreads.valueFor(streamId).get();
         return NULL;
     }
 
+    // stream threads report frame boundaries to it
+    void setSensorControl(sp<NXSensorControlThread> thread) {
+        SensorControl = thread;
+    }
+    sp<NXSensorControlThread> getSensorControl() const {
+        return SensorControl;
+    }
+
 private:
     NXCameraHWInterface2 *Parent;
     KeyedVector<int32_t, sp<NXStreamThread> > StreamThreads;
+    sp<NXSensorControlThread> SensorControl;
 
     uint32_t whatStreamAllocate(int format);
 
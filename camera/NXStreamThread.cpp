@@ -5,6 +5,8 @@
 #include <gralloc_priv.h>
 #include "NXStreamThread.h"
 #include <stdio.h>
+#include <stdlib.h>
+#include <cutils/properties.h>
 #include "libnxjpeg.h"
 
 #include <linux/ion.h>
@@ -37,6 +39,9 @@ NXStreamThread::NXStreamThread(nxp_v4l2_id id,
       ActiveStreamId(0),
       StreamManager(streamManager),
       Pausing(false),
+      FrameHandoff(new NXFrameHandoff()),
+      Fanout(new NXStreamFanout()),
+      FrameStats(new NXFrameStats()),
       State(STATE_EXIT)
 {
     ZoomController->setFormat(PIXINDEX2PIXCODE(PixelIndex), PIXINDEX2PIXCODE(PixelIndex));
@@ -51,6 +56,9 @@ NXStreamThread::NXStreamThread(int width, int height, sp<NXStreamManager> &strea
       ActiveStreamId(0),
       StreamManager(streamManager),
       Pausing(false),
+      FrameHandoff(new NXFrameHandoff()),
+      Fanout(new NXStreamFanout()),
+      FrameStats(new NXFrameStats()),
       State(STATE_EXIT)
 {
     ThreadName[0] = '\0';
@@ -141,6 +149,7 @@ void NXStreamThread::onZoomChanged(int left, int top, int width, int height, int
 {
     ZoomController->setBase(baseWidth, baseHeight);
     ZoomController->setCrop(left, top, width, height);
+    Fanout->setCrop(left, top, width, height, baseWidth, baseHeight);
 }
 
 status_t NXStreamThread::readyToRun()
@@ -172,6 +181,7 @@ status_t NXStreamThread::start(int streamId, char *threadName, unsigned int prio
 
     ALOGD("===> start %s, streamId %d, priority %d", threadName, streamId, priority);
     strcpy(ThreadName, threadName);
+    FrameStats->reset();
     status_t ret = run(ThreadName, priority, 0);
 
     if (ret == NO_ERROR)
@@ -202,6 +212,9 @@ status_t NXStreamThread::stop(bool waitExit, bool streamOff)
         setState(STATE_EXIT);
     }
 
+    // no more frames, don't leave a consumer waiting on this thread
+    FrameHandoff->abort();
+
     if (timeOut > 0) {
         NXStream *stream = getActiveStream();
         if (stream) {
@@ -210,13 +223,61 @@ status_t NXStreamThread::stop(bool waitExit, bool streamOff)
         }
     }
 
-    if (streamOff)
+    if (streamOff) {
         v4l2_streamoff(Id);
+        // streamoff gives every buffer back to the driver
+        sp<NXZslRing> ring = getZslRing();
+        if (ring != NULL)
+            ring->reset(ZSL_FRAME_TIMEOUT);
+        Fanout->reset(FANOUT_FRAME_TIMEOUT);
+    }
 
     ALOGD("stop end");
     return NO_ERROR;
 }
 
+bool NXStreamThread::acquireZslFrame(nsecs_t trigger, ZslFrame &frame)
+{
+    sp<NXZslRing> ring = getZslRing();
+    if (ring == NULL || !isRunning())
+        return false;
+
+    nsecs_t timestamp;
+    int index = ring->acquire(trigger, &timestamp);
+    if (index < 0)
+        return false;
+
+    struct nxp_vid_buffer *buffer = ZoomController->getBuffer(index);
+    if (!buffer) {
+        ring->release(index);
+        return false;
+    }
+
+    frame.Ring = ring;
+    frame.Index = index;
+    frame.Timestamp = timestamp;
+    frame.Width = Width;
+    frame.Height = Height;
+    frame.Buffer = buffer;
+    ALOGV("acquireZslFrame: index %d, %lld ns from trigger", index, timestamp - trigger);
+    return true;
+}
+
+void NXStreamThread::releaseZslFrame(ZslFrame &frame)
+{
+    if (frame.Ring != NULL) {
+        frame.Ring->release(frame.Index);
+        frame.Ring.clear();
+    }
+}
+
+bool NXStreamThread::useRecordFanout()
+{
+    char value[PROPERTY_VALUE_MAX];
+    property_get(RECORD_FANOUT_PROPERTY, value, "0");
+    return atoi(value) > 0;
+}
+
 status_t NXStreamThread::getFormat(uint32_t &width, uint32_t &height, uint32_t &format) const
 {
     width = Width;
@@ -14,6 +14,10 @@
 #include "NXStream.h"
 #include "NXZoomController.h"
 #include "NXStreamManager.h"
+#include "NXZslRing.h"
+#include "NXFrameHandoff.h"
+#include "NXStreamFanout.h"
+#include "NXFrameStats.h"
 #include "NXStreamThread.h"
 
 #define CHECK_AND_EXIT() do { \
@@ -44,6 +48,16 @@ class NXStreamThread:
     virtual public NXCommandThread::CommandListener
 {
 public:
+    // frame held for a zero shutter lag capture
+    struct ZslFrame {
+        sp<NXZslRing> Ring;
+        int Index;
+        nsecs_t Timestamp;
+        int Width;
+        int Height;
+        struct nxp_vid_buffer *Buffer;
+    };
+
     enum {
         STATE_EXIT = 0,
         STATE_RUNNING,
@@ -69,6 +83,10 @@ public:
 
     virtual void onCommand(int32_t streamId, camera_metadata_t *metadata) = 0;
     virtual void onZoomChanged(int left, int top, int width, int height, int baseWidth, int baseHeight);
+    // a running stream ignores the start command of a repeated request
+    virtual bool isCommandRedundant(int32_t streamId) {
+        return isRunning();
+    }
 
     virtual status_t start(int streamId, char *threadName, unsigned int priority = PRIORITY_DEFAULT);
     virtual status_t stop(bool waitExit, bool streamOff = true);
@@ -108,6 +126,30 @@ public:
 
     status_t getFormat(uint32_t &width, uint32_t &height, uint32_t &format) const;
 
+    // true while the thread keeps its device streaming between requests
+    virtual bool isSessionActive() {
+        return false;
+    }
+
+    // zero shutter lag, only threads that keep a ring return frames
+    bool acquireZslFrame(nsecs_t trigger, ZslFrame &frame);
+    void releaseZslFrame(ZslFrame &frame);
+
+    // frames this thread enqueued, for consumers that copy from them
+    sp<NXFrameHandoff> getFrameHandoff() const {
+        return FrameHandoff;
+    }
+
+    // per frame stage times, for dump()
+    sp<NXFrameStats> getFrameStats() const {
+        return FrameStats;
+    }
+
+    // internal frames this thread dequeued, for streams scaled from them
+    sp<NXStreamFanout> getStreamFanout() const {
+        return Fanout;
+    }
+
     private_handle_t const *getLastBuffer(int &width, int &height) {
         NXStream *stream = getActiveStream();
         if (!stream)
@@ -149,6 +191,18 @@ public:
 protected:
     virtual void init(nxp_v4l2_id id) = 0;
 
+    void setZslRing(NXZslRing *ring) {
+        Mutex::Autolock l(ZslLock);
+        ZslRing = ring;
+    }
+    sp<NXZslRing> getZslRing() {
+        Mutex::Autolock l(ZslLock);
+        return ZslRing;
+    }
+
+    // record is fed by the preview fan-out, see RECORD_FANOUT_PROPERTY
+    bool useRecordFanout();
+
 protected:
     char ThreadName[MAX_THREAD_NAME];
 
@@ -178,6 +232,13 @@ private:
     Condition SignalResume;
     bool Pausing;
 
+    Mutex ZslLock; // for ZslRing
+    sp<NXZslRing> ZslRing;
+
+    sp<NXFrameHandoff> FrameHandoff;
+    sp<NXStreamFanout> Fanout;
+    sp<NXFrameStats> FrameStats;
+
     volatile int32_t State;
 };
 
@@ -1,4 +1,6 @@
+#ifndef LOG_TAG
 #define LOG_TAG "NXZoomController"
+#endif
 
 #include <sys/types.h>
 #include <sys/stat.h>
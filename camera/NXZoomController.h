@@ -32,6 +32,24 @@ public:
     virtual bool handleZoom(private_handle_t const *srcHandle, private_handle_t const *dstHandle) = 0;
     virtual bool isZoomAvaliable() = 0;
 
+    // what handleZoom() does to the pixels with the current crop
+    enum {
+        ZOOM_IDENTITY = 0,  // the whole source at its own size
+        ZOOM_CROP,          // a window of the source at its own size
+        ZOOM_SCALE,         // the window needs the scaler
+    };
+    virtual int getZoomMode() {
+        return ZOOM_SCALE;
+    }
+    // identity and pure crop: the window as plane offsets of srcBuffer
+    // keeping its strides, no pixel work for a consumer honoring strides
+    virtual bool getCropView(const struct nxp_vid_buffer *srcBuffer, struct nxp_vid_buffer *view) {
+        return false;
+    }
+    // spread crop changes over the next frames handled by handleZoom()
+    virtual void setSmoothFrames(int frames) {
+    }
+
     virtual bool allocBuffer(int bufferCount, int width, int height, int format);
     virtual void freeBuffer();
     virtual struct nxp_vid_buffer *getBuffer(int index);
@@ -0,0 +1,151 @@
+#define LOG_TAG "NXZslRing"
+
+#include <string.h>
+#include <utils/Log.h>
+
+#include "NXZslRing.h"
+
+namespace android {
+
+NXZslRing::NXZslRing(size_t depth)
+    : Depth(depth),
+      Count(0)
+{
+    if (Depth > MAX_ZSL_RING_DEPTH) {
+        ALOGW("zsl depth %d is over max, use %d", depth, MAX_ZSL_RING_DEPTH);
+        Depth = MAX_ZSL_RING_DEPTH;
+    }
+    memset(&Statistics, 0, sizeof(Statistics));
+}
+
+void NXZslRing::removeAt(size_t pos)
+{
+    for (size_t i = pos + 1; i < Count; i++)
+        Slots[i - 1] = Slots[i];
+    Count--;
+}
+
+int NXZslRing::push(int index, nsecs_t timestamp)
+{
+    Mutex::Autolock l(Lock);
+    int evicted = -1;
+
+    Statistics.pushed++;
+    if (Depth == 0) {
+        Statistics.dropped++;
+        return index;
+    }
+
+    if (Count == Depth) {
+        size_t i;
+        for (i = 0; i < Count; i++) {
+            if (!Slots[i].locked)
+                break;
+        }
+        if (i == Count) {
+            Statistics.dropped++;
+            return index;
+        }
+        evicted = Slots[i].index;
+        removeAt(i);
+        Statistics.evicted++;
+    }
+
+    Slots[Count].index = index;
+    Slots[Count].timestamp = timestamp;
+    Slots[Count].locked = false;
+    Count++;
+    return evicted;
+}
+
+int NXZslRing::acquire(nsecs_t trigger, nsecs_t *timestamp)
+{
+    Mutex::Autolock l(Lock);
+    size_t best = Count;
+    nsecs_t bestDiff = 0;
+
+    for (size_t i = 0; i < Count; i++) {
+        nsecs_t diff = Slots[i].timestamp - trigger;
+        if (diff < 0)
+            diff = -diff;
+        // on a tie the older frame wins, it was exposed before the trigger
+        if (best == Count || diff < bestDiff) {
+            best = i;
+            bestDiff = diff;
+        }
+    }
+
+    if (best == Count) {
+        Statistics.misses++;
+        return -1;
+    }
+
+    Slots[best].locked = true;
+    if (timestamp)
+        *timestamp = Slots[best].timestamp;
+    Statistics.hits++;
+    return Slots[best].index;
+}
+
+void NXZslRing::release(int index)
+{
+    Mutex::Autolock l(Lock);
+    for (size_t i = 0; i < Count; i++) {
+        if (Slots[i].index == index) {
+            Slots[i].locked = false;
+            FrameReleased.broadcast();
+            return;
+        }
+    }
+    ALOGV("release: index %d is not in the ring", index);
+}
+
+size_t NXZslRing::flush(int *indices, size_t maxIndices)
+{
+    Mutex::Autolock l(Lock);
+    size_t n = 0;
+    size_t i = 0;
+
+    while (i < Count && n < maxIndices) {
+        if (Slots[i].locked) {
+            i++;
+            continue;
+        }
+        indices[n++] = Slots[i].index;
+        removeAt(i);
+    }
+    return n;
+}
+
+void NXZslRing::reset(nsecs_t timeout)
+{
+    Mutex::Autolock l(Lock);
+    // a capture may still be encoding a frame the stream thread is about to reuse
+    bool locked = true;
+    while (locked) {
+        locked = false;
+        for (size_t i = 0; i < Count; i++) {
+            if (Slots[i].locked)
+                locked = true;
+        }
+        if (locked && FrameReleased.waitRelative(Lock, timeout) == TIMED_OUT) {
+            ALOGW("reset: a capture still holds a frame");
+            break;
+        }
+    }
+    Count = 0;
+}
+
+size_t NXZslRing::size()
+{
+    Mutex::Autolock l(Lock);
+    return Count;
+}
+
+NXZslRing::Stats NXZslRing::getStats()
+{
+    Mutex::Autolock l(Lock);
+    return Statistics;
+}
+
+}; // namespace android
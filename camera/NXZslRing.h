@@ -0,0 +1,71 @@
+#ifndef _NX_ZSL_RING_H
+#define _NX_ZSL_RING_H
+
+#include <utils/RefBase.h>
+#include <utils/Mutex.h>
+#include <utils/Condition.h>
+#include <utils/Timers.h>
+
+#define MAX_ZSL_RING_DEPTH          8
+
+namespace android {
+
+// Zero shutter lag ring.
+// Keeps the v4l2 buffer indices of the most recent frames out of the driver
+// so that a capture can take a frame that was already exposed.
+// The stream thread owning the buffers pushes every frame and queues back
+// whatever push() returns; a capture acquires the frame closest to its
+// trigger time, which can't be evicted until it is released.
+class NXZslRing : public virtual RefBase
+{
+public:
+    struct Stats {
+        uint32_t pushed;    // frames pushed
+        uint32_t evicted;   // frames pushed out by newer ones
+        uint32_t dropped;   // frames not kept because every slot was locked
+        uint32_t hits;      // acquire() returned a frame
+        uint32_t misses;    // acquire() found the ring empty
+    };
+
+    NXZslRing(size_t depth);
+    virtual ~NXZslRing() {
+    }
+
+    // returns the index to give back to the driver, -1 if the ring kept it
+    // without evicting anything
+    int push(int index, nsecs_t timestamp);
+    // locks and returns the frame closest to trigger, -1 if empty
+    int acquire(nsecs_t trigger, nsecs_t *timestamp);
+    void release(int index);
+    // removes every unlocked frame, returns the number of indices stored
+    size_t flush(int *indices, size_t maxIndices);
+    // forgets every frame (after streamoff), a locked one once it is released
+    // or timeout passed, its buffer may be requeued or freed right after
+    void reset(nsecs_t timeout);
+
+    size_t getDepth() const {
+        return Depth;
+    }
+    size_t size();
+    Stats getStats();
+
+private:
+    struct Slot {
+        int index;
+        nsecs_t timestamp;
+        bool locked;
+    };
+
+    void removeAt(size_t pos);
+
+    Mutex Lock;
+    Condition FrameReleased;
+    size_t Depth;
+    size_t Count;
+    Slot Slots[MAX_ZSL_RING_DEPTH]; // oldest first
+    Stats Statistics;
+};
+
+}; // namespace
+
+#endif
@@ -35,6 +35,9 @@ public:
     virtual bool isZoomAvaliable() {
         return false;
     }
+    virtual int getZoomMode() {
+        return ZOOM_IDENTITY;
+    }
     virtual bool allocBuffer(int bufferCount, int width, int height, int format) {
         return true;
     }
@@ -5,6 +5,7 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 #include <linux/videodev2.h>
 #include <linux/v4l2-mediabus.h>
@@ -15,11 +16,13 @@
 #include <ion-private.h>
 #include <gralloc_priv.h>
 #include <nx_camera_board.h>
+#include <cutils/properties.h>
 
 #include <NXCpu.h>
 
 #include "Constants.h"
 #include "PreviewThread.h"
+#include "NXPreviewRequeue.h"
 
 namespace android {
 
@@ -33,6 +36,7 @@ PreviewThread::PreviewThread(nxp_v4l2_id id,
     init(id);
     UseZoom = ZoomController->useZoom();
     if (UseZoom) {
+        ZoomController->setSmoothFrames(ZOOM_SMOOTH_FRAMES);
         PlaneNum = 3;
         Format = V4L2_PIX_FMT_YUV420M;
     } else {
@@ -54,16 +58,35 @@ void PreviewThread::onCommand(int32_t streamId, camera_metadata_t *metadata)
 {
     if (streamId == STREAM_ID_PREVIEW) {
         if (metadata) {
+            NXStreamThread *captureThread = StreamManager->getStreamThread(STREAM_ID_CAPTURE);
+            if (captureThread && captureThread->isSessionActive()) {
+                // the device is streaming for capture, preview comes back after the session ends
+                ALOGV("capture session active, defer preview");
+                return;
+            }
             const char *threadName = "PreviewThread";
             start(streamId, const_cast<char *>(threadName), streamId);
         }
     } else if (streamId == STREAM_ID_ZSL) {
+        // frames are kept in ZslRing while previewing, see getZslDepth()
         ALOGV("get ZSL Command");
     } else {
         ALOGE("Invalid Stream ID: %d", streamId);
     }
 }
 
+size_t PreviewThread::getZslDepth()
+{
+    char value[PROPERTY_VALUE_MAX];
+    property_get(ZSL_DEPTH_PROPERTY, value, "0");
+    int depth = atoi(value);
+    if (depth <= 0)
+        depth = getStream(STREAM_ID_ZSL) ? MAX_ZSL_BUFFER : 0;
+    if (depth > MAX_ZSL_RING_DEPTH)
+        depth = MAX_ZSL_RING_DEPTH;
+    return depth;
+}
+
 status_t PreviewThread::readyToRun()
 {
     ALOGD("preview readyToRun entered: wxd(%dx%d)", Width, Height);
@@ -74,6 +97,12 @@ status_t PreviewThread::readyToRun()
         return NO_INIT;
     }
 
+    // the buffers are requeued or freed below, a zsl frame of the last run must be released first
+    sp<NXZslRing> lastRing = getZslRing();
+    if (lastRing != NULL)
+        lastRing->reset(ZSL_FRAME_TIMEOUT);
+    setZslRing(NULL);
+
     if (stream->getWidth() != Width || stream->getHeight() != Height) {
         ALOGD("Context Changed!!!(%dx%d --> %dx%d)", Width, Height, stream->getWidth(), stream->getHeight());
         Width = stream->getWidth();
@@ -118,11 +147,20 @@ status_t PreviewThread::readyToRun()
         }
     }
 
+    size_t zslDepth = getZslDepth();
+
     if (UseZoom) {
         uint32_t zoomFormat;
         zoomFormat = PIXINDEX2PIXFORMAT(PixelIndex);
 
-        if (false == ZoomController->allocBuffer(MAX_PREVIEW_ZOOM_BUFFER, Width, Height, zoomFormat)) {
+        // frames held by the zsl ring or the fan-out are out of the driver, add them on top
+        int bufferCount = MAX_PREVIEW_ZOOM_BUFFER + zslDepth;
+        if (useRecordFanout())
+            bufferCount += FANOUT_HELD_BUFFER;
+        if (ZoomController->getBufferCount() > 0 && ZoomController->getBufferCount() != bufferCount)
+            ZoomController->freeBuffer();
+
+        if (false == ZoomController->allocBuffer(bufferCount, Width, Height, zoomFormat)) {
             ALOGE("failed to allocate preview zoom buffer");
             return NO_MEMORY;
         }
@@ -139,7 +177,18 @@ status_t PreviewThread::readyToRun()
                 return NO_INIT;
             }
         }
+
+        if (zslDepth > 0) {
+            ALOGD("zsl ring depth %d", zslDepth);
+            setZslRing(new NXZslRing(zslDepth));
+        }
+        getStreamFanout()->setSource(Width, Height, PIXINDEX2PIXCODE(PixelIndex));
     } else {
+        if (zslDepth > 0)
+            ALOGW("zsl needs internal preview buffers, not available with sensor zoom");
+        if (useRecordFanout())
+            ALOGW("fan-out needs internal preview buffers, not available with sensor zoom");
+
         size_t queuedSize = stream->getQueuedSize();
         ret = v4l2_reqbuf(Id, queuedSize);
         if (ret < 0) {
@@ -169,6 +218,7 @@ status_t PreviewThread::readyToRun()
     }
 
     InitialSkipCount = get_board_preview_skip_frame(SensorId);
+    SensorControl = StreamManager->getSensorControl();
 
     ALOGD("readyToRun exit");
     return NO_ERROR;
@@ -179,7 +229,12 @@ bool PreviewThread::threadLoop()
     int dqIdx;
     int ret;
     nsecs_t timestamp;
+    nsecs_t zslTimestamp = 0;
     buffer_handle_t *buf = NULL;
+    struct nxp_vid_buffer *srcBuf = NULL;
+    sp<NXStreamFanout> fanout = getStreamFanout();
+    NXFrameStats::Sample sample;
+    nsecs_t sensorTimestamp;
 
     NXStream *stream = getActiveStream();
     if (!stream) {
@@ -187,20 +242,28 @@ bool PreviewThread::threadLoop()
         ERROR_EXIT();
     }
 
-    ret = v4l2_dqbuf(Id, PlaneNum, &dqIdx, NULL);
+    ret = v4l2_dqbuf_timestamp(Id, PlaneNum, &dqIdx, &sensorTimestamp);
     if (ret < 0) {
         ALOGE("failed to v4l2_dqbuf for preview");
         ERROR_EXIT();
     }
     ALOGV("dqIdx: %d", dqIdx);
+    memset(&sample, 0, sizeof(sample));
+    sample.Stage[NXFrameStats::STAGE_DQBUF] = NXFrameStats::now();
+    if (SensorControl != NULL)
+        SensorControl->frameBoundary(sample.Stage[NXFrameStats::STAGE_DQBUF]);
+#ifndef USE_SYSTEM_TIMESTAMP
+    sample.Stage[NXFrameStats::STAGE_SENSOR] = sensorTimestamp;
+#endif
 
     if (InitialSkipCount) {
         InitialSkipCount--;
         ALOGV("Preview Skip Frame: %d", InitialSkipCount);
         stream->cancelBuffer();
+        getFrameStats()->countSkip();
     } else {
         if (UseZoom) {
-            struct nxp_vid_buffer *srcBuf = ZoomController->getBuffer(dqIdx);
+            srcBuf = ZoomController->getBuffer(dqIdx);
             private_handle_t const *dstHandle = stream->getNextBuffer();
             if (!dstHandle) {
                 ALOGE("can't get dstHandle!!!");
@@ -210,9 +273,12 @@ bool PreviewThread::threadLoop()
             ZoomController->handleZoom(srcBuf, dstHandle);
             ALOGV("end handleZoom()");
         }
+        sample.Stage[NXFrameStats::STAGE_PROCESS] = NXFrameStats::now();
         CHECK_AND_EXIT();
 
         timestamp = systemTime(SYSTEM_TIME_MONOTONIC);
+        // zsl picks the frame exposed closest to the trigger
+        zslTimestamp = sample.Stage[NXFrameStats::STAGE_SENSOR] ? sample.Stage[NXFrameStats::STAGE_SENSOR] : timestamp;
         ret = stream->enqueueBuffer(timestamp);
         ALOGV("enqueueBuffer end(timestamp: %llu)", timestamp);
 
@@ -220,6 +286,10 @@ bool PreviewThread::threadLoop()
             ALOGE("failed to enqueue_buffer (idx:%d)", dqIdx);
             ERROR_EXIT();
         }
+        sample.Stage[NXFrameStats::STAGE_ENQUEUE] = NXFrameStats::now();
+        getFrameHandoff()->publish(stream->getLastEnqueuedBuffer(), Width, Height, timestamp);
+        if (srcBuf && fanout->hasOutputs())
+            fanout->publish(dqIdx, srcBuf, timestamp);
     }
 
     CHECK_AND_EXIT();
@@ -230,9 +300,14 @@ bool PreviewThread::threadLoop()
     }
     ALOGV("End dequeueBuffer()");
 
-    if (UseZoom)
-        ret = v4l2_qbuf(Id, PlaneNum, dqIdx, ZoomController->getBuffer(dqIdx), -1, NULL);
-    else
+    if (UseZoom) {
+        sp<NXZslRing> zslRing = getZslRing();
+        int requeue[MAX_NUM_FRAMES + 1];
+        size_t count = nxPreviewRequeue(dqIdx, zslRing.get(), zslTimestamp, fanout.get(), requeue);
+        ret = 0;
+        for (size_t i = 0; i < count && ret == 0; i++)
+            ret = v4l2_qbuf(Id, PlaneNum, requeue[i], ZoomController->getBuffer(requeue[i]), -1, NULL);
+    } else
         ret = v4l2_qbuf(Id, PlaneNum, dqIdx, reinterpret_cast<private_handle_t const *>(*buf), -1, NULL);
     if (ret) {
         ALOGE("failed to v4l2_qbuf()");
@@ -240,6 +315,11 @@ bool PreviewThread::threadLoop()
     }
     ALOGV("End v4l2_qbuf()");
 
+    if (sample.Stage[NXFrameStats::STAGE_ENQUEUE]) {
+        sample.Stage[NXFrameStats::STAGE_QBUF] = NXFrameStats::now();
+        getFrameStats()->commit(sample);
+    }
+
     CHECK_AND_EXIT();
 
     return true;
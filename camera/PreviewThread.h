@@ -33,11 +33,13 @@ protected:
 
 private:
     virtual bool threadLoop();
+    size_t getZslDepth();
 
 private:
     bool UseZoom;
     uint32_t PlaneNum;
     uint32_t Format;
+    sp<NXSensorControlThread> SensorControl;
 };
 
 }; // namespace
@@ -19,11 +19,14 @@ RecordThread::RecordThread(nxp_v4l2_id id,
         int height,
         sp<NXZoomController> &zoomController,
         sp<NXStreamManager> &streamManager)
-    : NXStreamThread(id, width, height, zoomController, streamManager)
+    : NXStreamThread(id, width, height, zoomController, streamManager),
+      UseFanout(false),
+      FanoutOutput(-1)
 {
     init(id);
     UseZoom = ZoomController->useZoom();
     if (UseZoom) {
+        ZoomController->setSmoothFrames(ZOOM_SMOOTH_FRAMES);
         PlaneNum = 3;
         Format = V4L2_PIX_FMT_YUV420M;
     } else {
@@ -67,6 +70,21 @@ status_t RecordThread::readyToRun()
         return NO_INIT;
     }
 
+    if (UseZoom && useRecordFanout()) {
+        NXStreamThread *previewThread = StreamManager->getStreamThread(STREAM_ID_PREVIEW);
+        if (previewThread) {
+            Fanout = previewThread->getStreamFanout();
+            FanoutOutput = Fanout->addOutput(Width, Height);
+            UseFanout = FanoutOutput >= 0;
+            if (UseFanout) {
+                ALOGD("record %dx%d from preview fan-out output %d", Width, Height, FanoutOutput);
+                return NO_ERROR;
+            }
+            Fanout.clear();
+        }
+        ALOGW("can't use preview fan-out, record from its own path");
+    }
+
     int ret = v4l2_set_format(Id, Width, Height, Format);
     if (ret < 0) {
         ALOGE("failed to v4l2_set_format for %d", Id);
@@ -126,12 +144,76 @@ status_t RecordThread::readyToRun()
     return NO_ERROR;
 }
 
+status_t RecordThread::stop(bool waitExit, bool streamOff)
+{
+    // the record device never streamed with the fan-out
+    status_t ret = NXStreamThread::stop(waitExit, streamOff && !UseFanout);
+    if (UseFanout) {
+        Fanout->removeOutput(FanoutOutput);
+        Fanout.clear();
+        FanoutOutput = -1;
+        UseFanout = false;
+    }
+    return ret;
+}
+
+/* scale or copy the latest preview frame into the record stream */
+bool RecordThread::fanoutLoop(NXStream *stream)
+{
+    NXStreamFanout::Frame frame;
+    NXFrameStats::Sample sample;
+    buffer_handle_t *buf;
+
+    status_t res = Fanout->take(FanoutOutput, frame, FANOUT_FRAME_TIMEOUT);
+    if (res == TIMED_OUT) {
+        CHECK_AND_EXIT();
+        return true;
+    }
+    if (res != NO_ERROR) {
+        ALOGE("failed to take fan-out frame(%d)", res);
+        ERROR_EXIT();
+    }
+    memset(&sample, 0, sizeof(sample));
+    sample.Stage[NXFrameStats::STAGE_DQBUF] = NXFrameStats::now();
+
+    // the record buffer is the framework's, a frame of its size is copied into it 1:1
+    private_handle_t const *dstHandle = stream->getNextBuffer();
+    bool rendered = dstHandle && Fanout->render(FanoutOutput, frame, dstHandle);
+    nsecs_t timestamp = frame.Timestamp;
+    Fanout->release(FanoutOutput, frame);
+    if (!rendered) {
+        ALOGE("failed to render fan-out frame");
+        ERROR_EXIT();
+    }
+    sample.Stage[NXFrameStats::STAGE_PROCESS] = NXFrameStats::now();
+
+    CHECK_AND_EXIT();
+
+    stream->setTimestamp(timestamp);
+    res = stream->enqueueBuffer(timestamp);
+    if (res != NO_ERROR) {
+        ALOGE("failed to enqueue_buffer");
+        ERROR_EXIT();
+    }
+    sample.Stage[NXFrameStats::STAGE_ENQUEUE] = NXFrameStats::now();
+
+    res = stream->dequeueBuffer(&buf);
+    if (res != NO_ERROR || buf == NULL) {
+        ALOGE("failed to dequeue_buffer");
+        ERROR_EXIT();
+    }
+    getFrameStats()->commit(sample);
+
+    return true;
+}
+
 bool RecordThread::threadLoop()
 {
     int dqIdx;
     int ret;
     nsecs_t timestamp;
     buffer_handle_t *buf;
+    NXFrameStats::Sample sample;
 
     NXStream *stream = getActiveStream();
     if (!stream) {
@@ -139,13 +221,18 @@ bool RecordThread::threadLoop()
         ERROR_EXIT();
     }
 
+    if (UseFanout)
+        return fanoutLoop(stream);
+
     ALOGV("dqEnter");
-    ret = v4l2_dqbuf(Id, PlaneNum, &dqIdx, NULL);
+    ret = v4l2_dqbuf_timestamp(Id, PlaneNum, &dqIdx, &timestamp);
     if (ret < 0) {
         ALOGE("failed to v4l2_dqbuf for %d", Id);
         return false;
     }
     ALOGV("dqIdx: %d", dqIdx);
+    memset(&sample, 0, sizeof(sample));
+    sample.Stage[NXFrameStats::STAGE_DQBUF] = NXFrameStats::now();
 
     CHECK_AND_EXIT();
 
@@ -154,14 +241,12 @@ bool RecordThread::threadLoop()
         private_handle_t const *dstHandle = stream->getNextBuffer();
         ZoomController->handleZoom(srcBuf, dstHandle);
     }
+    sample.Stage[NXFrameStats::STAGE_PROCESS] = NXFrameStats::now();
 
 #ifdef USE_SYSTEM_TIMESTAMP
     ret = stream->enqueueBuffer(systemTime(SYSTEM_TIME_MONOTONIC));
 #else
-    ret = v4l2_get_timestamp(Id, &timestamp);
-    if (ret < 0)
-        ALOGE("failed to v4l2_get_timestamp for %d", Id);
-
+    sample.Stage[NXFrameStats::STAGE_SENSOR] = timestamp;
     ALOGV("timestamp: %llu", timestamp);
     stream->setTimestamp(timestamp);
 
@@ -172,6 +257,7 @@ bool RecordThread::threadLoop()
         ERROR_EXIT();
     }
     ALOGV("end enqueueBuffer");
+    sample.Stage[NXFrameStats::STAGE_ENQUEUE] = NXFrameStats::now();
 
     ret = stream->dequeueBuffer(&buf);
     if (ret != NO_ERROR || buf == NULL) {
@@ -189,6 +275,8 @@ bool RecordThread::threadLoop()
         ERROR_EXIT();
     }
     ALOGV("end v4l2_qbuf");
+    sample.Stage[NXFrameStats::STAGE_QBUF] = NXFrameStats::now();
+    getFrameStats()->commit(sample);
 
     return true;
 }
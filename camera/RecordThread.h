@@ -27,17 +27,24 @@ public:
 
     virtual status_t readyToRun();
     virtual void onCommand(int32_t streamId, camera_metadata_t *metadata);
+    virtual status_t stop(bool waitExit, bool streamOff = true);
 
 protected:
     virtual void init(nxp_v4l2_id id);
 
 private:
     virtual bool threadLoop();
+    bool fanoutLoop(NXStream *stream);
 
 private:
     bool UseZoom;
     uint32_t PlaneNum;
     uint32_t Format;
+
+    // frames come from the preview fan-out instead of the record device
+    bool UseFanout;
+    sp<NXStreamFanout> Fanout;
+    int FanoutOutput;
 };
 
 }; // namespace
@@ -1,4 +1,6 @@
+#ifndef LOG_TAG
 #define LOG_TAG "ScalerZoomController"
+#endif
 
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -26,9 +28,14 @@ ScalerZoomController::ScalerZoomController()
      SrcLeft(0),
      SrcTop(0),
      SrcWidth(0),
-     SrcHeight(0)
+     SrcHeight(0),
+     SourceWidth(0),
+     SourceHeight(0),
+     SmoothFrames(0),
+     SmoothSteps(0)
 {
     memset(&ZoomContext, 0, sizeof(struct scale_ctx));
+    memset(&TargetContext, 0, sizeof(struct scale_ctx));
 }
 
 ScalerZoomController::ScalerZoomController(int cropLeft,
@@ -47,9 +54,14 @@ ScalerZoomController::ScalerZoomController(int cropLeft,
      SrcLeft(0),
      SrcTop(0),
      SrcWidth(0),
-     SrcHeight(0)
+     SrcHeight(0),
+     SourceWidth(0),
+     SourceHeight(0),
+     SmoothFrames(0),
+     SmoothSteps(0)
 {
     memset(&ZoomContext, 0, sizeof(struct scale_ctx));
+    memset(&TargetContext, 0, sizeof(struct scale_ctx));
     setCrop(cropLeft, cropTop, cropWidth, cropHeight);
 }
 
@@ -66,11 +78,104 @@ void ScalerZoomController::useDefault()
     ZoomContext.src_height = BaseHeight;
     ZoomContext.dst_width  = Width;
     ZoomContext.dst_height = Height;
+    TargetContext = ZoomContext;
+    SmoothSteps = 0;
+}
+
+int ScalerZoomController::classify(const struct scale_ctx &ctx)
+{
+    if (ctx.src_width != ctx.dst_width || ctx.src_height != ctx.dst_height)
+        return ZOOM_SCALE;
+    if (ctx.left || ctx.top)
+        return ZOOM_CROP;
+    return ZOOM_IDENTITY;
+}
+
+int ScalerZoomController::getZoomMode()
+{
+    Mutex::Autolock l(ZoomLock);
+    return classify(ZoomContext);
+}
+
+bool ScalerZoomController::getCropView(const struct nxp_vid_buffer *srcBuffer, struct nxp_vid_buffer *view)
+{
+    Mutex::Autolock l(ZoomLock);
+    int mode = classify(ZoomContext);
+    if (mode == ZOOM_SCALE)
+        return false;
+
+    *view = *srcBuffer;
+    if (mode == ZOOM_IDENTITY)
+        return true;
+
+    // left is 32 aligned, the chroma offsets stay 16 aligned
+    uint32_t left = ZoomContext.left;
+    uint32_t top  = ZoomContext.top;
+    unsigned long offset[MAX_BUFFER_PLANES] = { 0, };
+    switch (ZoomContext.src_code) {
+    case PIXCODE_YUV422_PACKED:
+        offset[0] = top * srcBuffer->stride[0] + (left << 1);
+        break;
+    case PIXCODE_YUV420_PLANAR:
+        offset[0] = top * srcBuffer->stride[0] + left;
+        offset[1] = (top >> 1) * srcBuffer->stride[1] + (left >> 1);
+        offset[2] = (top >> 1) * srcBuffer->stride[2] + (left >> 1);
+        break;
+    case PIXCODE_YUV422_PLANAR:
+        offset[0] = top * srcBuffer->stride[0] + left;
+        offset[1] = top * srcBuffer->stride[1] + (left >> 1);
+        offset[2] = top * srcBuffer->stride[2] + (left >> 1);
+        break;
+    case PIXCODE_YUV444_PLANAR:
+        offset[0] = top * srcBuffer->stride[0] + left;
+        offset[1] = top * srcBuffer->stride[1] + left;
+        offset[2] = top * srcBuffer->stride[2] + left;
+        break;
+    default:
+        ALOGE("can't make crop view of code 0x%x", ZoomContext.src_code);
+        return false;
+    }
+
+    // a contiguous buffer shares fd and mapping between its planes
+    for (int i = 0; i < MAX_BUFFER_PLANES; i++) {
+        if (!offset[i])
+            continue;
+        view->phys[i] += offset[i];
+        if (view->virt[i])
+            view->virt[i] += offset[i];
+        view->sizes[i] -= offset[i];
+    }
+    return true;
+}
+
+/* move the crop one frame towards the target, buffers are left alone */
+void ScalerZoomController::stepLocked()
+{
+    if (SmoothSteps <= 0)
+        return;
+
+    if (SmoothSteps == 1) {
+        ZoomContext = TargetContext;
+    } else {
+        ZoomContext.left += (int)(TargetContext.left - ZoomContext.left) / SmoothSteps;
+        ZoomContext.left  = (ZoomContext.left + 16) & (~31);
+        ZoomContext.top  += (int)(TargetContext.top - ZoomContext.top) / SmoothSteps;
+        ZoomContext.src_width  += (int)(TargetContext.src_width - ZoomContext.src_width) / SmoothSteps;
+        ZoomContext.src_height += (int)(TargetContext.src_height - ZoomContext.src_height) / SmoothSteps;
+        if ((ZoomContext.left + ZoomContext.src_width) > (uint32_t)getSourceWidth())
+            ZoomContext.src_width = getSourceWidth() - ZoomContext.left;
+        if ((ZoomContext.top + ZoomContext.src_height) > (uint32_t)getSourceHeight())
+            ZoomContext.src_height = getSourceHeight() - ZoomContext.top;
+    }
+    SmoothSteps--;
+    ALOGV("zoom step: left %d, top %d, src_width %d, src_height %d, %d steps left",
+            ZoomContext.left, ZoomContext.top, ZoomContext.src_width, ZoomContext.src_height, SmoothSteps);
 }
 
 bool ScalerZoomController::handleZoom(struct nxp_vid_buffer *srcBuffer, private_handle_t const *dstHandle)
 {
     Mutex::Autolock l(ZoomLock);
+    stepLocked();
     if (nxScalerRun(srcBuffer, dstHandle, &ZoomContext)) {
         ALOGE("failed to nxScalerRun()");
         return false;
@@ -81,6 +186,7 @@ bool ScalerZoomController::handleZoom(struct nxp_vid_buffer *srcBuffer, private_
 bool ScalerZoomController::handleZoom(struct nxp_vid_buffer *srcBuffer, struct nxp_vid_buffer *dstBuffer)
 {
     Mutex::Autolock l(ZoomLock);
+    stepLocked();
     if (nxScalerRun(srcBuffer, dstBuffer, &ZoomContext)) {
         ALOGE("failed to nxScalerRun()");
         return false;
@@ -91,6 +197,7 @@ bool ScalerZoomController::handleZoom(struct nxp_vid_buffer *srcBuffer, struct n
 bool ScalerZoomController::handleZoom(private_handle_t const *srcHandle, struct nxp_vid_buffer *dstBuffer)
 {
     Mutex::Autolock l(ZoomLock);
+    stepLocked();
     if (nxScalerRun(srcHandle, dstBuffer, &ZoomContext)) {
         ALOGE("failed to nxScalerRun()");
         return false;
@@ -101,6 +208,7 @@ bool ScalerZoomController::handleZoom(private_handle_t const *srcHandle, struct
 bool ScalerZoomController::handleZoom(private_handle_t const *srcHandle, private_handle_t const *dstHandle)
 {
     Mutex::Autolock l(ZoomLock);
+    stepLocked();
     if (nxScalerRun(srcHandle, dstHandle, &ZoomContext)) {
         ALOGE("failed to nxScalerRun()");
         return false;
@@ -115,49 +223,81 @@ void ScalerZoomController::setCrop(int left, int top, int width, int height)
         SrcTop = top;
         SrcWidth = width;
         SrcHeight = height;
+        // a crop already in use is stepped towards the new one by handleZoom()
+        calcCrop(true);
+    }
+}
 
-        int calcLeft, calcTop, calcWidth, calcHeight;
-
-        if (!Width || !Height || !BaseWidth || !BaseHeight) {
-            ALOGE("invalid wxh(%dx%d), base wxh(%dx%d)", Width, Height, BaseWidth, BaseHeight);
-            return;
-        }
-
-        if (BaseWidth == width) {
-            calcLeft  = 0;
-            calcWidth = Width;
-        } else {
-            calcLeft  = left * Width / BaseWidth;
-            calcWidth = width * Width / BaseWidth;
-        }
-
-        if (BaseHeight == height) {
-            calcTop = 0;
-            calcHeight = Height;
-        } else {
-            calcTop = top * Height / BaseHeight;
-            calcHeight = height * Height / BaseHeight;
-        }
-
-        // align 32pixel for cb,cr 16pixel align
-        calcLeft = (calcLeft + 31) & (~31);
-
-        // check!
-        if ((calcLeft + calcWidth) > Width)
-            calcWidth = Width - calcLeft;
-        if ((calcTop + calcHeight) > Height)
-            calcHeight = Height - calcTop;
-        Mutex::Autolock l(ZoomLock);
-        ZoomContext.left = calcLeft;
-        ZoomContext.top  = calcTop;
-        ZoomContext.src_width  = calcWidth;
-        ZoomContext.src_height = calcHeight;
-        ZoomContext.dst_width  = Width;
-        ZoomContext.dst_height = Height;
-
-        ALOGD("Width %d, Height %d, BaseWidth %d, BaseHeight %d, left %d, top %d, src_width %d, src_height %d, dst_width %d, dst_height %d, src_code 0x%x, dst_code 0x%x",
-                Width, Height, BaseWidth, BaseHeight, calcLeft, calcTop, calcWidth, calcHeight, Width, Height, ZoomContext.src_code, ZoomContext.dst_code);
+void ScalerZoomController::setSource(int width, int height)
+{
+    SourceWidth = width;
+    SourceHeight = height;
+    if (SrcWidth && SrcHeight)
+        calcCrop(false);
+}
+
+void ScalerZoomController::setDest(int width, int height)
+{
+    Width = width;
+    Height = height;
+    if (SrcWidth && SrcHeight)
+        calcCrop(false);
+}
+
+/* map the crop of the base into the source buffer */
+void ScalerZoomController::calcCrop(bool smooth)
+{
+    int calcLeft, calcTop, calcWidth, calcHeight;
+    int srcWidth  = getSourceWidth();
+    int srcHeight = getSourceHeight();
+
+    if (!Width || !Height || !BaseWidth || !BaseHeight) {
+        ALOGE("invalid wxh(%dx%d), base wxh(%dx%d)", Width, Height, BaseWidth, BaseHeight);
+        return;
+    }
+
+    if (BaseWidth == SrcWidth) {
+        calcLeft  = 0;
+        calcWidth = srcWidth;
+    } else {
+        calcLeft  = SrcLeft * srcWidth / BaseWidth;
+        calcWidth = SrcWidth * srcWidth / BaseWidth;
+    }
+
+    if (BaseHeight == SrcHeight) {
+        calcTop = 0;
+        calcHeight = srcHeight;
+    } else {
+        calcTop = SrcTop * srcHeight / BaseHeight;
+        calcHeight = SrcHeight * srcHeight / BaseHeight;
     }
+
+    // align 32pixel for cb,cr 16pixel align
+    calcLeft = (calcLeft + 31) & (~31);
+
+    // check!
+    if ((calcLeft + calcWidth) > srcWidth)
+        calcWidth = srcWidth - calcLeft;
+    if ((calcTop + calcHeight) > srcHeight)
+        calcHeight = srcHeight - calcTop;
+    Mutex::Autolock l(ZoomLock);
+    smooth = smooth && SmoothFrames > 1 && ZoomContext.src_width && ZoomContext.src_height;
+    TargetContext.left = calcLeft;
+    TargetContext.top  = calcTop;
+    TargetContext.src_width  = calcWidth;
+    TargetContext.src_height = calcHeight;
+    TargetContext.dst_width  = Width;
+    TargetContext.dst_height = Height;
+    if (smooth) {
+        SmoothSteps = SmoothFrames;
+    } else {
+        ZoomContext = TargetContext;
+        SmoothSteps = 0;
+    }
+
+    ALOGD("Width %d, Height %d, BaseWidth %d, BaseHeight %d, left %d, top %d, src_width %d, src_height %d, dst_width %d, dst_height %d, src_code 0x%x, dst_code 0x%x, mode %d",
+            Width, Height, BaseWidth, BaseHeight, calcLeft, calcTop, calcWidth, calcHeight, Width, Height,
+            TargetContext.src_code, TargetContext.dst_code, classify(TargetContext));
 }
 
 }; // namespace
@@ -19,17 +19,12 @@ public:
         BaseWidth  = baseWidth;
         BaseHeight = baseHeight;
     }
-    virtual void setSource(int width, int height) {
-        SrcWidth = width;
-        SrcHeight = height;
-    }
-    virtual void SetDest(int width, int height) {
-        Width = width;
-        Height = height;
-    }
+    virtual void setSource(int width, int height);
+    virtual void setDest(int width, int height);
     virtual void setFormat(int srcFormat, int dstFormat) {
-        ZoomContext.src_code = srcFormat;
-        ZoomContext.dst_code = dstFormat;
+        Mutex::Autolock l(ZoomLock);
+        ZoomContext.src_code = TargetContext.src_code = srcFormat;
+        ZoomContext.dst_code = TargetContext.dst_code = dstFormat;
     }
     virtual void setCrop(int left, int top, int width, int height);
     virtual void useDefault();
@@ -41,6 +36,24 @@ public:
         return ZoomContext.left != 0 ||
                ZoomContext.top  != 0;
     }
+    virtual int getZoomMode();
+    virtual bool getCropView(const struct nxp_vid_buffer *srcBuffer, struct nxp_vid_buffer *view);
+    virtual void setSmoothFrames(int frames) {
+        Mutex::Autolock l(ZoomLock);
+        SmoothFrames = frames;
+    }
+
+private:
+    static int classify(const struct scale_ctx &ctx);
+    void calcCrop(bool smooth);
+    void stepLocked();
+    // the source buffer is the size of the dest unless set
+    int getSourceWidth() const {
+        return SourceWidth ? SourceWidth : Width;
+    }
+    int getSourceHeight() const {
+        return SourceHeight ? SourceHeight : Height;
+    }
 
 private:
     int Width;
@@ -53,7 +66,13 @@ private:
     int SrcWidth;
     int SrcHeight;
 
-    struct scale_ctx ZoomContext;
+    int SourceWidth;
+    int SourceHeight;
+
+    struct scale_ctx ZoomContext;   // used by the next handleZoom()
+    struct scale_ctx TargetContext; // of the last setCrop()
+    int SmoothFrames;
+    int SmoothSteps;                // left until ZoomContext is TargetContext
     Mutex ZoomLock;
 };
 
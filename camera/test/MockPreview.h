@@ -0,0 +1,114 @@
+#ifndef _MOCK_PREVIEW_H
+#define _MOCK_PREVIEW_H
+
+/*
+ * Mock v4l2 source and preview loop shared by the zsl and fan-out tests,
+ * included by one source file of a test.
+ *
+ * The mock hands out buffer indices in queue order, each stamped with the
+ * time the sensor finished the frame, and fails on starvation or on a double
+ * qbuf. previewFrame() is one PreviewThread::threadLoop() iteration around
+ * the buffer bookkeeping of the thread itself, nxPreviewRequeue().
+ * nxScalerRun() only records the scale context.
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include <NXScaler.h>
+
+#include "NXPreviewRequeue.h"
+
+#define FRAME_INTERVAL      33000000LL /* ~30fps, even so the halfway point is exact */
+
+static struct scale_ctx lastContext;
+static int scaleCount = 0;
+
+int nxScalerRun(const struct nxp_vid_buffer *srcBuf, const struct nxp_vid_buffer *dstBuf, const struct scale_ctx *ctx)
+{
+    lastContext = *ctx;
+    scaleCount++;
+    return 0;
+}
+
+int nxScalerRun(const struct nxp_vid_buffer *srcBuf, private_handle_t const *dstHandle, const struct scale_ctx *ctx)
+{
+    lastContext = *ctx;
+    scaleCount++;
+    return 0;
+}
+
+class MockV4l2Source
+{
+public:
+    MockV4l2Source(int bufferCount, nsecs_t start = 0)
+        : BufferCount(bufferCount), Head(0), Count(0), Now(start) {
+        memset(Queued, 0, sizeof(Queued));
+        memset(Buffers, 0, sizeof(Buffers));
+        for (int i = 0; i < bufferCount; i++)
+            qbuf(i);
+    }
+
+    int qbuf(int index) {
+        if (index < 0 || index >= BufferCount || Queued[index]) {
+            printf("bad qbuf %d\n", index);
+            return -1;
+        }
+        Fifo[(Head + Count) % MAX_NUM_FRAMES] = index;
+        Count++;
+        Queued[index] = true;
+        return 0;
+    }
+
+    // blocks for one frame interval, returns the oldest queued buffer
+    int dqbuf(int *index, nsecs_t *timestamp) {
+        if (Count == 0)
+            return -1;
+        Now += FRAME_INTERVAL;
+        *index = Fifo[Head];
+        *timestamp = Now;
+        Head = (Head + 1) % MAX_NUM_FRAMES;
+        Count--;
+        Queued[*index] = false;
+        return 0;
+    }
+
+    struct nxp_vid_buffer *getBuffer(int index) {
+        return &Buffers[index];
+    }
+    int queuedCount() const {
+        return Count;
+    }
+    nsecs_t now() const {
+        return Now;
+    }
+
+private:
+    int BufferCount;
+    int Fifo[MAX_NUM_FRAMES];
+    bool Queued[MAX_NUM_FRAMES];
+    struct nxp_vid_buffer Buffers[MAX_NUM_FRAMES];
+    int Head;
+    int Count;
+    nsecs_t Now;
+};
+
+/* dq, publish to the fan-out, give back what neither the ring nor an output keeps */
+static int previewFrame(MockV4l2Source &source, android::NXZslRing *ring, android::NXStreamFanout &fanout)
+{
+    int index;
+    nsecs_t timestamp;
+    if (source.dqbuf(&index, &timestamp) < 0)
+        return -1;
+    if (fanout.hasOutputs())
+        fanout.publish(index, source.getBuffer(index), timestamp);
+
+    int requeue[MAX_NUM_FRAMES + 1];
+    size_t n = android::nxPreviewRequeue(index, ring, timestamp, &fanout, requeue);
+    for (size_t i = 0; i < n; i++) {
+        if (source.qbuf(requeue[i]) < 0)
+            return -1;
+    }
+    return 0;
+}
+
+#endif
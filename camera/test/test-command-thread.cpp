@@ -0,0 +1,319 @@
+/*
+ * NXCommandThread test with a mock request queue.
+ *
+ * The real command thread drains a mock camera2 request queue and hands the
+ * requests to mock stream listeners, the mock board sensor stands in for
+ * get_board_camera_sensor(). A listener takes SWITCH_TIME_US to change mode
+ * like a stop and start of the v4l2 stream. Mode switch latency is the time
+ * from the submission of a request to the return of waitIdle().
+ */
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include <cutils/log.h>
+#include <system/camera_metadata.h>
+
+#include <NXTest.h>
+
+#include "NXCommandThread.h"
+
+using namespace android;
+
+#define SWITCH_TIME_US      5000
+#define POLL_TIME_NS        (100*1000*1000LL) /* the usleep() waitIdle() had */
+#define TIMEOUT             (1000*1000*1000LL)
+#define MAX_REQUESTS        64
+#define SENSOR_WIDTH        1280
+#define SENSOR_HEIGHT       720
+
+class MockBoardSensor : public NXCameraBoardSensor
+{
+public:
+    MockBoardSensor() {
+        Width = SENSOR_WIDTH;
+        Height = SENSOR_HEIGHT;
+    }
+    virtual int applyControls(const NXSensorControlSet &set) {
+        return 0;
+    }
+    virtual void setAfMode(uint8_t afMode) {}
+    virtual void afEnable(bool enable) {}
+    virtual void setEffectMode(uint8_t effectMode) {}
+    virtual void setSceneMode(uint8_t sceneMode) {}
+    virtual void setAntibandingMode(uint8_t antibandingMode) {}
+    virtual void setAwbMode(uint8_t awbMode) {}
+    virtual void setExposure(int32_t exposure) {}
+    virtual uint32_t getZoomFactor(void) {
+        return 1;
+    }
+    virtual status_t setZoomCrop(uint32_t left, uint32_t top, uint32_t width, uint32_t height) {
+        return NO_ERROR;
+    }
+};
+
+NXCameraBoardSensor *android::get_board_camera_sensor(int id)
+{
+    return new MockBoardSensor();
+}
+
+NXCameraBoardSensor *android::get_board_camera_sensor_by_v4l2_id(int v4l2_id)
+{
+    return NULL;
+}
+
+uint32_t android::get_board_camera_orientation(int cameraId)
+{
+    return 0;
+}
+
+struct MockRequestQueue {
+    camera2_request_queue_src_ops_t ops; // must be first
+    Mutex Lock;
+    camera_metadata_t *Requests[MAX_REQUESTS];
+    int Head;
+    int Count;
+    int Freed;
+
+    MockRequestQueue() : Head(0), Count(0), Freed(0) {
+        ops.request_count = requestCount;
+        ops.dequeue_request = dequeueRequest;
+        ops.free_request = freeRequest;
+    }
+    ~MockRequestQueue() {
+        camera_metadata_t *request;
+        while (dequeueRequest(&ops, &request) == 0 && request)
+            free_camera_metadata(request);
+    }
+
+    // the output stream and the width of the crop region of a request
+    void enqueue(int32_t streamId, int32_t cropWidth = SENSOR_WIDTH) {
+        camera_metadata_t *request = allocate_camera_metadata(2, 32);
+        int32_t crop[3] = { 0, 0, cropWidth };
+        add_camera_metadata_entry(request, ANDROID_REQUEST_OUTPUT_STREAMS, &streamId, 1);
+        add_camera_metadata_entry(request, ANDROID_SCALER_CROP_REGION, crop, 3);
+        Mutex::Autolock l(Lock);
+        Requests[(Head + Count) % MAX_REQUESTS] = request;
+        Count++;
+    }
+
+    static MockRequestQueue *get(const camera2_request_queue_src_ops_t *ops) {
+        return (MockRequestQueue *)ops;
+    }
+    static int requestCount(const camera2_request_queue_src_ops_t *ops) {
+        MockRequestQueue *q = get(ops);
+        Mutex::Autolock l(q->Lock);
+        return q->Count;
+    }
+    static int dequeueRequest(const camera2_request_queue_src_ops_t *ops, camera_metadata_t **request) {
+        MockRequestQueue *q = get(ops);
+        Mutex::Autolock l(q->Lock);
+        if (q->Count == 0) {
+            *request = NULL;
+            return 0;
+        }
+        *request = q->Requests[q->Head];
+        q->Head = (q->Head + 1) % MAX_REQUESTS;
+        q->Count--;
+        return 0;
+    }
+    static int freeRequest(const camera2_request_queue_src_ops_t *ops, camera_metadata_t *request) {
+        MockRequestQueue *q = get(ops);
+        free_camera_metadata(request);
+        Mutex::Autolock l(q->Lock);
+        q->Freed++;
+        return 0;
+    }
+};
+
+/* a stream thread, running once it got a request */
+class MockStreamListener : public NXCommandThread::CommandListener
+{
+public:
+    MockStreamListener() : Running(false), Starts(0), Commands(0), Zooms(0) {
+    }
+
+    virtual void onCommand(int32_t id, camera_metadata_t *metadata) {
+        if (!metadata)
+            return;
+        Commands++;
+        if (Running)
+            return;
+        usleep(SWITCH_TIME_US);
+        Running = true;
+        Starts++;
+    }
+    virtual void onZoomChanged(int left, int top, int width, int height, int baseWidth, int baseHeight) {
+        Zooms++;
+    }
+    virtual bool isCommandRedundant(int32_t id) {
+        return Running;
+    }
+
+    volatile bool Running;
+    int Starts;
+    int Commands;
+    int Zooms;
+};
+
+class CommandThreadTest
+{
+public:
+    CommandThreadTest() : Sensor(0) {
+        Thread = new NXCommandThread(&Queue.ops, &Sensor);
+        for (int i = 0; i < STREAM_ID_MAX; i++) {
+            Listeners[i] = new MockStreamListener();
+            Thread->registerListener(i, Listeners[i]);
+        }
+    }
+    ~CommandThreadTest() {
+        Thread->requestExit();
+        Thread->join();
+        Thread.clear();
+    }
+
+    // the framework notifying the queue
+    void submit(int32_t streamId, int32_t cropWidth = SENSOR_WIDTH) {
+        Queue.enqueue(streamId, cropWidth);
+        Thread->wakeup();
+    }
+
+    MockRequestQueue Queue;
+    NXCameraSensor Sensor;
+    sp<NXCommandThread> Thread;
+    sp<MockStreamListener> Listeners[STREAM_ID_MAX];
+};
+
+static void testModeSwitchLatency()
+{
+    printf("%s\n", __func__);
+    CommandThreadTest test;
+    test.Thread->run("NXCommandThread");
+
+    nsecs_t max = 0, total = 0;
+    const int switches = 20;
+    for (int i = 0; i < switches; i++) {
+        int32_t stream = (i & 1) ? STREAM_ID_CAPTURE : STREAM_ID_PREVIEW;
+        int32_t other = (i & 1) ? STREAM_ID_PREVIEW : STREAM_ID_CAPTURE;
+        // the stream thread of the other mode stops
+        test.Listeners[other]->Running = false;
+
+        nsecs_t start = systemTime(SYSTEM_TIME_MONOTONIC);
+        test.submit(stream);
+        CHECK(test.Thread->waitIdle(TIMEOUT) == NO_ERROR);
+        nsecs_t latency = systemTime(SYSTEM_TIME_MONOTONIC) - start;
+        // the request is handled once the queue is idle
+        CHECK(test.Listeners[stream]->Running);
+        CHECK(test.Thread->getInProgressCount() == 0);
+        total += latency;
+        if (latency > max)
+            max = latency;
+    }
+
+    printf("\tmode switch avg %.2fms max %.2fms\n", total / switches / 1000000.0, max / 1000000.0);
+    CHECK(test.Listeners[STREAM_ID_PREVIEW]->Starts + test.Listeners[STREAM_ID_CAPTURE]->Starts == switches);
+    CHECK(test.Queue.Freed == switches);
+    // a polling waiter would see the switch a poll period late
+    CHECK(max < POLL_TIME_NS / 2);
+}
+
+static void testCoalesce()
+{
+    printf("%s\n", __func__);
+    CommandThreadTest test;
+
+    // notifications before the thread picks up the pass share one token
+    for (int i = 0; i < 10; i++)
+        test.submit(STREAM_ID_PREVIEW);
+    test.submit(STREAM_ID_CAPTURE);
+    CHECK(test.Thread->getInProgressCount() == 1);
+
+    test.Thread->run("NXCommandThread");
+    CHECK(test.Thread->waitIdle(TIMEOUT) == NO_ERROR);
+    NXCommandCompletion::Stats stats = test.Thread->getCompletionStats();
+    CHECK(stats.submitted == 11);
+    CHECK(stats.coalesced == 10);
+    CHECK(stats.passes == 1);
+    CHECK(test.Queue.Freed == 11);
+
+    // repeated requests don't reach the running stream thread
+    sp<MockStreamListener> preview = test.Listeners[STREAM_ID_PREVIEW];
+    CHECK(preview->Starts == 1);
+    CHECK(preview->Commands == 1);
+    CHECK(test.Listeners[STREAM_ID_CAPTURE]->Commands == 1);
+
+    // a zoom in between is not a repeat, all three go in one pass
+    test.Queue.enqueue(STREAM_ID_PREVIEW);
+    test.Queue.enqueue(STREAM_ID_PREVIEW, SENSOR_WIDTH / 2);
+    test.Queue.enqueue(STREAM_ID_PREVIEW, SENSOR_WIDTH / 2);
+    test.Thread->wakeup();
+    CHECK(test.Thread->waitIdle(TIMEOUT) == NO_ERROR);
+    CHECK(preview->Zooms == 1);
+    CHECK(preview->Commands == 3);
+    CHECK(preview->Starts == 1);
+    CHECK(test.Thread->getCompletionStats().passes == 2);
+}
+
+static void testTimeout()
+{
+    printf("%s\n", __func__);
+    CommandThreadTest test;
+
+    // nothing submitted, nothing to wait for
+    CHECK(test.Thread->getInProgressCount() == 0);
+    CHECK(test.Thread->waitIdle(0) == NO_ERROR);
+
+    // the thread doesn't run, the request stays queued
+    test.submit(STREAM_ID_PREVIEW);
+    nsecs_t start = systemTime(SYSTEM_TIME_MONOTONIC);
+    CHECK(test.Thread->waitIdle(20*1000*1000LL) == TIMED_OUT);
+    CHECK(systemTime(SYSTEM_TIME_MONOTONIC) - start >= 20*1000*1000LL);
+    CHECK(test.Thread->getInProgressCount() == 1);
+    CHECK(test.Listeners[STREAM_ID_PREVIEW]->Commands == 0);
+
+    test.Thread->run("NXCommandThread");
+    CHECK(test.Thread->waitIdle(TIMEOUT) == NO_ERROR);
+    CHECK(test.Thread->getInProgressCount() == 0);
+    CHECK(test.Listeners[STREAM_ID_PREVIEW]->Commands == 1);
+}
+
+struct WaiterArgs {
+    NXCommandThread *thread;
+    status_t result;
+};
+
+static void *waiterLoop(void *data)
+{
+    WaiterArgs *args = (WaiterArgs *)data;
+    args->result = args->thread->waitIdle(TIMEOUT * 10);
+    return NULL;
+}
+
+static void testExit()
+{
+    printf("%s\n", __func__);
+    CommandThreadTest test;
+    WaiterArgs args = { test.Thread.get(), NO_ERROR };
+    pthread_t thread;
+
+    // a pass that never runs, exit wakes its waiter
+    test.submit(STREAM_ID_PREVIEW);
+    pthread_create(&thread, NULL, waiterLoop, &args);
+    usleep(10000);
+    nsecs_t start = systemTime(SYSTEM_TIME_MONOTONIC);
+    test.Thread->requestExit();
+    pthread_join(thread, NULL);
+    CHECK(args.result == DEAD_OBJECT);
+    CHECK(systemTime(SYSTEM_TIME_MONOTONIC) - start < TIMEOUT);
+}
+
+int main(int argc, char *argv[])
+{
+    testModeSwitchLatency();
+    testCoalesce();
+    testTimeout();
+    testExit();
+
+    return testResult();
+}
@@ -0,0 +1,184 @@
+/*
+ * Frame stats test.
+ *
+ * Frames are committed with synthetic stage times, so the latency
+ * percentiles, the fps and the drop count are known. A reader thread
+ * checks that snapshots taken while the writer runs never mix two frames.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include <cutils/log.h>
+
+#include <NXTest.h>
+
+#include "NXFrameStats.h"
+
+using namespace android;
+
+#define FRAME_INTERVAL      33000000LL /* ~30fps */
+
+/* stage n of frame i is at i * FRAME_INTERVAL + n ms, so every delta is a whole ms */
+static void makeSample(NXFrameStats::Sample &sample, int frame)
+{
+    nsecs_t base = frame * FRAME_INTERVAL;
+    sample.Stage[NXFrameStats::STAGE_SENSOR] = base + 1;
+    for (int stage = NXFrameStats::STAGE_DQBUF; stage < NXFrameStats::STAGE_MAX; stage++)
+        sample.Stage[stage] = base + 1 + stage * 1000000LL;
+}
+
+static void testLatency()
+{
+    printf("%s\n", __func__);
+    sp<NXFrameStats> stats = new NXFrameStats();
+    NXFrameStats::Sample sample;
+
+    for (int i = 1; i <= 100; i++) {
+        makeSample(sample, i);
+        stats->commit(sample);
+    }
+
+    String8 result;
+    stats->dump(result, "preview");
+    printf("%s", result.string());
+    CHECK(strstr(result.string(), "100 frames") != NULL);
+    CHECK(strstr(result.string(), "30.3 fps") != NULL);
+    CHECK(strstr(result.string(), "0 dropped") != NULL);
+    CHECK(strstr(result.string(), "dqbuf->enqueue") != NULL);
+    CHECK(strstr(result.string(), "p50   2.00ms") != NULL);
+}
+
+static void testDrops()
+{
+    printf("%s\n", __func__);
+    sp<NXFrameStats> stats = new NXFrameStats();
+    NXFrameStats::Sample sample;
+    int frame = 1;
+
+    for (int i = 0; i < 20; i++) {
+        makeSample(sample, frame++);
+        stats->commit(sample);
+    }
+    // the sensor lost three frames
+    frame += 3;
+    makeSample(sample, frame++);
+    stats->commit(sample);
+    // a skipped frame isn't a drop
+    stats->countSkip();
+    frame++;
+    makeSample(sample, frame++);
+    stats->commit(sample);
+    stats->countDrop();
+
+    String8 result;
+    stats->dump(result, "record");
+    printf("%s", result.string());
+    CHECK(strstr(result.string(), "4 dropped") != NULL);
+    CHECK(strstr(result.string(), "1 skipped") != NULL);
+}
+
+static void testWrap()
+{
+    printf("%s\n", __func__);
+    sp<NXFrameStats> stats = new NXFrameStats();
+    NXFrameStats::Sample sample;
+    NXFrameStats::Sample samples[FRAME_STATS_RING_SIZE];
+
+    for (int i = 1; i <= FRAME_STATS_RING_SIZE * 3 + 5; i++) {
+        makeSample(sample, i);
+        stats->commit(sample);
+    }
+    size_t count = stats->snapshot(samples, FRAME_STATS_RING_SIZE);
+    CHECK(count == FRAME_STATS_RING_SIZE);
+    // oldest first, the last ring size frames
+    CHECK(samples[0].Stage[NXFrameStats::STAGE_SENSOR] == (FRAME_STATS_RING_SIZE * 2 + 6) * FRAME_INTERVAL + 1);
+    for (size_t i = 1; i < count; i++)
+        CHECK(samples[i].Stage[NXFrameStats::STAGE_DQBUF] - samples[i - 1].Stage[NXFrameStats::STAGE_DQBUF] == FRAME_INTERVAL);
+}
+
+static void testReset()
+{
+    printf("%s\n", __func__);
+    sp<NXFrameStats> stats = new NXFrameStats();
+    NXFrameStats::Sample sample;
+    NXFrameStats::Sample samples[FRAME_STATS_RING_SIZE];
+
+    for (int i = 1; i <= 50; i++) {
+        makeSample(sample, i);
+        stats->commit(sample);
+    }
+    // the stream restarts much later, the window holds only the new frames
+    stats->reset();
+    CHECK(stats->snapshot(samples, FRAME_STATS_RING_SIZE) == 0);
+    for (int i = 1000; i < 1010; i++) {
+        makeSample(sample, i);
+        stats->commit(sample);
+    }
+    CHECK(stats->snapshot(samples, FRAME_STATS_RING_SIZE) == 10);
+    CHECK(samples[0].Stage[NXFrameStats::STAGE_SENSOR] == 1000 * FRAME_INTERVAL + 1);
+
+    String8 result;
+    stats->dump(result, "preview");
+    printf("%s", result.string());
+    CHECK(strstr(result.string(), "10 frames") != NULL);
+    CHECK(strstr(result.string(), "30.3 fps") != NULL);
+    CHECK(strstr(result.string(), "0 dropped") != NULL);
+}
+
+struct ReaderArgs {
+    NXFrameStats *stats;
+    volatile bool stop;
+    int snapshots;
+    int torn;
+};
+
+static void *readerLoop(void *data)
+{
+    ReaderArgs *args = (ReaderArgs *)data;
+    NXFrameStats::Sample samples[FRAME_STATS_RING_SIZE];
+    while (!args->stop) {
+        size_t count = args->stats->snapshot(samples, FRAME_STATS_RING_SIZE);
+        for (size_t i = 0; i < count; i++) {
+            nsecs_t base = samples[i].Stage[NXFrameStats::STAGE_SENSOR] - 1;
+            for (int stage = NXFrameStats::STAGE_DQBUF; stage < NXFrameStats::STAGE_MAX; stage++) {
+                if (samples[i].Stage[stage] != base + 1 + stage * 1000000LL)
+                    args->torn++;
+            }
+        }
+        args->snapshots++;
+    }
+    return NULL;
+}
+
+static void testConcurrentReader()
+{
+    printf("%s\n", __func__);
+    sp<NXFrameStats> stats = new NXFrameStats();
+    ReaderArgs args = { stats.get(), false, 0, 0 };
+    NXFrameStats::Sample sample;
+    pthread_t thread;
+
+    pthread_create(&thread, NULL, readerLoop, &args);
+    for (int i = 1; i <= 200000; i++) {
+        makeSample(sample, i);
+        stats->commit(sample);
+    }
+    args.stop = true;
+    pthread_join(thread, NULL);
+    CHECK(args.snapshots > 0);
+    CHECK(args.torn == 0);
+    printf("\t%d snapshots\n", args.snapshots);
+}
+
+int main(int argc, char *argv[])
+{
+    testLatency();
+    testDrops();
+    testWrap();
+    testReset();
+    testConcurrentReader();
+
+    return testResult();
+}
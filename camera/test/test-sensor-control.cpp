@@ -0,0 +1,263 @@
+/*
+ * Sensor control batching test against a mock subdev.
+ *
+ * v4l2_set_ctrl() and v4l2_set_ctrls() are replaced by a mock that
+ * records every call and spends I2C_WRITE_US per control like the register
+ * writes of a sensor driver. The frame loop of PreviewThread is a thread
+ * calling frameBoundary() every FRAME_INTERVAL_US.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <linux/videodev2.h>
+
+#include <cutils/log.h>
+
+#include <NXTest.h>
+
+#include "NXSensorControlThread.h"
+
+using namespace android;
+
+#define I2C_WRITE_US        2000
+#define FRAME_INTERVAL_US   33000
+#define TIMEOUT             (1000*1000*1000LL)
+#define MAX_CALLS           32
+
+struct MockCall {
+    int count;
+    int ids[NXSensorControlSet::MAX_CONTROLS];
+    int values[NXSensorControlSet::MAX_CONTROLS];
+    pthread_t thread;
+    nsecs_t time;
+};
+
+static struct MockSubdev {
+    Mutex lock;
+    int single;  // VIDIOC_S_CTRL
+    int batches; // VIDIOC_S_EXT_CTRLS
+    int calls;
+    MockCall call[MAX_CALLS];
+    volatile nsecs_t lastFrame;
+
+    void reset() {
+        Mutex::Autolock l(lock);
+        single = batches = calls = 0;
+        lastFrame = 0;
+    }
+    void record(const int *ids, const int *values, int count) {
+        usleep(I2C_WRITE_US * count);
+        Mutex::Autolock l(lock);
+        if (calls >= MAX_CALLS)
+            return;
+        MockCall &c = call[calls++];
+        c.count = count;
+        memcpy(c.ids, ids, count * sizeof(int));
+        memcpy(c.values, values, count * sizeof(int));
+        c.thread = pthread_self();
+        c.time = systemTime(SYSTEM_TIME_MONOTONIC);
+    }
+} subdev;
+
+int v4l2_set_ctrl(int id, int ctrl_id, int value)
+{
+    subdev.single++;
+    subdev.record(&ctrl_id, &value, 1);
+    return 0;
+}
+
+int v4l2_set_ctrls(int id, const int *ctrl_ids, const int *values, int count)
+{
+    subdev.batches++;
+    subdev.record(ctrl_ids, values, count);
+    return 0;
+}
+
+int v4l2_set_format(int id, int w, int h, int f)
+{
+    return 0;
+}
+
+// setters like the ones of libcamerasensor
+class MockSensor : public NXCameraBoardSensor
+{
+public:
+    MockSensor() : NXCameraBoardSensor(0) {
+    }
+    virtual void setAfMode(uint8_t afMode) {
+    }
+    virtual void afEnable(bool enable) {
+        setCtrl(V4L2_CID_FOCUS_AUTO, enable);
+    }
+    virtual void setEffectMode(uint8_t effectMode) {
+        setCtrl(V4L2_CID_COLORFX, effectMode);
+    }
+    virtual void setSceneMode(uint8_t sceneMode) {
+        setCtrl(V4L2_CID_SCENE_MODE, sceneMode);
+    }
+    virtual void setAntibandingMode(uint8_t antibandingMode) {
+        setCtrl(V4L2_CID_POWER_LINE_FREQUENCY, antibandingMode);
+    }
+    virtual void setAwbMode(uint8_t awbMode) {
+        setCtrl(V4L2_CID_WHITE_BALANCE_TEMPERATURE, awbMode);
+    }
+    virtual void setExposure(int32_t exposure) {
+        setCtrl(V4L2_CID_BRIGHTNESS, exposure);
+    }
+    virtual uint32_t getZoomFactor(void) {
+        return 1;
+    }
+    virtual status_t setZoomCrop(uint32_t left, uint32_t top, uint32_t width, uint32_t height) {
+        return NO_ERROR;
+    }
+};
+
+/* the setters NXCommandThread::handleRequest() calls for a 3A change */
+static void request(MockSensor &sensor, NXSensorControlSet &set, int base)
+{
+    sensor.beginControls();
+    sensor.setEffectMode(base + 1);
+    sensor.setAwbMode(base + 2);
+    sensor.setSceneMode(base + 3);
+    sensor.setAntibandingMode(base + 4);
+    sensor.setExposure(base + 5);
+    sensor.setExposure(base + 6);
+    sensor.endControls(set);
+}
+
+struct FrameArgs {
+    NXSensorControlThread *thread;
+    volatile bool stop;
+};
+
+static void *frameLoop(void *data)
+{
+    FrameArgs *args = (FrameArgs *)data;
+    while (!args->stop) {
+        usleep(FRAME_INTERVAL_US);
+        subdev.lastFrame = systemTime(SYSTEM_TIME_MONOTONIC);
+        args->thread->frameBoundary(subdev.lastFrame);
+    }
+    return NULL;
+}
+
+static void *afTrigger(void *data)
+{
+    ((MockSensor *)data)->afEnable(true);
+    return NULL;
+}
+
+static void testCollect()
+{
+    printf("%s\n", __func__);
+    subdev.reset();
+    MockSensor sensor;
+    NXSensorControlSet set;
+
+    nsecs_t start = systemTime(SYSTEM_TIME_MONOTONIC);
+    request(sensor, set, 0);
+    // the setters didn't touch the subdev
+    CHECK(systemTime(SYSTEM_TIME_MONOTONIC) - start < I2C_WRITE_US * 1000LL);
+    CHECK(subdev.single == 0 && subdev.batches == 0);
+    CHECK(set.Count == 5);
+    CHECK(set.Ids[4] == V4L2_CID_BRIGHTNESS && set.Values[4] == 6);
+
+    CHECK(sensor.applyControls(set) == 0);
+    CHECK(subdev.batches == 1 && subdev.calls == 1 && subdev.call[0].count == 5);
+
+    // outside a request a setter writes right away
+    sensor.setEffectMode(7);
+    CHECK(subdev.single == 1);
+
+    // so does one of another thread while the command thread collects
+    sensor.beginControls();
+    pthread_t other;
+    pthread_create(&other, NULL, afTrigger, &sensor);
+    pthread_join(other, NULL);
+    sensor.endControls(set);
+    CHECK(subdev.single == 2 && set.Count == 0);
+}
+
+static void testFrameAligned()
+{
+    printf("%s\n", __func__);
+    subdev.reset();
+    MockSensor sensor;
+    sp<NXSensorControlThread> thread = new NXSensorControlThread(&sensor);
+    thread->run("NXSensorControlThread");
+    FrameArgs args = { thread.get(), false };
+    pthread_t frames;
+    pthread_create(&frames, NULL, frameLoop, &args);
+
+    // two requests before the next frame are one batch, the later values win
+    NXSensorControlSet set;
+    usleep(FRAME_INTERVAL_US / 2);
+    nsecs_t submit = systemTime(SYSTEM_TIME_MONOTONIC);
+    request(sensor, set, 0);
+    thread->submit(set);
+    request(sensor, set, 10);
+    thread->submit(set);
+    CHECK(systemTime(SYSTEM_TIME_MONOTONIC) - submit < I2C_WRITE_US * 1000LL);
+    CHECK(thread->waitApplied(TIMEOUT) == NO_ERROR);
+
+    CHECK(subdev.batches == 1 && subdev.single == 0);
+    CHECK(subdev.call[0].count == 5);
+    CHECK(subdev.call[0].values[0] == 11);
+    CHECK(!pthread_equal(subdev.call[0].thread, pthread_self()));
+    // written right after a frame boundary
+    nsecs_t afterFrame = subdev.call[0].time - I2C_WRITE_US * 5 * 1000LL - subdev.lastFrame;
+    CHECK(afterFrame < FRAME_INTERVAL_US * 1000LL / 2);
+
+    NXSensorControlThread::Stats stats = thread->getStats();
+    CHECK(stats.batches == 1 && stats.controls == 5 && stats.merged == 1);
+    CHECK(stats.unaligned == 0 && stats.failed == 0);
+    CHECK(stats.lastLatency >= stats.lastApply);
+    CHECK(stats.lastLatency < FRAME_INTERVAL_US * 1000LL + stats.lastApply + 10000000LL);
+
+    String8 result;
+    thread->dump(result);
+    printf("%s", result.string());
+    CHECK(strstr(result.string(), "1 batches, 5 controls, 1 merged") != NULL);
+
+    args.stop = true;
+    pthread_join(frames, NULL);
+    thread->requestExit();
+    thread->join();
+}
+
+static void testNoFrames()
+{
+    printf("%s\n", __func__);
+    subdev.reset();
+    MockSensor sensor;
+    sp<NXSensorControlThread> thread = new NXSensorControlThread(&sensor);
+    thread->run("NXSensorControlThread");
+
+    // not streaming, the batch goes out after the frame timeout
+    NXSensorControlSet set;
+    request(sensor, set, 0);
+    thread->submit(set);
+    CHECK(thread->waitApplied(TIMEOUT) == NO_ERROR);
+    CHECK(subdev.batches == 1);
+    NXSensorControlThread::Stats stats = thread->getStats();
+    CHECK(stats.unaligned == 1);
+    CHECK(stats.lastLatency >= SENSOR_CTRL_FRAME_TIMEOUT);
+
+    // pending controls are still written on exit
+    request(sensor, set, 20);
+    thread->submit(set);
+    thread->requestExit();
+    thread->join();
+    CHECK(subdev.batches == 2);
+    CHECK(subdev.call[1].values[0] == 21);
+}
+
+int main(int argc, char *argv[])
+{
+    testCollect();
+    testFrameAligned();
+    testNoFrames();
+
+    return testResult();
+}
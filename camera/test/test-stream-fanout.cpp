@@ -0,0 +1,287 @@
+/*
+ * Stream fan-out test against a mock v4l2 source, see MockPreview.h.
+ *
+ * The mock fails on a double qbuf, so a source buffer going back to the
+ * driver while an output still holds it or the zsl ring keeps it shows up
+ * as a failure.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include <cutils/log.h>
+
+#include <NXTest.h>
+
+#include "NXStreamFanout.h"
+#include "MockPreview.h"
+
+using namespace android;
+
+#define PREVIEW_BUFFERS     (MAX_PREVIEW_ZOOM_BUFFER + FANOUT_HELD_BUFFER)
+#define ZSL_DEPTH           4   /* MAX_ZSL_BUFFER */
+#define SRC_WIDTH           1280
+#define SRC_HEIGHT          720
+#define TIMEOUT             (10*1000*1000LL)
+
+/* a preview with a fan-out and no zsl */
+static int previewFrame(MockV4l2Source &source, NXStreamFanout &fanout)
+{
+    return previewFrame(source, NULL, fanout);
+}
+
+static void testNoOutputs()
+{
+    printf("%s\n", __func__);
+    MockV4l2Source source(PREVIEW_BUFFERS);
+    NXStreamFanout fanout;
+    fanout.setSource(SRC_WIDTH, SRC_HEIGHT, 0);
+
+    for (int i = 0; i < 20; i++) {
+        CHECK(previewFrame(source, fanout) == 0);
+        CHECK(source.queuedCount() == PREVIEW_BUFFERS);
+    }
+    CHECK(fanout.getStats().published == 0);
+}
+
+static void testUnscaledAndScaled()
+{
+    printf("%s\n", __func__);
+    MockV4l2Source source(PREVIEW_BUFFERS);
+    NXStreamFanout fanout;
+    fanout.setSource(SRC_WIDTH, SRC_HEIGHT, 0);
+
+    int copied = fanout.addOutput(SRC_WIDTH, SRC_HEIGHT);
+    int scaled = fanout.addOutput(SRC_WIDTH / 2, SRC_HEIGHT / 2);
+    CHECK(copied >= 0 && scaled >= 0 && copied != scaled);
+    CHECK(fanout.isUnscaled(copied));
+    CHECK(!fanout.isUnscaled(scaled));
+
+    CHECK(previewFrame(source, fanout) == 0);
+    // both outputs reference the frame, it stays out of the driver
+    CHECK(source.queuedCount() == PREVIEW_BUFFERS - 1);
+
+    NXStreamFanout::Frame a, b;
+    CHECK(fanout.take(copied, a, TIMEOUT) == NO_ERROR);
+    CHECK(fanout.take(scaled, b, TIMEOUT) == NO_ERROR);
+    CHECK(a.Buffer == b.Buffer);
+    CHECK(a.Index == b.Index);
+
+    // a second take without release is refused
+    NXStreamFanout::Frame c;
+    CHECK(fanout.take(copied, c, TIMEOUT) == BAD_VALUE);
+
+    struct nxp_vid_buffer dst;
+    int count = scaleCount;
+    CHECK(fanout.render(scaled, b, &dst));
+    CHECK(scaleCount == count + 1);
+    CHECK(lastContext.src_width == SRC_WIDTH && lastContext.src_height == SRC_HEIGHT);
+    CHECK(lastContext.dst_width == SRC_WIDTH / 2 && lastContext.dst_height == SRC_HEIGHT / 2);
+    CHECK(fanout.render(copied, a, &dst));
+    CHECK(lastContext.left == 0 && lastContext.top == 0);
+    CHECK(lastContext.src_width == SRC_WIDTH && lastContext.dst_width == SRC_WIDTH);
+
+    fanout.release(copied, a);
+    CHECK(source.queuedCount() == PREVIEW_BUFFERS - 1);
+    fanout.release(scaled, b);
+    // rendering a released frame is refused
+    CHECK(!fanout.render(scaled, b, &dst));
+
+    int released[MAX_NUM_FRAMES];
+    CHECK(fanout.collect(released, MAX_NUM_FRAMES) == 1);
+    CHECK(released[0] == a.Index);
+    CHECK(source.qbuf(released[0]) == 0);
+    CHECK(source.queuedCount() == PREVIEW_BUFFERS);
+
+    NXStreamFanout::Stats stats = fanout.getStats();
+    CHECK(stats.published == 1);
+    CHECK(stats.copied == 1);
+    CHECK(stats.scaled == 1);
+    CHECK(stats.deferred == 1);
+}
+
+static void testDropped()
+{
+    printf("%s\n", __func__);
+    MockV4l2Source source(PREVIEW_BUFFERS);
+    NXStreamFanout fanout;
+    fanout.setSource(SRC_WIDTH, SRC_HEIGHT, 0);
+    int output = fanout.addOutput(640, 480);
+
+    // a slow consumer only pins the newest frame
+    for (int i = 0; i < 10; i++) {
+        CHECK(previewFrame(source, fanout) == 0);
+        CHECK(source.queuedCount() == PREVIEW_BUFFERS - 1);
+    }
+    CHECK(fanout.getStats().dropped == 9);
+
+    NXStreamFanout::Frame frame;
+    CHECK(fanout.take(output, frame, TIMEOUT) == NO_ERROR);
+    CHECK(frame.Sequence == 10);
+    CHECK(fanout.take(output, frame, TIMEOUT) == BAD_VALUE);
+    fanout.release(output, frame);
+
+    // nothing new, the next take times out
+    CHECK(fanout.take(output, frame, TIMEOUT) == TIMED_OUT);
+
+    int released[MAX_NUM_FRAMES];
+    size_t n = fanout.collect(released, MAX_NUM_FRAMES);
+    for (size_t i = 0; i < n; i++)
+        CHECK(source.qbuf(released[i]) == 0);
+    CHECK(source.queuedCount() == PREVIEW_BUFFERS);
+
+    fanout.removeOutput(output);
+    CHECK(!fanout.hasOutputs());
+}
+
+static void testCrop()
+{
+    printf("%s\n", __func__);
+    MockV4l2Source source(PREVIEW_BUFFERS);
+    NXStreamFanout fanout;
+    fanout.setSource(SRC_WIDTH, SRC_HEIGHT, 0);
+    int output = fanout.addOutput(640, 360);
+    int full = fanout.addOutput(SRC_WIDTH, SRC_HEIGHT);
+
+    // 2x zoom given in a 2560x1440 base
+    CHECK(fanout.isUnscaled(full));
+    fanout.setCrop(640, 360, 1280, 720, 2560, 1440);
+    CHECK(!fanout.isUnscaled(full));
+    fanout.removeOutput(full);
+    CHECK(previewFrame(source, fanout) == 0);
+
+    NXStreamFanout::Frame frame;
+    struct nxp_vid_buffer dst;
+    CHECK(fanout.take(output, frame, TIMEOUT) == NO_ERROR);
+    CHECK(fanout.render(output, frame, &dst));
+    CHECK(lastContext.left == 320 && lastContext.top == 180);
+    CHECK(lastContext.src_width == 640 && lastContext.src_height == 360);
+    CHECK(lastContext.dst_width == 640 && lastContext.dst_height == 360);
+    fanout.release(output, frame);
+}
+
+/* the zsl ring and an output keep the same frames, each returns them once */
+static void testZsl()
+{
+    printf("%s\n", __func__);
+    MockV4l2Source source(PREVIEW_BUFFERS + ZSL_DEPTH);
+    NXZslRing ring(ZSL_DEPTH);
+    NXStreamFanout fanout;
+    fanout.setSource(SRC_WIDTH, SRC_HEIGHT, 0);
+    int output = fanout.addOutput(640, 480);
+
+    for (int i = 0; i < ZSL_DEPTH + 2; i++)
+        CHECK(previewFrame(source, &ring, fanout) == 0);
+    CHECK(source.queuedCount() == PREVIEW_BUFFERS);
+
+    // the ring evicts a frame the output still holds, it waits for the release
+    NXStreamFanout::Frame frame;
+    CHECK(fanout.take(output, frame, TIMEOUT) == NO_ERROR);
+    for (int i = 0; i < ZSL_DEPTH; i++)
+        CHECK(previewFrame(source, &ring, fanout) == 0);
+    CHECK(source.queuedCount() == PREVIEW_BUFFERS - 1);
+    CHECK(fanout.getStats().deferred == 1);
+    fanout.release(output, frame);
+    CHECK(previewFrame(source, &ring, fanout) == 0);
+    CHECK(source.queuedCount() == PREVIEW_BUFFERS);
+
+    // a capture and the output on one frame, the output lets go first
+    nsecs_t timestamp;
+    CHECK(fanout.take(output, frame, TIMEOUT) == NO_ERROR);
+    int locked = ring.acquire(source.now(), &timestamp);
+    CHECK(locked == frame.Index);
+    for (int i = 0; i < 2 * ZSL_DEPTH; i++) {
+        CHECK(previewFrame(source, &ring, fanout) == 0);
+        CHECK(source.queuedCount() == PREVIEW_BUFFERS);
+    }
+    fanout.release(output, frame);
+    CHECK(previewFrame(source, &ring, fanout) == 0);
+    CHECK(source.queuedCount() == PREVIEW_BUFFERS);
+    ring.release(locked);
+    for (int i = 0; i < ZSL_DEPTH; i++)
+        CHECK(previewFrame(source, &ring, fanout) == 0);
+    CHECK(source.queuedCount() == PREVIEW_BUFFERS);
+
+    // the capture lets go first
+    CHECK(fanout.take(output, frame, TIMEOUT) == NO_ERROR);
+    locked = ring.acquire(source.now(), &timestamp);
+    CHECK(locked == frame.Index);
+    ring.release(locked);
+    for (int i = 0; i < ZSL_DEPTH; i++)
+        CHECK(previewFrame(source, &ring, fanout) == 0);
+    CHECK(source.queuedCount() == PREVIEW_BUFFERS - 1);
+    fanout.release(output, frame);
+    CHECK(previewFrame(source, &ring, fanout) == 0);
+    CHECK(source.queuedCount() == PREVIEW_BUFFERS);
+}
+
+struct ConsumerArgs {
+    NXStreamFanout *fanout;
+    int output;
+    volatile bool stop;
+    int frames;
+};
+
+static void *consumerLoop(void *data)
+{
+    ConsumerArgs *args = (ConsumerArgs *)data;
+    struct nxp_vid_buffer dst;
+    while (!args->stop) {
+        NXStreamFanout::Frame frame;
+        if (args->fanout->take(args->output, frame, TIMEOUT) != NO_ERROR)
+            continue;
+        args->fanout->render(args->output, frame, &dst);
+        usleep(100);
+        args->fanout->release(args->output, frame);
+        args->frames++;
+    }
+    return NULL;
+}
+
+static void testConcurrent()
+{
+    printf("%s\n", __func__);
+    MockV4l2Source source(PREVIEW_BUFFERS);
+    NXStreamFanout fanout;
+    fanout.setSource(SRC_WIDTH, SRC_HEIGHT, 0);
+
+    ConsumerArgs record = { &fanout, fanout.addOutput(1920, 1080), false, 0 };
+    ConsumerArgs analytics = { &fanout, fanout.addOutput(320, 180), false, 0 };
+    pthread_t threads[2];
+    pthread_create(&threads[0], NULL, consumerLoop, &record);
+    pthread_create(&threads[1], NULL, consumerLoop, &analytics);
+
+    for (int i = 0; i < 5000; i++) {
+        // the mock checks for double qbuf and starvation
+        CHECK(previewFrame(source, fanout) == 0);
+        CHECK(source.queuedCount() >= PREVIEW_BUFFERS - 2 * FANOUT_HELD_BUFFER);
+        usleep(20);
+    }
+    record.stop = analytics.stop = true;
+    pthread_join(threads[0], NULL);
+    pthread_join(threads[1], NULL);
+    CHECK(record.frames > 0 && analytics.frames > 0);
+
+    // streamoff: everything is back in the driver, the fan-out forgets it
+    fanout.reset(TIMEOUT);
+    int released[MAX_NUM_FRAMES];
+    CHECK(fanout.collect(released, MAX_NUM_FRAMES) == 0);
+    CHECK(fanout.retire(0));
+
+    NXStreamFanout::Stats stats = fanout.getStats();
+    printf("\t%d record, %d analytics frames, %u dropped, %u deferred\n",
+            record.frames, analytics.frames, stats.dropped, stats.deferred);
+}
+
+int main(int argc, char *argv[])
+{
+    testNoOutputs();
+    testUnscaledAndScaled();
+    testDropped();
+    testCrop();
+    testZsl();
+    testConcurrent();
+
+    return testResult();
+}
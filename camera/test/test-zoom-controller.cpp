@@ -0,0 +1,198 @@
+/*
+ * Zoom classification and smoothing test of ScalerZoomController.
+ *
+ * nxScalerRun() is replaced by a stub that records the scale context of
+ * each pass and the allocator by one that hands out fake buffers, so the
+ * test sees which crop every frame was scaled with and whether a zoom
+ * change reallocated anything.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <linux/videodev2.h>
+#include <linux/v4l2-mediabus.h>
+
+#include <cutils/log.h>
+
+#include <NXAllocator.h>
+#include <NXTest.h>
+
+#include "ScalerZoomController.h"
+
+using namespace android;
+
+#define BASE_WIDTH          2560
+#define BASE_HEIGHT         1440
+#define WIDTH               1280
+#define HEIGHT              720
+#define SMOOTH_FRAMES       4
+
+static struct scale_ctx lastContext;
+static int scaleCount = 0;
+static int allocCount = 0;
+
+int nxScalerRun(const struct nxp_vid_buffer *srcBuf, const struct nxp_vid_buffer *dstBuf, const struct scale_ctx *ctx)
+{
+    lastContext = *ctx;
+    scaleCount++;
+    return 0;
+}
+
+int nxScalerRun(const struct nxp_vid_buffer *srcBuf, private_handle_t const *dstHandle, const struct scale_ctx *ctx)
+{
+    lastContext = *ctx;
+    scaleCount++;
+    return 0;
+}
+
+int nxScalerRun(private_handle_t const *srcHandle, private_handle_t const *dstHandle, const struct scale_ctx *ctx)
+{
+    lastContext = *ctx;
+    scaleCount++;
+    return 0;
+}
+
+int nxScalerRun(private_handle_t const *srcHandle, const struct nxp_vid_buffer *dstBuf, const struct scale_ctx *ctx)
+{
+    lastContext = *ctx;
+    scaleCount++;
+    return 0;
+}
+
+bool allocateBuffer(struct nxp_vid_buffer *buf, int bufSize, int width, int height, uint32_t format)
+{
+    allocCount++;
+    return true;
+}
+
+void freeBuffer(struct nxp_vid_buffer *buf, int bufSize)
+{
+}
+
+/* a yuv420 3 plane buffer like the ones of allocateBuffer() */
+static void fillBuffer(struct nxp_vid_buffer *buf, int width, int height)
+{
+    memset(buf, 0, sizeof(*buf));
+    buf->plane_num = 3;
+    buf->stride[0] = width;
+    buf->stride[1] = buf->stride[2] = width >> 1;
+    buf->sizes[0] = width * height;
+    buf->sizes[1] = buf->sizes[2] = (width >> 1) * (height >> 1);
+    buf->phys[0] = 0x10000000;
+    buf->phys[1] = buf->phys[0] + buf->sizes[0];
+    buf->phys[2] = buf->phys[1] + buf->sizes[1];
+}
+
+static void testClassify()
+{
+    printf("%s\n", __func__);
+    sp<ScalerZoomController> zoom = new ScalerZoomController(0, 0, BASE_WIDTH, BASE_HEIGHT,
+            BASE_WIDTH, BASE_HEIGHT, WIDTH, HEIGHT);
+    zoom->setFormat(PIXCODE_YUV420_PLANAR, PIXCODE_YUV420_PLANAR);
+    struct nxp_vid_buffer src, view;
+    fillBuffer(&src, WIDTH, HEIGHT);
+
+    // zoom 1.0, the source as it is
+    CHECK(zoom->getZoomMode() == NXZoomController::ZOOM_IDENTITY);
+    CHECK(zoom->getCropView(&src, &view));
+    CHECK(memcmp(&src, &view, sizeof(src)) == 0);
+
+    // 2x zoom of a source the size of the dest needs the scaler
+    zoom->setCrop(BASE_WIDTH / 4, BASE_HEIGHT / 4, BASE_WIDTH / 2, BASE_HEIGHT / 2);
+    CHECK(zoom->getZoomMode() == NXZoomController::ZOOM_SCALE);
+    CHECK(!zoom->getCropView(&src, &view));
+
+    // a crop at the origin scales too, isZoomAvaliable() doesn't tell
+    zoom->setCrop(0, 0, BASE_WIDTH / 2, BASE_HEIGHT / 2);
+    CHECK(!zoom->isZoomAvaliable());
+    CHECK(zoom->getZoomMode() == NXZoomController::ZOOM_SCALE);
+
+    // back to 1.0
+    zoom->setCrop(0, 0, BASE_WIDTH, BASE_HEIGHT);
+    CHECK(zoom->getZoomMode() == NXZoomController::ZOOM_IDENTITY);
+}
+
+static void testCropView()
+{
+    printf("%s\n", __func__);
+    // a source twice the dest, 2x zoom is the center of the source at its size
+    sp<ScalerZoomController> zoom = new ScalerZoomController(0, 0, BASE_WIDTH, BASE_HEIGHT,
+            BASE_WIDTH, BASE_HEIGHT, WIDTH, HEIGHT);
+    zoom->setFormat(PIXCODE_YUV420_PLANAR, PIXCODE_YUV420_PLANAR);
+    zoom->setSource(WIDTH * 2, HEIGHT * 2);
+    CHECK(zoom->getZoomMode() == NXZoomController::ZOOM_SCALE);
+
+    zoom->setCrop(BASE_WIDTH / 4, BASE_HEIGHT / 4, BASE_WIDTH / 2, BASE_HEIGHT / 2);
+    CHECK(zoom->getZoomMode() == NXZoomController::ZOOM_CROP);
+
+    struct nxp_vid_buffer src, view;
+    fillBuffer(&src, WIDTH * 2, HEIGHT * 2);
+    CHECK(zoom->getCropView(&src, &view));
+    int left = WIDTH / 2, top = HEIGHT / 2;
+    CHECK(view.phys[0] == src.phys[0] + top * src.stride[0] + left);
+    CHECK(view.phys[1] == src.phys[1] + (top >> 1) * src.stride[1] + (left >> 1));
+    CHECK(view.phys[2] == src.phys[2] + (top >> 1) * src.stride[2] + (left >> 1));
+    CHECK((view.phys[1] & 15) == 0 && (view.phys[2] & 15) == 0);
+    CHECK(view.stride[0] == src.stride[0] && view.stride[1] == src.stride[1]);
+    CHECK(view.sizes[0] == (int)(src.sizes[0] - (view.phys[0] - src.phys[0])));
+
+    // the consumer of a view doesn't run the scaler
+    CHECK(scaleCount == 0);
+}
+
+static void testSmooth()
+{
+    printf("%s\n", __func__);
+    sp<ScalerZoomController> zoom = new ScalerZoomController(0, 0, BASE_WIDTH, BASE_HEIGHT,
+            BASE_WIDTH, BASE_HEIGHT, WIDTH, HEIGHT);
+    zoom->setFormat(PIXCODE_YUV420_PLANAR, PIXCODE_YUV420_PLANAR);
+    zoom->setSmoothFrames(SMOOTH_FRAMES);
+    CHECK(zoom->allocBuffer(4, WIDTH, HEIGHT, PIXFORMAT_YUV420_PLANAR));
+    CHECK(allocCount == 1);
+
+    struct nxp_vid_buffer src;
+    fillBuffer(&src, WIDTH, HEIGHT);
+    private_handle_t const *dst = NULL;
+
+    // 1.0 -> 2x in SMOOTH_FRAMES steps, the crop only ever shrinks
+    zoom->setCrop(BASE_WIDTH / 4, BASE_HEIGHT / 4, BASE_WIDTH / 2, BASE_HEIGHT / 2);
+    uint32_t lastWidth = WIDTH;
+    for (int i = 0; i < SMOOTH_FRAMES; i++) {
+        scaleCount = 0;
+        CHECK(zoom->handleZoom(&src, dst));
+        CHECK(scaleCount == 1);
+        printf("\tframe %d: left %u top %u %ux%u\n", i, lastContext.left, lastContext.top,
+                lastContext.src_width, lastContext.src_height);
+        CHECK(lastContext.src_width < lastWidth);
+        CHECK((lastContext.left & 31) == 0);
+        CHECK(lastContext.left + lastContext.src_width <= WIDTH);
+        CHECK(lastContext.top + lastContext.src_height <= HEIGHT);
+        CHECK(lastContext.dst_width == WIDTH && lastContext.dst_height == HEIGHT);
+        lastWidth = lastContext.src_width;
+    }
+    CHECK(lastContext.left == WIDTH / 4 && lastContext.top == HEIGHT / 4);
+    CHECK(lastContext.src_width == WIDTH / 2 && lastContext.src_height == HEIGHT / 2);
+
+    // settled
+    zoom->handleZoom(&src, dst);
+    CHECK(lastContext.src_width == WIDTH / 2);
+
+    // the zoom buffers stay
+    CHECK(allocCount == 1);
+    CHECK(zoom->getBufferCount() == 4);
+
+    // without smoothing, e.g. capture, a crop applies right away
+    zoom->setSmoothFrames(0);
+    zoom->setCrop(0, 0, BASE_WIDTH, BASE_HEIGHT);
+    CHECK(zoom->getZoomMode() == NXZoomController::ZOOM_IDENTITY);
+    zoom->handleZoom(&src, dst);
+    CHECK(lastContext.src_width == WIDTH && lastContext.left == 0);
+}
+
+int main(int argc, char *argv[])
+{
+    testClassify();
+    testCropView();
+    testSmooth();
+
+    return testResult();
+}
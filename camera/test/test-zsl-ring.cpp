@@ -0,0 +1,258 @@
+/*
+ * ZSL ring test against a mock v4l2 source, see MockPreview.h.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include <cutils/log.h>
+
+#include <NXTest.h>
+
+#include "NXZslRing.h"
+#include "MockPreview.h"
+
+using namespace android;
+
+#define PREVIEW_BUFFERS     4   /* MAX_PREVIEW_ZOOM_BUFFER */
+#define ZSL_DEPTH           4   /* MAX_ZSL_BUFFER */
+
+/* a preview with zsl and no fan-out output */
+static int previewFrame(MockV4l2Source &source, NXZslRing &ring)
+{
+    static NXStreamFanout fanout;
+    return previewFrame(source, &ring, fanout);
+}
+
+static void testSteadyState()
+{
+    printf("%s\n", __func__);
+    MockV4l2Source source(PREVIEW_BUFFERS + ZSL_DEPTH, 0);
+    NXZslRing ring(ZSL_DEPTH);
+
+    for (int i = 0; i < 300; i++) {
+        CHECK(previewFrame(source, ring) == 0);
+        CHECK(ring.size() <= ZSL_DEPTH);
+        // the driver always keeps the preview buffers once the ring is full
+        if (i >= ZSL_DEPTH)
+            CHECK(source.queuedCount() == PREVIEW_BUFFERS);
+    }
+    NXZslRing::Stats stats = ring.getStats();
+    CHECK(stats.pushed == 300);
+    CHECK(stats.evicted == 300 - ZSL_DEPTH);
+    CHECK(stats.dropped == 0);
+}
+
+static void testClosestFrame()
+{
+    printf("%s\n", __func__);
+    MockV4l2Source source(PREVIEW_BUFFERS + ZSL_DEPTH, 0);
+    NXZslRing ring(ZSL_DEPTH);
+
+    for (int i = 0; i < 20; i++)
+        previewFrame(source, ring);
+
+    // the ring holds the last ZSL_DEPTH frames: now - 3T .. now
+    nsecs_t now = source.now();
+    nsecs_t timestamp = 0;
+
+    int index = ring.acquire(now - FRAME_INTERVAL - FRAME_INTERVAL / 3, &timestamp);
+    CHECK(index >= 0);
+    CHECK(timestamp == now - FRAME_INTERVAL);
+    ring.release(index);
+
+    // halfway between two frames takes the older one
+    index = ring.acquire(now - FRAME_INTERVAL / 2, &timestamp);
+    CHECK(timestamp == now - FRAME_INTERVAL);
+    ring.release(index);
+
+    // a trigger after the newest frame takes the newest
+    index = ring.acquire(now + 5 * FRAME_INTERVAL, &timestamp);
+    CHECK(timestamp == now);
+    ring.release(index);
+
+    // a trigger before the oldest frame takes the oldest
+    index = ring.acquire(now - 100 * FRAME_INTERVAL, &timestamp);
+    CHECK(timestamp == now - (ZSL_DEPTH - 1) * FRAME_INTERVAL);
+    ring.release(index);
+}
+
+static void testLockedFrameSurvives()
+{
+    printf("%s\n", __func__);
+    MockV4l2Source source(PREVIEW_BUFFERS + ZSL_DEPTH, 0);
+    NXZslRing ring(ZSL_DEPTH);
+
+    for (int i = 0; i < 10; i++)
+        previewFrame(source, ring);
+
+    nsecs_t timestamp;
+    int locked = ring.acquire(source.now(), &timestamp);
+    CHECK(locked >= 0);
+
+    // a slow jpeg encode while preview goes on
+    for (int i = 0; i < 50; i++) {
+        CHECK(previewFrame(source, ring) == 0);
+        CHECK(source.queuedCount() == PREVIEW_BUFFERS);
+    }
+
+    // still there, and only the locked frame is left of the old ones
+    nsecs_t again;
+    CHECK(ring.acquire(timestamp, &again) == locked);
+    CHECK(again == timestamp);
+    ring.release(locked);
+    ring.release(locked);
+
+    // released frames age out and go back to the driver
+    for (int i = 0; i < ZSL_DEPTH; i++)
+        previewFrame(source, ring);
+    int indices[MAX_ZSL_RING_DEPTH];
+    size_t n = ring.flush(indices, MAX_ZSL_RING_DEPTH);
+    for (size_t i = 0; i < n; i++)
+        CHECK(indices[i] != locked);
+    for (size_t i = 0; i < n; i++)
+        CHECK(source.qbuf(indices[i]) == 0);
+    CHECK(source.queuedCount() == PREVIEW_BUFFERS + ZSL_DEPTH);
+}
+
+static void testAllLocked()
+{
+    printf("%s\n", __func__);
+    MockV4l2Source source(PREVIEW_BUFFERS + 2, 0);
+    NXZslRing ring(2);
+    nsecs_t timestamp;
+
+    previewFrame(source, ring);
+    previewFrame(source, ring);
+    int a = ring.acquire(0, &timestamp);
+    int b = ring.acquire(source.now(), &timestamp);
+    CHECK(a >= 0 && b >= 0 && a != b);
+
+    // nothing can be evicted, new frames go straight back
+    for (int i = 0; i < 10; i++) {
+        CHECK(previewFrame(source, ring) == 0);
+        CHECK(source.queuedCount() == PREVIEW_BUFFERS);
+    }
+    CHECK(ring.getStats().dropped == 10);
+
+    // flush leaves locked frames alone, reset forgets them after its timeout
+    int indices[2];
+    CHECK(ring.flush(indices, 2) == 0);
+    ring.reset(1000000LL);
+    CHECK(ring.size() == 0);
+    CHECK(ring.acquire(0, &timestamp) == -1);
+    CHECK(ring.getStats().misses == 1);
+}
+
+static void testDisabled()
+{
+    printf("%s\n", __func__);
+    MockV4l2Source source(PREVIEW_BUFFERS, 0);
+    NXZslRing ring(0);
+    nsecs_t timestamp;
+
+    for (int i = 0; i < 10; i++) {
+        CHECK(previewFrame(source, ring) == 0);
+        CHECK(source.queuedCount() == PREVIEW_BUFFERS);
+    }
+    CHECK(ring.acquire(0, &timestamp) == -1);
+}
+
+struct CaptureArgs {
+    NXZslRing *ring;
+    volatile bool stop;
+    int captures;
+};
+
+static void *captureLoop(void *data)
+{
+    CaptureArgs *args = (CaptureArgs *)data;
+    while (!args->stop) {
+        nsecs_t timestamp;
+        int index = args->ring->acquire(systemTime(SYSTEM_TIME_MONOTONIC), &timestamp);
+        if (index >= 0) {
+            usleep(100);
+            args->ring->release(index);
+            args->captures++;
+        }
+        usleep(50);
+    }
+    return NULL;
+}
+
+static void testConcurrentCapture()
+{
+    printf("%s\n", __func__);
+    MockV4l2Source source(PREVIEW_BUFFERS + ZSL_DEPTH, systemTime(SYSTEM_TIME_MONOTONIC));
+    NXZslRing ring(ZSL_DEPTH);
+    CaptureArgs args = { &ring, false, 0 };
+    pthread_t thread;
+
+    pthread_create(&thread, NULL, captureLoop, &args);
+    for (int i = 0; i < 5000; i++) {
+        // the mock checks for double qbuf and starvation
+        CHECK(previewFrame(source, ring) == 0);
+        CHECK(source.queuedCount() >= PREVIEW_BUFFERS - 1);
+        usleep(20);
+    }
+    CHECK(args.captures > 0);
+    args.stop = true;
+    pthread_join(thread, NULL);
+
+    int indices[MAX_ZSL_RING_DEPTH];
+    size_t n = ring.flush(indices, MAX_ZSL_RING_DEPTH);
+    for (size_t i = 0; i < n; i++)
+        CHECK(source.qbuf(indices[i]) == 0);
+    CHECK(source.queuedCount() == PREVIEW_BUFFERS + ZSL_DEPTH);
+    printf("\t%d captures\n", args.captures);
+}
+
+struct HoldArgs {
+    NXZslRing *ring;
+    int index;
+    volatile bool released;
+};
+
+static void *holdLoop(void *data)
+{
+    HoldArgs *args = (HoldArgs *)data;
+    usleep(20000);
+    args->released = true;
+    args->ring->release(args->index);
+    return NULL;
+}
+
+/* a preview restart doesn't reuse the buffer of a frame a capture still encodes */
+static void testResetWaitsForCapture()
+{
+    printf("%s\n", __func__);
+    MockV4l2Source source(PREVIEW_BUFFERS + ZSL_DEPTH, 0);
+    NXZslRing ring(ZSL_DEPTH);
+    nsecs_t timestamp;
+
+    for (int i = 0; i < ZSL_DEPTH; i++)
+        previewFrame(source, ring);
+    HoldArgs args = { &ring, ring.acquire(source.now(), &timestamp), false };
+    CHECK(args.index >= 0);
+
+    pthread_t thread;
+    pthread_create(&thread, NULL, holdLoop, &args);
+    ring.reset(1000000000LL);
+    CHECK(args.released);
+    CHECK(ring.size() == 0);
+    pthread_join(thread, NULL);
+}
+
+int main(int argc, char *argv[])
+{
+    testSteadyState();
+    testClosestFrame();
+    testLockedFrameSurvives();
+    testAllLocked();
+    testDisabled();
+    testConcurrentCapture();
+    testResetWaitsForCapture();
+
+    return testResult();
+}
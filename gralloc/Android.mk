@@ -29,10 +29,26 @@ LOCAL_C_INCLUDES := system/core/include \
 LOCAL_SRC_FILES := 	\
 	gralloc.cpp 	\
 	framebuffer_device.cpp \
-	mapper.cpp
+	mapper.cpp \
+	map_cache.cpp
 	
 LOCAL_MODULE := gralloc.${TARGET_BOARD_PLATFORM}
 LOCAL_CFLAGS:= -DLOG_TAG=\"gralloc\"
 LOCAL_MODULE_TAGS := optional
 
 include $(BUILD_SHARED_LIBRARY)
+
+include $(CLEAR_VARS)
+# for test
+LOCAL_SRC_FILES := test/test-map-cache.cpp \
+	map_cache.cpp
+LOCAL_SHARED_LIBRARIES := liblog libcutils libutils
+LOCAL_C_INCLUDES := system/core/include \
+	$(LOCAL_PATH) \
+	$(LOCAL_PATH)/../include
+LOCAL_CFLAGS += -DLOG_TAG=\"test-map-cache\"
+
+LOCAL_MODULE := test_map_cache
+LOCAL_MODULE_TAGS := optional
+
+include $(BUILD_EXECUTABLE)
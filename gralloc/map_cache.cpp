@@ -0,0 +1,222 @@
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <stdio.h>
+
+#include <sys/mman.h>
+
+#include <cutils/log.h>
+
+#include "map_cache.h"
+
+static int64_t cache_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/* caller holds the lock, kept: one of the mappings no handle uses */
+static void unmap_entry_locked(struct map_cache *cache, size_t index, bool kept)
+{
+    const map_cache_entry &e = cache->entries->valueAt(index);
+    if (munmap(e.addr, e.size) < 0)
+        ALOGE("%s: could not unmap %p %zu, %s", __func__, e.addr, e.size, strerror(errno));
+    if (kept) {
+        cache->unused--;
+        cache->stats.cached_bytes -= e.size;
+    }
+    cache->stats.mapped_bytes -= e.size;
+    cache->stats.unmaps++;
+    cache->entries->removeItemsAt(index);
+}
+
+static ssize_t oldest_unused_locked(struct map_cache *cache)
+{
+    ssize_t oldest = -1;
+    for (size_t i = 0; i < cache->entries->size(); i++) {
+        const map_cache_entry &e = cache->entries->valueAt(i);
+        if (e.refs == 0 && (oldest < 0 || e.released < cache->entries->valueAt(oldest).released))
+            oldest = i;
+    }
+    return oldest;
+}
+
+static void evict_locked(struct map_cache *cache)
+{
+    while (cache->unused > MAP_CACHE_MAX_UNUSED || cache->stats.cached_bytes > cache->budget) {
+        ssize_t index = oldest_unused_locked(cache);
+        if (index < 0)
+            break;
+        unmap_entry_locked(cache, index, true);
+        cache->stats.evicted++;
+    }
+}
+
+void map_cache_init(struct map_cache *cache, size_t budget)
+{
+    memset(&cache->stats, 0, sizeof(cache->stats));
+    pthread_mutex_init(&cache->lock, NULL);
+    cache->budget = budget;
+    cache->unused = 0;
+    cache->entries = new android::KeyedVector<uint64_t, map_cache_entry>();
+    cache->private_keys = 0;
+}
+
+void map_cache_destroy(struct map_cache *cache)
+{
+    pthread_mutex_lock(&cache->lock);
+    while (cache->entries->size() > 0) {
+        size_t last = cache->entries->size() - 1;
+        unmap_entry_locked(cache, last, cache->entries->valueAt(last).refs == 0);
+    }
+    pthread_mutex_unlock(&cache->lock);
+    delete cache->entries;
+    cache->entries = NULL;
+    pthread_mutex_destroy(&cache->lock);
+}
+
+void *map_cache_get(struct map_cache *cache, uint64_t id, int fd, size_t size)
+{
+    pthread_mutex_lock(&cache->lock);
+    uint64_t key = id ? id : MAP_CACHE_PRIVATE_KEY | cache->private_keys++;
+    ssize_t index = cache->entries->indexOfKey(key);
+    if (index >= 0 && cache->entries->valueAt(index).size < size) {
+        // shorter than asked, only possible for a buffer nobody holds any more
+        if (cache->entries->valueAt(index).refs > 0) {
+            size_t mapped = cache->entries->valueAt(index).size;
+            cache->stats.failed++;
+            pthread_mutex_unlock(&cache->lock);
+            ALOGE("%s: fd %d mapped with %zu bytes, %zu asked", __func__, fd, mapped, size);
+            return NULL;
+        }
+        unmap_entry_locked(cache, index, true);
+        index = -1;
+    }
+    if (index >= 0) {
+        map_cache_entry &e = cache->entries->editValueAt(index);
+        if (e.refs++ == 0) {
+            cache->unused--;
+            cache->stats.cached_bytes -= e.size;
+        }
+        cache->stats.hits++;
+        void *addr = e.addr;
+        pthread_mutex_unlock(&cache->lock);
+        return addr;
+    }
+    cache->stats.misses++;
+    pthread_mutex_unlock(&cache->lock);
+
+    void *addr = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (MAP_FAILED == addr) {
+        ALOGE("%s: could not mmap fd %d, %zu bytes, %s", __func__, fd, size, strerror(errno));
+        pthread_mutex_lock(&cache->lock);
+        cache->stats.failed++;
+        pthread_mutex_unlock(&cache->lock);
+        return NULL;
+    }
+
+    pthread_mutex_lock(&cache->lock);
+    index = cache->entries->indexOfKey(key);
+    if (index >= 0) {
+        // mapped by another thread meanwhile, use that one
+        map_cache_entry &e = cache->entries->editValueAt(index);
+        if (e.refs++ == 0) {
+            cache->unused--;
+            cache->stats.cached_bytes -= e.size;
+        }
+        void *shared = e.addr;
+        pthread_mutex_unlock(&cache->lock);
+        munmap(addr, size);
+        return shared;
+    }
+    map_cache_entry e;
+    e.addr = addr;
+    e.size = size;
+    e.refs = 1;
+    e.released = 0;
+    cache->entries->add(key, e);
+    cache->stats.maps++;
+    cache->stats.mapped_bytes += size;
+    if (cache->stats.mapped_bytes > cache->stats.peak_bytes)
+        cache->stats.peak_bytes = cache->stats.mapped_bytes;
+    pthread_mutex_unlock(&cache->lock);
+    return addr;
+}
+
+void map_cache_put(struct map_cache *cache, void *addr, bool keep)
+{
+    pthread_mutex_lock(&cache->lock);
+    // by address, a process holds a few hundred mappings at most
+    ssize_t index = -1;
+    for (size_t i = 0; i < cache->entries->size(); i++) {
+        if (cache->entries->valueAt(i).addr == addr) {
+            index = i;
+            break;
+        }
+    }
+    if (index < 0) {
+        pthread_mutex_unlock(&cache->lock);
+        ALOGE("%s: %p is not mapped by the cache", __func__, addr);
+        return;
+    }
+
+    map_cache_entry &e = cache->entries->editValueAt(index);
+    if (--e.refs > 0) {
+        pthread_mutex_unlock(&cache->lock);
+        return;
+    }
+    if (!keep || e.size > cache->budget || (cache->entries->keyAt(index) & MAP_CACHE_PRIVATE_KEY)) {
+        unmap_entry_locked(cache, index, false);
+    } else {
+        e.released = cache_now();
+        cache->stats.cached_bytes += e.size;
+        cache->unused++;
+        evict_locked(cache);
+    }
+    pthread_mutex_unlock(&cache->lock);
+}
+
+size_t map_cache_trim(struct map_cache *cache, size_t target)
+{
+    size_t unmapped = 0;
+    pthread_mutex_lock(&cache->lock);
+    while (cache->stats.cached_bytes > target) {
+        ssize_t index = oldest_unused_locked(cache);
+        if (index < 0)
+            break;
+        unmapped += cache->entries->valueAt(index).size;
+        unmap_entry_locked(cache, index, true);
+    }
+    pthread_mutex_unlock(&cache->lock);
+    if (unmapped)
+        ALOGD("%s: unmapped %zu bytes", __func__, unmapped);
+    return unmapped;
+}
+
+struct map_cache_stats map_cache_get_stats(struct map_cache *cache)
+{
+    pthread_mutex_lock(&cache->lock);
+    struct map_cache_stats stats = cache->stats;
+    pthread_mutex_unlock(&cache->lock);
+    return stats;
+}
+
+void map_cache_dump(struct map_cache *cache, char *buff, int buff_len)
+{
+    pthread_mutex_lock(&cache->lock);
+    struct map_cache_stats stats = cache->stats;
+    size_t count = cache->entries->size();
+    int unused = cache->unused;
+    pthread_mutex_unlock(&cache->lock);
+
+    unsigned int requests = stats.hits + stats.misses;
+    snprintf(buff, buff_len,
+            "gralloc mappings: %zu, %zu KB mapped, peak %zu KB, %d kept %zu/%zu KB\n"
+            "  %u hits, %u misses (%u%%), %u maps, %u unmaps, %u evicted, %u failed\n",
+            count, stats.mapped_bytes >> 10, stats.peak_bytes >> 10,
+            unused, stats.cached_bytes >> 10, cache->budget >> 10,
+            stats.hits, stats.misses, requests ? stats.hits * 100 / requests : 0,
+            stats.maps, stats.unmaps, stats.evicted, stats.failed);
+}
@@ -0,0 +1,72 @@
+#ifndef GRALLOC_MAP_CACHE_H
+#define GRALLOC_MAP_CACHE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+#include <sys/types.h>
+
+#include <utils/KeyedVector.h>
+
+/*
+ * per-process cache of buffer mappings
+ * A buffer is mapped on its first lock, not when it is registered. The
+ * mappings are keyed by the id gralloc gave the buffer at alloc time, so
+ * handles of one buffer share a mapping and a buffer registered again
+ * finds the one of the last time. Not by the file behind the fd: the
+ * dma-bufs of this kernel all share one anon inode. Mappings no handle
+ * uses stay until MAP_CACHE_MAX_UNUSED of them or budget bytes are kept,
+ * the least recently released are unmapped first. A kept mapping holds its
+ * buffer, ion memory freed by the allocator stays pinned in every process
+ * keeping it, so there is no budget unless the property gives one.
+ */
+#define MAP_CACHE_MAX_UNUSED        16
+#define MAP_CACHE_BUDGET            0
+#define MAP_CACHE_BUDGET_PROPERTY   "gralloc.mapcache.budget_kb" // overrides MAP_CACHE_BUDGET, 0: unmap on release
+
+/* buffers without an id get a key of their own, never shared nor kept */
+#define MAP_CACHE_PRIVATE_KEY       (1ULL << 63)
+
+struct map_cache_entry {
+    void *addr;
+    size_t size;
+    int refs;               // handles using the mapping, 0: kept for later
+    int64_t released;       // ns, for lru
+};
+
+struct map_cache_stats {
+    unsigned int hits;
+    unsigned int misses;
+    unsigned int maps;
+    unsigned int unmaps;
+    unsigned int evicted;   // kept mappings unmapped for the budget or the count
+    unsigned int failed;
+    size_t mapped_bytes;    // all mappings
+    size_t cached_bytes;    // the kept ones
+    size_t peak_bytes;
+};
+
+struct map_cache {
+    pthread_mutex_t lock;
+    size_t budget;
+    int unused;
+    android::KeyedVector<uint64_t, map_cache_entry> *entries;
+    uint64_t private_keys;
+    struct map_cache_stats stats;
+};
+
+void map_cache_init(struct map_cache *cache, size_t budget);
+void map_cache_destroy(struct map_cache *cache);
+
+/* a shared mapping of size bytes of fd, the buffer id, with a reference taken, NULL on failure
+ * id 0: a mapping of this get alone */
+void *map_cache_get(struct map_cache *cache, uint64_t id, int fd, size_t size);
+/* drops a reference of addr, keep: the mapping may stay for the next get */
+void map_cache_put(struct map_cache *cache, void *addr, bool keep);
+/* unmap the least recently released mappings until at most target bytes are kept, returns the bytes unmapped */
+size_t map_cache_trim(struct map_cache *cache, size_t target);
+
+struct map_cache_stats map_cache_get_stats(struct map_cache *cache);
+void map_cache_dump(struct map_cache *cache, char *buff, int buff_len);
+
+#endif
@@ -3,6 +3,8 @@
 #include <pthread.h>
 #include <unistd.h>
 #include <string.h>
+#include <stdlib.h>
+#include <stdarg.h>
 
 #include <sys/mman.h>
 #include <sys/stat.h>
@@ -10,43 +12,110 @@
 
 #include <cutils/log.h>
 #include <cutils/atomic.h>
+#include <cutils/properties.h>
+#include <utils/KeyedVector.h>
 
 #include <hardware/hardware.h>
 #include <hardware/gralloc.h>
 
 #include <gralloc_priv.h>
+#include <nexell_format.h>
 
 #include <ion/ion.h>
 //#include <linux/ion.h>
+#include <linux/nxp_ion.h>
 #include <ion-private.h>
 
+#include "map_cache.h"
+
+/*
+ * cache maintenance of lock/unlock
+ * lock() invalidates the fds of a buffer for a sw read, unlock() cleans
+ * them only when one of the locks was for a sw write.
+ */
+struct buffer_sync {
+    int usage;      // of the locks not yet unlocked
+    int locks;
+};
+
+static pthread_mutex_t sync_lock = PTHREAD_MUTEX_INITIALIZER;
+static android::KeyedVector<const private_handle_t *, buffer_sync> sync_states;
+static unsigned int sync_cleans;    // for dump()
+static unsigned int sync_skipped;   // cleans a read-only lock saved
+
+static struct map_cache gralloc_maps;
+static pthread_once_t map_cache_once = PTHREAD_ONCE_INIT;
+
+static void map_cache_setup(void)
+{
+    char value[PROPERTY_VALUE_MAX];
+    size_t budget = MAP_CACHE_BUDGET;
+    if (property_get(MAP_CACHE_BUDGET_PROPERTY, value, NULL) > 0)
+        budget = (size_t)atoi(value) << 10;
+    map_cache_init(&gralloc_maps, budget);
+}
+
+static struct map_cache *get_map_cache(void)
+{
+    pthread_once(&map_cache_once, map_cache_setup);
+    return &gralloc_maps;
+}
+
+/* at register for cpu buffers, otherwise on the first lock: a buffer only
+ * passed through is never mapped */
 static int gralloc_map(gralloc_module_t const *module, buffer_handle_t handle)
 {
     private_handle_t *hnd = (private_handle_t *)handle;
 
-    void *mappedAddress = mmap(0, hnd->size, PROT_READ | PROT_WRITE, MAP_SHARED, hnd->share_fd, 0);
-    if (MAP_FAILED == mappedAddress) {
-        ALOGE("%s: could not mmap at %p, err %s", __func__, hnd, strerror(errno));
-        return -errno;
+    void *mappedAddress = map_cache_get(get_map_cache(), hnd->bufferId(), hnd->share_fd, hnd->size);
+    if (!mappedAddress) {
+        ALOGE("%s: could not mmap at %p", __func__, hnd);
+        return -ENOMEM;
     }
     hnd->base = (int)mappedAddress;
     return 0;
 }
 
-int gralloc_unmap(gralloc_module_t const *module, buffer_handle_t handle)
+static void sync_forget(const private_handle_t *hnd);
+
+/* keep: the buffer may be registered again, its mapping stays in the cache */
+static void unmap_buffer(private_handle_t *hnd, bool keep)
 {
-    private_handle_t *hnd = (private_handle_t *)handle;
+    sync_forget(hnd);
 
     if (!hnd->base)
-        return 0;
-
-    if (munmap((void *)hnd->base, hnd->size) < 0)
-        ALOGE("%s: could not unmap %s 0x%x %d", __func__, strerror(errno), hnd->base, hnd->size);
+        return;
 
+    map_cache_put(get_map_cache(), (void *)hnd->base, keep);
     hnd->base = 0;
+}
+
+/* the buffer is freed */
+int gralloc_unmap(gralloc_module_t const *module, buffer_handle_t handle)
+{
+    unmap_buffer((private_handle_t *)handle, false);
     return 0;
 }
 
+/* out of memory, drop the mappings that hold buffers nobody uses */
+size_t gralloc_map_trim(void)
+{
+    return map_cache_trim(get_map_cache(), 0);
+}
+
+void gralloc_map_dump(char *buff, int buff_len)
+{
+    map_cache_dump(get_map_cache(), buff, buff_len);
+
+    int len = strlen(buff);
+    pthread_mutex_lock(&sync_lock);
+    unsigned int cleans = sync_cleans;
+    unsigned int skipped = sync_skipped;
+    pthread_mutex_unlock(&sync_lock);
+    snprintf(buff + len, buff_len - len,
+            "gralloc cache sync: %u cleans, %u skipped after read-only locks\n", cleans, skipped);
+}
+
 static int getIonClient(gralloc_module_t const *module)
 {
     private_module_t *m = const_cast<private_module_t *>(reinterpret_cast<const private_module_t *>(module));
@@ -55,18 +124,48 @@ static int getIonClient(gralloc_module_t const *module)
     return m->ion_client;
 }
 
+/* every fd of hnd, forDevice: clean after a cpu write, otherwise invalidate for a cpu read */
+static void sync_buffer(gralloc_module_t const *module, const private_handle_t *hnd, bool forDevice)
+{
+    int fds[3] = { hnd->share_fd, hnd->share_fd1, hnd->share_fd2 };
+    int ion = getIonClient(module);
+    for (int i = 0; i < 3; i++) {
+        if (fds[i] < 0)
+            continue;
+        if (forDevice)
+            ion_sync_fd(ion, fds[i]);
+        else
+            ion_sync_from_device(ion, fds[i]);
+    }
+}
+
+static void sync_forget(const private_handle_t *hnd)
+{
+    pthread_mutex_lock(&sync_lock);
+    ssize_t index = sync_states.indexOfKey(hnd);
+    if (index >= 0)
+        sync_states.removeItemsAt(index);
+    pthread_mutex_unlock(&sync_lock);
+}
+
 int gralloc_register_buffer(gralloc_module_t const *module, buffer_handle_t handle)
 {
     if (private_handle_t::validate(handle) < 0)
         return -EINVAL;
-    return gralloc_map(module, handle);
+    // base is the one of the sending process
+    private_handle_t *hnd = (private_handle_t *)handle;
+    hnd->base = 0;
+    // users of cpu buffers (camera jpeg, exif) write through base without locking
+    if (hnd->usage & (GRALLOC_USAGE_SW_READ_MASK | GRALLOC_USAGE_SW_WRITE_MASK))
+        return gralloc_map(module, hnd);
+    return 0;
 }
 
 int gralloc_unregister_buffer(gralloc_module_t const *module, buffer_handle_t handle)
 {
     if (private_handle_t::validate(handle) < 0)
         return -EINVAL;
-    gralloc_unmap(module, handle);
+    unmap_buffer((private_handle_t *)handle, true);
     return 0;
 }
 
@@ -75,15 +174,29 @@ int gralloc_lock(gralloc_module_t const *module, buffer_handle_t handle, int usa
     if (private_handle_t::validate(handle) < 0)
         return -EINVAL;
 
+    private_handle_t *hnd = (private_handle_t *)handle;
+    if (usage & (GRALLOC_USAGE_SW_READ_MASK | GRALLOC_USAGE_SW_WRITE_MASK)) {
+        pthread_mutex_lock(&sync_lock);
+        ssize_t index = sync_states.indexOfKey(hnd);
+        if (index < 0) {
+            buffer_sync state;
+            memset(&state, 0, sizeof(state));
+            index = sync_states.add(hnd, state);
+        }
+        buffer_sync &state = sync_states.editValueAt(index);
+        // nested, unlock cleans for any of them
+        state.usage |= usage;
+        state.locks++;
+        pthread_mutex_unlock(&sync_lock);
+    }
+
     if (vaddr) {
-        private_handle_t *hnd = (private_handle_t *)handle;
         if (!hnd->base)
             gralloc_map(module, hnd);
         *vaddr = (void *)hnd->base;
 
-        if ((usage & GRALLOC_USAGE_SW_READ_MASK) && (hnd->format != HAL_PIXEL_FORMAT_BLOB)) {
-            ion_sync_from_device(getIonClient(module), hnd->share_fd);
-        }
+        if ((usage & GRALLOC_USAGE_SW_READ_MASK) && (hnd->format != HAL_PIXEL_FORMAT_BLOB))
+            sync_buffer(module, hnd, false);
     }
     return 0;
 }
@@ -95,11 +208,109 @@ int gralloc_unlock(gralloc_module_t const *module, buffer_handle_t handle)
 
     private_handle_t *hnd = (private_handle_t *)handle;
 
-    ion_sync_fd(getIonClient(module), hnd->share_fd);
-    if (hnd->share_fd1 >= 0)
-        ion_sync_fd(getIonClient(module), hnd->share_fd1);
-    if (hnd->share_fd2 >= 0)
-        ion_sync_fd(getIonClient(module), hnd->share_fd2);
+    // a buffer locked elsewhere may have been written anywhere
+    int usage = GRALLOC_USAGE_SW_WRITE_MASK;
+    pthread_mutex_lock(&sync_lock);
+    ssize_t index = sync_states.indexOfKey(hnd);
+    if (index >= 0 && sync_states.valueAt(index).locks > 0) {
+        buffer_sync &state = sync_states.editValueAt(index);
+        usage = state.usage;
+        if (--state.locks == 0)
+            state.usage = 0;
+    }
+    // only cpu writes leave dirty lines
+    if (usage & GRALLOC_USAGE_SW_WRITE_MASK)
+        sync_cleans++;
+    else
+        sync_skipped++;
+    pthread_mutex_unlock(&sync_lock);
+
+    if (usage & GRALLOC_USAGE_SW_WRITE_MASK)
+        sync_buffer(module, hnd, true);
 
     return 0;
 }
+
+/*
+ * plane pointers of a yuv buffer from the one mapping of share_fd, buffers
+ * with a fd per plane would need a mapping each and aren't supported
+ */
+int gralloc_lock_ycbcr(gralloc_module_t const *module, buffer_handle_t handle, int usage, int l, int t, int w, int h,
+        struct android_ycbcr *ycbcr)
+{
+    if (private_handle_t::validate(handle) < 0 || !ycbcr)
+        return -EINVAL;
+
+    private_handle_t *hnd = (private_handle_t *)handle;
+    if (hnd->planeNum() < 2 || hnd->share_fd1 >= 0) {
+        ALOGE("%s: %p format 0x%x has no planes in one buffer", __func__, hnd, hnd->format);
+        return -EINVAL;
+    }
+
+    void *vaddr = NULL;
+    int ret = gralloc_lock(module, handle, usage, l, t, w, h, &vaddr);
+    if (ret)
+        return ret;
+    if (!vaddr) {
+        gralloc_unlock(module, handle);
+        return -ENOMEM;
+    }
+
+    char *base = (char *)vaddr;
+    memset(ycbcr, 0, sizeof(*ycbcr));
+    ycbcr->y = base + hnd->plane_offset[0];
+    ycbcr->ystride = hnd->plane_stride[0];
+    ycbcr->cstride = hnd->plane_stride[1];
+    switch (hnd->format) {
+    case HAL_PIXEL_FORMAT_YV12: // Y, Cr, Cb
+        ycbcr->cr = base + hnd->plane_offset[1];
+        ycbcr->cb = base + hnd->plane_offset[2];
+        ycbcr->chroma_step = 1;
+        break;
+    case HAL_PIXEL_FORMAT_NEXELL_YV12: // Y, Cb, Cr
+        ycbcr->cb = base + hnd->plane_offset[1];
+        ycbcr->cr = base + hnd->plane_offset[2];
+        ycbcr->chroma_step = 1;
+        break;
+    case HAL_PIXEL_FORMAT_YCrCb_420_SP:
+    case HAL_PIXEL_FORMAT_NEXELL_YCrCb_420_SP:
+        ycbcr->cr = base + hnd->plane_offset[1];
+        ycbcr->cb = (char *)ycbcr->cr + 1;
+        ycbcr->chroma_step = 2;
+        break;
+    case HAL_PIXEL_FORMAT_NEXELL_YCbCr_422_SP:
+        ycbcr->cb = base + hnd->plane_offset[1];
+        ycbcr->cr = (char *)ycbcr->cb + 1;
+        ycbcr->chroma_step = 2;
+        break;
+    default:
+        gralloc_unlock(module, handle);
+        return -EINVAL;
+    }
+    return 0;
+}
+
+int gralloc_perform(gralloc_module_t const *module, int operation, ...)
+{
+    int ret = -EINVAL;
+    va_list args;
+
+    va_start(args, operation);
+    switch (operation) {
+    case GRALLOC_PERFORM_LOCK_YCBCR: {
+        buffer_handle_t handle = va_arg(args, buffer_handle_t);
+        int usage = va_arg(args, int);
+        int l = va_arg(args, int);
+        int t = va_arg(args, int);
+        int w = va_arg(args, int);
+        int h = va_arg(args, int);
+        struct android_ycbcr *ycbcr = va_arg(args, struct android_ycbcr *);
+        ret = gralloc_lock_ycbcr(module, handle, usage, l, t, w, h, ycbcr);
+        break;
+    }
+    default:
+        break;
+    }
+    va_end(args);
+    return ret;
+}
@@ -0,0 +1,193 @@
+/*
+ * Mapping cache test with memory file descriptors as buffers.
+ *
+ * A dup of a buffer fd with the id of the buffer stands for the fd another
+ * registration of the same buffer gets. A dup with another id stands for
+ * another dma-buf, they all share one inode.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include <cutils/log.h>
+
+#include <NXTest.h>
+
+#include "map_cache.h"
+
+#define SIZE                (1 << 20)
+#define BUDGET              (4 << 20)
+
+static int newBuffer(size_t size)
+{
+    int fd = syscall(SYS_memfd_create, "fake-ion", 0);
+    if (fd < 0 || ftruncate(fd, size) < 0)
+        return -errno;
+    return fd;
+}
+
+static void testShare()
+{
+    printf("%s\n", __func__);
+    struct map_cache cache;
+    map_cache_init(&cache, BUDGET);
+
+    int fd = newBuffer(SIZE);
+    int other = dup(fd);
+
+    // two handles of one buffer, one mapping
+    char *a = (char *)map_cache_get(&cache, 1, fd, SIZE);
+    char *b = (char *)map_cache_get(&cache, 1, other, SIZE);
+    CHECK(a != NULL && a == b);
+    a[0] = 0x5a;
+    CHECK(b[0] == 0x5a);
+    struct map_cache_stats stats = map_cache_get_stats(&cache);
+    CHECK(stats.maps == 1 && stats.hits == 1 && stats.misses == 1);
+    CHECK(stats.mapped_bytes == SIZE);
+
+    // the first release keeps it for the other
+    map_cache_put(&cache, a, true);
+    CHECK(b[0] == 0x5a);
+    map_cache_put(&cache, b, true);
+    stats = map_cache_get_stats(&cache);
+    CHECK(stats.unmaps == 0 && stats.cached_bytes == SIZE);
+
+    // a kept mapping outlives the fds of its buffer
+    close(fd);
+    close(other);
+    CHECK(map_cache_get_stats(&cache).mapped_bytes == SIZE);
+    map_cache_destroy(&cache);
+}
+
+static void testReregister()
+{
+    printf("%s\n", __func__);
+    struct map_cache cache;
+    map_cache_init(&cache, BUDGET);
+
+    int fd = newBuffer(SIZE);
+    // the fd a process gets each time the buffer comes over binder
+    for (int i = 0; i < 100; i++) {
+        int received = dup(fd);
+        char *base = (char *)map_cache_get(&cache, 1, received, SIZE);
+        CHECK(base != NULL);
+        base[i] = i;
+        map_cache_put(&cache, base, true);
+        close(received);
+    }
+    struct map_cache_stats stats = map_cache_get_stats(&cache);
+    CHECK(stats.maps == 1 && stats.unmaps == 0);
+    CHECK(stats.hits == 99 && stats.misses == 1);
+
+    char dump[256];
+    map_cache_dump(&cache, dump, sizeof(dump));
+    printf("%s", dump);
+    CHECK(strstr(dump, "99 hits") != NULL);
+
+    // freed, not kept
+    int received = dup(fd);
+    void *base = map_cache_get(&cache, 1, received, SIZE);
+    map_cache_put(&cache, base, false);
+    stats = map_cache_get_stats(&cache);
+    CHECK(stats.unmaps == 1 && stats.mapped_bytes == 0 && stats.cached_bytes == 0);
+    close(received);
+    close(fd);
+    map_cache_destroy(&cache);
+}
+
+static void testBudget()
+{
+    printf("%s\n", __func__);
+    struct map_cache cache;
+    map_cache_init(&cache, BUDGET);
+
+    // 6 released buffers of 1MB, 4 stay
+    int fds[6];
+    for (int i = 0; i < 6; i++) {
+        fds[i] = newBuffer(SIZE);
+        map_cache_put(&cache, map_cache_get(&cache, i + 1, fds[i], SIZE), true);
+    }
+    struct map_cache_stats stats = map_cache_get_stats(&cache);
+    CHECK(stats.evicted == 2);
+    CHECK(stats.cached_bytes == BUDGET);
+
+    // least recently released went first
+    map_cache_put(&cache, map_cache_get(&cache, 1, fds[0], SIZE), true);
+    stats = map_cache_get_stats(&cache);
+    CHECK(stats.hits == 0 && stats.maps == 7);
+    map_cache_put(&cache, map_cache_get(&cache, 6, fds[5], SIZE), true);
+    CHECK(map_cache_get_stats(&cache).hits == 1);
+
+    // buffers in use don't count
+    void *used[6];
+    for (int i = 0; i < 6; i++)
+        used[i] = map_cache_get(&cache, i + 1, fds[i], SIZE);
+    stats = map_cache_get_stats(&cache);
+    CHECK(stats.cached_bytes == 0 && stats.mapped_bytes == 6 * SIZE);
+    for (int i = 0; i < 6; i++)
+        map_cache_put(&cache, used[i], true);
+
+    // out of memory, all kept ones go
+    CHECK(map_cache_trim(&cache, 0) == BUDGET);
+    stats = map_cache_get_stats(&cache);
+    CHECK(stats.mapped_bytes == 0);
+
+    // no budget, unmapped on release
+    struct map_cache off;
+    map_cache_init(&off, 0);
+    map_cache_put(&off, map_cache_get(&off, 1, fds[0], SIZE), true);
+    CHECK(map_cache_get_stats(&off).unmaps == 1);
+    map_cache_destroy(&off);
+
+    for (int i = 0; i < 6; i++)
+        close(fds[i]);
+    map_cache_destroy(&cache);
+}
+
+static void testSharedInode()
+{
+    printf("%s\n", __func__);
+    struct map_cache cache;
+    map_cache_init(&cache, BUDGET);
+
+    // two buffers behind one inode, a mapping each
+    int fd = newBuffer(SIZE);
+    int other = dup(fd);
+    void *a = map_cache_get(&cache, 1, fd, SIZE);
+    void *b = map_cache_get(&cache, 2, other, SIZE);
+    CHECK(a != NULL && b != NULL && a != b);
+    map_cache_put(&cache, a, true);
+    map_cache_put(&cache, b, true);
+
+    // the second one registered again finds its own
+    void *c = map_cache_get(&cache, 2, other, SIZE);
+    CHECK(c == b);
+    map_cache_put(&cache, c, true);
+    struct map_cache_stats stats = map_cache_get_stats(&cache);
+    CHECK(stats.maps == 2 && stats.hits == 1);
+
+    // unnamed, mapped on each get and never kept
+    void *d = map_cache_get(&cache, 0, fd, SIZE);
+    void *e = map_cache_get(&cache, 0, fd, SIZE);
+    CHECK(d != NULL && e != NULL && d != e);
+    map_cache_put(&cache, d, true);
+    map_cache_put(&cache, e, true);
+    stats = map_cache_get_stats(&cache);
+    CHECK(stats.maps == 4 && stats.unmaps == 2 && stats.cached_bytes == 2 * SIZE);
+
+    close(fd);
+    close(other);
+    map_cache_destroy(&cache);
+}
+
+int main(int argc, char *argv[])
+{
+    testShare();
+    testReregister();
+    testBudget();
+    testSharedInode();
+
+    return testResult();
+}
@@ -41,6 +41,19 @@ LOCAL_MODULE := report_hwc_scenario
 LOCAL_MODULE_TAGS := optional
 include $(BUILD_EXECUTABLE)
 
+# for hwc frame timing
+include $(CLEAR_VARS)
+LOCAL_PRELINK_MODULE := false
+LOCAL_MODULE_PATH := $(TARGET_OUT_EXECUTABLES)
+LOCAL_SHARED_LIBRARIES := liblog libutils libnxhwcservice libcutils libbinder
+LOCAL_CFLAGS += -DLOG_TAG=\"HWC_STATS\"
+LOCAL_C_INCLUDES += frameworks/native/include \
+					system/core/include
+LOCAL_SRC_FILES := executable/dump_hwc_stats.cpp
+LOCAL_MODULE := dump_hwc_stats
+LOCAL_MODULE_TAGS := optional
+include $(BUILD_EXECUTABLE)
+
 # hwc
 include $(CLEAR_VARS)
 LOCAL_PRELINK_MODULE := false
@@ -71,6 +84,12 @@ LOCAL_SRC_FILES := hwc.cpp \
 	impl/HDMIUseOnlyGLImpl.cpp \
 	impl/HDMIUseMirrorAndVideoImpl.cpp \
 	impl/HDMIUseRescCommonImpl.cpp \
+	impl/HWCPlanner.cpp \
+	impl/HWCLayerPlanner.cpp \
+	impl/HWCFrameSignature.cpp \
+	impl/HWCVsyncModel.cpp \
+	impl/HWCFrameStats.cpp \
+	impl/HWCDisplay.cpp \
 	HWCreator.cpp
 
 LOCAL_MODULE := hwcomposer.$(TARGET_BOARD_PLATFORM)
@@ -78,4 +97,98 @@ LOCAL_MODULE_TAGS := optional
 
 include $(BUILD_SHARED_LIBRARY)
 
+include $(CLEAR_VARS)
+# for test
+LOCAL_SRC_FILES := test/test-planner.cpp \
+	impl/HWCPlanner.cpp
+LOCAL_C_INCLUDES := $(LOCAL_PATH)/include \
+	$(LOCAL_PATH)/../include
+LOCAL_CFLAGS += -DLOG_TAG=\"test-planner\"
+
+LOCAL_MODULE := test_hwc_planner
+LOCAL_MODULE_TAGS := optional
+
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+# for test, on the build host
+LOCAL_SRC_FILES := test/test-planner.cpp \
+	impl/HWCPlanner.cpp
+LOCAL_C_INCLUDES := $(LOCAL_PATH)/include \
+	$(LOCAL_PATH)/../include
+LOCAL_CFLAGS += -DLOG_TAG=\"test-planner\"
+
+LOCAL_MODULE := test_hwc_planner_host
+LOCAL_MODULE_TAGS := optional
+
+include $(BUILD_HOST_EXECUTABLE)
+
+include $(CLEAR_VARS)
+# for test
+LOCAL_SRC_FILES := test/test-frame-signature.cpp \
+	impl/HWCFrameSignature.cpp
+LOCAL_SHARED_LIBRARIES := liblog libcutils
+LOCAL_C_INCLUDES := hardware/libhardware/include \
+	system/core/include \
+	$(LOCAL_PATH)/include \
+	$(LOCAL_PATH)/../include
+LOCAL_CFLAGS += -DLOG_TAG=\"test-frame-signature\"
+
+LOCAL_MODULE := test_hwc_frame_signature
+LOCAL_MODULE_TAGS := optional
+
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+# for test
+LOCAL_SRC_FILES := test/test-vsync-model.cpp \
+	impl/HWCVsyncModel.cpp
+LOCAL_SHARED_LIBRARIES := liblog libcutils
+LOCAL_C_INCLUDES := system/core/include \
+	$(LOCAL_PATH)/include \
+	$(LOCAL_PATH)/../include
+LOCAL_CFLAGS += -DLOG_TAG=\"test-vsync-model\"
+
+LOCAL_MODULE := test_hwc_vsync_model
+LOCAL_MODULE_TAGS := optional
+
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+# for test
+LOCAL_SRC_FILES := test/bench-hwc-replay.cpp \
+	test/mock-display.cpp \
+	renderer/HWCCommonRenderer.cpp \
+	renderer/LCDRGBRenderer.cpp \
+	renderer/HDMIMirrorRenderer.cpp \
+	impl/RescConfigure.cpp \
+	impl/LCDCommonImpl.cpp \
+	impl/LCDUseOnlyGLImpl.cpp \
+	impl/LCDUseGLAndVideoImpl.cpp \
+	impl/HDMICommonImpl.cpp \
+	impl/HDMIUseOnlyMirrorImpl.cpp \
+	impl/HDMIUseGLAndVideoImpl.cpp \
+	impl/HDMIUseOnlyGLImpl.cpp \
+	impl/HDMIUseMirrorAndVideoImpl.cpp \
+	impl/HDMIUseRescCommonImpl.cpp \
+	impl/HWCPlanner.cpp \
+	impl/HWCLayerPlanner.cpp \
+	impl/HWCFrameSignature.cpp \
+	impl/HWCVsyncModel.cpp \
+	impl/HWCFrameStats.cpp \
+	impl/HWCDisplay.cpp \
+	HWCreator.cpp
+LOCAL_C_INCLUDES := frameworks/native/include \
+	system/core/include \
+	hardware/libhardware/include \
+	$(LOCAL_PATH)/include \
+	$(LOCAL_PATH)/../include
+LOCAL_CFLAGS += -DLOG_TAG=\"bench-hwc-replay\"
+LOCAL_STATIC_LIBRARIES := libutils liblog libcutils
+
+LOCAL_MODULE := bench_hwc_replay
+LOCAL_MODULE_TAGS := optional
+
+include $(BUILD_HOST_EXECUTABLE)
+
 endif
@@ -0,0 +1,23 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <cutils/log.h>
+#include "../service/NXHWCService.h"
+
+using namespace android;
+
+/* usage: dump_hwc_stats [display], 0: lcd, 1: hdmi, all by default */
+int main(int argc, char *argv[])
+{
+    int32_t display = argc > 1 ? atoi(argv[1]) : -1;
+
+    sp<INXHWCService> hwcService = getNXHWCService();
+    if (hwcService == NULL) {
+        fprintf(stderr, "can't get NXHWCService\n");
+        return 1;
+    }
+
+    String8 stats = hwcService->hwcFrameStats(display);
+    printf("%s", stats.string());
+    return 0;
+}
@@ -4,6 +4,7 @@
 #include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <time.h>
 
 #include <sys/ioctl.h>
 #include <sys/time.h>
@@ -38,6 +39,7 @@
 #include <hardware_legacy/uevent.h>
 
 #include <utils/Atomic.h>
+#include <utils/Timers.h>
 
 #include <gralloc_priv.h>
 
@@ -46,6 +48,10 @@
 #include "HWCRenderer.h"
 #include "HWCImpl.h"
 #include "HWCreator.h"
+#include "HWCFrameSignature.h"
+#include "HWCVsyncModel.h"
+#include "HWCFrameStats.h"
+#include "HWCDisplay.h"
 
 #include "service/NXHWCService.h"
 
@@ -62,6 +68,8 @@
 #define HWC_RESOLUTION_PROPERTY_KEY  "hwc.resolution"
 #define HWC_HDMIMODE_PROPERTY_KEY    "hwc.hdmimode"
 #define HWC_SCREEN_DOWNSIZING_PROPERTY_KEY "hwc.screendownsizing"
+#define HWC_SKIP_UNCHANGED_PROPERTY_KEY    "hwc.skipunchanged"
+#define HWC_SW_VSYNC_PROPERTY_KEY          "hwc.swvsync"
 
 #define MAX_SCALE_FACTOR        3
 
@@ -103,6 +111,17 @@ public:
             NXHWC *mParent;
     } *mPropertyChangeListener;
 
+    struct HWCStatsProvider : public NXHWCService::StatsProvider {
+        public:
+            HWCStatsProvider(struct NXHWC *parent)
+                : mParent(parent)
+            {
+            }
+        virtual String8 getFrameStats(int display);
+        private:
+            NXHWC *mParent;
+    } *mStatsProvider;
+
     /* fds */
     int mVsyncCtlFd;
     int mVsyncMonFd;
@@ -110,6 +129,7 @@ public:
 
     /* threads */
     pthread_t mVsyncThread;
+    pthread_t mSwVsyncThread;
     pthread_t mHDMICECThread;
 
     /* screeninfo */
@@ -143,6 +163,24 @@ public:
     uint32_t mHDMIHeight;
     volatile int32_t mChangingScenario;
 
+    /* software vsync */
+    android::HWCVsyncModel *mVsyncModel;
+    Mutex mVsyncLock;
+    Condition mVsyncSignal;
+    bool mSwVsync;
+    bool mVsyncEnabled;     // by SurfaceFlinger
+    bool mHwVsyncOn;
+    bool mVsyncExit;
+    nsecs_t mLastVsync;     // last one SurfaceFlinger got
+
+    /* unchanged frames */
+    android::HWCFrameSignature mLCDSignature;
+    android::HWCFrameSignature mHDMISignature;
+
+    /* timing */
+    android::HWCFrameStats mLCDStats;
+    android::HWCFrameStats mHDMIStats;
+
     // for prepare, set sync
 #ifdef USE_PREPARE_SET_SERIALIZING_SYNC
     Mutex mSyncLock;
@@ -155,7 +193,12 @@ public:
     Condition mChangeImplSignal;
     bool mChangingImpl;
 
+    int dump(int display, char *buff, int buff_len);
     void handleVsyncEvent();
+    void handleSwVsync();
+    int enableVsync(bool enabled);
+    void resetVsync();
+    int setHwVsync(bool on);
     void handleHDMIEvent(const char *buf, int len);
     void handleUsageScenarioChanged(uint32_t usageScenario);
     void handleResolutionChanged(uint32_t reolution);
@@ -170,6 +213,16 @@ public:
     void setHDMIPreset(uint32_t preset);
 
     void determineUsageScenario();
+
+    android::HWCDisplay getLCDDisplay() {
+        android::HWCDisplay display = { mLCDImpl, NULL, NULL, NULL, &mLCDSignature, &mLCDStats };
+        return display;
+    }
+    android::HWCDisplay getHDMIDisplay() {
+        android::HWCDisplay display = { mHDMIImpl, mHDMIAlternateImpl, &mUseHDMIAlternate, &mChangeHDMIImpl,
+            &mHDMISignature, &mHDMIStats };
+        return display;
+    }
 };
 
 /**
@@ -296,6 +349,19 @@ static void *hwc_vsync_thread(void *data)
     return NULL;
 }
 
+/**********************************************************************************************
+ * Software VSync Thread
+ */
+static void *hwc_sw_vsync_thread(void *data)
+{
+    struct NXHWC *me = (struct NXHWC *)data;
+
+    setpriority(PRIO_PROCESS, 0, HAL_PRIORITY_URGENT_DISPLAY);
+
+    me->handleSwVsync();
+    return NULL;
+}
+
 /**********************************************************************************************
  * HDMI CEC Thread
  */
@@ -580,6 +646,33 @@ void NXHWC::HWCPropertyChangeListener::onPropertyChanged(int code, int val)
     }
 }
 
+String8 NXHWC::HWCStatsProvider::getFrameStats(int display)
+{
+    char buf[4096];
+    mParent->dump(display, buf, sizeof(buf));
+    return String8(buf);
+}
+
+/* display: HWC_DISPLAY_PRIMARY, HWC_DISPLAY_EXTERNAL or -1 for all */
+int NXHWC::dump(int display, char *buff, int buff_len)
+{
+    int len = 0;
+    buff[0] = '\0';
+    if (display < 0 || display == HWC_DISPLAY_PRIMARY) {
+        len += mLCDStats.dump("lcd", buff + len, buff_len - len);
+        len += mLCDSignature.dump("lcd", buff + len, buff_len - len);
+    }
+    if (display < 0 || display == HWC_DISPLAY_EXTERNAL) {
+        len += mHDMIStats.dump("hdmi", buff + len, buff_len - len);
+        len += mHDMISignature.dump("hdmi", buff + len, buff_len - len);
+    }
+    if (display < 0 && mVsyncModel) {
+        Mutex::Autolock l(mVsyncLock);
+        len += mVsyncModel->dump(buff + len, buff_len - len);
+    }
+    return len;
+}
+
 void NXHWC::handleVsyncEvent()
 {
     if (!mProcs)
@@ -602,8 +695,120 @@ void NXHWC::handleVsyncEvent()
     errno = 0;
     uint64_t timestamp = strtoull(buf, NULL, 0);
     ALOGV("vsync: timestamp %llu", timestamp);
-    if (!errno)
-        mProcs->vsync(mProcs, 0, timestamp);
+    if (errno)
+        return;
+
+    if (mSwVsync) {
+        // the hardware delivers only while the model learns
+        Mutex::Autolock l(mVsyncLock);
+        bool wasLocked = mVsyncModel->isLocked();
+        if (!mVsyncModel->addSample(timestamp))
+            setHwVsync(false);
+        if (mVsyncModel->isLocked() != wasLocked)
+            mVsyncSignal.signal();
+        // the sample that locks the model still goes out, the predictions follow it
+        if (wasLocked || !mVsyncEnabled)
+            return;
+        mLastVsync = timestamp;
+    }
+
+    mProcs->vsync(mProcs, 0, timestamp);
+}
+
+/* predicted vsyncs, for as long as the model is locked */
+void NXHWC::handleSwVsync()
+{
+    while (true) {
+        nsecs_t timestamp;
+        {
+            Mutex::Autolock l(mVsyncLock);
+            while (!mVsyncExit && !(mVsyncEnabled && mVsyncModel->isLocked()))
+                mVsyncSignal.wait(mVsyncLock);
+            if (mVsyncExit)
+                break;
+            // never before or on the last one delivered, hardware or predicted
+            nsecs_t after = systemTime(SYSTEM_TIME_MONOTONIC);
+            if (after < mLastVsync + mVsyncModel->getPeriod() / 2)
+                after = mLastVsync + mVsyncModel->getPeriod() / 2;
+            timestamp = mVsyncModel->nextVsync(after);
+        }
+
+        struct timespec spec;
+        spec.tv_sec  = timestamp / 1000000000;
+        spec.tv_nsec = timestamp % 1000000000;
+        int err;
+        do {
+            err = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &spec, NULL);
+        } while (err == EINTR);
+
+        {
+            Mutex::Autolock l(mVsyncLock);
+            if (mVsyncExit || !mVsyncEnabled || !mVsyncModel->isLocked())
+                continue;
+            // the hardware checks the model now and then, meanwhile the predictions go on
+            if (mVsyncModel->needsResync(timestamp)) {
+                mVsyncModel->beginResync();
+                setHwVsync(true);
+            }
+            mLastVsync = timestamp;
+        }
+
+        if (mProcs)
+            mProcs->vsync(mProcs, 0, timestamp);
+    }
+}
+
+/* caller holds mVsyncLock with software vsync */
+int NXHWC::setHwVsync(bool on)
+{
+    if (on == mHwVsyncOn)
+        return 0;
+
+    int err;
+    if (on)
+        err = write(mVsyncCtlFd, VSYNC_ON, sizeof(VSYNC_ON));
+    else
+        err = write(mVsyncCtlFd, VSYNC_OFF, sizeof(VSYNC_OFF));
+    if (err < 0) {
+        ALOGE("failed to write to vsync ctl fd");
+        return -errno;
+    }
+    mHwVsyncOn = on;
+    return 0;
+}
+
+int NXHWC::enableVsync(bool enabled)
+{
+    Mutex::Autolock l(mVsyncLock);
+    mVsyncEnabled = enabled;
+    if (!mSwVsync || !enabled)
+        return setHwVsync(enabled);
+
+    if (!mVsyncModel->isLocked()) {
+        return setHwVsync(true);
+    } else if (mVsyncModel->needsResync(systemTime(SYSTEM_TIME_MONOTONIC))) {
+        mVsyncModel->beginResync();
+        setHwVsync(true);
+    }
+    mVsyncSignal.signal();
+    return 0;
+}
+
+/*
+ * The display stopped or came back, maybe with another timing: the model
+ * starts over and learns from the hardware again.
+ */
+void NXHWC::resetVsync()
+{
+    if (!mSwVsync)
+        return;
+
+    Mutex::Autolock l(mVsyncLock);
+    mVsyncModel->reset();
+    mLastVsync = 0;
+    if (mVsyncEnabled)
+        setHwVsync(true);
+    mVsyncSignal.signal();
 }
 
 void NXHWC::handleHDMIEvent(const char *buf, int len)
@@ -626,6 +831,7 @@ void NXHWC::handleHDMIEvent(const char *buf, int len)
             ALOGD("hdmi plugged!!!");
 
             mHDMIPlugged = true;
+            mHDMISignature.invalidate();
             mHDMIImpl->enable();
             mProcs->hotplug(mProcs, HWC_DISPLAY_EXTERNAL, mHDMIPlugged);
 
@@ -639,6 +845,7 @@ void NXHWC::handleHDMIEvent(const char *buf, int len)
             ALOGD("hdmi unplugged!!!");
 
             mHDMIPlugged = false;
+            mHDMISignature.invalidate();
             mHDMIImpl->disable();
             if (mHDMIAlternateImpl)
                 mHDMIAlternateImpl->disable();
@@ -696,6 +903,8 @@ void NXHWC::changeUsageScenario()
     mLCDImpl = newLCDImpl;
     mHDMIImpl = newHDMIImpl;
     mHDMIAlternateImpl = newHDMIAlternativeImpl;
+    mLCDSignature.invalidate();
+    mHDMISignature.invalidate();
 
     mHDMIImpl->enable();
 
@@ -757,6 +966,7 @@ void NXHWC::changeHDMIImpl()
 
     mHDMIImpl = newHDMIImpl;
     mHDMIAlternateImpl = newHDMIAlternativeImpl;
+    mHDMISignature.invalidate();
 
     // 4. delete old impl
     delete oldHDMIImpl;
@@ -823,6 +1033,8 @@ void NXHWC::handleResolutionChanged(uint32_t preset)
         return;
 
     setHDMIPreset(preset);
+    // a primary hdmi display changes its timing
+    resetVsync();
 
     {
         Mutex::Autolock l(mChangeImplLock);
@@ -867,6 +1079,14 @@ void NXHWC::getHWCProperty()
         mScreenDownSizing = false;
     else
         mScreenDownSizing = buf[0] == '1' ? true : false;
+
+    len = property_get((const char *)HWC_SKIP_UNCHANGED_PROPERTY_KEY, buf, "1"); // default - skip unchanged frames
+    bool skipUnchanged = len <= 0 || buf[0] == '1';
+    mLCDSignature.setEnabled(skipUnchanged);
+    mHDMISignature.setEnabled(skipUnchanged);
+
+    len = property_get((const char *)HWC_SW_VSYNC_PROPERTY_KEY, buf, "1"); // default - predicted vsync
+    mSwVsync = len <= 0 || buf[0] == '1';
 }
 
 void NXHWC::checkHDMIModeAndSetProperty()
@@ -995,28 +1215,14 @@ static int hwc_prepare(struct hwc_composer_device_1 *dev,
 
     ALOGV("prepare: lcd %p, hdmi %p", lcdContents, hdmiContents);
 
-    if (lcdContents)
-        me->mLCDImpl->prepare(lcdContents);
+    if (lcdContents) {
+        android::HWCDisplay lcd = me->getLCDDisplay();
+        android::prepareDisplay(lcd, lcdContents, me->mUsageScenario);
+    }
 
     if (hdmiContents) {
-        int ret = me->mHDMIImpl->prepare(hdmiContents);
-        if (me->mHDMIAlternateImpl) {
-            if (ret < 0) {
-                if (!me->mUseHDMIAlternate) {
-                    ALOGD("Change to Alternate");
-                    me->mChangeHDMIImpl = 1;
-                    me->mUseHDMIAlternate = 1;
-                } else {
-                    me->mHDMIAlternateImpl->prepare(hdmiContents);
-                }
-            } else {
-                if (me->mUseHDMIAlternate) {
-                    ALOGD("Change to Original");
-                    me->mChangeHDMIImpl = 1;
-                    me->mUseHDMIAlternate = 0;
-                }
-            }
-        }
+        android::HWCDisplay hdmi = me->getHDMIDisplay();
+        android::prepareDisplay(hdmi, hdmiContents, me->mUsageScenario);
     }
 
     return 0;
@@ -1035,35 +1241,18 @@ static int hwc_set(struct hwc_composer_device_1 *dev,
 
     ALOGV("hwc_set lcd %p, hdmi %p", lcdContents, hdmiContents);
 
-    private_handle_t const *rgbHandle = NULL;
+    bool lcdCommit = false;
+    android::HWCMirrorSource mirror;
+    mirror.handle = NULL;
+    mirror.target = NULL;
+    android::HWCDisplay lcd = me->getLCDDisplay();
 
-    if (lcdContents) {
-        me->mLCDImpl->set(lcdContents, NULL);
-        rgbHandle = me->mLCDImpl->getRgbHandle();
-    }
+    if (lcdContents)
+        lcdCommit = android::setPrimaryDisplay(lcd, lcdContents, mirror);
 
     if (hdmiContents && me->mHDMIPlugged) {
-        if (me->mChangeHDMIImpl) {
-            if (me->mUseHDMIAlternate) {
-                ALOGD("Use Alternate");
-                me->mHDMIImpl->disable();
-                me->mHDMIAlternateImpl->enable();
-            } else {
-                ALOGD("Use Original");
-                me->mHDMIAlternateImpl->disable();
-                me->mHDMIImpl->enable();
-            }
-            me->mChangeHDMIImpl = 0;
-        } else {
-            android::HWCImpl *impl;
-            if (me->mUseHDMIAlternate) {
-                impl = me->mHDMIAlternateImpl;
-            } else {
-                impl = me->mHDMIImpl;
-            }
-            impl->set(hdmiContents, (void *)rgbHandle);
-            impl->render();
-        }
+        android::HWCDisplay hdmi = me->getHDMIDisplay();
+        android::setExternalDisplay(hdmi, hdmiContents, mirror);
 
         // handle unplug
 #if 0
@@ -1080,8 +1269,11 @@ static int hwc_set(struct hwc_composer_device_1 *dev,
 #endif
     }
 
+    me->mHDMIStats.end();
+
     if (lcdContents)
-        me->mLCDImpl->render();
+        android::renderPrimaryDisplay(lcd, lcdCommit);
+    me->mLCDStats.end();
 
 
     // handle scenario change
@@ -1112,17 +1304,8 @@ static int hwc_eventControl(struct hwc_composer_device_1 *dev, int dpy,
 
     switch (event) {
     case HWC_EVENT_VSYNC:
-        __u32 val = !!enabled;
-        ALOGV("HWC_EVENT_VSYNC: val %d", val);
-        int err;
-        if (val)
-            err = write(me->mVsyncCtlFd, VSYNC_ON, sizeof(VSYNC_ON));
-        else
-            err = write(me->mVsyncCtlFd, VSYNC_OFF, sizeof(VSYNC_OFF));
-        if (err < 0) {
-            ALOGE("failed to write to vsync ctl fd");
-            return -errno;
-        }
+        ALOGV("HWC_EVENT_VSYNC: val %d", !!enabled);
+        return me->enableVsync(!!enabled);
     }
 
     return 0;
@@ -1136,6 +1319,9 @@ static int hwc_blank(struct hwc_composer_device_1 *dev, int disp, int blank)
     me->mBlank[disp] = blank;
     switch (disp) {
     case HWC_DISPLAY_PRIMARY:
+        me->mLCDSignature.invalidate();
+        // no predicted vsync while the panel is off, a fresh model after
+        me->resetVsync();
         if (blank)
             return me->mLCDImpl->disable();
         else
@@ -1143,6 +1329,7 @@ static int hwc_blank(struct hwc_composer_device_1 *dev, int disp, int blank)
         break;
 
     case HWC_DISPLAY_EXTERNAL:
+        me->mHDMISignature.invalidate();
         if (blank)
             v4l2_set_ctrl(nxp_v4l2_hdmi, V4L2_CID_HDMI_ON_OFF, 0);
         else
@@ -1252,6 +1439,12 @@ static int hwc_getDisplayAttributes(struct hwc_composer_device_1 *dev,
     return 0;
 }
 
+static void hwc_dump(struct hwc_composer_device_1 *dev, char *buff, int buff_len)
+{
+    struct NXHWC *me = (struct NXHWC *)dev;
+    me->dump(-1, buff, buff_len);
+}
+
 static void hwc_registerProcs(struct hwc_composer_device_1 *dev,
         hwc_procs_t const *procs)
 {
@@ -1267,6 +1460,16 @@ static int hwc_close(hw_device_t *device)
     pthread_kill(me->mVsyncThread, SIGTERM);
     pthread_join(me->mVsyncThread, NULL);
 
+    if (me->mVsyncModel) {
+        {
+            Mutex::Autolock l(me->mVsyncLock);
+            me->mVsyncExit = true;
+            me->mVsyncSignal.signal();
+        }
+        pthread_join(me->mSwVsyncThread, NULL);
+        delete me->mVsyncModel;
+    }
+
     if (me->mVsyncCtlFd > 0)
         close(me->mVsyncCtlFd);
     if (me->mVsyncMonFd > 0)
@@ -1292,6 +1495,7 @@ static int hwc_open(const struct hw_module_t *module, const char *name, struct h
     ALOGD("hwc_open");
 
     NXHWC::HWCPropertyChangeListener *listener = NULL;
+    NXHWC::HWCStatsProvider *statsProvider = NULL;
     NXHWCService *service = NULL;
 
     if (strcmp(name, HWC_HARDWARE_COMPOSER)) {
@@ -1327,6 +1531,22 @@ static int hwc_open(const struct hw_module_t *module, const char *name, struct h
 
     me->getHWCProperty();
     me->checkHDMIModeAndSetProperty();
+    me->mLCDStats.setPeriod(me->mScreenInfo.vsync_period);
+
+    me->mVsyncEnabled = false;
+    me->mHwVsyncOn = false;
+    me->mVsyncExit = false;
+    me->mLastVsync = 0;
+    if (me->mSwVsync) {
+        me->mVsyncModel = new android::HWCVsyncModel(me->mScreenInfo.vsync_period);
+        ret = pthread_create(&me->mSwVsyncThread, NULL, hwc_sw_vsync_thread, me);
+        if (ret) {
+            ALOGE("failed to start software vsync thread: %s", strerror(ret));
+            delete me->mVsyncModel;
+            me->mVsyncModel = NULL;
+            me->mSwVsync = false;
+        }
+    }
 
     if (me->mHDMIMode == HDMI_MODE_SECONDARY && hdmi_connected()) {
         me->mHDMIPlugged = true;
@@ -1392,6 +1612,7 @@ static int hwc_open(const struct hw_module_t *module, const char *name, struct h
     me->base.blank          = hwc_blank;
     me->base.query          = hwc_query;
     me->base.registerProcs  = hwc_registerProcs;
+    me->base.dump           = hwc_dump;
     me->base.getDisplayConfigs      = hwc_getDisplayConfigs;
     me->base.getDisplayAttributes   = hwc_getDisplayAttributes;
 
@@ -1406,6 +1627,13 @@ static int hwc_open(const struct hw_module_t *module, const char *name, struct h
     }
     me->mPropertyChangeListener = listener;
 
+    statsProvider = new NXHWC::HWCStatsProvider(me);
+    if (!statsProvider) {
+        ALOGE("can't create HWCStatsProvider!!!");
+        goto error_out;
+    }
+    me->mStatsProvider = statsProvider;
+
     ALOGD("start NXHWCService");
     service = startNXHWCService();
     if (!service) {
@@ -1414,6 +1642,7 @@ static int hwc_open(const struct hw_module_t *module, const char *name, struct h
     }
 
     service->registerListener(listener);
+    service->registerStatsProvider(statsProvider);
 
     // prepare - set sync
 #ifdef USE_PREPARE_SET_SERIALIZING_SYNC
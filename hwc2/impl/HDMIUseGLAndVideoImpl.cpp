@@ -32,6 +32,8 @@
 #include "HWCRenderer.h"
 #include "HWCCommonRenderer.h"
 
+#include "HWCPlanner.h"
+#include "HWCLayerPlanner.h"
 #include "HWCImpl.h"
 #include "HDMICommonImpl.h"
 #include "HDMIUseGLAndVideoImpl.h"
@@ -44,6 +46,7 @@ HDMIUseGLAndVideoImpl::HDMIUseGLAndVideoImpl(int rgbID, int videoID)
     mVideoLayerIndex(-1),
     mRGBRenderer(NULL),
     mVideoRenderer(NULL),
+    mPlanner(NULL),
     mRGBHandle(NULL),
     mVideoHandle(NULL),
     mVideoLayer(NULL)
@@ -57,6 +60,7 @@ HDMIUseGLAndVideoImpl::HDMIUseGLAndVideoImpl(int rgbID, int videoID, int width,
     mVideoLayerIndex(-1),
     mRGBRenderer(NULL),
     mVideoRenderer(NULL),
+    mPlanner(NULL),
     mRGBHandle(NULL),
     mVideoHandle(NULL),
     mVideoLayer(NULL)
@@ -70,6 +74,8 @@ HDMIUseGLAndVideoImpl::~HDMIUseGLAndVideoImpl()
         delete mRGBRenderer;
     if (mVideoRenderer)
         delete mVideoRenderer;
+    if (mPlanner)
+        delete mPlanner;
 }
 
 void HDMIUseGLAndVideoImpl::init()
@@ -81,6 +87,8 @@ void HDMIUseGLAndVideoImpl::init()
     mVideoRenderer = new HWCCommonRenderer(mVideoID, 4, 3);
     if (!mVideoRenderer)
         ALOGE("FATAL: can't create VideoRenderer");
+
+    mPlanner = new HWCLayerPlanner(mWidth, mHeight);
 }
 
 int HDMIUseGLAndVideoImpl::enable()
@@ -117,29 +125,7 @@ int HDMIUseGLAndVideoImpl::prepare(hwc_display_contents_1_t *contents)
     // if (unlikely(!mEnabled))
     //     return 0;
 
-    mRGBLayerIndex = -1;
-    mVideoLayerIndex = -1;
-
-    for (size_t i = 0; i < contents->numHwLayers; i++) {
-        hwc_layer_1_t &layer = contents->hwLayers[i];
-
-        if (layer.compositionType == HWC_FRAMEBUFFER_TARGET) {
-            mRGBLayerIndex = i;
-            continue;
-        }
-
-        if (layer.compositionType == HWC_BACKGROUND)
-            continue;
-
-        if (mVideoLayerIndex == -1 && canOverlay(layer)) {
-            layer.compositionType = HWC_OVERLAY;
-            layer.hints |= HWC_HINT_CLEAR_FB;
-            mVideoLayerIndex = i;
-            continue;
-        }
-
-        layer.compositionType = HWC_FRAMEBUFFER;
-    }
+    mVideoLayerIndex = mPlanner->prepare(contents, &mRGBLayerIndex);
 
     ALOGV("prepare");
     return 0;
@@ -185,7 +171,7 @@ int HDMIUseGLAndVideoImpl::set(hwc_display_contents_1_t *contents, void *unused)
         if (layer.compositionType == HWC_BACKGROUND)
             continue;
 
-        if (mVideoLayerIndex == -1 && canOverlay(layer)) {
+        if (mVideoLayerIndex == -1 && layer.compositionType == HWC_OVERLAY) {
             mVideoLayerIndex = i;
             mVideoLayer = &layer;
             continue;
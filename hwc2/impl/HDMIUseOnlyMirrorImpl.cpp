@@ -5,6 +5,7 @@
 #include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <unistd.h>
 
 #include <sys/ioctl.h>
 
@@ -22,6 +23,7 @@
 #include <nxp-v4l2.h>
 
 #include <cutils/log.h>
+#include <sync/sync.h>
 
 #include <hardware/hwcomposer.h>
 #include <hardware/hardware.h>
@@ -40,7 +42,8 @@ using namespace android;
 HDMIUseOnlyMirrorImpl::HDMIUseOnlyMirrorImpl(int rgbID)
     :HDMICommonImpl(rgbID, -1),
     mConfigured(false),
-    mMirrorRenderer(NULL)
+    mMirrorRenderer(NULL),
+    mTarget(NULL)
 {
     init();
 }
@@ -48,7 +51,8 @@ HDMIUseOnlyMirrorImpl::HDMIUseOnlyMirrorImpl(int rgbID)
 HDMIUseOnlyMirrorImpl::HDMIUseOnlyMirrorImpl(int rgbID, int width, int height, int srcWidth, int srcHeight)
     :HDMICommonImpl(rgbID, -1, width, height, srcWidth, srcHeight),
     mConfigured(false),
-    mMirrorRenderer(NULL)
+    mMirrorRenderer(NULL),
+    mTarget(NULL)
 {
     init();
     ALOGD("mWidth %d, mHeight %d, srcWidth %d, srcHeight %d", mWidth, mHeight, srcWidth, srcHeight);
@@ -152,8 +156,9 @@ int HDMIUseOnlyMirrorImpl::set(hwc_display_contents_1_t *contents, void *hnd)
     if (!mConfigured)
         config();
 
-    private_handle_t const *rgbHandle = (private_handle_t const *)hnd;
-    mMirrorRenderer->setHandle(rgbHandle);
+    HWCMirrorSource const *source = (HWCMirrorSource const *)hnd;
+    mMirrorRenderer->setHandle(source ? source->handle : NULL);
+    mTarget = source ? source->target : NULL;
 
     ALOGV("set");
     return -EINVAL;
@@ -171,7 +176,30 @@ private_handle_t const *HDMIUseOnlyMirrorImpl::getVideoHandle()
 
 int HDMIUseOnlyMirrorImpl::render()
 {
-    return mMirrorRenderer->render();
+    int fenceFd = mTarget ? mTarget->acquireFenceFd : -1;
+    int ret = mMirrorRenderer->render(&fenceFd);
+    if (fenceFd < 0) {
+        mTarget = NULL;
+        return ret;
+    }
+
+    // surfaceflinger renders into the target again once lcd and hdmi are done with it
+    if (!mTarget) {
+        close(fenceFd);
+    } else if (mTarget->releaseFenceFd < 0) {
+        mTarget->releaseFenceFd = fenceFd;
+    } else {
+        int merged = sync_merge("hdmi-mirror", mTarget->releaseFenceFd, fenceFd);
+        if (merged < 0) {
+            ALOGE("failed to sync_merge(): %d", errno);
+        } else {
+            close(mTarget->releaseFenceFd);
+            mTarget->releaseFenceFd = merged;
+        }
+        close(fenceFd);
+    }
+    mTarget = NULL;
+    return ret;
 }
 
 int HDMIUseOnlyMirrorImpl::config()
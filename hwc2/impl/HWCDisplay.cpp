@@ -0,0 +1,103 @@
+#undef LOG_TAG
+#define LOG_TAG     "HWCDisplay"
+
+#include <cutils/log.h>
+
+#include <hardware/hwcomposer.h>
+#include <hardware/hardware.h>
+
+#include <gralloc_priv.h>
+
+#include "HWCDisplay.h"
+
+using namespace android;
+
+void android::prepareDisplay(HWCDisplay &display, hwc_display_contents_1_t *contents, int32_t scenario)
+{
+    display.stats->stage(HWCFrameStats::PREPARE_BEGIN);
+    display.signature->restore(contents);
+    int ret = display.impl->prepare(contents);
+    if (display.alternate) {
+        if (ret < 0) {
+            if (!*display.useAlternate) {
+                ALOGD("Change to Alternate");
+                *display.changeImpl = 1;
+                *display.useAlternate = 1;
+            } else {
+                display.alternate->prepare(contents);
+            }
+        } else {
+            if (*display.useAlternate) {
+                ALOGD("Change to Original");
+                *display.changeImpl = 1;
+                *display.useAlternate = 0;
+            }
+        }
+    }
+    if (display.changeImpl && *display.changeImpl)
+        display.signature->invalidate();
+    if (display.signature->prepare(contents))
+        display.stats->setFlags(HWCFrameStats::FLAG_GLES_SKIPPED);
+    if (display.useAlternate && *display.useAlternate)
+        display.stats->setFlags(HWCFrameStats::FLAG_ALTERNATE);
+    display.stats->setLayers(contents, scenario);
+    display.stats->stage(HWCFrameStats::PREPARE_END);
+}
+
+bool android::setPrimaryDisplay(HWCDisplay &display, hwc_display_contents_1_t *contents, HWCMirrorSource &mirror)
+{
+    display.stats->stage(HWCFrameStats::SET_BEGIN);
+    bool commit = display.signature->set(contents);
+    if (commit)
+        display.impl->set(contents, NULL);
+    else
+        display.stats->setFlags(HWCFrameStats::FLAG_COMMIT_SKIPPED);
+    mirror.handle = display.impl->getRgbHandle();
+    if (commit && contents->numHwLayers > 0) {
+        hwc_layer_1_t *target = &contents->hwLayers[contents->numHwLayers - 1];
+        if (target->compositionType == HWC_FRAMEBUFFER_TARGET &&
+                reinterpret_cast<private_handle_t const *>(target->handle) == mirror.handle)
+            mirror.target = target;
+    }
+    display.stats->stage(HWCFrameStats::SET_END);
+    return commit;
+}
+
+void android::setExternalDisplay(HWCDisplay &display, hwc_display_contents_1_t *contents, HWCMirrorSource &mirror)
+{
+    if (display.changeImpl && *display.changeImpl) {
+        if (*display.useAlternate) {
+            ALOGD("Use Alternate");
+            display.impl->disable();
+            display.alternate->enable();
+        } else {
+            ALOGD("Use Original");
+            display.alternate->disable();
+            display.impl->enable();
+        }
+        *display.changeImpl = 0;
+        return;
+    }
+
+    HWCImpl *impl = display.useAlternate && *display.useAlternate ? display.alternate : display.impl;
+    display.stats->stage(HWCFrameStats::SET_BEGIN);
+    if (display.signature->set(contents, mirror.handle)) {
+        impl->set(contents, &mirror);
+        display.stats->stage(HWCFrameStats::SET_END);
+        display.stats->stage(HWCFrameStats::RENDER_BEGIN);
+        impl->render();
+        display.stats->stage(HWCFrameStats::RENDER_END);
+    } else {
+        display.stats->setFlags(HWCFrameStats::FLAG_COMMIT_SKIPPED);
+        display.stats->stage(HWCFrameStats::SET_END);
+    }
+}
+
+void android::renderPrimaryDisplay(HWCDisplay &display, bool commit)
+{
+    if (!commit)
+        return;
+    display.stats->stage(HWCFrameStats::RENDER_BEGIN);
+    display.impl->render();
+    display.stats->stage(HWCFrameStats::RENDER_END);
+}
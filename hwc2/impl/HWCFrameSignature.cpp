@@ -0,0 +1,184 @@
+#undef LOG_TAG
+#define LOG_TAG     "HWCFrameSignature"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <cutils/log.h>
+#include <cutils/atomic.h>
+
+#include <hardware/hwcomposer.h>
+#include <hardware/hardware.h>
+
+#include "HWCFrameSignature.h"
+
+using namespace android;
+
+static uint32_t regionHash(const hwc_region_t &region)
+{
+    // fnv-1a
+    uint32_t hash = 2166136261u;
+    const uint8_t *p = (const uint8_t *)region.rects;
+    size_t len = region.numRects * sizeof(hwc_rect_t);
+    for (size_t i = 0; region.rects && i < len; i++)
+        hash = (hash ^ p[i]) * 16777619u;
+    return hash ^ region.numRects;
+}
+
+static inline uint64_t area(const hwc_rect_t &r)
+{
+    return (uint64_t)(r.right - r.left) * (r.bottom - r.top);
+}
+
+HWCFrameSignature::HWCFrameSignature()
+    :mEnabled(true),
+    mInvalidated(0),
+    mValid(false),
+    mFaked(0)
+{
+    memset(&mPrepared, 0, sizeof(mPrepared));
+    memset(&mComposed, 0, sizeof(mComposed));
+    memset(&mCommitted, 0, sizeof(mCommitted));
+    memset(&mStats, 0, sizeof(mStats));
+}
+
+void HWCFrameSignature::setEnabled(bool enabled)
+{
+    mEnabled = enabled;
+    invalidate();
+}
+
+void HWCFrameSignature::invalidate()
+{
+    android_atomic_release_store(1, &mInvalidated);
+}
+
+/* glesOnly: the handles of the overlays are left out, the framebuffer target doesn't hold them */
+bool HWCFrameSignature::build(hwc_display_contents_1_t *contents, bool glesOnly, Signature &sig)
+{
+    memset(&sig, 0, sizeof(sig));
+    for (size_t i = 0; i < contents->numHwLayers; i++) {
+        hwc_layer_1_t &layer = contents->hwLayers[i];
+        if (layer.compositionType == HWC_FRAMEBUFFER_TARGET) {
+            sig.target = layer.handle;
+            break;
+        }
+        if (sig.count == MAX_LAYERS)
+            return false;
+        if (!layer.handle || (layer.flags & HWC_SKIP_LAYER))
+            return false;
+
+        LayerKey &key = sig.layers[sig.count++];
+        key.handle = glesOnly && layer.compositionType != HWC_FRAMEBUFFER ? NULL : layer.handle;
+        key.compositionType = layer.compositionType;
+        key.flags = layer.flags;
+        key.transform = layer.transform;
+        key.blending = layer.blending;
+#ifdef HWC_DEVICE_API_VERSION_1_2
+        key.planeAlpha = layer.planeAlpha;
+#endif
+        key.sourceCrop[0] = layer.sourceCrop.left;
+        key.sourceCrop[1] = layer.sourceCrop.top;
+        key.sourceCrop[2] = layer.sourceCrop.right;
+        key.sourceCrop[3] = layer.sourceCrop.bottom;
+        key.displayFrame[0] = layer.displayFrame.left;
+        key.displayFrame[1] = layer.displayFrame.top;
+        key.displayFrame[2] = layer.displayFrame.right;
+        key.displayFrame[3] = layer.displayFrame.bottom;
+        key.visibleRegion = regionHash(layer.visibleRegionScreen);
+    }
+    return true;
+}
+
+bool HWCFrameSignature::equal(const Signature &a, const Signature &b)
+{
+    return a.count == b.count &&
+        a.target == b.target &&
+        a.extra == b.extra &&
+        !memcmp(a.layers, b.layers, a.count * sizeof(LayerKey));
+}
+
+void HWCFrameSignature::restore(hwc_display_contents_1_t *contents)
+{
+    for (size_t i = 0; mFaked && i < contents->numHwLayers && i < MAX_LAYERS; i++) {
+        hwc_layer_1_t &layer = contents->hwLayers[i];
+        if ((mFaked & (1u << i)) && layer.compositionType == HWC_OVERLAY)
+            layer.compositionType = HWC_FRAMEBUFFER;
+    }
+    mFaked = 0;
+}
+
+bool HWCFrameSignature::prepare(hwc_display_contents_1_t *contents)
+{
+    mStats.frames++;
+
+    bool built = build(contents, true, mPrepared);
+    if (!built)
+        mPrepared.count = -1;
+    if (!mEnabled || !built || !mValid || android_atomic_acquire_load(&mInvalidated))
+        return false;
+    if ((contents->flags & HWC_GEOMETRY_CHANGED) || !mPrepared.target)
+        return false;
+    // SurfaceFlinger hands the target of the last frame until GLES composes again
+    if (!equal(mPrepared, mComposed))
+        return false;
+
+    uint64_t saved = 0;
+    for (int i = 0; i < mPrepared.count; i++) {
+        hwc_layer_1_t &layer = contents->hwLayers[i];
+        if (layer.compositionType != HWC_FRAMEBUFFER)
+            continue;
+        layer.compositionType = HWC_OVERLAY;
+        mFaked |= 1u << i;
+        // read the source, write the target
+        saved += (area(layer.sourceCrop) + area(layer.displayFrame)) * 4;
+    }
+    if (!mFaked)
+        return false;
+
+    mStats.glesSkipped++;
+    mStats.savedBytes += saved;
+    ALOGV("prepare: gles skipped, %d layers", mPrepared.count);
+    return true;
+}
+
+bool HWCFrameSignature::set(hwc_display_contents_1_t *contents, const void *extra)
+{
+    restore(contents);
+
+    bool invalidated = android_atomic_acquire_cas(1, 0, &mInvalidated) == 0;
+
+    Signature committed;
+    bool built = mEnabled && mPrepared.count >= 0 && build(contents, false, committed);
+    committed.extra = extra;
+    if (built && mValid && !invalidated && !(contents->flags & HWC_GEOMETRY_CHANGED) &&
+            equal(committed, mCommitted)) {
+        mStats.commitsSkipped++;
+        ALOGV("set: commit skipped");
+        return false;
+    }
+
+    mValid = built;
+    if (built) {
+        mCommitted = committed;
+        mComposed = mPrepared;
+        mComposed.target = committed.target;
+    }
+    return true;
+}
+
+HWCFrameSignature::Stats HWCFrameSignature::getStats() const
+{
+    return mStats;
+}
+
+int HWCFrameSignature::dump(const char *name, char *buff, int buff_len) const
+{
+    if (buff_len <= 0)
+        return 0;
+    int len = snprintf(buff, buff_len,
+            "%s: %u frames, %u gles skipped, %u commits skipped, %llu KB gpu traffic saved%s\n",
+            name, mStats.frames, mStats.glesSkipped, mStats.commitsSkipped,
+            (unsigned long long)(mStats.savedBytes >> 10), mEnabled ? "" : " (disabled)");
+    return len < buff_len ? len : buff_len - 1;
+}
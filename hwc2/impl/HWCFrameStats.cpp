@@ -0,0 +1,186 @@
+#undef LOG_TAG
+#define LOG_TAG     "HWCFrameStats"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <cutils/log.h>
+#include <utils/Timers.h>
+
+#include <hardware/hwcomposer.h>
+#include <hardware/hardware.h>
+
+#include "HWCFrameStats.h"
+
+using namespace android;
+
+static char typeChar(int32_t type)
+{
+    switch (type) {
+    case HWC_FRAMEBUFFER:           return 'F';
+    case HWC_OVERLAY:               return 'O';
+    case HWC_BACKGROUND:            return 'B';
+    case HWC_FRAMEBUFFER_TARGET:    return 'T';
+    default:                        return '?';
+    }
+}
+
+static inline int64_t span(const HWCFrameStats::Frame &f, int from, int to)
+{
+    return f.time[from] && f.time[to] ? f.time[to] - f.time[from] : -1;
+}
+
+HWCFrameStats::HWCFrameStats()
+    :mPeriod(16666667),
+    mCurrent(0),
+    mOpen(false),
+    mFrameCount(0),
+    mMissed(0)
+{
+    memset(mFrames, 0, sizeof(mFrames));
+    memset(mScenarios, 0, sizeof(mScenarios));
+}
+
+void HWCFrameStats::setPeriod(int64_t period)
+{
+    Mutex::Autolock l(mLock);
+    if (period > 0)
+        mPeriod = period;
+}
+
+/* caller holds mLock */
+void HWCFrameStats::close()
+{
+    if (!mOpen)
+        return;
+    mOpen = false;
+
+    const Frame &f = mFrames[mCurrent];
+    int last = f.time[RENDER_END] ? RENDER_END : f.time[SET_END] ? SET_END : PREPARE_END;
+    int64_t total = span(f, PREPARE_BEGIN, last);
+    if (total >= mPeriod)
+        mMissed += total / mPeriod;
+}
+
+void HWCFrameStats::stage(Stage stage)
+{
+    int64_t now = systemTime(SYSTEM_TIME_MONOTONIC);
+    Mutex::Autolock l(mLock);
+
+    if (stage == PREPARE_BEGIN) {
+        close();
+        mCurrent = (mCurrent + 1) % FRAMES;
+        memset(&mFrames[mCurrent], 0, sizeof(Frame));
+        mOpen = true;
+        mFrameCount++;
+    } else if (!mOpen) {
+        return;
+    }
+
+    mFrames[mCurrent].time[stage] = now;
+    if (stage == RENDER_END)
+        close();
+}
+
+void HWCFrameStats::setLayers(hwc_display_contents_1_t *contents, int32_t scenario)
+{
+    Mutex::Autolock l(mLock);
+    if (!mOpen)
+        return;
+
+    Frame &f = mFrames[mCurrent];
+    f.scenario = scenario;
+    f.layers = contents->numHwLayers;
+    size_t i;
+    for (i = 0; i < contents->numHwLayers && i < MAX_TYPES; i++)
+        f.types[i] = typeChar(contents->hwLayers[i].compositionType);
+    f.types[i] = '\0';
+
+    if (scenario >= 0 && scenario < MAX_SCENARIOS)
+        mScenarios[scenario]++;
+}
+
+void HWCFrameStats::setFlags(uint16_t flags)
+{
+    Mutex::Autolock l(mLock);
+    if (mOpen)
+        mFrames[mCurrent].flags |= flags;
+}
+
+void HWCFrameStats::end()
+{
+    Mutex::Autolock l(mLock);
+    close();
+}
+
+int HWCFrameStats::dump(const char *name, char *buff, int buff_len) const
+{
+    Mutex::Autolock l(mLock);
+    int len = 0;
+
+#define APPEND(...) do { \
+        if (len < buff_len) \
+            len += snprintf(buff + len, buff_len - len, __VA_ARGS__); \
+    } while (0)
+
+    // durations over the ring, in us
+    static const struct {
+        const char *name;
+        int from;
+        int to;
+    } spans[] = {
+        { "prepare", PREPARE_BEGIN, PREPARE_END },
+        { "set", SET_BEGIN, SET_END },
+        { "render", RENDER_BEGIN, RENDER_END },
+        { "frame", PREPARE_BEGIN, RENDER_END },
+    };
+
+    uint32_t frames = mFrameCount < FRAMES ? mFrameCount : FRAMES;
+    APPEND("%s: %u frames, %u missed vsyncs, period %lld us\n",
+            name, mFrameCount, mMissed, (long long)(mPeriod / 1000));
+
+    for (size_t s = 0; s < sizeof(spans) / sizeof(spans[0]); s++) {
+        int64_t sum = 0, max = 0;
+        uint32_t count = 0;
+        for (int i = 0; i < FRAMES; i++) {
+            int64_t d = span(mFrames[i], spans[s].from, spans[s].to);
+            if (d < 0)
+                continue;
+            sum += d;
+            if (d > max)
+                max = d;
+            count++;
+        }
+        APPEND("  %-8s avg %5lld us, max %6lld us, %u of the last %u\n", spans[s].name,
+                count ? (long long)(sum / count / 1000) : 0LL, (long long)(max / 1000), count, frames);
+    }
+
+    APPEND("  scenarios:");
+    for (int i = 0; i < MAX_SCENARIOS; i++) {
+        if (mScenarios[i])
+            APPEND(" %d:%u", i, mScenarios[i]);
+    }
+    APPEND("\n");
+
+    // the latest first, times in us from the start of prepare
+    APPEND("  prepared      set  set end   render      end scn flags layers\n");
+    for (uint32_t n = 0; n < frames && n < DUMP_FRAMES; n++) {
+        const Frame &f = mFrames[(mCurrent + FRAMES - n) % FRAMES];
+        APPEND(" ");
+        for (int s = PREPARE_END; s < STAGE_MAX; s++) {
+            int64_t d = span(f, PREPARE_BEGIN, s);
+            if (d < 0)
+                APPEND(" %8s", "-");
+            else
+                APPEND(" %8lld", (long long)(d / 1000));
+        }
+        APPEND(" %3d %c%c%c   %s%s\n", f.scenario,
+                f.flags & FLAG_GLES_SKIPPED ? 'g' : '-',
+                f.flags & FLAG_COMMIT_SKIPPED ? 'c' : '-',
+                f.flags & FLAG_ALTERNATE ? 'a' : '-',
+                f.types, f.layers > MAX_TYPES ? "..." : "");
+    }
+
+#undef APPEND
+    return len < buff_len ? len : buff_len - 1;
+}
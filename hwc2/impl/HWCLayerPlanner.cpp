@@ -0,0 +1,186 @@
+#undef LOG_TAG
+#define LOG_TAG     "HWCLayerPlanner"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <cutils/log.h>
+
+#include <hardware/hwcomposer.h>
+#include <hardware/hardware.h>
+
+#include <gralloc_priv.h>
+
+#include "HWCPlanner.h"
+#include "HWCLayerPlanner.h"
+
+using namespace android;
+
+// the mlc video layer scales by 1/2 to 8
+#define VIDEO_MAX_DOWNSCALE     2
+#define VIDEO_MAX_UPSCALE       8
+
+// a byte through the gpu costs as much as 3 scanned out:
+// texture fetch, blend and the framebuffer write all go through its cache
+#define GPU_WEIGHT              300
+// register writes and the qbuf of each frame
+#define OVERLAY_COST            (64 * 1024)
+// set_format, reqbuf and a stream restart when the video layer changes
+#define SWITCH_COST             (1024 * 1024)
+
+static int formatBits(int format, bool *hasAlpha)
+{
+    *hasAlpha = false;
+    switch (format) {
+    case HAL_PIXEL_FORMAT_RGBA_8888:
+    case HAL_PIXEL_FORMAT_BGRA_8888:
+        *hasAlpha = true;
+        return 32;
+    case HAL_PIXEL_FORMAT_RGBX_8888:
+        return 32;
+    case HAL_PIXEL_FORMAT_RGB_888:
+        return 24;
+    case HAL_PIXEL_FORMAT_RGB_565:
+    case HAL_PIXEL_FORMAT_YCbCr_422_SP:
+    case HAL_PIXEL_FORMAT_YCbCr_422_I:
+        return 16;
+    case HAL_PIXEL_FORMAT_YV12:
+    case HAL_PIXEL_FORMAT_YCrCb_420_SP:
+        return 12;
+    default:
+        return 32;
+    }
+}
+
+static HWCPlanner::Blending toBlending(int32_t blending)
+{
+    switch (blending) {
+    case HWC_BLENDING_PREMULT:
+        return HWCPlanner::BLEND_PREMULT;
+    case HWC_BLENDING_COVERAGE:
+        return HWCPlanner::BLEND_COVERAGE;
+    default:
+        return HWCPlanner::BLEND_NONE;
+    }
+}
+
+static inline void toRect(HWCPlanner::Rect &dst, const hwc_rect_t &src)
+{
+    dst.left = src.left;
+    dst.top = src.top;
+    dst.right = src.right;
+    dst.bottom = src.bottom;
+}
+
+HWCLayerPlanner::HWCLayerPlanner(int width, int height)
+    :mPlanner(NULL),
+    mLayers(NULL),
+    mLayerCapacity(0),
+    mHasLast(false)
+{
+    HWCPlanner::Config config;
+    memset(&config, 0, sizeof(config));
+    config.width = width;
+    config.height = height;
+
+    // the formats of canOverlay(), no alpha: the layer goes under the framebuffer
+    HWCPlanner::Plane &video = config.planes[0];
+    video.name = "video";
+    video.zorder = -1;
+    video.formats[0] = HAL_PIXEL_FORMAT_YCbCr_422_SP;
+    video.formats[1] = HAL_PIXEL_FORMAT_YCrCb_420_SP;
+    video.formats[2] = HAL_PIXEL_FORMAT_YCbCr_422_I;
+    video.formats[3] = HAL_PIXEL_FORMAT_YV12;
+    video.formatCount = 4;
+    video.scaling = true;
+    video.maxDownscale = VIDEO_MAX_DOWNSCALE;
+    video.maxUpscale = VIDEO_MAX_UPSCALE;
+    config.planeCount = 1;
+
+    config.gpuWeight = GPU_WEIGHT;
+    config.overlayCost = OVERLAY_COST;
+    config.switchCost = SWITCH_COST;
+    // a full screen of 32 bit pixels, the bus has no room for more next to the framebuffer
+    if (width > 0 && height > 0)
+        config.maxOverlayBytes = (unsigned long long)width * height * 4;
+
+    mPlanner = new HWCPlanner(config);
+    memset(&mLast, 0, sizeof(mLast));
+}
+
+HWCLayerPlanner::~HWCLayerPlanner()
+{
+    if (mPlanner)
+        delete mPlanner;
+    free(mLayers);
+}
+
+bool HWCLayerPlanner::convert(hwc_display_contents_1_t *contents, int count)
+{
+    if ((size_t)count > mLayerCapacity) {
+        HWCPlanner::Layer *layers = (HWCPlanner::Layer *)realloc(mLayers, count * sizeof(*layers));
+        if (!layers) {
+            ALOGE("can't alloc %d layers", count);
+            return false;
+        }
+        mLayers = layers;
+        mLayerCapacity = count;
+    }
+
+    for (int i = 0; i < count; i++) {
+        hwc_layer_1_t &layer = contents->hwLayers[i];
+        HWCPlanner::Layer &l = mLayers[i];
+        private_handle_t const *hnd = reinterpret_cast<private_handle_t const *>(layer.handle);
+        l.skip = !hnd || (layer.flags & HWC_SKIP_LAYER) || layer.compositionType == HWC_BACKGROUND;
+        l.format = hnd ? hnd->format : 0;
+        l.bitsPerPixel = formatBits(l.format, &l.hasAlpha);
+        l.blending = toBlending(layer.blending);
+        l.transform = layer.transform;
+        toRect(l.sourceCrop, layer.sourceCrop);
+        toRect(l.displayFrame, layer.displayFrame);
+    }
+    return true;
+}
+
+int HWCLayerPlanner::prepare(hwc_display_contents_1_t *contents, int *fbTarget)
+{
+    // the layers above the framebuffer target are not composed
+    int count = 0;
+    *fbTarget = -1;
+    for (size_t i = 0; i < contents->numHwLayers; i++) {
+        if (contents->hwLayers[i].compositionType == HWC_FRAMEBUFFER_TARGET) {
+            *fbTarget = i;
+            break;
+        }
+        count++;
+    }
+
+    HWCPlanner::Result result;
+    if (convert(contents, count)) {
+        mPlanner->plan(mLayers, count, mHasLast ? &mLast : NULL, result);
+    } else {
+        // all in GLES
+        memset(&result, 0, sizeof(result));
+        for (int p = 0; p < HWCPlanner::MAX_PLANES; p++)
+            result.layer[p] = -1;
+    }
+
+    for (int i = 0; i < count; i++) {
+        hwc_layer_1_t &layer = contents->hwLayers[i];
+        if (layer.compositionType == HWC_BACKGROUND)
+            continue;
+        if (HWCPlanner::planeOf(result, i) >= 0) {
+            layer.compositionType = HWC_OVERLAY;
+            layer.hints |= HWC_HINT_CLEAR_FB;
+        } else {
+            layer.compositionType = HWC_FRAMEBUFFER;
+        }
+    }
+
+    ALOGV("prepare: %d layers, video %d, cost %llu (gles %llu, overlay %llu), %d candidates",
+            count, result.layer[0], result.cost, result.glesCost, result.overlayCost, result.candidates);
+
+    mLast = result;
+    mHasLast = true;
+    return result.layer[0];
+}
@@ -0,0 +1,260 @@
+#include <string.h>
+
+#include "HWCPlanner.h"
+
+namespace android {
+
+struct HWCPlanner::Search {
+    const Layer *layers;
+    int count;
+    int candidates;                 // layers a plane may take, at most MAX_LAYERS
+    const Result *previous;
+    int assign[MAX_PLANES];
+    bool used[MAX_LAYERS];
+    int evaluated;
+    Result best;
+    bool found;
+    bool bestIsPrevious;
+};
+
+static inline int width(const HWCPlanner::Rect &r)
+{
+    return r.right - r.left;
+}
+
+static inline int height(const HWCPlanner::Rect &r)
+{
+    return r.bottom - r.top;
+}
+
+static inline bool intersects(const HWCPlanner::Rect &a, const HWCPlanner::Rect &b)
+{
+    return a.left < b.right && b.left < a.right && a.top < b.bottom && b.top < a.bottom;
+}
+
+static inline bool blended(const HWCPlanner::Layer &layer)
+{
+    return layer.hasAlpha && layer.blending != HWCPlanner::BLEND_NONE;
+}
+
+static inline unsigned long long sourceBytes(const HWCPlanner::Layer &layer)
+{
+    return (unsigned long long)width(layer.sourceCrop) * height(layer.sourceCrop) * layer.bitsPerPixel / 8;
+}
+
+static inline unsigned long long frameBytes(const HWCPlanner::Layer &layer)
+{
+    return (unsigned long long)width(layer.displayFrame) * height(layer.displayFrame) * 4;
+}
+
+HWCPlanner::HWCPlanner(const Config &config)
+    :mConfig(config)
+{
+    if (mConfig.planeCount > MAX_PLANES)
+        mConfig.planeCount = MAX_PLANES;
+}
+
+int HWCPlanner::planeOf(const Result &result, int layer)
+{
+    for (int i = 0; i < MAX_PLANES; i++) {
+        if (result.layer[i] == layer)
+            return i;
+    }
+    return -1;
+}
+
+bool HWCPlanner::accepts(const Plane &plane, const Layer &layer, const char **reason) const
+{
+    const char *dummy;
+    if (!reason)
+        reason = &dummy;
+
+    if (layer.skip) {
+        *reason = "skip";
+        return false;
+    }
+
+    bool format = false;
+    for (int i = 0; i < plane.formatCount; i++)
+        format |= plane.formats[i] == layer.format;
+    if (!format) {
+        *reason = "format";
+        return false;
+    }
+
+    if (layer.transform) {
+        *reason = "transform";
+        return false;
+    }
+
+    const Rect &src = layer.sourceCrop;
+    const Rect &dst = layer.displayFrame;
+    if (width(src) <= 0 || height(src) <= 0 || width(dst) <= 0 || height(dst) <= 0) {
+        *reason = "empty";
+        return false;
+    }
+    if (dst.left < 0 || dst.top < 0 ||
+        (mConfig.width > 0 && dst.right > mConfig.width) || (mConfig.height > 0 && dst.bottom > mConfig.height)) {
+        *reason = "offscreen";
+        return false;
+    }
+
+    if (width(src) != width(dst) || height(src) != height(dst)) {
+        if (!plane.scaling) {
+            *reason = "scaling";
+            return false;
+        }
+        if (width(src) > width(dst) * plane.maxDownscale || height(src) > height(dst) * plane.maxDownscale) {
+            *reason = "downscale";
+            return false;
+        }
+        if (width(dst) > width(src) * plane.maxUpscale || height(dst) > height(src) * plane.maxUpscale) {
+            *reason = "upscale";
+            return false;
+        }
+    }
+
+    if (blended(layer)) {
+        if (layer.blending == BLEND_PREMULT && !plane.premultiplied) {
+            *reason = "premultiplied";
+            return false;
+        }
+        if (layer.blending == BLEND_COVERAGE && !plane.perPixelAlpha) {
+            *reason = "alpha";
+            return false;
+        }
+    }
+
+    *reason = 0;
+    return true;
+}
+
+/* assign: layer of each plane or -1 */
+bool HWCPlanner::valid(const Layer *layers, int count, const int *assign) const
+{
+    unsigned long long scanout = 0;
+
+    for (int p = 0; p < mConfig.planeCount; p++) {
+        int i = assign[p];
+        if (i < 0)
+            continue;
+        const Plane &plane = mConfig.planes[p];
+        if (!accepts(plane, layers[i]))
+            return false;
+        scanout += sourceBytes(layers[i]);
+
+        // overlapping layers keep their order, the GLES ones are at 0
+        for (int j = 0; j < count; j++) {
+            if (j == i || !intersects(layers[i].displayFrame, layers[j].displayFrame))
+                continue;
+            int z = 0;
+            for (int q = 0; q < mConfig.planeCount; q++) {
+                if (assign[q] == j)
+                    z = mConfig.planes[q].zorder;
+            }
+            if ((i < j) != (plane.zorder < z))
+                return false;
+        }
+    }
+
+    return !mConfig.maxOverlayBytes || scanout <= mConfig.maxOverlayBytes;
+}
+
+unsigned long long HWCPlanner::cost(const Layer *layers, int count, const int *assign, const Result *previous,
+        unsigned long long *glesCost, unsigned long long *overlayCost) const
+{
+    unsigned long long gles = 0, overlay = 0;
+    bool onPlane[MAX_LAYERS] = { false, };
+
+    for (int p = 0; p < mConfig.planeCount; p++) {
+        int i = assign[p];
+        if (previous && previous->layer[p] != i)
+            overlay += mConfig.switchCost;
+        if (i < 0)
+            continue;
+        onPlane[i] = true;
+        overlay += sourceBytes(layers[i]) + mConfig.overlayCost;
+    }
+
+    bool composing = false;
+    for (int i = 0; i < count; i++) {
+        if (i < MAX_LAYERS && onPlane[i])
+            continue;
+        // read the source, write the framebuffer, read it back when blending
+        gles += sourceBytes(layers[i]) + frameBytes(layers[i]) * (blended(layers[i]) ? 2 : 1);
+        composing = true;
+    }
+    // the holes of the planes under the framebuffer are cleared
+    if (composing) {
+        for (int p = 0; p < mConfig.planeCount; p++) {
+            if (assign[p] >= 0 && mConfig.planes[p].zorder < 0)
+                gles += frameBytes(layers[assign[p]]);
+        }
+    }
+    gles = gles * mConfig.gpuWeight / 100;
+
+    *glesCost = gles;
+    *overlayCost = overlay;
+    return gles + overlay;
+}
+
+void HWCPlanner::search(Search &s, int plane) const
+{
+    if (plane == mConfig.planeCount) {
+        Result r;
+        memset(&r, 0, sizeof(r));
+        s.evaluated++;
+        if (!valid(s.layers, s.count, s.assign))
+            return;
+        r.cost = cost(s.layers, s.count, s.assign, s.previous, &r.glesCost, &r.overlayCost);
+
+        bool isPrevious = s.previous != NULL;
+        for (int p = 0; p < MAX_PLANES; p++) {
+            r.layer[p] = p < mConfig.planeCount ? s.assign[p] : -1;
+            if (r.layer[p] >= 0)
+                r.overlays++;
+            if (s.previous && s.previous->layer[p] != r.layer[p])
+                isPrevious = false;
+        }
+
+        if (!s.found || r.cost < s.best.cost || (r.cost == s.best.cost && isPrevious && !s.bestIsPrevious)) {
+            s.best = r;
+            s.found = true;
+            s.bestIsPrevious = isPrevious;
+        }
+        return;
+    }
+
+    // the plane unused, then each layer it can take
+    s.assign[plane] = -1;
+    search(s, plane + 1);
+    for (int i = 0; i < s.candidates; i++) {
+        if (s.used[i] || !accepts(mConfig.planes[plane], s.layers[i]))
+            continue;
+        s.used[i] = true;
+        s.assign[plane] = i;
+        search(s, plane + 1);
+        s.used[i] = false;
+    }
+    s.assign[plane] = -1;
+}
+
+void HWCPlanner::plan(const Layer *layers, int count, const Result *previous, Result &result) const
+{
+    Search s;
+    memset(&s, 0, sizeof(s));
+    s.layers = layers;
+    s.count = count;
+    s.candidates = count < MAX_LAYERS ? count : MAX_LAYERS;
+    s.previous = previous;
+    for (int p = 0; p < MAX_PLANES; p++)
+        s.assign[p] = -1;
+
+    search(s, 0);
+
+    // all in GLES is always valid, found is set
+    result = s.best;
+    result.candidates = s.evaluated;
+}
+
+}; // namespace
@@ -0,0 +1,165 @@
+#undef LOG_TAG
+#define LOG_TAG     "HWCVsyncModel"
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include <cutils/log.h>
+
+#include "HWCVsyncModel.h"
+
+using namespace android;
+
+/* rounds to the nearest, also for negative a */
+static inline int64_t divRound(int64_t a, int64_t b)
+{
+    return a >= 0 ? (a + b / 2) / b : -((-a + b / 2) / b);
+}
+
+static inline int64_t divFloor(int64_t a, int64_t b)
+{
+    return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
+
+HWCVsyncModel::HWCVsyncModel(int64_t nominalPeriod)
+    :mNominalPeriod(nominalPeriod),
+    mErrorLimit(nominalPeriod / 10)
+{
+    memset(&mStats, 0, sizeof(mStats));
+    reset();
+}
+
+void HWCVsyncModel::reset()
+{
+    mReference = 0;
+    mCount = 0;
+    mNext = 0;
+    mPeriod = mNominalPeriod;
+    mPhase = 0;
+    mLocked = false;
+    mOutliers = 0;
+    mChecks = 0;
+    mLastSample = 0;
+    mStats.error = 0;
+}
+
+void HWCVsyncModel::restart(int64_t timestamp)
+{
+    // a fitted period survives, the display clock rarely changes
+    int64_t period = mPeriod;
+    reset();
+    if (period > mNominalPeriod - mNominalPeriod / 10 && period < mNominalPeriod + mNominalPeriod / 10)
+        mPeriod = period;
+
+    mReference = timestamp;
+    mTimes[0] = 0;
+    mCounts[0] = 0;
+    mCount = 1;
+    mNext = 1;
+    mLastSample = timestamp;
+}
+
+void HWCVsyncModel::fit()
+{
+    double meanN = 0, meanT = 0;
+    for (int i = 0; i < mCount; i++) {
+        meanN += mCounts[i];
+        meanT += mTimes[i];
+    }
+    meanN /= mCount;
+    meanT /= mCount;
+
+    double cov = 0, var = 0;
+    for (int i = 0; i < mCount; i++) {
+        double dn = mCounts[i] - meanN;
+        cov += dn * (mTimes[i] - meanT);
+        var += dn * dn;
+    }
+    if (var > 0)
+        mPeriod = (int64_t)(cov / var + 0.5);
+    mPhase = (int64_t)(meanT - mPeriod * meanN);
+
+    double squares = 0;
+    for (int i = 0; i < mCount; i++) {
+        double err = mTimes[i] - (mPhase + mCounts[i] * mPeriod);
+        squares += err * err;
+    }
+    mStats.error = (int64_t)sqrt(squares / mCount);
+}
+
+bool HWCVsyncModel::addSample(int64_t timestamp)
+{
+    mStats.samples++;
+    if (mCount == 0 || timestamp < mReference) {
+        restart(timestamp);
+        return true;
+    }
+    mLastSample = timestamp;
+
+    int64_t t = timestamp - mReference;
+    int64_t n = divRound(t - mPhase, mPeriod);
+    int64_t err = t - (mPhase + n * mPeriod);
+    int64_t last = mCounts[(mNext + MAX_SAMPLES - 1) % MAX_SAMPLES];
+    // until locked the period may still be off, only the gross ones go
+    int64_t limit = mLocked ? mErrorLimit : mPeriod / 4;
+
+    if (err > limit || err < -limit || n <= last) {
+        mStats.outliers++;
+        ALOGV("outlier: %lld ns off vsync %lld", (long long)err, (long long)n);
+        if (++mOutliers >= MAX_OUTLIERS) {
+            ALOGD("drift: %lld ns off, period %lld, start over", (long long)err, (long long)mPeriod);
+            mStats.resets++;
+            restart(timestamp);
+        }
+        return true;
+    }
+    mOutliers = 0;
+
+    mTimes[mNext] = t;
+    mCounts[mNext] = n;
+    mNext = (mNext + 1) % MAX_SAMPLES;
+    if (mCount < MAX_SAMPLES)
+        mCount++;
+    fit();
+
+    if (!mLocked && mCount >= MIN_SAMPLES && mStats.error < mErrorLimit / 2) {
+        mLocked = true;
+        ALOGD("locked: period %lld ns, error %lld ns", (long long)mPeriod, (long long)mStats.error);
+    }
+    if (mChecks > 0)
+        mChecks--;
+
+    return !mLocked || mCount < LEARN_SAMPLES || mChecks > 0;
+}
+
+int64_t HWCVsyncModel::nextVsync(int64_t time) const
+{
+    if (!mLocked)
+        return time;
+    int64_t n = divFloor(time - mReference - mPhase, mPeriod) + 1;
+    return mReference + mPhase + n * mPeriod;
+}
+
+bool HWCVsyncModel::needsResync(int64_t now) const
+{
+    return mLocked && mChecks == 0 && now - mLastSample > RESYNC_INTERVAL_MS * 1000000LL;
+}
+
+void HWCVsyncModel::beginResync()
+{
+    mChecks = RESYNC_SAMPLES;
+    mStats.resyncs++;
+}
+
+int HWCVsyncModel::dump(char *buff, int buff_len) const
+{
+    if (buff_len <= 0)
+        return 0;
+    int len = snprintf(buff, buff_len,
+            "vsync: %s, period %lld ns (nominal %lld), error %lld ns\n"
+            "  %u samples, %u outliers, %u resets, %u resyncs\n",
+            mLocked ? "locked" : "learning", (long long)mPeriod, (long long)mNominalPeriod, (long long)mStats.error,
+            mStats.samples, mStats.outliers, mStats.resets, mStats.resyncs);
+    return len < buff_len ? len : buff_len - 1;
+}
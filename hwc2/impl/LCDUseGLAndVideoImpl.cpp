@@ -32,6 +32,8 @@
 #include "LCDRGBRenderer.h"
 #include "HWCCommonRenderer.h"
 
+#include "HWCPlanner.h"
+#include "HWCLayerPlanner.h"
 #include "HWCImpl.h"
 #include "LCDCommonImpl.h"
 #include "LCDUseGLAndVideoImpl.h"
@@ -42,6 +44,7 @@ LCDUseGLAndVideoImpl::LCDUseGLAndVideoImpl(int rgbID, int videoID)
     :LCDCommonImpl(rgbID, videoID),
     mRGBRenderer(NULL),
     mVideoRenderer(NULL),
+    mPlanner(NULL),
     mRGBHandle(NULL),
     mVideoHandle(NULL),
     mOverlayConfigured(false),
@@ -55,6 +58,7 @@ LCDUseGLAndVideoImpl::LCDUseGLAndVideoImpl(int rgbID, int videoID, int width, in
     :LCDCommonImpl(rgbID, videoID, width, height),
     mRGBRenderer(NULL),
     mVideoRenderer(NULL),
+    mPlanner(NULL),
     mRGBHandle(NULL),
     mVideoHandle(NULL),
     mOverlayConfigured(false),
@@ -70,6 +74,8 @@ LCDUseGLAndVideoImpl::~LCDUseGLAndVideoImpl()
         delete mRGBRenderer;
     if (mVideoRenderer)
         delete mVideoRenderer;
+    if (mPlanner)
+        delete mPlanner;
 }
 
 void LCDUseGLAndVideoImpl::init()
@@ -84,6 +90,8 @@ void LCDUseGLAndVideoImpl::init()
     mVideoRenderer = new HWCCommonRenderer(mVideoID, 4);
     if (!mVideoRenderer)
         ALOGE("FATAL: can't create VideoRenderer");
+
+    mPlanner = new HWCLayerPlanner(mWidth, mHeight);
 }
 
 int LCDUseGLAndVideoImpl::configOverlay(struct hwc_layer_1 &layer)
@@ -153,32 +161,8 @@ int LCDUseGLAndVideoImpl::configCrop(struct hwc_layer_1 &layer)
 
 int LCDUseGLAndVideoImpl::prepare(hwc_display_contents_1_t *contents)
 {
-    mRGBLayerIndex = -1;
-    mOverlayLayerIndex = -1;
-
-    for (size_t i = 0; i < contents->numHwLayers; i++) {
-        hwc_layer_1_t &layer = contents->hwLayers[i];
-
-        if (layer.compositionType == HWC_FRAMEBUFFER_TARGET) {
-            mRGBLayerIndex = i;
-            ALOGV("prepare: rgb %d", i);
-            continue;
-        }
-
-        if (layer.compositionType == HWC_BACKGROUND)
-            continue;
-
-        if (mOverlayLayerIndex == -1 && canOverlay(layer)) {
-            layer.compositionType = HWC_OVERLAY;
-            layer.hints |= HWC_HINT_CLEAR_FB;
-            mOverlayLayerIndex = i;
-            ALOGV("prepare: overlay %d", i);
-            continue;
-        }
-
-        layer.compositionType = HWC_FRAMEBUFFER;
-    }
-
+    mOverlayLayerIndex = mPlanner->prepare(contents, &mRGBLayerIndex);
+    ALOGV("prepare: rgb %d, overlay %d", mRGBLayerIndex, mOverlayLayerIndex);
     return 0;
 }
 
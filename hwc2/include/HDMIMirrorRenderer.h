@@ -6,32 +6,38 @@ class HWCRenderer;
 
 namespace android {
 
-#define MAX_MIRROR_HANDLE_COUNT     4
-
+#define MAX_MIRROR_BUFFER_COUNT     4
+
+/*
+ * queues the dma-buf of the primary display's framebuffer target itself,
+ * nothing is copied. A buffer is dequeued only once its release fence has
+ * signaled, with all slots still on screen the frame is dropped instead of
+ * blocking in dqbuf.
+ */
 class HDMIMirrorRenderer: public HWCRenderer
 {
 public:
     HDMIMirrorRenderer(int id, int maxBufferCount = 3);
     virtual ~HDMIMirrorRenderer();
 
-    virtual int setHandle(private_handle_t const *handle);
-    virtual private_handle_t const *getHandle();
-    virtual int stop();
+    /* fenceFd: in the acquire fence of the handle, out its release fence or -1 */
     virtual int render(int *fenceFd = NULL);
+    virtual int stop();
 
 private:
-    int mFBFd;
-    int mFBSize;
+    bool released(int slot);
+    int dequeue();
 
+private:
     int mMaxBufferCount;
     int mOutCount;
     int mOutIndex;
-    int mMirrorIndex;
 
     bool mStarted;
 
-    private_handle_t *mMirrorHandleArray[MAX_MIRROR_HANDLE_COUNT];
-    private_handle_t *mHandle;
+    int mReleaseFence[MAX_MIRROR_BUFFER_COUNT];     // of each queued slot, -1: none from the driver
+    unsigned int mFrames;
+    unsigned int mDropped;
 };
 
 }; // namespace
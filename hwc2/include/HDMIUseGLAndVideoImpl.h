@@ -6,6 +6,8 @@ struct hwc_layer_1;
 
 namespace android {
 
+class HWCLayerPlanner;
+
 class HDMIUseGLAndVideoImpl: public HDMICommonImpl
 {
 public:
@@ -30,6 +32,7 @@ private:
     int  mVideoLayerIndex;
     HWCRenderer *mRGBRenderer;
     HWCRenderer *mVideoRenderer;
+    HWCLayerPlanner *mPlanner;
     private_handle_t const *mRGBHandle;
     private_handle_t const *mVideoHandle;
     struct hwc_layer_1 *mVideoLayer;
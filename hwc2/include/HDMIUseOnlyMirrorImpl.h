@@ -2,6 +2,7 @@
 #define _HDMIUSEONLYMIRRORIMPL_H
 
 class HDMICommonImpl;
+struct hwc_layer_1;
 
 namespace android {
 
@@ -29,6 +30,7 @@ private:
 private:
     bool mConfigured;
     HWCRenderer *mMirrorRenderer;
+    struct hwc_layer_1 *mTarget;
 };
 
 }; // namespace
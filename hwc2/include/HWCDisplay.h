@@ -0,0 +1,39 @@
+#ifndef _HWCDISPLAY_H
+#define _HWCDISPLAY_H
+
+#include <stdint.h>
+
+#include "HWCImpl.h"
+#include "HWCFrameSignature.h"
+#include "HWCFrameStats.h"
+
+struct hwc_display_contents_1;
+
+namespace android {
+
+/*
+ * per-display sequence of hwc_prepare() and hwc_set()
+ * The impl with its frame signature and timing, and for the external
+ * display the alternate impl taking the frames the impl refuses. The state
+ * stays with the owner, a HWCDisplay only points at it, so hwc.cpp and the
+ * host replay benchmark run the same sequence.
+ */
+struct HWCDisplay {
+    HWCImpl *impl;
+    HWCImpl *alternate;             // NULL: none
+    volatile int32_t *useAlternate; // NULL without alternate
+    volatile int32_t *changeImpl;   // set() swaps impl and alternate
+    HWCFrameSignature *signature;
+    HWCFrameStats *stats;
+};
+
+void prepareDisplay(HWCDisplay &display, struct hwc_display_contents_1 *contents, int32_t scenario);
+/* returns true when the frame is committed, fills the mirror source of the external display */
+bool setPrimaryDisplay(HWCDisplay &display, struct hwc_display_contents_1 *contents, HWCMirrorSource &mirror);
+void setExternalDisplay(HWCDisplay &display, struct hwc_display_contents_1 *contents, HWCMirrorSource &mirror);
+/* after the external display, commit: what setPrimaryDisplay() returned */
+void renderPrimaryDisplay(HWCDisplay &display, bool commit);
+
+}; // namespace
+
+#endif
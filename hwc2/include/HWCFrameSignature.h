@@ -0,0 +1,88 @@
+#ifndef _HWCFRAMESIGNATURE_H
+#define _HWCFRAMESIGNATURE_H
+
+#include <stdint.h>
+
+struct hwc_display_contents_1;
+
+namespace android {
+
+/*
+ * frame signature of a display
+ * The handles, crops, frames, transforms and blending of the layers of a
+ * frame against the ones of the last committed frame.
+ * When the GLES layers are the ones already composed into the framebuffer
+ * target, prepare() turns them into overlays so SurfaceFlinger leaves the
+ * target as it is, and set() turns them back before the impl sees them.
+ * When nothing changed at all, not even the framebuffer target, set() tells
+ * the caller to skip the commit.
+ * Layers without a buffer or with the skip flag change without a new
+ * handle (dim, screenshot), a frame with one is always composed.
+ */
+class HWCFrameSignature
+{
+public:
+    enum {
+        MAX_LAYERS = 32,    // frames with more are always composed
+    };
+
+    struct Stats {
+        uint32_t frames;
+        uint32_t glesSkipped;       // frames GLES didn't compose
+        uint32_t commitsSkipped;    // frames not committed at all
+        uint64_t savedBytes;        // estimated gpu traffic of the skipped compositions
+    };
+
+    HWCFrameSignature();
+
+    void setEnabled(bool enabled);
+
+    /* before the prepare of the impl, the layers the last prepare() took from GLES go back */
+    void restore(struct hwc_display_contents_1 *contents);
+    /* after the prepare of the impl, true when GLES composition is skipped */
+    bool prepare(struct hwc_display_contents_1 *contents);
+    /* before the set of the impl, false when the frame on screen is the same and needs no commit.
+     * extra: another buffer the display shows, the mirrored one */
+    bool set(struct hwc_display_contents_1 *contents, const void *extra = NULL);
+    /* the screen lost what was committed: blank, hotplug, impl change */
+    void invalidate();
+
+    Stats getStats() const;
+    int dump(const char *name, char *buff, int buff_len) const;
+
+private:
+    struct LayerKey {
+        const void *handle;
+        int32_t compositionType;
+        uint32_t flags;
+        uint32_t transform;
+        int32_t blending;
+        int32_t planeAlpha;
+        int32_t sourceCrop[4];
+        int32_t displayFrame[4];
+        uint32_t visibleRegion;     // hash of the visible rects
+    };
+
+    struct Signature {
+        LayerKey layers[MAX_LAYERS];
+        int count;
+        const void *target;
+        const void *extra;
+    };
+
+    bool mEnabled;
+    volatile int32_t mInvalidated;
+    bool mValid;
+
+    Signature mPrepared;    // GLES layers of the frame being prepared
+    Signature mComposed;    // GLES layers in the framebuffer target on screen
+    Signature mCommitted;   // all of the frame on screen
+    uint32_t mFaked;        // layers prepare() took from GLES, a bit each
+    Stats mStats;
+
+    bool build(struct hwc_display_contents_1 *contents, bool glesOnly, Signature &sig);
+    static bool equal(const Signature &a, const Signature &b);
+};
+
+}; // namespace
+#endif
@@ -0,0 +1,81 @@
+#ifndef _HWCFRAMESTATS_H
+#define _HWCFRAMESTATS_H
+
+#include <stdint.h>
+#include <utils/threads.h>
+
+struct hwc_display_contents_1;
+
+namespace android {
+
+/*
+ * per-display frame timing
+ * A ring of the last FRAMES frames with the time of each stage, the
+ * composition type of each layer and the usage scenario, plus counters
+ * since boot. A frame longer than a vsync period from prepare to the end
+ * of render missed that many vsyncs.
+ * Written by the composition thread, dumped from any other.
+ */
+class HWCFrameStats
+{
+public:
+    enum {
+        FRAMES = 128,
+        MAX_TYPES = 16,         // layers whose type is kept
+        MAX_SCENARIOS = 16,
+        DUMP_FRAMES = 8,        // the latest frames in the dump
+    };
+
+    enum Stage {
+        PREPARE_BEGIN,
+        PREPARE_END,
+        SET_BEGIN,
+        SET_END,
+        RENDER_BEGIN,
+        RENDER_END,
+        STAGE_MAX
+    };
+
+    enum {
+        FLAG_GLES_SKIPPED = 1 << 0,
+        FLAG_COMMIT_SKIPPED = 1 << 1,
+        FLAG_ALTERNATE = 1 << 2,    // the alternate hdmi impl
+    };
+
+    struct Frame {
+        int64_t time[STAGE_MAX];    // ns, 0: the stage didn't run
+        int32_t scenario;
+        uint16_t flags;
+        uint16_t layers;
+        char types[MAX_TYPES + 1];  // F: GLES, O: overlay, B: background, T: target
+    };
+
+    HWCFrameStats();
+
+    void setPeriod(int64_t period);
+
+    /* a frame starts with PREPARE_BEGIN and ends with RENDER_END or end() */
+    void stage(Stage stage);
+    void setLayers(struct hwc_display_contents_1 *contents, int32_t scenario);
+    void setFlags(uint16_t flags);
+    void end();
+
+    int dump(const char *name, char *buff, int buff_len) const;
+
+private:
+    mutable Mutex mLock;
+    int64_t mPeriod;
+
+    Frame mFrames[FRAMES];
+    int mCurrent;
+    bool mOpen;
+
+    uint32_t mFrameCount;
+    uint32_t mMissed;
+    uint32_t mScenarios[MAX_SCENARIOS];
+
+    void close();
+};
+
+}; // namespace
+#endif
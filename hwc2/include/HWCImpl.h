@@ -3,9 +3,19 @@
 
 struct private_handle_t;
 struct hwc_display_contents_1;
+struct hwc_layer_1;
 
 namespace android {
 
+/*
+ * set() of the external display impls gets this for the primary display's
+ * frame, the mirror ones show it
+ */
+struct HWCMirrorSource {
+    private_handle_t const *handle;     // on the primary display
+    struct hwc_layer_1 *target;         // its framebuffer target for the fences, NULL: not composed this frame
+};
+
 class HWCImpl
 {
 public:
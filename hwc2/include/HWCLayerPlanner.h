@@ -0,0 +1,34 @@
+#ifndef _HWCLAYERPLANNER_H
+#define _HWCLAYERPLANNER_H
+
+struct hwc_display_contents_1;
+
+namespace android {
+
+/*
+ * HWCPlanner for the hwcomposer layers of a display with one video plane
+ * under the GLES framebuffer.
+ * prepare() sets the composition type of each layer before the framebuffer
+ * target and keeps the plan for the next frame.
+ */
+class HWCLayerPlanner
+{
+public:
+    HWCLayerPlanner(int width, int height);
+    virtual ~HWCLayerPlanner();
+
+    /* returns the index of the video layer or -1, fbTarget: the framebuffer target or -1 */
+    int prepare(struct hwc_display_contents_1 *contents, int *fbTarget);
+
+private:
+    HWCPlanner *mPlanner;
+    HWCPlanner::Layer *mLayers;
+    size_t mLayerCapacity;
+    HWCPlanner::Result mLast;
+    bool mHasLast;
+
+    bool convert(struct hwc_display_contents_1 *contents, int count);
+};
+
+}; // namespace
+#endif
@@ -0,0 +1,107 @@
+#ifndef _HWCPLANNER_H
+#define _HWCPLANNER_H
+
+namespace android {
+
+/*
+ * overlay planner
+ * plan() assigns the layers of a frame to the planes of the display
+ * controller or leaves them to GLES, whichever moves the fewest bytes per
+ * frame. GLES bytes are weighted by gpuWeight, a plane costs its scanout,
+ * overlayCost and switchCost when its layer changes from the last frame.
+ * Assignments a plane can't show (format, scaling, blending, position) or
+ * that would put two overlapping layers in the wrong z-order are never
+ * taken, all layers in GLES always is. Among equal costs the assignment of
+ * the last frame wins, then the first in enumeration order, so the same
+ * input always gives the same plan.
+ * Without any hwcomposer type, the caller converts the layers.
+ */
+class HWCPlanner
+{
+public:
+    enum {
+        MAX_LAYERS = 16,    // considered for planes, the ones above go to GLES
+        MAX_PLANES = 3,
+        MAX_FORMATS = 8,
+    };
+
+    enum Blending {
+        BLEND_NONE,
+        BLEND_PREMULT,
+        BLEND_COVERAGE,
+    };
+
+    struct Rect {
+        int left;
+        int top;
+        int right;
+        int bottom;
+    };
+
+    struct Layer {
+        int format;
+        int bitsPerPixel;
+        bool hasAlpha;          // the format has a per-pixel alpha
+        Blending blending;
+        unsigned int transform;
+        Rect sourceCrop;
+        Rect displayFrame;
+        bool skip;              // GLES only: skip flag, no buffer
+    };
+
+    struct Plane {
+        const char *name;
+        int zorder;             // the GLES framebuffer is at 0, planes under it below 0
+        int formats[MAX_FORMATS];
+        int formatCount;
+        bool scaling;
+        int maxDownscale;       // source / display
+        int maxUpscale;         // display / source
+        bool perPixelAlpha;     // coverage blending
+        bool premultiplied;     // premultiplied blending
+    };
+
+    struct Config {
+        int width;
+        int height;
+        Plane planes[MAX_PLANES];
+        int planeCount;
+        unsigned int gpuWeight;             // percent, a byte through the gpu against one scanned out
+        unsigned long long overlayCost;     // bytes, for each plane in use
+        unsigned long long switchCost;      // bytes, for each plane whose layer changes
+        unsigned long long maxOverlayBytes; // scanout of the planes in a frame, 0: no limit
+    };
+
+    struct Result {
+        int layer[MAX_PLANES];      // index of the layer of each plane, -1: unused
+        int overlays;
+        unsigned long long cost;
+        unsigned long long glesCost;
+        unsigned long long overlayCost;
+        int candidates;             // assignments evaluated
+    };
+
+    HWCPlanner(const Config &config);
+
+    /* previous: the plan of the last frame or NULL */
+    void plan(const Layer *layers, int count, const Result *previous, Result &result) const;
+
+    /* false with the reason when plane can't show layer */
+    bool accepts(const Plane &plane, const Layer &layer, const char **reason = 0) const;
+
+    /* -1: layer is in GLES */
+    static int planeOf(const Result &result, int layer);
+
+private:
+    Config mConfig;
+
+    struct Search;
+
+    bool valid(const Layer *layers, int count, const int *assign) const;
+    unsigned long long cost(const Layer *layers, int count, const int *assign, const Result *previous,
+            unsigned long long *glesCost, unsigned long long *overlayCost) const;
+    void search(Search &s, int plane) const;
+};
+
+}; // namespace
+#endif
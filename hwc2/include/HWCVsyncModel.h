@@ -0,0 +1,89 @@
+#ifndef _HWCVSYNCMODEL_H
+#define _HWCVSYNCMODEL_H
+
+#include <stdint.h>
+
+namespace android {
+
+/*
+ * software vsync model
+ * Fits period and phase to the hardware vsync timestamps by least squares
+ * over the last MAX_SAMPLES of them. A sample off the model by more than
+ * the error limit is an outlier and left out, MAX_OUTLIERS in a row mean the
+ * display drifted and the model starts over. Once locked, nextVsync()
+ * predicts the vsyncs and the hardware can be turned off; needsResync()
+ * asks for it again after RESYNC_INTERVAL_MS so beginResync() can check the
+ * model against RESYNC_SAMPLES new samples.
+ * Without locks and clocks, the caller serializes and gives the time.
+ */
+class HWCVsyncModel
+{
+public:
+    enum {
+        MAX_SAMPLES = 32,
+        MIN_SAMPLES = 6,        // to lock
+        LEARN_SAMPLES = 24,     // before the hardware is let go
+        MAX_OUTLIERS = 4,       // in a row, then the model starts over
+        RESYNC_SAMPLES = 3,
+        RESYNC_INTERVAL_MS = 2000,
+    };
+
+    struct Stats {
+        uint32_t samples;
+        uint32_t outliers;
+        uint32_t resets;        // drift or phase jumps
+        uint32_t resyncs;
+        int64_t error;          // ns, rms of the samples in the model
+    };
+
+    HWCVsyncModel(int64_t nominalPeriod);
+
+    void reset();
+
+    /* a hardware timestamp, returns true while the model wants more */
+    bool addSample(int64_t timestamp);
+
+    bool isLocked() const {
+        return mLocked;
+    }
+
+    int64_t getPeriod() const {
+        return mPeriod;
+    }
+
+    /* the first vsync later than time, time itself when not locked */
+    int64_t nextVsync(int64_t time) const;
+
+    /* true when the model is locked but hasn't seen the hardware for too long */
+    bool needsResync(int64_t now) const;
+    void beginResync();
+
+    Stats getStats() const {
+        return mStats;
+    }
+    int dump(char *buff, int buff_len) const;
+
+private:
+    int64_t mNominalPeriod;
+    int64_t mErrorLimit;
+
+    int64_t mReference;                 // timestamp of vsync 0
+    int64_t mTimes[MAX_SAMPLES];        // since mReference
+    int64_t mCounts[MAX_SAMPLES];       // vsyncs since mReference
+    int mCount;
+    int mNext;
+
+    int64_t mPeriod;
+    int64_t mPhase;                     // of vsync 0, from mReference
+    bool mLocked;
+    int mOutliers;
+    int mChecks;                        // resync samples still to come
+    int64_t mLastSample;
+    Stats mStats;
+
+    void fit();
+    void restart(int64_t timestamp);
+};
+
+}; // namespace
+#endif
@@ -6,6 +6,8 @@ struct hwc_layer_1;
 
 namespace android {
 
+class HWCLayerPlanner;
+
 class LCDUseGLAndVideoImpl: public LCDCommonImpl
 {
 public:
@@ -25,6 +27,7 @@ protected:
 private:
     HWCRenderer *mRGBRenderer;
     HWCRenderer *mVideoRenderer;
+    HWCLayerPlanner *mPlanner;
     private_handle_t const *mRGBHandle;
     private_handle_t const *mVideoHandle;
     bool mOverlayConfigured;
@@ -5,6 +5,7 @@
 #include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <unistd.h>
 
 #include <sys/ioctl.h>
 
@@ -22,6 +23,7 @@
 #include <nxp-v4l2.h>
 
 #include <cutils/log.h>
+#include <sync/sync.h>
 
 #include <hardware/hwcomposer.h>
 #include <hardware/hardware.h>
@@ -36,110 +38,99 @@ namespace android {
 
 HDMIMirrorRenderer::HDMIMirrorRenderer(int id, int maxBufferCount)
     :HWCRenderer(id),
-    mFBFd(-1),
-    mFBSize(0),
     mMaxBufferCount(maxBufferCount),
     mOutCount(0),
     mOutIndex(0),
     mStarted(false),
-    mHandle(NULL)
+    mFrames(0),
+    mDropped(0)
 {
-    for (int i = 0; i < mMaxBufferCount; i++)
-        mMirrorHandleArray[i] = NULL;
+    if (mMaxBufferCount > MAX_MIRROR_BUFFER_COUNT)
+        mMaxBufferCount = MAX_MIRROR_BUFFER_COUNT;
+    for (int i = 0; i < MAX_MIRROR_BUFFER_COUNT; i++)
+        mReleaseFence[i] = -1;
 }
 
 HDMIMirrorRenderer::~HDMIMirrorRenderer()
 {
-    struct private_handle_t *hnd;
-    for (int i = 0; i < mMaxBufferCount; i++) {
-        hnd = mMirrorHandleArray[i];
-        if (hnd) delete hnd;
-    }
-
-    if (mFBFd >= 0)
-        close(mFBFd);
+    stop();
 }
 
-#define NXPFB_GET_FB_FD _IOWR('N', 101, __u32)
-int HDMIMirrorRenderer::setHandle(private_handle_t const *handle)
+/* the scanout of slot is over, dqbuf returns without waiting */
+bool HDMIMirrorRenderer::released(int slot)
 {
-#if 0
-    if (!handle)
-        return 0;
-
-    if (mFBFd < 0) {
-        mFBFd = open("/dev/graphics/fb0", O_RDWR);
-        if (mFBFd < 0) {
-            ALOGE("failed to open framebuffer");
-            return -EINVAL;
-        }
-
-        struct fb_var_screeninfo info;
-        if (ioctl(mFBFd, FBIOGET_VSCREENINFO, &info) == -1) {
-            ALOGE("can't get fb_var_screeninfo");
-            return -EINVAL;
-        }
-
-        struct fb_fix_screeninfo finfo;
-        if (ioctl(mFBFd, FBIOGET_FSCREENINFO, &finfo) == -1) {
-            ALOGE("can't get fb_fix_screeninfo");
-            return -EINVAL;
-        }
-
-        mFBSize = finfo.line_length * info.yres;
+    int fd = mReleaseFence[slot];
+    if (fd < 0)
+        return false;
+    if (sync_wait(fd, 0) < 0) {
+        if (errno == ETIME)
+            return false;
+        ALOGE("failed to sync_wait() release fence %d: %d", fd, errno);
     }
-
-    mMirrorIndex = handle->offset / mFBSize;
-    if (!mMirrorHandleArray[mMirrorIndex]) {
-        private_handle_t *hnd = new private_handle_t(private_handle_t::PRIV_FLAGS_USES_ION, mFBSize);
-        if (!hnd) {
-            ALOGE("can't create handle: index %d", mMirrorIndex);
-            return -ENOMEM;
-        }
-        int share_fd = mMirrorIndex;
-        int ret = ioctl(mFBFd, NXPFB_GET_FB_FD, &share_fd);
-        if (ret < 0) {
-            ALOGE("setHandle: failed to ioctl NXPFB_GET_FB_FD for index %d", mMirrorIndex);
-            return ret;
-        }
-        hnd->share_fd = share_fd;
-        hnd->size = mFBSize;
-        hnd->offset = 0;
-        mMirrorHandleArray[mMirrorIndex] = hnd;
-    }
-#else
-    mHandle = const_cast<private_handle_t *>(handle);
-#endif
-
-    return 0;
+    return true;
 }
 
-private_handle_t const *HDMIMirrorRenderer::getHandle()
+int HDMIMirrorRenderer::dequeue()
 {
-#if 0
-    return mMirrorHandleArray[mMirrorIndex];
-#else
-    return mHandle;
-#endif
+    int oldest = (mOutIndex + mMaxBufferCount - mOutCount) % mMaxBufferCount;
+    int dqIdx;
+    int ret = v4l2_dqbuf(mID, 1, &dqIdx, NULL);
+    if (ret < 0) {
+        ALOGE("failed to v4l2_dqbuf()");
+        return ret;
+    }
+    if (mReleaseFence[oldest] >= 0) {
+        close(mReleaseFence[oldest]);
+        mReleaseFence[oldest] = -1;
+    }
+    mOutCount--;
+    return 0;
 }
 
 int HDMIMirrorRenderer::render(int *fenceFd)
 {
     int ret;
-#if 0
-    private_handle_t *hnd = mMirrorHandleArray[mMirrorIndex];
-#else
-    private_handle_t *hnd = mHandle;
-#endif
+    int acquireFd = fenceFd ? *fenceFd : -1;
 
-    if (!hnd)
+    if (fenceFd)
+        *fenceFd = -1;
+
+    if (!mHandle)
         return 0;
 
-    ret = v4l2_qbuf(mID, 1, mOutIndex, hnd, -1, NULL);
+    // the ones done with
+    while (mOutCount > 0 && released((mOutIndex + mMaxBufferCount - mOutCount) % mMaxBufferCount)) {
+        ret = dequeue();
+        if (ret < 0)
+            return ret;
+    }
+
+    if (mOutCount >= mMaxBufferCount) {
+        if (mReleaseFence[mOutIndex] >= 0) {
+            // all on screen yet, hdmi keeps the last frame
+            mDropped++;
+            ALOGV("drop: %u of %u", mDropped, mFrames);
+            mHandle = NULL;
+            return 0;
+        }
+        // no fences from the driver, wait for the oldest
+        ret = dequeue();
+        if (ret < 0)
+            return ret;
+    }
+
+    int syncFd = acquireFd;
+    ret = v4l2_qbuf(mID, 1, mOutIndex, mHandle, -1, NULL, &syncFd, NULL);
     if (ret < 0) {
         ALOGE("failed to v4l2_qbuf()");
         return ret;
     }
+    // a driver without fences hands back what it got
+    if (syncFd == acquireFd)
+        syncFd = -1;
+    mReleaseFence[mOutIndex] = syncFd;
+    if (fenceFd && syncFd >= 0)
+        *fenceFd = dup(syncFd);
 
     if (!mStarted) {
         ret = v4l2_streamon(mID);
@@ -151,20 +142,12 @@ int HDMIMirrorRenderer::render(int *fenceFd)
         mStarted = true;
     }
 
+    mFrames++;
     mOutCount++;
     mOutIndex++;
     mOutIndex %= mMaxBufferCount;
 
-    if (mOutCount >= mMaxBufferCount) {
-        int dqIdx;
-        ret = v4l2_dqbuf(mID, 1, &dqIdx, NULL);
-        if (ret < 0) {
-            ALOGE("failed to v4l2_dqbuf()");
-            return ret;
-        }
-        mOutCount--;
-    }
-
+    mHandle = NULL;
     return 0;
 }
 
@@ -173,8 +156,18 @@ int HDMIMirrorRenderer::stop()
     if (mStarted) {
         v4l2_streamoff(mID);
         mStarted = false;
-        ALOGD("Stop");
+        ALOGD("Stop: %u frames, %u dropped", mFrames, mDropped);
+    }
+    for (int i = 0; i < MAX_MIRROR_BUFFER_COUNT; i++) {
+        if (mReleaseFence[i] >= 0) {
+            close(mReleaseFence[i]);
+            mReleaseFence[i] = -1;
+        }
     }
+    mOutCount = 0;
+    mOutIndex = 0;
+    mFrames = 0;
+    mDropped = 0;
     return 0;
 }
 
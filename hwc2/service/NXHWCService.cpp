@@ -35,6 +35,10 @@ status_t BnNXHWCService::onTransact(uint32_t code, const Parcel &data, Parcel *r
         hwcScreenDownSizingChanged(val);
         break;
 
+    case HWC_GET_FRAME_STATS:
+        reply->writeString8(hwcFrameStats(val));
+        break;
+
     default:
         return BBinder::onTransact(code, data, reply, flags);
     }
@@ -48,6 +52,12 @@ status_t NXHWCService::registerListener(sp<PropertyChangeListener> listener)
     return NO_ERROR;
 }
 
+status_t NXHWCService::registerStatsProvider(sp<StatsProvider> provider)
+{
+    mStatsProvider = provider;
+    return NO_ERROR;
+}
+
 void NXHWCService::hwcScenarioChanged(int32_t scenario)
 {
     if (mListener != NULL)
@@ -72,6 +82,13 @@ void NXHWCService::hwcScreenDownSizingChanged(int32_t downsizing)
         mListener->onPropertyChanged(HWC_SCREEN_DOWNSIZING_CHANGED, downsizing);
 }
 
+String8 NXHWCService::hwcFrameStats(int32_t display)
+{
+    if (mStatsProvider != NULL)
+        return mStatsProvider->getFrameStats(display);
+    return String8();
+}
+
 sp<INXHWCService> getNXHWCService()
 {
     sp<IServiceManager> sm = defaultServiceManager();
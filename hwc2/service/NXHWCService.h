@@ -3,6 +3,7 @@
 
 #include <utils/RefBase.h>
 #include <utils/Log.h>
+#include <utils/String8.h>
 
 #include <binder/IInterface.h>
 #include <binder/IBinder.h>
@@ -21,12 +22,15 @@ public:
         HWC_RESOLUTION_CHANGED,
         HWC_RESC_SCALE_FACTOR_CHANGED,
         HWC_SCREEN_DOWNSIZING_CHANGED,
+        HWC_GET_FRAME_STATS,
     };
 
     virtual void hwcScenarioChanged(int32_t scenario) = 0;
     virtual void hwcResolutionChanged(int32_t resolution) = 0;
     virtual void hwcRescScaleFactorChanged(int32_t factor) = 0;
     virtual void hwcScreenDownSizingChanged(int32_t downsizing) = 0;
+    // display: HWC_DISPLAY_PRIMARY, HWC_DISPLAY_EXTERNAL or -1 for all
+    virtual String8 hwcFrameStats(int32_t display) = 0;
 
     DECLARE_META_INTERFACE(NXHWCService);
 };
@@ -74,6 +78,17 @@ public:
         ALOGD("transact %d", downsizing);
         remote()->transact(HWC_SCREEN_DOWNSIZING_CHANGED, data, NULL);
     }
+
+    virtual String8 hwcFrameStats(int32_t display) {
+        Parcel data, reply;
+        data.writeInterfaceToken(INXHWCService::getInterfaceDescriptor());
+        data.writeInt32(display);
+
+        status_t ret = remote()->transact(HWC_GET_FRAME_STATS, data, &reply);
+        if (ret != NO_ERROR)
+            return String8();
+        return reply.readString8();
+    }
 };
 
 IMPLEMENT_META_INTERFACE(NXHWCService, "NXHWCService");
@@ -96,15 +111,22 @@ public:
         virtual void onPropertyChanged(int code, int val) = 0;
     };
 
+    struct StatsProvider: virtual public RefBase {
+        virtual String8 getFrameStats(int display) = 0;
+    };
+
     status_t registerListener(sp<PropertyChangeListener> listener);
+    status_t registerStatsProvider(sp<StatsProvider> provider);
 
     virtual void hwcScenarioChanged(int32_t scenario);
     virtual void hwcRescScaleFactorChanged(int32_t factor);
     virtual void hwcResolutionChanged(int32_t resolution);
     virtual void hwcScreenDownSizingChanged(int32_t downsizing);
+    virtual String8 hwcFrameStats(int32_t display);
 
 private:
     sp<PropertyChangeListener> mListener;
+    sp<StatsProvider> mStatsProvider;
 };
 
 sp<INXHWCService> getNXHWCService();
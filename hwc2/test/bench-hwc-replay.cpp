@@ -0,0 +1,773 @@
+/*
+ * hwcomposer replay benchmark
+ *
+ * Built on the host against the mock display backend (mock-display.cpp) it
+ * runs frames of layers through the impls of each usage scenario with the
+ * per-display sequence of hwc_prepare() and hwc_set() from HWCDisplay, a
+ * fake SurfaceFlinger composing the GLES layers of both displays and a mock
+ * vsync source. Reported for each
+ * scenario: the composition of the layers, the cpu time of prepare and set
+ * per frame, the calls to the display controller and the fences.
+ *
+ * The workloads are made up (idle, scroll, video) or read from a trace, one
+ * frame after the other:
+ *     frame [geometry]
+ *     layer <name>[*] <format> <crop l t r b> <frame l t r b> [premult|coverage [transform]]
+ * for the primary display, '*' marks a new buffer of the layer, the external
+ * display gets the same layers scaled to its size. format: rgba, rgbx, rgb565,
+ * yv12, nv21, nv16, yuyv.
+ *
+ * The primary display posts through /dev/graphics/fb0, missing on the host,
+ * its frame is taken from the impl. ANDROID_LOG_TAGS=*:s quiets the impls.
+ *
+ * usage: bench_hwc_replay [-s scenario] [-w idle|scroll|video] [-n frames]
+ *                         [-g gpu latency in vsyncs] [-j vsync jitter us] [-v] [trace]
+ */
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <cutils/log.h>
+
+#include <hardware/hwcomposer.h>
+#include <hardware/hardware.h>
+
+#include <gralloc_priv.h>
+#include <nxp-v4l2.h>
+#include <NXTest.h>
+
+#include "HWCImpl.h"
+#include "HWCreator.h"
+#include "HWCFrameSignature.h"
+#include "HWCFrameStats.h"
+#include "HWCVsyncModel.h"
+#include "HWCDisplay.h"
+
+#include "mock-display.h"
+
+using namespace android;
+
+#define LCD_WIDTH           1024
+#define LCD_HEIGHT          600
+#define HDMI_WIDTH          1920
+#define HDMI_HEIGHT         1080
+#define PERIOD              16666667LL
+
+#define MAX_LAYERS          16
+#define MAX_FRAMES          4096
+#define QUEUE_BUFFERS       3   // of each layer and framebuffer target
+#define DUMP_SIZE           4096
+
+enum {
+    LCD,
+    HDMI,
+    DISPLAYS
+};
+
+static const char *displayNames[DISPLAYS] = { "lcd", "hdmi" };
+
+static const char *scenarioNames[HWCreator::USAGE_SCENARIO_MAX] = {
+    "lcd gl, hdmi mirror",
+    "lcd gl, hdmi mirror resc",
+    "lcd gl, hdmi gl",
+    "lcd gl, hdmi gl resc",
+    "lcd gl, hdmi gl+video",
+    "lcd gl, hdmi gl+video resc",
+    "lcd gl, hdmi mirror+video",
+    "lcd gl, hdmi mirror+video resc",
+    "lcd gl+video, hdmi gl",
+    "lcd gl+video, hdmi gl resc",
+    "lcd gl+video, hdmi gl+video",
+    "lcd gl+video, hdmi gl+video resc",
+    "lcd gl+video, hdmi mirror+video",
+    "lcd gl+video, hdmi mirror+video resc",
+};
+
+/*
+ * workload
+ */
+struct LayerDesc {
+    char name[32];
+    int format;
+    hwc_rect_t crop;
+    hwc_rect_t frame;
+    int32_t blending;
+    uint32_t transform;
+    bool update;        // a new buffer this frame
+};
+
+struct FrameDesc {
+    LayerDesc layers[MAX_LAYERS];
+    int count;
+    bool geometry;
+};
+
+static hwc_rect_t rect(int left, int top, int right, int bottom)
+{
+    hwc_rect_t r = { left, top, right, bottom };
+    return r;
+}
+
+static void addLayer(FrameDesc &f, const char *name, int format, hwc_rect_t crop, hwc_rect_t frame,
+        int32_t blending, bool update)
+{
+    LayerDesc &l = f.layers[f.count++];
+    memset(&l, 0, sizeof(l));
+    strncpy(l.name, name, sizeof(l.name) - 1);
+    l.format = format;
+    l.crop = crop;
+    l.frame = frame;
+    l.blending = blending;
+    l.update = update;
+}
+
+/* home screen, nothing moves but the clock once a second */
+static void idleFrame(int n, FrameDesc &f)
+{
+    f.count = 0;
+    f.geometry = n == 0;
+    addLayer(f, "wallpaper", HAL_PIXEL_FORMAT_RGBX_8888, rect(0, 0, LCD_WIDTH, LCD_HEIGHT),
+            rect(0, 0, LCD_WIDTH, LCD_HEIGHT), HWC_BLENDING_NONE, n == 0);
+    addLayer(f, "launcher", HAL_PIXEL_FORMAT_RGBA_8888, rect(0, 0, LCD_WIDTH, LCD_HEIGHT - 48),
+            rect(0, 48, LCD_WIDTH, LCD_HEIGHT), HWC_BLENDING_PREMULT, n == 0);
+    addLayer(f, "statusbar", HAL_PIXEL_FORMAT_RGBA_8888, rect(0, 0, LCD_WIDTH, 48),
+            rect(0, 0, LCD_WIDTH, 48), HWC_BLENDING_PREMULT, n % 60 == 0);
+}
+
+/* a list scrolling under the status bar */
+static void scrollFrame(int n, FrameDesc &f)
+{
+    f.count = 0;
+    f.geometry = n == 0;
+    addLayer(f, "app", HAL_PIXEL_FORMAT_RGBX_8888, rect(0, 0, LCD_WIDTH, LCD_HEIGHT - 48),
+            rect(0, 48, LCD_WIDTH, LCD_HEIGHT), HWC_BLENDING_NONE, true);
+    addLayer(f, "statusbar", HAL_PIXEL_FORMAT_RGBA_8888, rect(0, 0, LCD_WIDTH, 48),
+            rect(0, 0, LCD_WIDTH, 48), HWC_BLENDING_PREMULT, n % 60 == 0);
+}
+
+/* 30 fps 720p video letterboxed, the controls come up every 5 s for 2 s */
+static void videoFrame(int n, FrameDesc &f)
+{
+    f.count = 0;
+    bool controls = n % 300 >= 180;
+    f.geometry = n == 0 || n % 300 == 0 || n % 300 == 180;
+    addLayer(f, "video", HAL_PIXEL_FORMAT_YV12, rect(0, 0, 1280, 720),
+            rect(0, 12, LCD_WIDTH, LCD_HEIGHT - 12), HWC_BLENDING_NONE, n % 2 == 0);
+    if (controls)
+        addLayer(f, "controls", HAL_PIXEL_FORMAT_RGBA_8888, rect(0, 0, LCD_WIDTH, 96),
+                rect(0, LCD_HEIGHT - 96, LCD_WIDTH, LCD_HEIGHT), HWC_BLENDING_PREMULT, n % 300 == 180 || n % 30 == 0);
+}
+
+static int parseFormat(const char *s)
+{
+    if (!strcmp(s, "rgba"))     return HAL_PIXEL_FORMAT_RGBA_8888;
+    if (!strcmp(s, "rgbx"))     return HAL_PIXEL_FORMAT_RGBX_8888;
+    if (!strcmp(s, "rgb565"))   return HAL_PIXEL_FORMAT_RGB_565;
+    if (!strcmp(s, "yv12"))     return HAL_PIXEL_FORMAT_YV12;
+    if (!strcmp(s, "nv21"))     return HAL_PIXEL_FORMAT_YCrCb_420_SP;
+    if (!strcmp(s, "nv16"))     return HAL_PIXEL_FORMAT_YCbCr_422_SP;
+    if (!strcmp(s, "yuyv"))     return HAL_PIXEL_FORMAT_YCbCr_422_I;
+    return -1;
+}
+
+/* returns the frames read, -1: error */
+static int readTrace(const char *path, FrameDesc *frames, int max)
+{
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        printf("can't open %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    char line[256];
+    int count = 0;
+    int lineNo = 0;
+    while (fgets(line, sizeof(line), fp)) {
+        lineNo++;
+        char word[32];
+        if (line[0] == '#' || sscanf(line, "%31s", word) != 1)
+            continue;
+
+        if (!strcmp(word, "frame")) {
+            if (count == max)
+                break;
+            FrameDesc &f = frames[count++];
+            f.count = 0;
+            f.geometry = strstr(line, "geometry") != NULL || count == 1;
+            continue;
+        }
+
+        char name[32], format[16], blending[16] = "";
+        hwc_rect_t c, d;
+        unsigned int transform = 0;
+        int fields = sscanf(line, "layer %31s %15s %d %d %d %d %d %d %d %d %15s %u", name, format,
+                &c.left, &c.top, &c.right, &c.bottom, &d.left, &d.top, &d.right, &d.bottom,
+                blending, &transform);
+        if (strcmp(word, "layer") || fields < 10 || !count || parseFormat(format) < 0 ||
+                frames[count - 1].count == MAX_LAYERS) {
+            printf("%s:%d: bad line\n", path, lineNo);
+            fclose(fp);
+            return -1;
+        }
+
+        FrameDesc &f = frames[count - 1];
+        size_t len = strlen(name);
+        bool update = name[len - 1] == '*';
+        if (update)
+            name[len - 1] = 0;
+        int32_t blend = !strcmp(blending, "premult") ? HWC_BLENDING_PREMULT :
+            !strcmp(blending, "coverage") ? HWC_BLENDING_COVERAGE : HWC_BLENDING_NONE;
+        addLayer(f, name, parseFormat(format), c, d, blend, update || count == 1);
+        f.layers[f.count - 1].transform = transform;
+    }
+
+    fclose(fp);
+    return count;
+}
+
+/*
+ * fake SurfaceFlinger: the buffer queues of the layers and the targets
+ */
+struct Queue {
+    char name[32];
+    int format;
+    int width;
+    int height;
+    private_handle_t *buffers[QUEUE_BUFFERS];
+    int releaseFence[QUEUE_BUFFERS];    // from hwc, -1: none
+    int current;
+};
+
+static Queue queues[MAX_LAYERS * 2 + DISPLAYS];
+static int queueCount;
+
+struct SurfaceFlingerStats {
+    uint32_t glesFrames;        // frames GLES composed, per display
+    uint32_t glesLayers;
+    uint32_t overlayLayers;
+    uint32_t releaseFences;     // got back from hwc for the targets
+    uint32_t fenceWaits;        // GLES found the target buffer still fenced
+    uint32_t tears;             // GLES rendered into a buffer on screen, no fence held it back
+};
+
+static int bitsPerPixel(int format)
+{
+    switch (format) {
+    case HAL_PIXEL_FORMAT_RGB_565:
+    case HAL_PIXEL_FORMAT_YCbCr_422_SP:
+    case HAL_PIXEL_FORMAT_YCbCr_422_I:
+        return 16;
+    case HAL_PIXEL_FORMAT_YV12:
+    case HAL_PIXEL_FORMAT_YCrCb_420_SP:
+        return 12;
+    default:
+        return 32;
+    }
+}
+
+static Queue *getQueue(const char *name, int format, int width, int height)
+{
+    for (int i = 0; i < queueCount; i++) {
+        Queue &q = queues[i];
+        if (!strcmp(q.name, name) && q.format == format && q.width == width && q.height == height)
+            return &q;
+    }
+    if (queueCount == (int)(sizeof(queues) / sizeof(queues[0])))
+        return NULL;
+
+    Queue &q = queues[queueCount++];
+    memset(&q, 0, sizeof(q));
+    strncpy(q.name, name, sizeof(q.name) - 1);
+    q.format = format;
+    q.width = width;
+    q.height = height;
+    for (int i = 0; i < QUEUE_BUFFERS; i++) {
+        int size = width * height * bitsPerPixel(format) / 8;
+        q.buffers[i] = new private_handle_t(private_handle_t::PRIV_FLAGS_USES_ION, 0, size, format,
+                width, height, width, 0, MALI_YUV_NO_INFO, -1);
+        q.releaseFence[i] = -1;
+    }
+    q.current = 0;
+    return &q;
+}
+
+static void freeQueues()
+{
+    for (int i = 0; i < queueCount; i++) {
+        for (int j = 0; j < QUEUE_BUFFERS; j++) {
+            delete queues[i].buffers[j];
+            if (queues[i].releaseFence[j] >= 0)
+                close(queues[i].releaseFence[j]);
+        }
+    }
+    queueCount = 0;
+}
+
+static hwc_display_contents_1_t *newContents()
+{
+    return (hwc_display_contents_1_t *)calloc(1,
+            sizeof(hwc_display_contents_1_t) + (MAX_LAYERS + 1) * sizeof(hwc_layer_1_t));
+}
+
+static hwc_rect_t scale(hwc_rect_t r, int width, int height)
+{
+    return rect(r.left * width / LCD_WIDTH, r.top * height / LCD_HEIGHT,
+            r.right * width / LCD_WIDTH, r.bottom * height / LCD_HEIGHT);
+}
+
+/* the layers of desc for a display of width x height and its target */
+static void buildContents(hwc_display_contents_1_t *contents, const FrameDesc &desc, int display,
+        int width, int height)
+{
+    // without a geometry change the types stay the ones of the last prepare
+    bool geometry = desc.geometry || contents->numHwLayers != (size_t)desc.count + 1;
+    contents->flags = geometry ? HWC_GEOMETRY_CHANGED : 0;
+    contents->numHwLayers = desc.count + 1;
+    for (int i = 0; i < desc.count; i++) {
+        const LayerDesc &d = desc.layers[i];
+        hwc_layer_1_t &layer = contents->hwLayers[i];
+        int32_t type = geometry ? HWC_FRAMEBUFFER : layer.compositionType;
+        memset(&layer, 0, sizeof(layer));
+        Queue *q = getQueue(d.name, d.format, d.crop.right, d.crop.bottom);
+        if (q && d.update && display == LCD)
+            q->current = (q->current + 1) % QUEUE_BUFFERS;
+        layer.compositionType = type;
+        layer.handle = q ? q->buffers[q->current] : NULL;
+        layer.blending = d.blending;
+        layer.transform = d.transform;
+        layer.sourceCrop = d.crop;
+        layer.displayFrame = display == LCD ? d.frame : scale(d.frame, width, height);
+        layer.visibleRegionScreen.numRects = 1;
+        layer.visibleRegionScreen.rects = &layer.displayFrame;
+        layer.acquireFenceFd = -1;
+        layer.releaseFenceFd = -1;
+    }
+
+    hwc_layer_1_t &target = contents->hwLayers[desc.count];
+    memset(&target, 0, sizeof(target));
+    Queue *q = getQueue(displayNames[display], HAL_PIXEL_FORMAT_RGBA_8888, width, height);
+    target.compositionType = HWC_FRAMEBUFFER_TARGET;
+    target.handle = q->buffers[q->current];
+    target.sourceCrop = rect(0, 0, width, height);
+    target.displayFrame = target.sourceCrop;
+    target.visibleRegionScreen.numRects = 1;
+    target.visibleRegionScreen.rects = &target.displayFrame;
+    target.acquireFenceFd = -1;
+    target.releaseFenceFd = -1;
+}
+
+/* GLES into the next target buffer when any layer is left to it */
+static void compose(hwc_display_contents_1_t *contents, int display, int gpuLatency, SurfaceFlingerStats &stats)
+{
+    hwc_layer_1_t &target = contents->hwLayers[contents->numHwLayers - 1];
+    bool gles = false;
+    for (size_t i = 0; i + 1 < contents->numHwLayers; i++) {
+        if (contents->hwLayers[i].compositionType == HWC_FRAMEBUFFER) {
+            gles = true;
+            stats.glesLayers++;
+        } else if (contents->hwLayers[i].compositionType == HWC_OVERLAY) {
+            stats.overlayLayers++;
+        }
+    }
+    if (!gles)
+        return;
+
+    private_handle_t const *hnd = reinterpret_cast<private_handle_t const *>(target.handle);
+    Queue *q = getQueue(displayNames[display], HAL_PIXEL_FORMAT_RGBA_8888, hnd->width, hnd->height);
+    q->current = (q->current + 1) % QUEUE_BUFFERS;
+    int &fence = q->releaseFence[q->current];
+    if (fence >= 0) {
+        // the gpu waits for it
+        if (!MockDisplay::isSignaled(fence))
+            stats.fenceWaits++;
+        close(fence);
+        fence = -1;
+    } else if (MockDisplay::isBusy(q->buffers[q->current])) {
+        stats.tears++;
+    }
+    stats.glesFrames++;
+    target.handle = q->buffers[q->current];
+    target.acquireFenceFd = MockDisplay::createFence(MockDisplay::getVsyncCount() + gpuLatency);
+}
+
+static int *findReleaseFence(buffer_handle_t handle)
+{
+    for (int i = 0; i < queueCount; i++) {
+        for (int j = 0; j < QUEUE_BUFFERS; j++) {
+            if (queues[i].buffers[j] == handle)
+                return &queues[i].releaseFence[j];
+        }
+    }
+    return NULL;
+}
+
+/* after set: the fences back from hwc, the acquire fence the harness made */
+static void retire(hwc_display_contents_1_t *contents, int acquireFd, SurfaceFlingerStats &stats)
+{
+    for (size_t i = 0; i < contents->numHwLayers; i++) {
+        hwc_layer_1_t &layer = contents->hwLayers[i];
+        if (layer.releaseFenceFd < 0)
+            continue;
+        int *fence = layer.compositionType == HWC_FRAMEBUFFER_TARGET ? findReleaseFence(layer.handle) : NULL;
+        if (fence) {
+            stats.releaseFences++;
+            if (*fence >= 0)
+                close(*fence);
+            *fence = layer.releaseFenceFd;
+        } else {
+            close(layer.releaseFenceFd);
+        }
+        layer.releaseFenceFd = -1;
+    }
+    if (acquireFd >= 0)
+        close(acquireFd);
+}
+
+/*
+ * the displays of hwc.cpp without the device, prepared and set by HWCDisplay
+ */
+class Composer
+{
+public:
+    Composer(int scenario)
+        :mScenario(scenario),
+        mUseHDMIAlternate(0),
+        mChangeHDMIImpl(0),
+        alternateFrames(0)
+    {
+        mLCDImpl = HWCreator::create(HWCreator::DISPLAY_LCD, scenario, LCD_WIDTH, LCD_HEIGHT);
+        mHDMIImpl = HWCreator::create(HWCreator::DISPLAY_HDMI, scenario, HDMI_WIDTH, HDMI_HEIGHT,
+                LCD_WIDTH, LCD_HEIGHT, 1);
+        mHDMIAlternateImpl = HWCreator::create(HWCreator::DISPLAY_HDMI_ALTERNATE, scenario, HDMI_WIDTH, HDMI_HEIGHT,
+                LCD_WIDTH, LCD_HEIGHT, 1);
+        if (mHDMIImpl)
+            mHDMIImpl->enable();
+    }
+
+    ~Composer() {
+        if (mHDMIImpl) {
+            mHDMIImpl->disable();
+            delete mHDMIImpl;
+        }
+        if (mHDMIAlternateImpl) {
+            mHDMIAlternateImpl->disable();
+            delete mHDMIAlternateImpl;
+        }
+        delete mLCDImpl;
+    }
+
+    bool valid() const {
+        return mLCDImpl && mHDMIImpl;
+    }
+
+    void prepare(hwc_display_contents_1_t *lcd, hwc_display_contents_1_t *hdmi) {
+        HWCDisplay lcdDisplay = getDisplay(LCD);
+        HWCDisplay hdmiDisplay = getDisplay(HDMI);
+        prepareDisplay(lcdDisplay, lcd, mScenario);
+        prepareDisplay(hdmiDisplay, hdmi, mScenario);
+        if (mUseHDMIAlternate)
+            alternateFrames++;
+    }
+
+    void set(hwc_display_contents_1_t *lcd, hwc_display_contents_1_t *hdmi) {
+        HWCDisplay lcdDisplay = getDisplay(LCD);
+        HWCDisplay hdmiDisplay = getDisplay(HDMI);
+        HWCMirrorSource mirror;
+        mirror.handle = NULL;
+        mirror.target = NULL;
+
+        bool lcdCommit = setPrimaryDisplay(lcdDisplay, lcd, mirror);
+        setExternalDisplay(hdmiDisplay, hdmi, mirror);
+        stats[HDMI].end();
+        renderPrimaryDisplay(lcdDisplay, lcdCommit);
+        stats[LCD].end();
+    }
+
+private:
+    HWCDisplay getDisplay(int d) {
+        HWCDisplay display = { mLCDImpl, NULL, NULL, NULL, &signature[d], &stats[d] };
+        if (d == HDMI) {
+            display.impl = mHDMIImpl;
+            display.alternate = mHDMIAlternateImpl;
+            display.useAlternate = &mUseHDMIAlternate;
+            display.changeImpl = &mChangeHDMIImpl;
+        }
+        return display;
+    }
+
+    int mScenario;
+    android::HWCImpl *mLCDImpl;
+    android::HWCImpl *mHDMIImpl;
+    android::HWCImpl *mHDMIAlternateImpl;
+    volatile int32_t mUseHDMIAlternate;
+    volatile int32_t mChangeHDMIImpl;
+
+public:
+    HWCFrameSignature signature[DISPLAYS];
+    HWCFrameStats stats[DISPLAYS];
+    uint32_t alternateFrames;
+};
+
+/*
+ * replay
+ */
+struct Options {
+    int gpuLatency;         // vsyncs
+    int64_t jitter;         // ns
+    bool verbose;
+};
+
+struct Result {
+    int frames;
+    int64_t cpu[MAX_FRAMES];    // ns, prepare and set of a frame
+    SurfaceFlingerStats sf[DISPLAYS];
+    MockDisplay::Stats layers;  // all layers
+    MockDisplay::FenceStats fences;
+    uint32_t vsyncs;
+    uint32_t hwVsyncs;          // the ones the model took
+    int64_t maxError;           // ns, of the predicted vsyncs
+};
+
+typedef void (*Workload)(int n, FrameDesc &f);
+
+static const int mlcLayers[] = {
+    nxp_v4l2_mlc0_rgb, nxp_v4l2_mlc0_video, nxp_v4l2_mlc1_rgb, nxp_v4l2_mlc1_video,
+    nxp_v4l2_resol, nxp_v4l2_hdmi, nxp_v4l2_mlc0, nxp_v4l2_mlc1,
+};
+#define MLC_LAYER_COUNT     (int)(sizeof(mlcLayers) / sizeof(mlcLayers[0]))
+
+static NXTestRandom rng;
+
+static int64_t cpuTime()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int compareTime(const void *a, const void *b)
+{
+    int64_t d = *(const int64_t *)a - *(const int64_t *)b;
+    return d < 0 ? -1 : d > 0;
+}
+
+static void dumpDetail(Composer &composer, const Result &r)
+{
+    char buff[DUMP_SIZE];
+    for (int d = 0; d < DISPLAYS; d++) {
+        composer.stats[d].dump(displayNames[d], buff, sizeof(buff));
+        printf("%s", buff);
+        composer.signature[d].dump(displayNames[d], buff, sizeof(buff));
+        printf("%s", buff);
+        const SurfaceFlingerStats &s = r.sf[d];
+        printf("  %s: %u gles frames, %u gles layers, %u overlay layers, %u release fences, "
+                "%u fence waits, %u tears\n",
+                displayNames[d], s.glesFrames, s.glesLayers, s.overlayLayers, s.releaseFences,
+                s.fenceWaits, s.tears);
+    }
+    for (int i = 0; i < MLC_LAYER_COUNT; i++) {
+        MockDisplay::Stats s = MockDisplay::getStats(mlcLayers[i]);
+        if (!s.configs && !s.qbufs)
+            continue;
+        printf("  %-10s %5u configs, %5u qbufs, %5u dqbufs, %3u stalls, %5u shown, %3u late acquires, "
+                "%5u release fences\n",
+                MockDisplay::getName(mlcLayers[i]), s.configs, s.qbufs, s.dqbufs, s.stalls, s.shown,
+                s.lateAcquires, s.releaseFences);
+    }
+    printf("  fences: %u created, %u waits, %u blocking, %u merges\n",
+            r.fences.created, r.fences.waits, r.fences.blockingWaits, r.fences.merges);
+    printf("  vsync: %u vsyncs for %d frames, %u from the hardware, max error %lld us, %u alternate frames\n",
+            r.vsyncs, r.frames, r.hwVsyncs, (long long)(r.maxError / 1000), composer.alternateFrames);
+}
+
+static int replay(int scenario, const char *name, Workload workload, const FrameDesc *trace, int frames,
+        const Options &opt)
+{
+    static Result r;
+    memset(&r, 0, sizeof(r));
+    MockDisplay::reset();
+    rng.reset();
+
+    Composer *composer = new Composer(scenario);
+    if (!composer->valid()) {
+        printf("%2d %-36s no impl\n", scenario, scenarioNames[scenario]);
+        delete composer;
+        return -1;
+    }
+
+    hwc_display_contents_1_t *contents[DISPLAYS] = { newContents(), newContents() };
+    static FrameDesc desc;
+    HWCVsyncModel model(PERIOD);
+    bool hwVsync = true;
+    int64_t start = 1000000000LL;
+    int64_t last = start;
+
+    for (int n = 0; n < frames; n++) {
+        if (trace)
+            desc = trace[n];
+        else
+            workload(n, desc);
+        buildContents(contents[LCD], desc, LCD, LCD_WIDTH, LCD_HEIGHT);
+        buildContents(contents[HDMI], desc, HDMI, HDMI_WIDTH, HDMI_HEIGHT);
+
+        int64_t begin = cpuTime();
+        composer->prepare(contents[LCD], contents[HDMI]);
+        r.cpu[n] = cpuTime() - begin;
+
+        int acquire[DISPLAYS];
+        for (int d = 0; d < DISPLAYS; d++) {
+            compose(contents[d], d, opt.gpuLatency, r.sf[d]);
+            acquire[d] = contents[d]->hwLayers[contents[d]->numHwLayers - 1].acquireFenceFd;
+        }
+
+        begin = cpuTime();
+        composer->set(contents[LCD], contents[HDMI]);
+        r.cpu[n] += cpuTime() - begin;
+
+        for (int d = 0; d < DISPLAYS; d++)
+            retire(contents[d], acquire[d], r.sf[d]);
+
+        // the vsync the frame is shown at, seen by the model
+        MockDisplay::vsync();
+        int64_t actual = start + (int64_t)MockDisplay::getVsyncCount() * PERIOD;
+        if (model.isLocked()) {
+            int64_t error = model.nextVsync(last + PERIOD / 2) - actual;
+            if (error < 0)
+                error = -error;
+            if (error > r.maxError)
+                r.maxError = error;
+        }
+        last = actual;
+        if (!hwVsync && model.needsResync(actual)) {
+            model.beginResync();
+            hwVsync = true;
+        }
+        if (hwVsync) {
+            r.hwVsyncs++;
+            hwVsync = model.addSample(actual + rng.jitter(opt.jitter));
+        }
+    }
+    r.frames = frames;
+    r.vsyncs = MockDisplay::getVsyncCount();
+    r.fences = MockDisplay::getFenceStats();
+    for (int i = 0; i < MLC_LAYER_COUNT; i++) {
+        MockDisplay::Stats s = MockDisplay::getStats(mlcLayers[i]);
+        r.layers.configs += s.configs;
+        r.layers.qbufs += s.qbufs;
+        r.layers.stalls += s.stalls;
+        r.layers.lateAcquires += s.lateAcquires;
+        r.layers.releaseFences += s.releaseFences;
+    }
+
+    qsort(r.cpu, frames, sizeof(r.cpu[0]), compareTime);
+    int64_t total = 0;
+    for (int n = 0; n < frames; n++)
+        total += r.cpu[n];
+
+    uint32_t sfWaits = r.sf[LCD].fenceWaits + r.sf[HDMI].fenceWaits;
+    uint32_t tears = r.sf[LCD].tears + r.sf[HDMI].tears;
+    printf("%2d %-36s %-7s %5lld %5lld %5lld %6lld  %3u%% %3u%%  %5.1f %5.1f  %3u %3u  %3u %3u %3u\n",
+            scenario, scenarioNames[scenario], name,
+            total / frames / 1000, r.cpu[frames / 2] / 1000, r.cpu[frames * 99 / 100] / 1000,
+            r.cpu[frames - 1] / 1000,
+            r.sf[LCD].glesFrames * 100 / frames, r.sf[HDMI].glesFrames * 100 / frames,
+            (double)r.layers.configs / frames, (double)r.layers.qbufs / frames,
+            r.layers.stalls, r.layers.lateAcquires,
+            r.layers.releaseFences, sfWaits, tears);
+    if (opt.verbose)
+        dumpDetail(*composer, r);
+
+    delete composer;
+    free(contents[LCD]);
+    free(contents[HDMI]);
+    freeQueues();
+    return 0;
+}
+
+static FrameDesc traceFrames[MAX_FRAMES];
+
+int main(int argc, char *argv[])
+{
+    int scenario = -1;
+    const char *workloadName = NULL;
+    int frames = 600;
+    Options opt;
+    opt.gpuLatency = 0;
+    opt.jitter = 0;
+    opt.verbose = false;
+
+    int c;
+    while ((c = getopt(argc, argv, "s:w:n:g:j:v")) != -1) {
+        switch (c) {
+        case 's': scenario = atoi(optarg); break;
+        case 'w': workloadName = optarg; break;
+        case 'n': frames = atoi(optarg); break;
+        case 'g': opt.gpuLatency = atoi(optarg); break;
+        case 'j': opt.jitter = atoll(optarg) * 1000; break;
+        case 'v': opt.verbose = true; break;
+        default:
+            printf("usage: %s [-s scenario] [-w idle|scroll|video] [-n frames] [-g gpu latency] "
+                    "[-j vsync jitter us] [-v] [trace]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (scenario < -1 || scenario >= HWCreator::USAGE_SCENARIO_MAX || frames <= 0) {
+        printf("bad scenario or frame count\n");
+        return 1;
+    }
+    if (frames > MAX_FRAMES)
+        frames = MAX_FRAMES;
+
+    static const struct {
+        const char *name;
+        Workload workload;
+    } workloads[] = {
+        { "idle", idleFrame },
+        { "scroll", scrollFrame },
+        { "video", videoFrame },
+    };
+    int workloadCount = sizeof(workloads) / sizeof(workloads[0]);
+    if (workloadName) {
+        int w = 0;
+        while (w < workloadCount && strcmp(workloadName, workloads[w].name))
+            w++;
+        if (w == workloadCount) {
+            printf("unknown workload %s\n", workloadName);
+            return 1;
+        }
+    }
+
+    const FrameDesc *trace = NULL;
+    const char *traceName = "trace";
+    if (optind < argc) {
+        int count = readTrace(argv[optind], traceFrames, MAX_FRAMES);
+        if (count <= 0)
+            return 1;
+        trace = traceFrames;
+        frames = count;
+    }
+
+    printf("%d frames, lcd %dx%d, hdmi %dx%d, gpu latency %d vsyncs, vsync jitter %lld us\n",
+            frames, LCD_WIDTH, LCD_HEIGHT, HDMI_WIDTH, HDMI_HEIGHT, opt.gpuLatency, (long long)(opt.jitter / 1000));
+    printf("             cpu us: avg p50 p99 max, gles frames: lcd hdmi, per frame: v4l2 calls qbufs,\n"
+            "             stalled dqbufs, late acquires, release fences, gles fence waits, tears\n");
+
+    int failed = 0;
+    for (int s = 0; s < HWCreator::USAGE_SCENARIO_MAX; s++) {
+        if (scenario >= 0 && s != scenario)
+            continue;
+        if (trace) {
+            failed |= replay(s, traceName, NULL, trace, frames, opt);
+            continue;
+        }
+        for (int w = 0; w < workloadCount; w++) {
+            if (workloadName && strcmp(workloadName, workloads[w].name))
+                continue;
+            failed |= replay(s, workloads[w].name, workloads[w].workload, NULL, frames, opt);
+        }
+    }
+    return failed ? 1 : 0;
+}
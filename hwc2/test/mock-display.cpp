@@ -0,0 +1,412 @@
+#undef LOG_TAG
+#define LOG_TAG     "MockDisplay"
+
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <cutils/log.h>
+#include <sync/sync.h>
+
+#include <nxp-v4l2.h>
+
+#include "mock-display.h"
+
+namespace {
+
+struct Buffer {
+    int index;
+    const void *handle;
+    int acquire;        // dup of the acquire fence, -1: none
+    int release;        // write end of the release fence, -1: none
+};
+
+struct Layer {
+    bool streaming;
+    Buffer queue[MockDisplay::MAX_BUFFERS];
+    int queued;
+    Buffer shown;
+    bool hasShown;
+    int done[MockDisplay::MAX_BUFFERS];   // indexes for dqbuf
+    int doneCount;
+    MockDisplay::Stats stats;
+};
+
+struct Fence {
+    int write;          // -1: free
+    uint32_t signalAt;  // vsync count, for the timed ones
+    int merged[2];      // the two of a merge, -1 for the timed ones
+};
+
+Layer layers[nxp_v4l2_id_max];
+Fence fences[MockDisplay::MAX_FENCES];
+uint32_t vsyncCount;
+MockDisplay::FenceStats fenceStats;
+bool initialized;
+
+void closeFd(int &fd)
+{
+    if (fd >= 0) {
+        close(fd);
+        fd = -1;
+    }
+}
+
+void init()
+{
+    if (initialized)
+        return;
+    for (int i = 0; i < MockDisplay::MAX_FENCES; i++)
+        fences[i].write = -1;
+    initialized = true;
+}
+
+/* the read end, the write end is kept in slot, NULL when all are in use */
+int newFence(Fence **slot)
+{
+    init();
+    int fds[2];
+    if (pipe(fds) < 0)
+        return -errno;
+    fenceStats.created++;
+    *slot = NULL;
+    for (int i = 0; i < MockDisplay::MAX_FENCES; i++) {
+        if (fences[i].write < 0) {
+            *slot = &fences[i];
+            break;
+        }
+    }
+    if (!*slot) {
+        ALOGE("out of fences, signaled at once");
+        close(fds[1]);
+        return fds[0];
+    }
+    (*slot)->write = fds[1];
+    (*slot)->merged[0] = (*slot)->merged[1] = -1;
+    return fds[0];
+}
+
+void signalFences()
+{
+    for (int i = 0; i < MockDisplay::MAX_FENCES; i++) {
+        Fence &f = fences[i];
+        if (f.write < 0)
+            continue;
+        if (f.merged[0] >= 0) {
+            if (MockDisplay::isSignaled(f.merged[0]) && MockDisplay::isSignaled(f.merged[1])) {
+                closeFd(f.merged[0]);
+                closeFd(f.merged[1]);
+                closeFd(f.write);
+            }
+        } else if (f.signalAt <= vsyncCount) {
+            closeFd(f.write);
+        }
+    }
+}
+
+void release(Layer &layer, Buffer &b)
+{
+    closeFd(b.acquire);
+    closeFd(b.release);
+    if (layer.doneCount < MockDisplay::MAX_BUFFERS)
+        layer.done[layer.doneCount++] = b.index;
+}
+
+void scanout(Layer &layer)
+{
+    if (!layer.streaming || !layer.queued)
+        return;
+    Buffer &next = layer.queue[0];
+    if (next.acquire >= 0 && !MockDisplay::isSignaled(next.acquire)) {
+        layer.stats.lateAcquires++;
+        return;
+    }
+    if (layer.hasShown)
+        release(layer, layer.shown);
+    layer.shown = next;
+    layer.hasShown = true;
+    layer.queued--;
+    memmove(&layer.queue[0], &layer.queue[1], layer.queued * sizeof(Buffer));
+    layer.stats.shown++;
+}
+
+Layer *getLayer(int id)
+{
+    if (id < 0 || id >= nxp_v4l2_id_max) {
+        ALOGE("no layer %d", id);
+        return NULL;
+    }
+    return &layers[id];
+}
+
+int config(int id)
+{
+    Layer *layer = getLayer(id);
+    if (!layer)
+        return -EINVAL;
+    layer->stats.configs++;
+    return 0;
+}
+
+}; // namespace
+
+void MockDisplay::reset()
+{
+    init();
+    for (int id = 0; id < nxp_v4l2_id_max; id++)
+        v4l2_streamoff(id);
+    memset(layers, 0, sizeof(layers));
+    for (int i = 0; i < MAX_FENCES; i++) {
+        closeFd(fences[i].write);
+        closeFd(fences[i].merged[0]);
+        closeFd(fences[i].merged[1]);
+    }
+    memset(&fenceStats, 0, sizeof(fenceStats));
+    vsyncCount = 0;
+}
+
+void MockDisplay::vsync()
+{
+    vsyncCount++;
+    signalFences();
+    for (int id = 0; id < nxp_v4l2_id_max; id++)
+        scanout(layers[id]);
+    // the releases of this vsync
+    signalFences();
+}
+
+uint32_t MockDisplay::getVsyncCount()
+{
+    return vsyncCount;
+}
+
+int MockDisplay::createFence(uint32_t signalAt)
+{
+    Fence *f;
+    int fd = newFence(&f);
+    if (fd >= 0 && f) {
+        f->signalAt = signalAt;
+        if (signalAt <= vsyncCount)
+            closeFd(f->write);
+    }
+    return fd;
+}
+
+bool MockDisplay::isSignaled(int fd)
+{
+    struct pollfd p = { fd, POLLIN, 0 };
+    return poll(&p, 1, 0) > 0;
+}
+
+bool MockDisplay::isBusy(const void *handle)
+{
+    for (int id = 0; id < nxp_v4l2_id_max; id++) {
+        const Layer &layer = layers[id];
+        if (layer.hasShown && layer.shown.handle == handle)
+            return true;
+        for (int i = 0; i < layer.queued; i++) {
+            if (layer.queue[i].handle == handle)
+                return true;
+        }
+    }
+    return false;
+}
+
+MockDisplay::Stats MockDisplay::getStats(int id)
+{
+    Layer *layer = getLayer(id);
+    if (!layer) {
+        Stats none;
+        memset(&none, 0, sizeof(none));
+        return none;
+    }
+    return layer->stats;
+}
+
+MockDisplay::FenceStats MockDisplay::getFenceStats()
+{
+    return fenceStats;
+}
+
+const char *MockDisplay::getName(int id)
+{
+    switch (id) {
+    case nxp_v4l2_mlc0_rgb:     return "mlc0-rgb";
+    case nxp_v4l2_mlc0_video:   return "mlc0-video";
+    case nxp_v4l2_mlc1_rgb:     return "mlc1-rgb";
+    case nxp_v4l2_mlc1_video:   return "mlc1-video";
+    case nxp_v4l2_resol:        return "resol";
+    case nxp_v4l2_hdmi:         return "hdmi";
+    default:                    return "?";
+    }
+}
+
+/*
+ * libv4l2-nexell
+ */
+int v4l2_link(int src_id, int dst_id)
+{
+    return config(src_id);
+}
+
+int v4l2_unlink(int src_id, int dst_id)
+{
+    return config(src_id);
+}
+
+int v4l2_set_format(int id, int w, int h, int f)
+{
+    return config(id);
+}
+
+int v4l2_set_crop(int id, int l, int t, int w, int h)
+{
+    return config(id);
+}
+
+int v4l2_set_format_with_pad(int id, int pad, int w, int h, int f)
+{
+    return config(id);
+}
+
+int v4l2_set_crop_with_pad(int id, int pad, int l, int t, int w, int h)
+{
+    return config(id);
+}
+
+int v4l2_set_ctrl(int id, int ctrl_id, int value)
+{
+    return config(id);
+}
+
+int v4l2_set_preset(int id, uint32_t preset)
+{
+    return config(id);
+}
+
+int v4l2_reqbuf(int id, int buf_count)
+{
+    return config(id);
+}
+
+int v4l2_qbuf(int id, int plane_num, int index0, struct private_handle_t const *b0, int index1, struct private_handle_t const *b1,
+        int *syncfd0, int *syncfd1)
+{
+    Layer *layer = getLayer(id);
+    if (!layer || !b0)
+        return -EINVAL;
+    if (layer->queued >= MockDisplay::MAX_BUFFERS) {
+        ALOGE("%s: %d buffers queued", MockDisplay::getName(id), layer->queued);
+        return -EBUSY;
+    }
+
+    Buffer &b = layer->queue[layer->queued++];
+    b.index = index0;
+    b.handle = b0;
+    b.acquire = -1;
+    b.release = -1;
+    if (syncfd0) {
+        if (*syncfd0 >= 0)
+            b.acquire = dup(*syncfd0);
+        int fds[2];
+        if (pipe(fds) == 0) {
+            fenceStats.created++;
+            b.release = fds[1];
+            *syncfd0 = fds[0];
+            layer->stats.releaseFences++;
+        } else {
+            *syncfd0 = -1;
+        }
+    }
+    layer->stats.qbufs++;
+    return 0;
+}
+
+int v4l2_dqbuf(int id, int plane_num, int *index0, int *index1)
+{
+    Layer *layer = getLayer(id);
+    if (!layer || !layer->streaming)
+        return -EINVAL;
+
+    if (!layer->doneCount) {
+        // the driver sleeps until the scanout of the next vsync is over
+        layer->stats.stalls++;
+        for (int i = 0; i < MockDisplay::MAX_BUFFERS && !layer->doneCount; i++)
+            MockDisplay::vsync();
+        if (!layer->doneCount)
+            return -EAGAIN;
+    }
+    *index0 = layer->done[0];
+    layer->doneCount--;
+    memmove(&layer->done[0], &layer->done[1], layer->doneCount * sizeof(int));
+    layer->stats.dqbufs++;
+    return 0;
+}
+
+int v4l2_streamon(int id)
+{
+    Layer *layer = getLayer(id);
+    if (!layer)
+        return -EINVAL;
+    layer->streaming = true;
+    return 0;
+}
+
+int v4l2_streamoff(int id)
+{
+    Layer *layer = getLayer(id);
+    if (!layer)
+        return -EINVAL;
+    for (int i = 0; i < layer->queued; i++) {
+        closeFd(layer->queue[i].acquire);
+        closeFd(layer->queue[i].release);
+    }
+    if (layer->hasShown) {
+        closeFd(layer->shown.acquire);
+        closeFd(layer->shown.release);
+    }
+    layer->queued = 0;
+    layer->hasShown = false;
+    layer->doneCount = 0;
+    layer->streaming = false;
+    return 0;
+}
+
+/*
+ * libsync
+ */
+extern "C" int sync_wait(int fd, int timeout)
+{
+    fenceStats.waits++;
+    if (MockDisplay::isSignaled(fd))
+        return 0;
+    if (timeout == 0) {
+        errno = ETIME;
+        return -1;
+    }
+    fenceStats.blockingWaits++;
+    for (int i = 0; i < MockDisplay::MAX_BUFFERS; i++) {
+        MockDisplay::vsync();
+        if (MockDisplay::isSignaled(fd))
+            return 0;
+    }
+    errno = ETIME;
+    return -1;
+}
+
+extern "C" int sync_merge(const char *name, int fd1, int fd2)
+{
+    Fence *f;
+    int fd = newFence(&f);
+    if (fd < 0)
+        return fd;
+    fenceStats.merges++;
+    if (f) {
+        f->merged[0] = dup(fd1);
+        f->merged[1] = dup(fd2);
+        signalFences();
+    }
+    return fd;
+}
@@ -0,0 +1,59 @@
+#ifndef _MOCK_DISPLAY_H
+#define _MOCK_DISPLAY_H
+
+#include <stdint.h>
+
+/*
+ * mock display backend for the host
+ * Implements libv4l2-nexell (nxp-v4l2.h) and libsync over a model of the
+ * MLC layers: a queued buffer goes on screen at the vsync after its acquire
+ * fence signaled, the one it replaces is released then, its release fence
+ * signals and dqbuf returns it. A dqbuf or a sync_wait that would block
+ * waits for the next vsync and counts as a stall.
+ * Fences are pipes, signaled when the write end is closed. Nothing is
+ * thread safe, vsync() is the only clock.
+ */
+class MockDisplay
+{
+public:
+    enum {
+        MAX_BUFFERS = 8,    // queued on a layer
+        MAX_FENCES = 256,
+    };
+
+    struct Stats {
+        uint32_t configs;       // format, crop, ctrl, link, preset and reqbuf calls
+        uint32_t qbufs;
+        uint32_t dqbufs;
+        uint32_t stalls;        // dqbufs that waited for a vsync
+        uint32_t shown;         // buffers put on screen
+        uint32_t lateAcquires;  // vsyncs a queued buffer waited for its acquire fence
+        uint32_t releaseFences; // handed out by qbuf
+    };
+
+    struct FenceStats {
+        uint32_t created;
+        uint32_t waits;         // sync_wait calls
+        uint32_t blockingWaits; // ones that waited for a vsync
+        uint32_t merges;
+    };
+
+    static void reset();
+
+    /* one vsync on every layer */
+    static void vsync();
+    static uint32_t getVsyncCount();
+
+    /* a fence that signals at the vsync count signalAt, signaled when that has passed */
+    static int createFence(uint32_t signalAt);
+    static bool isSignaled(int fd);
+
+    /* the buffer is queued or on screen on any layer */
+    static bool isBusy(const void *handle);
+
+    static Stats getStats(int id);
+    static FenceStats getFenceStats();
+    static const char *getName(int id);
+};
+
+#endif
@@ -0,0 +1,185 @@
+/*
+ * Frame signature test with a fake SurfaceFlinger.
+ *
+ * Each frame runs prepare, GLES composition into a new target buffer when
+ * any layer is left to GLES, and set, the way SurfaceFlinger does. Handles
+ * are plain addresses, nothing dereferences them.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <hardware/hwcomposer.h>
+
+#include <NXTest.h>
+
+#include "HWCFrameSignature.h"
+
+using namespace android;
+
+#define LAYERS              3   // wallpaper, video, status bar
+
+static char buffers[64];
+static int nextBuffer = 0;
+
+static buffer_handle_t newBuffer()
+{
+    return (buffer_handle_t)&buffers[nextBuffer++ % sizeof(buffers)];
+}
+
+static hwc_rect_t rect(int left, int top, int right, int bottom)
+{
+    hwc_rect_t r = { left, top, right, bottom };
+    return r;
+}
+
+static hwc_display_contents_1_t *newContents()
+{
+    hwc_display_contents_1_t *contents = (hwc_display_contents_1_t *)calloc(1,
+            sizeof(*contents) + (LAYERS + 1) * sizeof(hwc_layer_1_t));
+    contents->numHwLayers = LAYERS + 1;
+    for (int i = 0; i < LAYERS; i++) {
+        hwc_layer_1_t &layer = contents->hwLayers[i];
+        layer.handle = newBuffer();
+        layer.blending = HWC_BLENDING_NONE;
+        layer.sourceCrop = rect(0, 0, 800, 480);
+        layer.displayFrame = rect(0, 0, 800, 480);
+        layer.visibleRegionScreen.numRects = 1;
+        layer.visibleRegionScreen.rects = &layer.displayFrame;
+        layer.acquireFenceFd = -1;
+        layer.releaseFenceFd = -1;
+    }
+    contents->hwLayers[LAYERS].compositionType = HWC_FRAMEBUFFER_TARGET;
+    contents->hwLayers[LAYERS].handle = newBuffer();
+    contents->flags = HWC_GEOMETRY_CHANGED;
+    return contents;
+}
+
+/* the impl: the video layer goes to the overlay, the rest to GLES */
+static void implPrepare(hwc_display_contents_1_t *contents)
+{
+    for (int i = 0; i < LAYERS; i++)
+        contents->hwLayers[i].compositionType = i == 1 ? HWC_OVERLAY : HWC_FRAMEBUFFER;
+}
+
+struct Frame {
+    bool glesSkipped;
+    bool committed;
+    bool composed;
+};
+
+static Frame frame(HWCFrameSignature &sig, hwc_display_contents_1_t *contents)
+{
+    Frame f;
+    sig.restore(contents);
+    implPrepare(contents);
+    f.glesSkipped = sig.prepare(contents);
+
+    f.composed = false;
+    for (int i = 0; i < LAYERS; i++)
+        f.composed |= contents->hwLayers[i].compositionType == HWC_FRAMEBUFFER;
+    if (f.composed)
+        contents->hwLayers[LAYERS].handle = newBuffer();
+
+    f.committed = sig.set(contents);
+    // the impl sees its own composition types
+    CHECK(contents->hwLayers[0].compositionType == HWC_FRAMEBUFFER);
+    CHECK(contents->hwLayers[2].compositionType == HWC_FRAMEBUFFER);
+    contents->flags = 0;
+    return f;
+}
+
+static void testStatic()
+{
+    printf("%s\n", __func__);
+    HWCFrameSignature sig;
+    hwc_display_contents_1_t *contents = newContents();
+
+    Frame f = frame(sig, contents);
+    CHECK(!f.glesSkipped && f.composed && f.committed);
+
+    // nothing changed: no composition, no commit
+    f = frame(sig, contents);
+    CHECK(f.glesSkipped && !f.composed && !f.committed);
+    f = frame(sig, contents);
+    CHECK(f.glesSkipped && !f.committed);
+
+    HWCFrameSignature::Stats stats = sig.getStats();
+    CHECK(stats.frames == 3 && stats.glesSkipped == 2 && stats.commitsSkipped == 2);
+    CHECK(stats.savedBytes == 2 * 2 * 2 * 800 * 480 * 4);
+
+    char dump[256];
+    sig.dump("lcd", dump, sizeof(dump));
+    printf("%s", dump);
+    CHECK(strstr(dump, "2 gles skipped") != NULL);
+
+    // the status bar updates: composed again, then skipped again
+    contents->hwLayers[2].handle = newBuffer();
+    f = frame(sig, contents);
+    CHECK(!f.glesSkipped && f.composed && f.committed);
+    f = frame(sig, contents);
+    CHECK(f.glesSkipped && !f.committed);
+    free(contents);
+}
+
+static void testVideo()
+{
+    printf("%s\n", __func__);
+    HWCFrameSignature sig;
+    hwc_display_contents_1_t *contents = newContents();
+    frame(sig, contents);
+
+    // a new video frame each time, the ui stays in the target
+    for (int i = 0; i < 5; i++) {
+        contents->hwLayers[1].handle = newBuffer();
+        Frame f = frame(sig, contents);
+        CHECK(f.glesSkipped && !f.composed && f.committed);
+    }
+
+    // the video moves, the holes in the ui change
+    contents->hwLayers[1].displayFrame = rect(0, 0, 400, 240);
+    Frame f = frame(sig, contents);
+    CHECK(!f.glesSkipped && f.composed);
+    free(contents);
+}
+
+static void testInvalidate()
+{
+    printf("%s\n", __func__);
+    HWCFrameSignature sig;
+    hwc_display_contents_1_t *contents = newContents();
+    frame(sig, contents);
+
+    // blank or an impl change: the screen doesn't show the last commit
+    sig.invalidate();
+    Frame f = frame(sig, contents);
+    CHECK(!f.glesSkipped && f.committed);
+    f = frame(sig, contents);
+    CHECK(f.glesSkipped && !f.committed);
+
+    contents->flags = HWC_GEOMETRY_CHANGED;
+    f = frame(sig, contents);
+    CHECK(!f.glesSkipped && f.committed);
+
+    // a layer without a buffer is drawn by SurfaceFlinger, always composed
+    contents->hwLayers[2].handle = NULL;
+    frame(sig, contents);
+    f = frame(sig, contents);
+    CHECK(!f.glesSkipped && f.committed);
+    contents->hwLayers[2].handle = newBuffer();
+
+    sig.setEnabled(false);
+    frame(sig, contents);
+    f = frame(sig, contents);
+    CHECK(!f.glesSkipped && f.committed);
+    free(contents);
+}
+
+int main(int argc, char *argv[])
+{
+    testStatic();
+    testVideo();
+    testInvalidate();
+
+    return testResult();
+}
@@ -0,0 +1,226 @@
+/*
+ * Overlay planner test with synthetic layers.
+ *
+ * Formats are plain numbers, the planner only compares them with the
+ * formats of its planes.
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include <NXTest.h>
+
+#include "HWCPlanner.h"
+
+using namespace android;
+
+#define WIDTH               1280
+#define HEIGHT              720
+
+#define RGBA                1
+#define YUV                 2
+
+static HWCPlanner::Rect rect(int left, int top, int right, int bottom)
+{
+    HWCPlanner::Rect r = { left, top, right, bottom };
+    return r;
+}
+
+static HWCPlanner::Layer layer(int format, HWCPlanner::Rect frame)
+{
+    HWCPlanner::Layer l;
+    memset(&l, 0, sizeof(l));
+    l.format = format;
+    l.bitsPerPixel = format == YUV ? 12 : 32;
+    l.hasAlpha = format == RGBA;
+    l.blending = format == RGBA ? HWCPlanner::BLEND_PREMULT : HWCPlanner::BLEND_NONE;
+    l.sourceCrop = rect(0, 0, frame.right - frame.left, frame.bottom - frame.top);
+    l.displayFrame = frame;
+    return l;
+}
+
+/* a video plane under the framebuffer and an rgb plane above it */
+static HWCPlanner::Config config(int planes)
+{
+    HWCPlanner::Config c;
+    memset(&c, 0, sizeof(c));
+    c.width = WIDTH;
+    c.height = HEIGHT;
+
+    HWCPlanner::Plane &video = c.planes[0];
+    video.name = "video";
+    video.zorder = -1;
+    video.formats[0] = YUV;
+    video.formatCount = 1;
+    video.scaling = true;
+    video.maxDownscale = 2;
+    video.maxUpscale = 8;
+
+    HWCPlanner::Plane &rgb = c.planes[1];
+    rgb.name = "rgb";
+    rgb.zorder = 1;
+    rgb.formats[0] = RGBA;
+    rgb.formatCount = 1;
+    rgb.premultiplied = true;
+
+    c.planeCount = planes;
+    c.gpuWeight = 300;
+    c.overlayCost = 64 * 1024;
+    c.switchCost = 1024 * 1024;
+    return c;
+}
+
+static void testVideo()
+{
+    printf("%s\n", __func__);
+    HWCPlanner planner(config(1));
+    HWCPlanner::Result r;
+
+    // full screen video under the ui
+    HWCPlanner::Layer layers[2] = {
+        layer(YUV, rect(0, 0, WIDTH, HEIGHT)),
+        layer(RGBA, rect(0, 600, WIDTH, HEIGHT)),
+    };
+    planner.plan(layers, 2, NULL, r);
+    CHECK(r.layer[0] == 0 && r.overlays == 1);
+    CHECK(HWCPlanner::planeOf(r, 1) == -1);
+    CHECK(r.cost == r.glesCost + r.overlayCost);
+
+    // the video plane is under the framebuffer, the ui can't go under the video
+    HWCPlanner::Layer above[2] = {
+        layer(RGBA, rect(0, 0, WIDTH, HEIGHT)),
+        layer(YUV, rect(100, 100, 740, 460)),
+    };
+    planner.plan(above, 2, NULL, r);
+    CHECK(r.overlays == 0);
+
+    // unless they don't overlap
+    above[0].displayFrame = above[0].sourceCrop = rect(0, 0, WIDTH, 50);
+    planner.plan(above, 2, NULL, r);
+    CHECK(r.layer[0] == 1);
+}
+
+static void testAccepts()
+{
+    printf("%s\n", __func__);
+    HWCPlanner::Config c = config(2);
+    HWCPlanner planner(c);
+    const char *reason;
+
+    HWCPlanner::Layer video = layer(YUV, rect(0, 0, WIDTH, HEIGHT));
+    CHECK(planner.accepts(c.planes[0], video, &reason) && reason == NULL);
+    CHECK(!planner.accepts(c.planes[1], video, &reason) && !strcmp(reason, "format"));
+
+    video.sourceCrop = rect(0, 0, 4 * WIDTH, 4 * HEIGHT);
+    CHECK(!planner.accepts(c.planes[0], video, &reason) && !strcmp(reason, "downscale"));
+    video.sourceCrop = rect(0, 0, WIDTH / 16, HEIGHT / 16);
+    CHECK(!planner.accepts(c.planes[0], video, &reason) && !strcmp(reason, "upscale"));
+    video.sourceCrop = rect(0, 0, WIDTH / 2, HEIGHT / 2);
+    CHECK(planner.accepts(c.planes[0], video));
+
+    video.transform = 4;
+    CHECK(!planner.accepts(c.planes[0], video, &reason) && !strcmp(reason, "transform"));
+    video.transform = 0;
+    video.displayFrame = rect(-10, 0, WIDTH, HEIGHT);
+    CHECK(!planner.accepts(c.planes[0], video, &reason) && !strcmp(reason, "offscreen"));
+    video.displayFrame = rect(0, 0, WIDTH, HEIGHT);
+    video.skip = true;
+    CHECK(!planner.accepts(c.planes[0], video, &reason) && !strcmp(reason, "skip"));
+
+    // the rgb plane blends premultiplied only, and doesn't scale
+    HWCPlanner::Layer ui = layer(RGBA, rect(0, 0, 200, 200));
+    CHECK(planner.accepts(c.planes[1], ui));
+    ui.blending = HWCPlanner::BLEND_COVERAGE;
+    CHECK(!planner.accepts(c.planes[1], ui, &reason) && !strcmp(reason, "alpha"));
+    ui.blending = HWCPlanner::BLEND_PREMULT;
+    ui.sourceCrop = rect(0, 0, 100, 100);
+    CHECK(!planner.accepts(c.planes[1], ui, &reason) && !strcmp(reason, "scaling"));
+}
+
+static void testTwoPlanes()
+{
+    printf("%s\n", __func__);
+    HWCPlanner planner(config(2));
+    HWCPlanner::Result r;
+
+    // video, status bar, and a cursor on top: one of the rgb layers goes to GLES
+    HWCPlanner::Layer layers[3] = {
+        layer(YUV, rect(0, 0, WIDTH, HEIGHT)),
+        layer(RGBA, rect(0, 0, WIDTH, 40)),
+        layer(RGBA, rect(600, 300, 632, 332)),
+    };
+    planner.plan(layers, 3, NULL, r);
+    CHECK(r.layer[0] == 0 && r.overlays == 2);
+    // the bigger one saves more gpu bytes
+    CHECK(r.layer[1] == 1);
+
+    // the rgb plane is above the framebuffer, a GLES layer over it isn't
+    layers[2].displayFrame = rect(600, 20, 632, 52);
+    layers[2].sourceCrop = rect(0, 0, 32, 32);
+    planner.plan(layers, 3, NULL, r);
+    CHECK(r.layer[1] != 1);
+    CHECK(r.candidates > 1);
+}
+
+static void testHysteresis()
+{
+    printf("%s\n", __func__);
+    HWCPlanner::Config c = config(1);
+    c.overlayCost = 0;
+    HWCPlanner planner(c);
+    HWCPlanner::Result first, second, again;
+
+    // two equal videos side by side, the first in enumeration order wins
+    HWCPlanner::Layer layers[2] = {
+        layer(YUV, rect(0, 0, 640, 360)),
+        layer(YUV, rect(640, 0, 1280, 360)),
+    };
+    planner.plan(layers, 2, NULL, first);
+    CHECK(first.layer[0] == 0);
+    planner.plan(layers, 2, NULL, again);
+    CHECK(memcmp(&first, &again, sizeof(first)) == 0);
+
+    // the second grows a little, not enough to pay for the switch
+    layers[1].sourceCrop = rect(0, 0, 660, 360);
+    layers[1].displayFrame = rect(620, 0, 1280, 360);
+    planner.plan(layers, 2, &first, second);
+    CHECK(second.layer[0] == 0);
+
+    // it becomes much bigger, worth the switch
+    layers[0].sourceCrop = rect(0, 0, 64, 36);
+    layers[0].displayFrame = rect(0, 400, 64, 436);
+    layers[1].sourceCrop = rect(0, 0, WIDTH, 360);
+    layers[1].displayFrame = rect(0, 0, WIDTH, 360);
+    planner.plan(layers, 2, &second, again);
+    CHECK(again.layer[0] == 1);
+}
+
+static void testBandwidth()
+{
+    printf("%s\n", __func__);
+    HWCPlanner::Config c = config(1);
+    HWCPlanner::Layer video = layer(YUV, rect(0, 0, WIDTH, HEIGHT));
+    video.sourceCrop = rect(0, 0, 2 * WIDTH, 2 * HEIGHT);
+    HWCPlanner::Result r;
+
+    HWCPlanner unlimited(c);
+    unlimited.plan(&video, 1, NULL, r);
+    CHECK(r.layer[0] == 0);
+
+    // the 4x source doesn't fit the bus next to the framebuffer
+    c.maxOverlayBytes = (unsigned long long)WIDTH * HEIGHT * 4;
+    HWCPlanner limited(c);
+    limited.plan(&video, 1, NULL, r);
+    CHECK(r.layer[0] == -1 && r.overlays == 0);
+    CHECK(r.glesCost == r.cost && r.overlayCost == 0);
+}
+
+int main(int argc, char *argv[])
+{
+    testVideo();
+    testAccepts();
+    testTwoPlanes();
+    testHysteresis();
+    testBandwidth();
+
+    return testResult();
+}
@@ -0,0 +1,160 @@
+/*
+ * Software vsync model test with vsync timestamp traces.
+ *
+ * The traces are made up from a display clock, jitter, missed and late
+ * interrupts and drift. A recorded trace, one timestamp in ns per line as
+ * read from /sys/devices/platform/display/vsync.0, can be given as argument
+ * to see how the model follows it.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <cutils/log.h>
+
+#include <NXTest.h>
+
+#include "HWCVsyncModel.h"
+
+using namespace android;
+
+#define PERIOD              16666667LL
+#define START               123456789000LL
+
+static NXTestRandom rng;
+
+static int64_t vsync(int64_t n, int64_t period = PERIOD)
+{
+    return START + n * period;
+}
+
+/* feeds vsyncs first..last, returns the last n the model asked for */
+static int64_t feed(HWCVsyncModel &model, int64_t first, int64_t last, int64_t range, int64_t period = PERIOD)
+{
+    int64_t n;
+    for (n = first; n <= last; n++) {
+        if (!model.addSample(vsync(n, period) + rng.jitter(range)))
+            break;
+    }
+    return n;
+}
+
+static void testLock()
+{
+    printf("%s\n", __func__);
+    HWCVsyncModel model(PERIOD);
+
+    // 100us of interrupt latency jitter, a little off the nominal period
+    int64_t period = PERIOD + 2000;
+    int64_t n = feed(model, 0, 100, 100000, period);
+    CHECK(model.isLocked());
+    CHECK(n >= HWCVsyncModel::LEARN_SAMPLES - 1 && n < 40);
+    CHECK(model.getPeriod() > period - 10000 && model.getPeriod() < period + 10000);
+
+    // predicted 2.5s later without the hardware
+    int64_t later = vsync(n + 150, period);
+    int64_t next = model.nextVsync(later - 1000000);
+    CHECK(next > later - 500000 && next < later + 500000);
+    CHECK(model.nextVsync(next) > next);
+    CHECK(model.needsResync(later));
+    CHECK(!model.needsResync(vsync(n + 10, period)));
+
+    char dump[256];
+    model.dump(dump, sizeof(dump));
+    printf("%s", dump);
+}
+
+static void testOutliers()
+{
+    printf("%s\n", __func__);
+    HWCVsyncModel model(PERIOD);
+    feed(model, 0, 30, 50000);
+    CHECK(model.isLocked());
+    int64_t period = model.getPeriod();
+
+    // a late interrupt and a missed one don't move the model
+    model.addSample(vsync(31) + 5000000);
+    model.addSample(vsync(33));
+    model.addSample(vsync(34));
+    CHECK(model.isLocked());
+    CHECK(model.getStats().outliers == 1);
+    CHECK(model.getPeriod() > period - 5000 && model.getPeriod() < period + 5000);
+
+    // the same vsync twice
+    model.addSample(vsync(34));
+    CHECK(model.getStats().outliers == 2 && model.isLocked());
+}
+
+static void testResync()
+{
+    printf("%s\n", __func__);
+    HWCVsyncModel model(PERIOD);
+    int64_t n = feed(model, 0, 100, 100000);
+
+    // in time: a few checks, the hardware goes off again
+    n += 150;
+    CHECK(model.needsResync(vsync(n)));
+    model.beginResync();
+    CHECK(!model.needsResync(vsync(n)));
+    int64_t done = feed(model, n, n + 10, 100000);
+    CHECK(done == n + HWCVsyncModel::RESYNC_SAMPLES - 1);
+    CHECK(model.isLocked() && model.getStats().resets == 0);
+
+    // the display clock changed meanwhile: 60 to 50 Hz
+    int64_t slow = 20000000;
+    int64_t base = vsync(done + 150);
+    model.beginResync();
+    int i;
+    for (i = 0; i < 100; i++) {
+        if (!model.addSample(base + i * slow + rng.jitter(100000)))
+            break;
+    }
+    CHECK(model.getStats().resets >= 1);
+    CHECK(model.isLocked());
+    CHECK(model.getPeriod() > slow - 10000 && model.getPeriod() < slow + 10000);
+}
+
+static void testTrace(const char *path)
+{
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        printf("can't open %s\n", path);
+        testFailures()++;
+        return;
+    }
+
+    HWCVsyncModel model(PERIOD);
+    long long timestamp;
+    int64_t worst = 0;
+    int predicted = 0;
+    while (fscanf(fp, "%lld", &timestamp) == 1) {
+        // how far off the prediction was before the sample came in
+        if (model.isLocked()) {
+            int64_t err = model.nextVsync(timestamp - model.getPeriod() / 2) - timestamp;
+            if (err < 0)
+                err = -err;
+            if (err > worst)
+                worst = err;
+            predicted++;
+        }
+        model.addSample(timestamp);
+    }
+    fclose(fp);
+
+    char dump[256];
+    model.dump(dump, sizeof(dump));
+    printf("%s  %d predicted, worst %lld ns off\n", dump, predicted, (long long)worst);
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc > 1) {
+        testTrace(argv[1]);
+    } else {
+        testLock();
+        testOutliers();
+        testResync();
+    }
+
+    return testResult();
+}
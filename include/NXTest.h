@@ -0,0 +1,54 @@
+#ifndef _NX_TEST_H
+#define _NX_TEST_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+/*
+ * shared by the unit tests and benchmarks in <module>/test
+ *
+ * CHECK() prints the line of a condition that doesn't hold and counts a
+ * failure, the test goes on. main() returns testResult().
+ */
+static inline int &testFailures()
+{
+    static int failures = 0;
+    return failures;
+}
+
+#define CHECK(cond) do { \
+        if (!(cond)) { \
+            printf("line %d: check failed: %s\n", __LINE__, #cond); \
+            testFailures()++; \
+        } \
+    } while (0)
+
+/* prints the verdict, returns the exit code */
+static inline int testResult()
+{
+    printf("%s\n", testFailures() ? "FAILED" : "PASSED");
+    return testFailures() ? 1 : 0;
+}
+
+/* seeded LCG, the same sequence on each run and target */
+class NXTestRandom
+{
+public:
+    NXTestRandom(uint32_t seed = 1) : Seed(seed) {
+    }
+
+    void reset(uint32_t seed = 1) {
+        Seed = seed;
+    }
+
+    /* -range..range */
+    int64_t jitter(int64_t range) {
+        Seed = Seed * 1103515245 + 12345;
+        return range ? (int64_t)((Seed >> 8) % (2 * range + 1)) - range : 0;
+    }
+
+private:
+    uint32_t Seed;
+};
+
+#endif
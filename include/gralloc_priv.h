@@ -17,6 +17,33 @@
 
 #define GRALLOC_ARM_DMA_BUF_MODULE  1
 
+#define GRALLOC_MAX_PLANES  3
+
+/*
+ * nexell yuv formats in one ion buffer, planes at plane_offset, 0: one fd per
+ * plane. The planes of all single fd yuv buffers are queued to v4l2 with
+ * data_offset only when it is set, not every video driver honours it.
+ */
+#define GRALLOC_YUV_CONTIGUOUS_PROPERTY "gralloc.yuv.contiguous"
+
+/* private perform() operations */
+enum {
+    GRALLOC_PERFORM_LOCK_YCBCR = 0x4e580001, // handle, usage, l, t, w, h, struct android_ycbcr *
+};
+
+#ifndef GRALLOC_MODULE_API_VERSION_0_2
+/* the android_ycbcr of newer frameworks for gralloc modules without lock_ycbcr */
+struct android_ycbcr {
+    void *y;
+    void *cb;
+    void *cr;
+    size_t ystride;
+    size_t cstride;
+    size_t chroma_step;
+    uint32_t reserved[8];
+};
+#endif
+
 typedef enum
 {
 	MALI_YUV_NO_INFO,
@@ -54,6 +81,7 @@ struct private_handle_t {
          PRIV_FLAGS_FRAMEBUFFER = 0x00000001,
          PRIV_FLAGS_USES_UMP    = 0x00000002,
          PRIV_FLAGS_USES_ION    = 0x00000004,
+         PRIV_FLAGS_DATA_OFFSET = 0x00000008, // planes go to v4l2 as share_fd at plane_offset
     };
 
     // file descriptors
@@ -72,11 +100,25 @@ struct private_handle_t {
     int stride;
     int base;
     mali_gralloc_yuv_info yuv_info;
+    // planes in memory order, offsets in the fd of the plane: share_fd when
+    // share_fd1 is -1, otherwise share_fd, share_fd1 and share_fd2
+    int plane_offset[GRALLOC_MAX_PLANES];
+    int plane_stride[GRALLOC_MAX_PLANES]; // bytes
+    int plane_size[GRALLOC_MAX_PLANES];   // 0 past the last plane
+    // gralloc_alloc() names the buffer, the same on each handle of it
+    // in any process, 0: unnamed
+    int alloc_pid;
+    int alloc_id;
 
 #ifdef __cplusplus
+    // ABI: the plane table and the buffer id grew the handle from 10 to 21
+    // ints. The magic carries the layout version so a consumer built against
+    // the old header (magic 0x3141592) rejects these handles instead of
+    // misreading them, and the other way round. Prebuilt users of private_handle_t have to be
+    // rebuilt against this header.
     static const int sNumFds  = 3;
-    static const int sNumInts = 10;
-    static const int sMagic   = 0x3141592;
+    static const int sNumInts = 12 + GRALLOC_MAX_PLANES * 3;
+    static const int sMagic   = 0x3141593;
 
     private_handle_t(
             int flags,
@@ -103,11 +145,20 @@ struct private_handle_t {
         height(height),
         stride(stride),
         base(base),
-        yuv_info(yuv_info)
+        yuv_info(yuv_info),
+        alloc_pid(0),
+        alloc_id(0)
     {
         version = sizeof(native_handle);
         numInts = sNumInts;
         numFds  = sNumFds;
+        // one plane, stride is in bytes for rgb and the framebuffer,
+        // gralloc fills the table of yuv formats
+        for (int i = 0; i < GRALLOC_MAX_PLANES; i++) {
+            plane_offset[i] = 0;
+            plane_stride[i] = i ? 0 : stride;
+            plane_size[i] = i ? 0 : size;
+        }
         if (fd1 < 0) {
             numInts++;
             numFds--;
@@ -134,6 +185,27 @@ struct private_handle_t {
         return 0;
     }
 
+    int planeNum() const {
+        int n = 0;
+        while (n < GRALLOC_MAX_PLANES && plane_size[n])
+            n++;
+        return n;
+    }
+
+    /* the fd plane i lives in */
+    int planeFd(int i) const {
+        if (i == 0 || share_fd1 < 0)
+            return share_fd;
+        return i == 1 ? share_fd1 : share_fd2;
+    }
+
+    /* for the mapping cache, 0 for an unnamed buffer */
+    uint64_t bufferId() const {
+        if (!alloc_id)
+            return 0;
+        return ((uint64_t)(uint32_t)alloc_pid << 32) | (uint32_t)alloc_id;
+    }
+
     static private_handle_t *dynamicCast(const native_handle *in) {
          if (0 == validate(in))
              return (private_handle_t *)in;
@@ -1,11 +1,55 @@
 #ifndef _LIBNXJPEGHW_H
 #define _LIBNXJPEGHW_H
 
+#include <stdint.h>
+
+#define NX_JPEGHW_DEFAULT_QUALITY   100
+#define NX_JPEGHW_MAX_HEADER_SIZE   4096
+
+/**
+ * one shot encode, opens and closes the encoder instance
+ * return jpeg Size
+ */
 int NX_JpegHWEncoding(void *dstVirt, int dstSize,
         int width, int height, unsigned int fourcc,
-        unsigned int yPhy, unsigned int yVirt, unsigned int yStride,
-        unsigned int cbPhy, unsigned int cbVirt, unsigned int cbStride,
-        unsigned int crPhy, unsigned int crVirt, unsigned int crStride,
+        unsigned int yPhy, uintptr_t yVirt, unsigned int yStride,
+        unsigned int cbPhy, uintptr_t cbVirt, unsigned int cbStride,
+        unsigned int crPhy, uintptr_t crVirt, unsigned int crStride,
         bool copySOI = true);
 
+/**
+ * encoder session, keeps one encoder instance open for back to back encodes
+ * open() is cheap when width, height and quality didn't change
+ */
+class NXJpegHWEncoder
+{
+public:
+    NXJpegHWEncoder();
+    ~NXJpegHWEncoder();
+
+    int open(int width, int height, int quality = NX_JPEGHW_DEFAULT_QUALITY);
+    void close();
+    bool isOpen() const {
+        return Handle != NULL;
+    }
+
+    /**
+     * encodes one frame at the opened size into dstVirt
+     * without SOI the output continues an exif blob that already has one
+     * return jpeg Size, negative errno on failure
+     */
+    int encode(void *dstVirt, int dstSize, unsigned int fourcc,
+            unsigned int yPhy, uintptr_t yVirt, unsigned int yStride,
+            unsigned int cbPhy, uintptr_t cbVirt, unsigned int cbStride,
+            unsigned int crPhy, uintptr_t crVirt, unsigned int crStride,
+            bool copySOI = true);
+
+private:
+    void *Handle;
+    int Width;
+    int Height;
+    int Quality;
+    unsigned char Header[NX_JPEGHW_MAX_HEADER_SIZE]; // for headers without SOI
+};
+
 #endif
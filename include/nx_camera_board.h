@@ -1,24 +1,90 @@
 #ifndef _NX_CAMERA_BOARD_H
 #define _NX_CAMERA_BOARD_H
 
+#include <pthread.h>
 #include <nxp-v4l2.h>
+#include <utils/Mutex.h>
 #include <hardware/camera2.h>
 #include <camera/Camera.h>
 #include <camera/CameraParameters.h>
 
 namespace android {
 
+// v4l2 controls the setters changed for one request
+struct NXSensorControlSet {
+    enum {
+        MAX_CONTROLS = 16 // MAX_EXT_CTRLS of libv4l2-nexell
+    };
+
+    NXSensorControlSet()
+        : Count(0) {
+    }
+
+    void clear() {
+        Count = 0;
+    }
+
+    // a control set twice keeps the last value
+    bool add(int id, int value) {
+        for (int i = 0; i < Count; i++) {
+            if (Ids[i] == id) {
+                Values[i] = value;
+                return true;
+            }
+        }
+        if (Count >= MAX_CONTROLS)
+            return false;
+        Ids[Count] = id;
+        Values[Count] = value;
+        Count++;
+        return true;
+    }
+
+    void merge(const NXSensorControlSet &set) {
+        for (int i = 0; i < set.Count; i++)
+            add(set.Ids[i], set.Values[i]);
+    }
+
+    int Count;
+    int Ids[MAX_CONTROLS];
+    int Values[MAX_CONTROLS];
+};
+
 class NXCameraBoardSensor {
 public:
-    NXCameraBoardSensor() {
+    NXCameraBoardSensor()
+        : Batching(false) {
     }
     NXCameraBoardSensor(uint32_t v4l2ID)
-        : V4l2ID(v4l2ID) {
+        : V4l2ID(v4l2ID),
+          Batching(false) {
 
     }
     virtual ~NXCameraBoardSensor() {
     }
 
+    // between beginControls() and endControls() the setters the calling
+    // thread makes collect their controls instead of writing them, the ones
+    // of other threads still write at once. applyControls() writes a set in
+    // one go
+    void beginControls() {
+        Mutex::Autolock l(ControlLock);
+        Controls.clear();
+        BatchThread = pthread_self();
+        Batching = true;
+    }
+    void endControls(NXSensorControlSet &set) {
+        Mutex::Autolock l(ControlLock);
+        set = Controls;
+        Controls.clear();
+        Batching = false;
+    }
+    virtual int applyControls(const NXSensorControlSet &set) {
+        if (set.Count == 0)
+            return 0;
+        return v4l2_set_ctrls(V4l2ID, set.Ids, set.Values, set.Count);
+    }
+
 public:
     virtual void setAfMode(uint8_t afMode) = 0;
     virtual void afEnable(bool enable) = 0;
@@ -33,9 +99,25 @@ public:
         return v4l2_set_format(V4l2ID, width, height, format);
     }
 
+protected:
+    int setCtrl(int ctrlId, int value) {
+        {
+            Mutex::Autolock l(ControlLock);
+            if (Batching && pthread_equal(BatchThread, pthread_self()) && Controls.add(ctrlId, value))
+                return 0;
+        }
+        return v4l2_set_ctrl(V4l2ID, ctrlId, value);
+    }
+
 protected:
     uint32_t V4l2ID;
 
+private:
+    Mutex ControlLock;
+    bool Batching;
+    pthread_t BatchThread;
+    NXSensorControlSet Controls;
+
 public:
     int32_t Width;
     int32_t Height;
@@ -105,6 +105,8 @@ int v4l2_set_crop_with_pad(int id, int pad, int l, int t, int w, int h);
 int v4l2_get_crop_with_pad(int id, int pad, int *l, int *t, int *w, int *h);
 int v4l2_set_ctrl(int id, int ctrl_id, int value);
 int v4l2_get_ctrl(int id, int ctrl_id, int *value);
+/* up to 16 controls in one VIDIOC_S_EXT_CTRLS, one by one if the driver has no ext ctrls */
+int v4l2_set_ctrls(int id, const int *ctrl_ids, const int *values, int count);
 int v4l2_reqbuf(int id, int buf_count);
 #ifdef ANDROID
 //int v4l2_qbuf(int id, int plane_num, int index0, struct private_handle_t *b0, int index1, struct private_handle_t *b1);
@@ -113,6 +115,8 @@ int v4l2_qbuf(int id, int plane_num, int index0, struct private_handle_t const *
 #endif
 int v4l2_qbuf(int id, int plane_num, int index0, struct nxp_vid_buffer *b0, int index1, struct nxp_vid_buffer *b1);
 int v4l2_dqbuf(int id, int plane_num, int *index0, int *index1);
+/* v4l2_dqbuf() of a capture device, also returns the driver timestamp of the buffer in ns */
+int v4l2_dqbuf_timestamp(int id, int plane_num, int *index0, long long *timestamp);
 int v4l2_streamon(int id);
 int v4l2_streamoff(int id);
 int v4l2_get_timestamp(int id, long long *timestamp);
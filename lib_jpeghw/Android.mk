@@ -17,3 +17,15 @@ LOCAL_MODULE := libNX_Jpeghw
 LOCAL_MODULE_TAGS := optional
 
 include $(BUILD_SHARED_LIBRARY)
+
+# for test
+include $(CLEAR_VARS)
+LOCAL_SRC_FILES := NXJpegHWEnc.cpp \
+	test/bench-jpeghw.cpp
+LOCAL_C_INCLUDES += \
+	$(LOCAL_PATH)/../include
+LOCAL_CFLAGS += -DNX_JPEGHW_STUB
+LOCAL_STATIC_LIBRARIES := liblog libcutils
+LOCAL_MODULE := bench_jpeghw
+LOCAL_MODULE_TAGS := optional
+include $(BUILD_HOST_EXECUTABLE)
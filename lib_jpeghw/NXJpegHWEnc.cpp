@@ -1,79 +1,293 @@
 #define LOG_TAG "NXJpegHW"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <errno.h>
 
 #include <utils/Log.h>
 
+#ifndef NX_JPEGHW_STUB
 #include <nx_fourcc.h>
 #include <nx_video_api.h>
+#endif
 #include <libnxjpeghw.h>
 
-/**
- * return jpeg Size
+struct NXJpegHWImage {
+    unsigned int fourcc;
+    int width;
+    int height;
+    unsigned int yPhy;
+    uintptr_t yVirt;
+    unsigned int yStride;
+    unsigned int cbPhy;
+    uintptr_t cbVirt;
+    unsigned int cbStride;
+    unsigned int crPhy;
+    uintptr_t crVirt;
+    unsigned int crStride;
+};
+
+#ifndef NX_JPEGHW_STUB
+/*
+ * vpu backend
  */
-int NX_JpegHWEncoding(void *dstVirt, int dstSize,
-        int width, int height, unsigned int fourcc,
-        unsigned int yPhy, unsigned int yVirt, unsigned int yStride,
-        unsigned int cbPhy, unsigned int cbVirt, unsigned int cbStride,
-        unsigned int crPhy, unsigned int crVirt, unsigned int crStride,
-        bool copySOI)
+static void *backendOpen(int width, int height, int quality)
 {
-    NX_VID_ENC_HANDLE hEnc;
-    NX_VID_ENC_OUT encOut;
-    NX_VID_MEMORY_INFO memInfo;
     NX_VID_ENC_INIT_PARAM encInitParam;
-    int ret = 0;
 
-    unsigned char *dst = (unsigned char *)dstVirt;
-    unsigned char *jpegHeader = (unsigned char *)dst;
-
-    memset(&memInfo, 0, sizeof(NX_VID_MEMORY_INFO));
-    memInfo.fourCC = fourcc;
-    memInfo.imgWidth = width;
-    memInfo.imgHeight = height;
-    memInfo.luPhyAddr = yPhy;
-    memInfo.luVirAddr = yVirt;
-    memInfo.luStride = yStride;
-    memInfo.cbPhyAddr = cbPhy;
-    memInfo.cbVirAddr = cbVirt;
-    memInfo.cbStride = cbStride;
-    memInfo.crPhyAddr = crPhy;
-    memInfo.crVirAddr = crVirt;
-    memInfo.crStride = crStride;
-
-    memset( &encInitParam, 0, sizeof(encInitParam) );
+    memset(&encInitParam, 0, sizeof(encInitParam));
     encInitParam.width = width;
     encInitParam.height = height;
     encInitParam.rotAngle = 0;
     encInitParam.mirDirection = 0;
-    encInitParam.jpgQuality = 100;
+    encInitParam.jpgQuality = quality;
 
-    hEnc = NX_VidEncOpen(NX_JPEG_ENC, NULL);
+    NX_VID_ENC_HANDLE hEnc = NX_VidEncOpen(NX_JPEG_ENC, NULL);
+    if (!hEnc) {
+        ALOGE("NX_VidEncOpen failed!!!");
+        return NULL;
+    }
     if (NX_VidEncInit(hEnc, &encInitParam) != 0) {
         ALOGE("NX_VidEncInit failed!!!");
+        NX_VidEncClose(hEnc);
+        return NULL;
+    }
+    return hEnc;
+}
+
+static void backendClose(void *handle)
+{
+    NX_VidEncClose((NX_VID_ENC_HANDLE)handle);
+}
+
+static int backendGetHeader(void *handle, unsigned char *header)
+{
+    int size = 0;
+    NX_VidEncJpegGetHeader((NX_VID_ENC_HANDLE)handle, header, &size);
+    return size;
+}
+
+static int backendRunFrame(void *handle, const NXJpegHWImage *image, unsigned char **bitstream)
+{
+    NX_VID_MEMORY_INFO memInfo;
+    NX_VID_ENC_OUT encOut;
+
+    memset(&memInfo, 0, sizeof(NX_VID_MEMORY_INFO));
+    memInfo.fourCC = image->fourcc;
+    memInfo.imgWidth = image->width;
+    memInfo.imgHeight = image->height;
+    memInfo.luPhyAddr = image->yPhy;
+    memInfo.luVirAddr = image->yVirt;
+    memInfo.luStride = image->yStride;
+    memInfo.cbPhyAddr = image->cbPhy;
+    memInfo.cbVirAddr = image->cbVirt;
+    memInfo.cbStride = image->cbStride;
+    memInfo.crPhyAddr = image->crPhy;
+    memInfo.crVirAddr = image->crVirt;
+    memInfo.crStride = image->crStride;
+
+    memset(&encOut, 0, sizeof(encOut));
+    if (NX_VidEncJpegRunFrame((NX_VID_ENC_HANDLE)handle, &memInfo, &encOut) != 0) {
+        ALOGE("NX_VidEncJpegRunFrame failed!!!");
         return -EIO;
     }
+    *bitstream = (unsigned char *)encOut.outBuf;
+    return encOut.bufSize;
+}
+#else
+/*
+ * stub backend for host benchmarks, reads the whole image and produces
+ * a bitstream of a plausible size, the output is not a decodable jpeg
+ */
+struct StubEncoder {
+    int width;
+    int height;
+    int quality;
+    unsigned char *bitstream;
+};
+
+#define STUB_HEADER_SIZE    623
+
+static void *backendOpen(int width, int height, int quality)
+{
+    StubEncoder *enc = (StubEncoder *)malloc(sizeof(StubEncoder));
+    if (!enc)
+        return NULL;
+    enc->width = width;
+    enc->height = height;
+    enc->quality = quality;
+    enc->bitstream = (unsigned char *)malloc(width * height * 3 / 2);
+    if (!enc->bitstream) {
+        free(enc);
+        return NULL;
+    }
+    return enc;
+}
+
+static void backendClose(void *handle)
+{
+    StubEncoder *enc = (StubEncoder *)handle;
+    free(enc->bitstream);
+    free(enc);
+}
 
+static int backendGetHeader(void *handle, unsigned char *header)
+{
+    StubEncoder *enc = (StubEncoder *)handle;
+    memset(header, enc->quality, STUB_HEADER_SIZE);
+    header[0] = 0xff;
+    header[1] = 0xd8;
+    return STUB_HEADER_SIZE;
+}
+
+static int backendRunFrame(void *handle, const NXJpegHWImage *image, unsigned char **bitstream)
+{
+    StubEncoder *enc = (StubEncoder *)handle;
+    // roughly 1 to 3 bits per pixel depending on quality
+    int size = enc->width * enc->height * (8 + enc->quality * 16 / 100) / 64;
+    const unsigned char *planes[3] = {
+        (const unsigned char *)image->yVirt,
+        (const unsigned char *)image->cbVirt,
+        (const unsigned char *)image->crVirt
+    };
+    unsigned int strides[3] = { image->yStride, image->cbStride, image->crStride };
+    unsigned int sum = 0;
+    int pos = 0;
+
+    for (int p = 0; p < 3; p++) {
+        int w = p ? enc->width >> 1 : enc->width;
+        int h = p ? enc->height >> 1 : enc->height;
+        for (int y = 0; y < h; y++) {
+            const unsigned char *line = planes[p] + y * strides[p];
+            for (int x = 0; x < w; x++)
+                sum = sum * 31 + line[x];
+            enc->bitstream[pos] = (unsigned char)sum;
+            pos = (pos + 1) % (size - 2);
+        }
+    }
+    enc->bitstream[size - 2] = 0xff;
+    enc->bitstream[size - 1] = 0xd9;
+    *bitstream = enc->bitstream;
+    return size;
+}
+#endif
+
+NXJpegHWEncoder::NXJpegHWEncoder()
+    : Handle(NULL),
+      Width(0),
+      Height(0),
+      Quality(0)
+{
+}
+
+NXJpegHWEncoder::~NXJpegHWEncoder()
+{
+    close();
+}
+
+int NXJpegHWEncoder::open(int width, int height, int quality)
+{
+    if (quality <= 0 || quality > 100)
+        quality = NX_JPEGHW_DEFAULT_QUALITY;
+
+    if (Handle && width == Width && height == Height && quality == Quality)
+        return 0;
+
+    close();
+    Handle = backendOpen(width, height, quality);
+    if (!Handle)
+        return -EIO;
+
+    Width = width;
+    Height = height;
+    Quality = quality;
+    ALOGV("open %dx%d, quality %d", width, height, quality);
+    return 0;
+}
+
+void NXJpegHWEncoder::close()
+{
+    if (Handle) {
+        backendClose(Handle);
+        Handle = NULL;
+    }
+}
+
+int NXJpegHWEncoder::encode(void *dstVirt, int dstSize, unsigned int fourcc,
+        unsigned int yPhy, uintptr_t yVirt, unsigned int yStride,
+        unsigned int cbPhy, uintptr_t cbVirt, unsigned int cbStride,
+        unsigned int crPhy, uintptr_t crVirt, unsigned int crStride,
+        bool copySOI)
+{
+    if (!Handle) {
+        ALOGE("encode: not opened");
+        return -EINVAL;
+    }
+
+    unsigned char *dst = (unsigned char *)dstVirt;
     int size;
-    NX_VidEncJpegGetHeader(hEnc, jpegHeader, &size);
+
+    // with SOI the header goes straight to the output, otherwise it is copied without it
+    if (copySOI) {
+        if (dstSize < NX_JPEGHW_MAX_HEADER_SIZE) {
+            ALOGE("encode: dst size %d too small", dstSize);
+            return -ENOSPC;
+        }
+        size = backendGetHeader(Handle, dst);
+    } else {
+        size = backendGetHeader(Handle, Header);
+        if (size > 2) {
+            size -= 2;
+            if (size > dstSize) {
+                ALOGE("encode: dst size %d too small for header %d", dstSize, size);
+                return -ENOSPC;
+            }
+            memcpy(dst, Header + 2, size);
+        }
+    }
     if (size <= 0) {
         ALOGE("Invalid JPEG Header Size %d", size);
         return -EINVAL;
     }
-    if (!copySOI) {
-        memcpy(jpegHeader, jpegHeader + 2, size - 2);
-        size -= 2;
+
+    NXJpegHWImage image = {
+        fourcc, Width, Height,
+        yPhy, yVirt, yStride,
+        cbPhy, cbVirt, cbStride,
+        crPhy, crVirt, crStride
+    };
+    unsigned char *bitstream = NULL;
+    int bitstreamSize = backendRunFrame(Handle, &image, &bitstream);
+    if (bitstreamSize <= 0)
+        return bitstreamSize < 0 ? bitstreamSize : -EIO;
+    if (size + bitstreamSize > dstSize) {
+        ALOGE("encode: dst size %d too small for %d", dstSize, size + bitstreamSize);
+        return -ENOSPC;
     }
-    dst += size;
-    ret = size;
+    memcpy(dst + size, bitstream, bitstreamSize);
 
-    NX_VidEncJpegRunFrame(hEnc, &memInfo, &encOut);
-    memcpy(dst, encOut.outBuf, encOut.bufSize);
-    ret += encOut.bufSize;
+    return size + bitstreamSize;
+}
+
+/**
+ * return jpeg Size
+ */
+int NX_JpegHWEncoding(void *dstVirt, int dstSize,
+        int width, int height, unsigned int fourcc,
+        unsigned int yPhy, uintptr_t yVirt, unsigned int yStride,
+        unsigned int cbPhy, uintptr_t cbVirt, unsigned int cbStride,
+        unsigned int crPhy, uintptr_t crVirt, unsigned int crStride,
+        bool copySOI)
+{
+    NXJpegHWEncoder encoder;
 
-    NX_VidEncClose(hEnc);
+    int ret = encoder.open(width, height, NX_JPEGHW_DEFAULT_QUALITY);
+    if (ret < 0)
+        return ret;
 
-    return ret;
+    return encoder.encode(dstVirt, dstSize, fourcc,
+            yPhy, yVirt, yStride,
+            cbPhy, cbVirt, cbStride,
+            crPhy, crVirt, crStride,
+            copySOI);
 }
-
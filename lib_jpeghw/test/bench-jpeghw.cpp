@@ -0,0 +1,110 @@
+/*
+ * jpeg hw encoder benchmark
+ *
+ * Built on the host against the stub backend (NX_JPEGHW_STUB) it measures the
+ * per frame cost of the library itself: one shot NX_JpegHWEncoding() against a
+ * NXJpegHWEncoder session reused for a burst.
+ *
+ * usage: bench_jpeghw [width height [frames [quality]]]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <libnxjpeghw.h>
+
+#define FOURCC_MVS0 0x3053564D /* 'M','V','S','0' */
+
+static double nowMs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+int main(int argc, char *argv[])
+{
+    int width = 1920;
+    int height = 1080;
+    int frames = 30;
+    int quality = 90;
+
+    if (argc > 2) {
+        width = atoi(argv[1]);
+        height = atoi(argv[2]);
+    }
+    if (argc > 3)
+        frames = atoi(argv[3]);
+    if (argc > 4)
+        quality = atoi(argv[4]);
+
+    int ySize = width * height;
+    int cSize = ySize / 4;
+    unsigned char *image = (unsigned char *)malloc(ySize + cSize * 2);
+    int dstSize = ySize * 2;
+    unsigned char *dst = (unsigned char *)malloc(dstSize);
+    unsigned char *dstNoSOI = (unsigned char *)malloc(dstSize);
+    if (!image || !dst || !dstNoSOI) {
+        printf("out of memory\n");
+        return 1;
+    }
+    for (int i = 0; i < ySize + cSize * 2; i++)
+        image[i] = (unsigned char)(i * 7);
+
+    uintptr_t y = (uintptr_t)image;
+    uintptr_t cb = (uintptr_t)(image + ySize);
+    uintptr_t cr = (uintptr_t)(image + ySize + cSize);
+
+    printf("%dx%d, %d frames, quality %d\n", width, height, frames, quality);
+
+    double start = nowMs();
+    int size = 0;
+    for (int i = 0; i < frames; i++) {
+        size = NX_JpegHWEncoding(dst, dstSize, width, height, FOURCC_MVS0,
+                0, y, width, 0, cb, width >> 1, 0, cr, width >> 1);
+        if (size <= 0) {
+            printf("NX_JpegHWEncoding failed %d\n", size);
+            return 1;
+        }
+    }
+    double oneShot = (nowMs() - start) / frames;
+
+    NXJpegHWEncoder encoder;
+    start = nowMs();
+    for (int i = 0; i < frames; i++) {
+        if (encoder.open(width, height, quality) < 0) {
+            printf("open failed\n");
+            return 1;
+        }
+        size = encoder.encode(dst, dstSize, FOURCC_MVS0,
+                0, y, width, 0, cb, width >> 1, 0, cr, width >> 1);
+        if (size <= 0) {
+            printf("encode failed %d\n", size);
+            return 1;
+        }
+    }
+    double session = (nowMs() - start) / frames;
+
+    // the exif path: same stream without SOI
+    int sizeNoSOI = encoder.encode(dstNoSOI, dstSize, FOURCC_MVS0,
+            0, y, width, 0, cb, width >> 1, 0, cr, width >> 1, false);
+    int failed = 0;
+    if (sizeNoSOI != size - 2 || memcmp(dst + 2, dstNoSOI, sizeNoSOI)) {
+        printf("output without SOI doesn't match\n");
+        failed = 1;
+    }
+    if (encoder.encode(dst, 16, FOURCC_MVS0,
+                0, y, width, 0, cb, width >> 1, 0, cr, width >> 1) >= 0) {
+        printf("small dst not detected\n");
+        failed = 1;
+    }
+
+    printf("one shot  %8.3f ms/frame\n", oneShot);
+    printf("session   %8.3f ms/frame, jpeg %d bytes\n", session, size);
+
+    free(dstNoSOI);
+    free(dst);
+    free(image);
+    return failed;
+}
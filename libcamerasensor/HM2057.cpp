@@ -197,7 +197,7 @@ void HM2057::setEffectMode(uint8_t effectMode)
             return;
         }
 
-        v4l2_set_ctrl(V4l2ID, V4L2_CID_COLORFX, val);
+        setCtrl(V4L2_CID_COLORFX, val);
         EffectMode = effectMode;
     }
 }
@@ -217,10 +217,10 @@ void HM2057::setAwbMode(uint8_t awbMode)
 
         switch (awbMode) {
         case ANDROID_CONTROL_AWB_MODE_OFF:
-            v4l2_set_ctrl(V4l2ID, V4L2_CID_AUTO_WHITE_BALANCE, 0);
+            setCtrl(V4L2_CID_AUTO_WHITE_BALANCE, 0);
             return;
         case ANDROID_CONTROL_AWB_MODE_AUTO:
-            v4l2_set_ctrl(V4l2ID, V4L2_CID_AUTO_WHITE_BALANCE, 1);
+            setCtrl(V4L2_CID_AUTO_WHITE_BALANCE, 1);
             return;
         case ANDROID_CONTROL_AWB_MODE_DAYLIGHT:
             val = WB_DAYLIGHT;
@@ -240,7 +240,7 @@ void HM2057::setAwbMode(uint8_t awbMode)
         }
         AwbMode = awbMode;
 
-        v4l2_set_ctrl(V4l2ID, V4L2_CID_WHITE_BALANCE_TEMPERATURE, val);
+        setCtrl(V4L2_CID_WHITE_BALANCE_TEMPERATURE, val);
     }
 }
 
@@ -253,7 +253,7 @@ void HM2057::setExposure(int32_t exposure)
 
     if (exposure != Exposure) {
         Exposure = exposure;
-        v4l2_set_ctrl(V4l2ID, V4L2_CID_BRIGHTNESS, exposure);
+        setCtrl(V4L2_CID_BRIGHTNESS, exposure);
     }
 }
 
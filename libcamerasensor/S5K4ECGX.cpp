@@ -179,7 +179,7 @@ void S5K4ECGX::afEnable(bool enable)
     } else {
         val = 0; // init
     }
-    // v4l2_set_ctrl(V4l2ID, V4L2_CID_FOCUS_AUTO, val);
+    // setCtrl(V4L2_CID_FOCUS_AUTO, val);
 }
 
 void S5K4ECGX::setEffectMode(uint8_t effectMode)
@@ -208,7 +208,7 @@ void S5K4ECGX::setEffectMode(uint8_t effectMode)
     //         return;
     //     }
 
-    //     // v4l2_set_ctrl(V4l2ID, V4L2_CID_COLORFX, val);
+    //     // setCtrl(V4L2_CID_COLORFX, val);
     //     EffectMode = effectMode;
     // }
 }
@@ -240,7 +240,7 @@ void S5K4ECGX::setSceneMode(uint8_t sceneMode)
     //     }
     //     SceneMode = sceneMode;
 
-    //     // v4l2_set_ctrl(V4l2ID, V4L2_CID_CAMERA_SCENE_MODE, val);
+    //     // setCtrl(V4L2_CID_CAMERA_SCENE_MODE, val);
     // }
 }
 
@@ -265,7 +265,7 @@ void S5K4ECGX::setAntibandingMode(uint8_t antibandingMode)
     //     }
     //     AntibandingMode = antibandingMode;
 
-    //     // v4l2_set_ctrl(V4l2ID, V4L2_CID_CAMERA_ANTI_SHAKE, val);
+    //     // setCtrl(V4L2_CID_CAMERA_ANTI_SHAKE, val);
     // }
 }
 
@@ -299,7 +299,7 @@ void S5K4ECGX::setAwbMode(uint8_t awbMode)
     //     }
     //     AwbMode = awbMode;
 
-    //     // v4l2_set_ctrl(V4l2ID, V4L2_CID_DO_WHITE_BALANCE, val);
+    //     // setCtrl(V4L2_CID_DO_WHITE_BALANCE, val);
     // }
 }
 
@@ -315,7 +315,7 @@ void S5K4ECGX::setExposure(int32_t exposure)
 
     if (exposure != Exposure) {
         Exposure = exposure;
-        // v4l2_set_ctrl(V4l2ID, V4L2_CID_EXPOSURE, exposure);
+        // setCtrl(V4L2_CID_EXPOSURE, exposure);
     }
 }
 
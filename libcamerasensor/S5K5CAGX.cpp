@@ -189,7 +189,7 @@ void S5K5CAGX::afEnable(bool enable)
     } else {
         val = 0; // init
     }
-    v4l2_set_ctrl(V4l2ID, V4L2_CID_FOCUS_AUTO, val);
+    setCtrl(V4L2_CID_FOCUS_AUTO, val);
 }
 
 void S5K5CAGX::setEffectMode(uint8_t effectMode)
@@ -218,7 +218,7 @@ void S5K5CAGX::setEffectMode(uint8_t effectMode)
             return;
         }
 
-        v4l2_set_ctrl(V4l2ID, V4L2_CID_COLORFX, val);
+        setCtrl(V4L2_CID_COLORFX, val);
         EffectMode = effectMode;
     }
 }
@@ -250,7 +250,7 @@ void S5K5CAGX::setSceneMode(uint8_t sceneMode)
         }
         SceneMode = sceneMode;
 
-        v4l2_set_ctrl(V4l2ID, V4L2_CID_CAMERA_SCENE_MODE, val);
+        setCtrl(V4L2_CID_CAMERA_SCENE_MODE, val);
     }
 }
 
@@ -275,7 +275,7 @@ void S5K5CAGX::setAntibandingMode(uint8_t antibandingMode)
         }
         AntibandingMode = antibandingMode;
 
-        v4l2_set_ctrl(V4l2ID, V4L2_CID_CAMERA_ANTI_SHAKE, val);
+        setCtrl(V4L2_CID_CAMERA_ANTI_SHAKE, val);
     }
 }
 
@@ -309,7 +309,7 @@ void S5K5CAGX::setAwbMode(uint8_t awbMode)
         }
         AwbMode = awbMode;
 
-        v4l2_set_ctrl(V4l2ID, V4L2_CID_DO_WHITE_BALANCE, val);
+        setCtrl(V4L2_CID_DO_WHITE_BALANCE, val);
     }
 }
 
@@ -325,7 +325,7 @@ void S5K5CAGX::setExposure(int32_t exposure)
 
     if (exposure != Exposure) {
         Exposure = exposure;
-        v4l2_set_ctrl(V4l2ID, V4L2_CID_EXPOSURE, exposure);
+        setCtrl(V4L2_CID_EXPOSURE, exposure);
     }
 }
 
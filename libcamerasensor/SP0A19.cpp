@@ -198,7 +198,7 @@ void SP0A19::setEffectMode(uint8_t effectMode)
             return;
         }
 
-        v4l2_set_ctrl(V4l2ID, V4L2_CID_EFFECT, val);
+        setCtrl(V4L2_CID_EFFECT, val);
         EffectMode = effectMode;
     }
 }
@@ -214,7 +214,7 @@ void SP0A19::setSceneMode(uint8_t sceneMode)
             val = 0;
         }
 
-        v4l2_set_ctrl(V4l2ID, V4L2_CID_SCENE, val);
+        setCtrl(V4L2_CID_SCENE, val);
         SceneMode = sceneMode;
     }
 }
@@ -253,7 +253,7 @@ void SP0A19::setAwbMode(uint8_t awbMode)
         }
         AwbMode = awbMode;
 
-        v4l2_set_ctrl(V4l2ID, V4L2_CID_DO_WHITE_BALANCE, val);
+        setCtrl(V4L2_CID_DO_WHITE_BALANCE, val);
     }
 }
 
@@ -266,7 +266,7 @@ void SP0A19::setExposure(int32_t exposure)
 
     if (exposure != Exposure) {
         Exposure = exposure;
-        v4l2_set_ctrl(V4l2ID, V4L2_CID_EXPOSURE, exposure);
+        setCtrl(V4L2_CID_EXPOSURE, exposure);
     }
 }
 
@@ -196,7 +196,7 @@ void SP2518::setEffectMode(uint8_t effectMode)
             return;
         }
 
-        v4l2_set_ctrl(V4l2ID, V4L2_CID_COLORFX, val);
+        setCtrl(V4L2_CID_COLORFX, val);
         EffectMode = effectMode;
     }
 }
@@ -216,10 +216,10 @@ void SP2518::setAwbMode(uint8_t awbMode)
 
         switch (awbMode) {
         case ANDROID_CONTROL_AWB_MODE_OFF:
-            v4l2_set_ctrl(V4l2ID, V4L2_CID_AUTO_WHITE_BALANCE, 0);
+            setCtrl(V4L2_CID_AUTO_WHITE_BALANCE, 0);
             return;
         case ANDROID_CONTROL_AWB_MODE_AUTO:
-            v4l2_set_ctrl(V4l2ID, V4L2_CID_AUTO_WHITE_BALANCE, 1);
+            setCtrl(V4L2_CID_AUTO_WHITE_BALANCE, 1);
             return;
         case ANDROID_CONTROL_AWB_MODE_DAYLIGHT:
             val = WB_DAYLIGHT;
@@ -239,7 +239,7 @@ void SP2518::setAwbMode(uint8_t awbMode)
         }
         AwbMode = awbMode;
 
-        v4l2_set_ctrl(V4l2ID, V4L2_CID_WHITE_BALANCE_TEMPERATURE, val);
+        setCtrl(V4L2_CID_WHITE_BALANCE_TEMPERATURE, val);
     }
 }
 
@@ -252,7 +252,7 @@ void SP2518::setExposure(int32_t exposure)
 
     if (exposure != Exposure) {
         Exposure = exposure;
-        v4l2_set_ctrl(V4l2ID, V4L2_CID_BRIGHTNESS, exposure + 3);
+        setCtrl(V4L2_CID_BRIGHTNESS, exposure + 3);
     }
 }
 
@@ -0,0 +1,203 @@
+/*
+ * Copyright (C) 2008 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <fcntl.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <cutils/log.h>
+
+#include "SysfsAttributes.h"
+
+/*****************************************************************************/
+
+SysfsAttributes::SysfsAttributes(size_t maxAttributes)
+    : mAttributes(new Attribute[maxAttributes]),
+      mMaxAttributes(maxAttributes),
+      mNumAttributes(0),
+      mRoot(NULL),
+      mGuard(NULL),
+      mGuardDropped(false)
+{
+    memset(&mStats, 0, sizeof(mStats));
+}
+
+SysfsAttributes::~SysfsAttributes()
+{
+    closeAll();
+    free(mRoot);
+    free(mGuard);
+    delete [] mAttributes;
+}
+
+void SysfsAttributes::closeAll()
+{
+    for (size_t i = 0; i < mNumAttributes; i++) {
+        if (mAttributes[i].fd >= 0) {
+            close(mAttributes[i].fd);
+        }
+        free(mAttributes[i].name);
+    }
+    mNumAttributes = 0;
+}
+
+void SysfsAttributes::setRoot(const char* root)
+{
+    closeAll();
+    free(mRoot);
+    mRoot = root ? strdup(root) : NULL;
+}
+
+SysfsAttributes::Attribute* SysfsAttributes::lookup(const char* name)
+{
+    for (size_t i = 0; i < mNumAttributes; i++) {
+        if (!strcmp(mAttributes[i].name, name)) {
+            return &mAttributes[i];
+        }
+    }
+    if (mNumAttributes == mMaxAttributes) {
+        // out of slots, written the slow way
+        return NULL;
+    }
+
+    Attribute* attr = &mAttributes[mNumAttributes];
+    attr->name = strdup(name);
+    if (attr->name == NULL) {
+        return NULL;
+    }
+    attr->fd = -1;
+    attr->valid = false;
+    attr->len = 0;
+    mNumAttributes++;
+    return attr;
+}
+
+int SysfsAttributes::store(const char* name, Attribute* attr, const char* buf, size_t len)
+{
+    char path[PATH_MAX];
+    int fd = attr ? attr->fd : -1;
+
+    if (fd < 0) {
+        snprintf(path, sizeof(path), "%s%s", mRoot ? mRoot : "", name);
+        fd = open(path, O_WRONLY);
+        if (fd < 0) {
+            int err = errno;
+            mStats.errors++;
+            ALOGE("couldn't open %s (%s)", path, strerror(err));
+            return -err;
+        }
+        mStats.opens++;
+        if (attr) {
+            attr->fd = fd;
+        }
+    }
+
+    // sysfs ignores the file position, pwrite() just saves the lseek()
+    ssize_t nb = pwrite(fd, buf, len, 0);
+    int err = nb < 0 ? errno : 0;
+
+    if (attr == NULL) {
+        close(fd);
+    } else if (err || len > sizeof(attr->value)) {
+        // unknown state, write it again next time
+        attr->valid = false;
+    } else {
+        memcpy(attr->value, buf, len);
+        attr->len = len;
+        attr->valid = true;
+    }
+
+    if (err) {
+        mStats.errors++;
+        ALOGE("write to %s%s failed (%s)", mRoot ? mRoot : "", name, strerror(err));
+        return -err;
+    }
+    mStats.writes++;
+    return 0;
+}
+
+int SysfsAttributes::write(const char* name, const char* buf, size_t len)
+{
+    Attribute* attr = lookup(name);
+
+    if (attr && attr->valid && attr->len == len && !memcmp(attr->value, buf, len)) {
+        mStats.skipped++;
+        return 0;
+    }
+
+    if (mGuard && strcmp(name, mGuard)) {
+        int err = dropGuard();
+        if (err < 0) {
+            return err;
+        }
+    }
+
+    return store(name, attr, buf, len);
+}
+
+int SysfsAttributes::writeInt(const char* name, long long value)
+{
+    char buf[24];
+    int len = snprintf(buf, sizeof(buf), "%lld\n", value);
+    return write(name, buf, len);
+}
+
+void SysfsAttributes::begin(const char* guard)
+{
+    free(mGuard);
+    mGuard = guard ? strdup(guard) : NULL;
+    mGuardDropped = false;
+}
+
+/*
+ * Take the guard down now. Needed before writing guarded attributes behind
+ * the cache's back.
+ */
+int SysfsAttributes::dropGuard()
+{
+    if (mGuard == NULL || mGuardDropped) {
+        return 0;
+    }
+    mGuardDropped = true;
+    return write(mGuard, "0\n", 2);
+}
+
+int SysfsAttributes::commit(long long guardValue)
+{
+    char* guard = mGuard;
+
+    mGuard = NULL;
+    mGuardDropped = false;
+    if (guard == NULL) {
+        return 0;
+    }
+
+    // skipped when nothing changed and the guard keeps its value
+    int err = writeInt(guard, guardValue);
+    free(guard);
+    return err;
+}
+
+void SysfsAttributes::invalidate()
+{
+    for (size_t i = 0; i < mNumAttributes; i++) {
+        mAttributes[i].valid = false;
+    }
+}
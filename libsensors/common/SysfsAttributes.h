@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2008 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_SYSFS_ATTRIBUTES_H
+#define ANDROID_SYSFS_ATTRIBUTES_H
+
+#include <stdint.h>
+#include <errno.h>
+#include <sys/cdefs.h>
+#include <sys/types.h>
+
+/*****************************************************************************/
+
+/*
+ * Write-through cache of sysfs attributes.
+ *
+ * Attribute files are opened on first use and kept open, later writes go
+ * out with a single pwrite(). The last value written to each attribute is
+ * remembered and writing the same value again is skipped.
+ *
+ * Dependent writes can be grouped in a transaction guarded by a master
+ * enable attribute: begin() only notes the guard, which is taken down right
+ * before the first write that actually changes something, and commit()
+ * brings it to its final value. A transaction that changes nothing costs no
+ * syscall at all.
+ *
+ * Attributes must only be written through this cache, otherwise the
+ * remembered values go stale; call invalidate() after writing behind its
+ * back.
+ */
+class SysfsAttributes
+{
+public:
+    struct Stats {
+        uint32_t opens;
+        uint32_t writes;
+        uint32_t skipped;
+        uint32_t errors;
+    };
+
+            SysfsAttributes(size_t maxAttributes = 16);
+            ~SysfsAttributes();
+
+    // directory prepended to attribute names, NULL to use full paths
+    void setRoot(const char* root);
+
+    int write(const char* name, const char* buf, size_t len);
+    int writeInt(const char* name, long long value);
+
+    void begin(const char* guard);
+    int dropGuard();
+    int commit(long long guardValue);
+
+    void invalidate();
+    const Stats& getStats() const { return mStats; }
+
+private:
+    struct Attribute {
+        char* name;
+        int fd;
+        bool valid;
+        size_t len;
+        char value[32];
+    };
+
+    Attribute* const mAttributes;
+    const size_t mMaxAttributes;
+    size_t mNumAttributes;
+    char* mRoot;
+    char* mGuard;
+    bool mGuardDropped;
+    Stats mStats;
+
+    Attribute* lookup(const char* name);
+    int store(const char* name, Attribute* attr, const char* buf, size_t len);
+    void closeAll();
+};
+
+/*****************************************************************************/
+
+#endif  // ANDROID_SYSFS_ATTRIBUTES_H
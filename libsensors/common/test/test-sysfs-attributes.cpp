@@ -0,0 +1,158 @@
+/*
+ * Runs SysfsAttributes against a temporary directory tree standing in for
+ * a sensor's sysfs attributes. Checks that fds are kept open, unchanged
+ * values are not written again, and that a guarded transaction only takes
+ * the master enable down when something actually changes.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <NXTest.h>
+
+#include "../SysfsAttributes.h"
+
+static char sRoot[64];
+
+static int createAttribute(const char* name, const char* value)
+{
+    char path[128];
+    snprintf(path, sizeof(path), "%s%s", sRoot, name);
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        return -1;
+    int ret = write(fd, value, strlen(value)) == (ssize_t)strlen(value) ? 0 : -1;
+    close(fd);
+    return ret;
+}
+
+static bool attributeIs(const char* name, const char* value, size_t len)
+{
+    char path[128];
+    char buf[32];
+    snprintf(path, sizeof(path), "%s%s", sRoot, name);
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return false;
+    ssize_t nb = read(fd, buf, sizeof(buf));
+    close(fd);
+    return nb == (ssize_t)len && !memcmp(buf, value, len);
+}
+
+static void testCache()
+{
+    SysfsAttributes attrs;
+    attrs.setRoot(sRoot);
+
+    CHECK(attrs.writeInt("delay", 20) == 0);
+    CHECK(attrs.writeInt("delay", 20) == 0);
+    CHECK(attrs.writeInt("delay", 50) == 0);
+    CHECK(attributeIs("delay", "50\n", 3));
+
+    // the generic HAL writes NUL terminated values
+    CHECK(attrs.write("enable", "1", 2) == 0);
+    CHECK(attrs.write("enable", "1", 2) == 0);
+    CHECK(attributeIs("enable", "1\0", 2));
+
+    const SysfsAttributes::Stats& stats(attrs.getStats());
+    CHECK(stats.opens == 2);
+    CHECK(stats.writes == 3);
+    CHECK(stats.skipped == 2);
+
+    // after invalidate() the same value goes out again, on the open fd
+    attrs.invalidate();
+    CHECK(attrs.writeInt("delay", 50) == 0);
+    CHECK(stats.writes == 4);
+    CHECK(stats.opens == 2);
+
+    // missing attributes report the error and are not cached as written
+    CHECK(attrs.writeInt("missing", 1) == -ENOENT);
+    CHECK(attrs.writeInt("missing", 1) == -ENOENT);
+    CHECK(stats.errors == 2);
+}
+
+static void testTransaction()
+{
+    SysfsAttributes attrs;
+    attrs.setRoot(sRoot);
+
+    CHECK(attrs.writeInt("master_enable", 1) == 0);
+    CHECK(attrs.writeInt("accel_rate", 100) == 0);
+    CHECK(attrs.writeInt("accel_fifo_enable", 1) == 0);
+    const SysfsAttributes::Stats& stats(attrs.getStats());
+    uint32_t writes = stats.writes;
+
+    // nothing changes: not even the master enable is touched
+    attrs.begin("master_enable");
+    CHECK(attrs.writeInt("accel_rate", 100) == 0);
+    CHECK(attrs.writeInt("accel_fifo_enable", 1) == 0);
+    CHECK(attrs.commit(1) == 0);
+    CHECK(stats.writes == writes);
+    CHECK(attributeIs("master_enable", "1\n", 2));
+
+    // a rate change takes the master enable down first, then back up
+    attrs.begin("master_enable");
+    CHECK(attrs.writeInt("accel_fifo_enable", 1) == 0);
+    CHECK(attributeIs("master_enable", "1\n", 2));
+    CHECK(attrs.writeInt("accel_rate", 200) == 0);
+    CHECK(attributeIs("master_enable", "0\n", 2));
+    CHECK(attributeIs("accel_rate", "200\n", 4));
+    CHECK(attrs.commit(1) == 0);
+    CHECK(attributeIs("master_enable", "1\n", 2));
+    CHECK(stats.writes == writes + 3);
+
+    // turning everything off leaves the master enable down
+    attrs.begin("master_enable");
+    CHECK(attrs.writeInt("accel_fifo_enable", 0) == 0);
+    CHECK(attrs.commit(0) == 0);
+    CHECK(attributeIs("master_enable", "0\n", 2));
+    CHECK(attributeIs("accel_fifo_enable", "0\n", 2));
+    writes = stats.writes;
+
+    // guard already down: dropping it again costs nothing
+    attrs.begin("master_enable");
+    CHECK(attrs.dropGuard() == 0);
+    CHECK(attrs.writeInt("accel_rate", 100) == 0);
+    CHECK(attrs.commit(0) == 0);
+    CHECK(stats.writes == writes + 1);
+}
+
+int main(int argc, char *argv[])
+{
+    char tmpl[] = "/data/local/tmp/sysfsXXXXXX";
+    char fallback[] = "/tmp/sysfsXXXXXX";
+    char* dir = mkdtemp(tmpl);
+    if (dir == NULL)
+        dir = mkdtemp(fallback);
+    if (dir == NULL) {
+        fprintf(stderr, "can't create temporary directory (%s)\n", strerror(errno));
+        return 1;
+    }
+    snprintf(sRoot, sizeof(sRoot), "%s/", dir);
+
+    if (createAttribute("enable", "0") || createAttribute("delay", "200") ||
+        createAttribute("master_enable", "0") || createAttribute("accel_rate", "0") ||
+        createAttribute("accel_fifo_enable", "0")) {
+        fprintf(stderr, "can't create attributes in %s\n", dir);
+        return 1;
+    }
+
+    testCache();
+    testTransaction();
+
+    const char* names[] = { "enable", "delay", "master_enable", "accel_rate", "accel_fifo_enable" };
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        char path[128];
+        snprintf(path, sizeof(path), "%s%s", sRoot, names[i]);
+        unlink(path);
+    }
+    rmdir(dir);
+
+    return testResult();
+}
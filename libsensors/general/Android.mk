@@ -32,11 +32,37 @@ LOCAL_SRC_FILES := 						\
 				CompassSensor.cpp         \
 				GyroSensor.cpp         \
 				TemperatureSensor.cpp         \
+				SensorEventFifo.cpp         \
+				../common/SysfsAttributes.cpp         \
 	           InputEventReader.cpp
 
+LOCAL_C_INCLUDES := $(LOCAL_PATH)/../common
 LOCAL_SHARED_LIBRARIES := liblog libcutils libdl
 LOCAL_PRELINK_MODULE := false
 
 include $(BUILD_SHARED_LIBRARY)
 
+include $(CLEAR_VARS)
+# for test
+LOCAL_SRC_FILES := test/test-batching.cpp \
+				sensors.cpp \
+				SensorBase.cpp \
+				AccelerationSensor.cpp \
+				LightSensor.cpp \
+				CompassSensor.cpp \
+				GyroSensor.cpp \
+				TemperatureSensor.cpp \
+				SensorEventFifo.cpp \
+				../common/SysfsAttributes.cpp \
+				InputEventReader.cpp
+LOCAL_C_INCLUDES := $(LOCAL_PATH)/../common \
+	$(LOCAL_PATH)/../../include
+LOCAL_SHARED_LIBRARIES := liblog libcutils libdl
+LOCAL_CFLAGS := -DLOG_TAG=\"sensors_batch_test\"
+
+LOCAL_MODULE := sensors_batch_test
+LOCAL_MODULE_TAGS := optional
+
+include $(BUILD_EXECUTABLE)
+
 endif
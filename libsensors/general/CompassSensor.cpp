@@ -46,17 +46,6 @@ CompassSensor::CompassSensor(char* name, float resolution, int minDelay)
     
     
     memset(mPendingEvent.data, 0, sizeof(mPendingEvent.data));
-    
-    ALOGD("CompassSensor::CompassSensor() open data_fd");
-	
-    if (data_fd) {
-        strcpy(input_sysfs_path, "/sys/class/input/");
-        strcat(input_sysfs_path, input_name);
-        strcat(input_sysfs_path, "/device/");
-        input_sysfs_path_len = strlen(input_sysfs_path);
-
-        //enable(0, 1);
-    }
 }
 
 CompassSensor::~CompassSensor() {
@@ -75,26 +64,12 @@ int CompassSensor::enable(int32_t, int en) {
     ALOGD("CompassSensor::~enable(0, %d)", en);
     int flags = en ? 1 : 0;
     if (flags != mEnabled) {
-        int fd;
-        strcpy(&input_sysfs_path[input_sysfs_path_len], "enable");
-        ALOGD("CompassSensor::~enable(0, %d) open %s",en,  input_sysfs_path);
-        fd = open(input_sysfs_path, O_RDWR);
-        if (fd >= 0) {
-             ALOGD("CompassSensor::~enable(0, %d) opened %s",en,  input_sysfs_path);
-            char buf[2];
-            int err;
-            buf[1] = 0;
-            if (flags) {
-                buf[0] = '1';
-            } else {
-                buf[0] = '0';
-            }
-            err = write(fd, buf, sizeof(buf));
-            close(fd);
-            mEnabled = flags;
-            return 0;
+        char buf[2] = { flags ? '1' : '0', 0 };
+        if (mSysfs.write("enable", buf, sizeof(buf)) < 0) {
+            return -1;
         }
-        return -1;        
+        mEnabled = flags;
+        return 0;
     }
     return 0;
 }
@@ -112,22 +87,16 @@ int CompassSensor::setDelay(int32_t handle, int64_t ns)
 {
     ALOGD("CompassSensor::~setDelay(%d, %lld)", handle, ns);
     
-    int fd;
-
     if (ns < (mMinDelay * 1000000)) {
         ns = (mMinDelay * 1000000); // Minimum on stock
     }
 
-    strcpy(&input_sysfs_path[input_sysfs_path_len], "delay");
-    fd = open(input_sysfs_path, O_RDWR);
-    if (fd >= 0) {
-        char buf[80];
-        sprintf(buf, "%lld", ns / 10000000 * 10); // Some flooring to match stock value
-        write(fd, buf, strlen(buf)+1);
-        close(fd);
-        return 0;
+    char buf[80];
+    sprintf(buf, "%lld", ns / 10000000 * 10); // Some flooring to match stock value
+    if (mSysfs.write("delay", buf, strlen(buf)+1) < 0) {
+        return -1;
     }
-    return -1;
+    return 0;
 }
 
 
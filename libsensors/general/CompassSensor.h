@@ -36,8 +36,6 @@ class CompassSensor : public SensorBase {
     InputEventCircularReader mInputReader;
     sensors_event_t mPendingEvent;
     bool mHasPendingEvent;
-    char input_sysfs_path[PATH_MAX];
-    int input_sysfs_path_len;
 
     char *mName;
     float mResolution;
@@ -39,6 +39,11 @@ SensorBase::SensorBase(
     if (data_name) {
         data_fd = openInput(data_name);
     }
+    if (data_fd >= 0) {
+        char path[PATH_MAX];
+        snprintf(path, sizeof(path), "/sys/class/input/%s/device/", input_name);
+        mSysfs.setRoot(path);
+    }
 }
 
 SensorBase::~SensorBase() {
@@ -22,6 +22,7 @@
 #include <sys/cdefs.h>
 #include <sys/types.h>
 
+#include "SysfsAttributes.h"
 
 /*****************************************************************************/
 
@@ -34,6 +35,8 @@ protected:
     char        input_name[PATH_MAX];
     int         dev_fd;
     int         data_fd;
+    // attributes under /sys/class/input/<input_name>/device/
+    SysfsAttributes mSysfs;
 
     int openInput(const char* inputName);
     static int64_t getTimestamp();
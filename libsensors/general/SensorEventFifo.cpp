@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2008 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdint.h>
+#include <errno.h>
+#include <string.h>
+
+#include <sys/cdefs.h>
+#include <sys/types.h>
+
+#include "SensorEventFifo.h"
+
+/*****************************************************************************/
+
+SensorEventFifo::SensorEventFifo(size_t numEvents)
+    : mBuffer(new sensors_event_t[numEvents]),
+      mSize(numEvents),
+      mHighWatermark(numEvents - numEvents / 8),
+      mTail(0),
+      mCount(0),
+      mLatency(0),
+      mOldestArrival(0)
+{
+}
+
+SensorEventFifo::~SensorEventFifo()
+{
+    delete [] mBuffer;
+}
+
+void SensorEventFifo::setLatency(int64_t ns)
+{
+    mLatency = ns > 0 ? ns : 0;
+}
+
+size_t SensorEventFifo::write(sensors_event_t const* events, size_t count, int64_t now)
+{
+    if (count > space()) {
+        count = space();
+    }
+    if (!count) {
+        return 0;
+    }
+
+    if (!mCount) {
+        mOldestArrival = now;
+    }
+
+    size_t head = (mTail + mCount) % mSize;
+    size_t n = count;
+    while (n) {
+        size_t chunk = mSize - head;
+        if (chunk > n) {
+            chunk = n;
+        }
+        memcpy(&mBuffer[head], events, chunk * sizeof(sensors_event_t));
+        events += chunk;
+        n -= chunk;
+        head = (head + chunk) % mSize;
+    }
+    mCount += count;
+
+    return count;
+}
+
+size_t SensorEventFifo::read(sensors_event_t* data, size_t count)
+{
+    if (count > mCount) {
+        count = mCount;
+    }
+
+    size_t n = count;
+    while (n) {
+        size_t chunk = mSize - mTail;
+        if (chunk > n) {
+            chunk = n;
+        }
+        memcpy(data, &mBuffer[mTail], chunk * sizeof(sensors_event_t));
+        data += chunk;
+        n -= chunk;
+        mTail = (mTail + chunk) % mSize;
+    }
+    mCount -= count;
+
+    // whatever is left over stays due, so the next poll() picks it up
+    // without waiting for another full latency period
+    return count;
+}
+
+void SensorEventFifo::clear()
+{
+    mTail = 0;
+    mCount = 0;
+}
+
+int64_t SensorEventFifo::getDeadline() const
+{
+    if (!mCount) {
+        return -1;
+    }
+    if (!isBatching() || mCount >= mHighWatermark) {
+        return mOldestArrival;
+    }
+    return mOldestArrival + mLatency;
+}
+
+bool SensorEventFifo::isDue(int64_t now) const
+{
+    int64_t deadline = getDeadline();
+    return deadline >= 0 && deadline <= now;
+}
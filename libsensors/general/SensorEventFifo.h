@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2008 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_SENSOR_EVENT_FIFO_H
+#define ANDROID_SENSOR_EVENT_FIFO_H
+
+#include <stdint.h>
+#include <errno.h>
+#include <sys/cdefs.h>
+#include <sys/types.h>
+
+#include <hardware/sensors.h>
+
+/*****************************************************************************/
+
+/*
+ * Software FIFO batching the events of one sensor.
+ *
+ * The sensor driver still reads its input device through an
+ * InputEventCircularReader; while the sensor is batching, the decoded events
+ * are queued here instead of being returned from poll(). The queue is due,
+ * and must be handed over in bulk, once its oldest event has waited for the
+ * max report latency or once it reaches the high watermark.
+ *
+ * Deadlines use the time the events arrived in the HAL rather than their
+ * timestamp, as input devices may stamp events with CLOCK_REALTIME.
+ */
+class SensorEventFifo
+{
+    sensors_event_t* const mBuffer;
+    const size_t mSize;
+    const size_t mHighWatermark;
+    size_t mTail;
+    size_t mCount;
+    int64_t mLatency;
+    int64_t mOldestArrival;
+
+public:
+    SensorEventFifo(size_t numEvents);
+    ~SensorEventFifo();
+
+    void setLatency(int64_t ns);
+    int64_t getLatency() const { return mLatency; }
+    bool isBatching() const { return mLatency > 0; }
+
+    size_t size() const { return mCount; }
+    size_t space() const { return mSize - mCount; }
+
+    size_t write(sensors_event_t const* events, size_t count, int64_t now);
+    size_t read(sensors_event_t* data, size_t count);
+    void clear();
+
+    // time at which the queued events have to be reported, -1 when empty
+    int64_t getDeadline() const;
+    bool isDue(int64_t now) const;
+};
+
+/*****************************************************************************/
+
+#endif  // ANDROID_SENSOR_EVENT_FIFO_H
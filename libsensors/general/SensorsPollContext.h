@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2008 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_SENSORS_POLL_CONTEXT_H
+#define ANDROID_SENSORS_POLL_CONTEXT_H
+
+#include <stdint.h>
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/cdefs.h>
+#include <sys/types.h>
+
+#include <hardware/sensors.h>
+
+#include "sensors.h"
+#include "SensorBase.h"
+#include "SensorEventFifo.h"
+
+/*****************************************************************************/
+
+struct sensors_poll_context_t {
+    struct sensors_poll_device_1 device; // must be first
+
+        sensors_poll_context_t();
+        // drivers indexed by handle (ID_A ... ID_T), NULL when absent; the
+        // context takes ownership. Used by the tests in place of detection.
+        sensors_poll_context_t(SensorBase* const* drivers, int num);
+        ~sensors_poll_context_t();
+    int activate(int handle, int enabled);
+    int setDelay(int handle, int64_t ns);
+    int pollEvents(sensors_event_t* data, int count);
+    int batch(int handle, int flags, int64_t period_ns, int64_t timeout);
+    int flush(int handle);
+
+private:
+    enum {
+        accel   = 0,
+        magnetic,
+        orietation,
+        light,
+        proximity,
+        gyroscope,
+        temperature,
+        numSensorDrivers,   // max sensor num
+        numFds,     // max fd num
+    };
+
+    static const size_t wake = numFds - 1;
+    static const char WAKE_MESSAGE = 'W';
+    struct pollfd mPollFds[numFds];
+    int mWritePipeFd;
+    SensorBase* mSensors[numSensorDrivers];
+
+    // batching state, shared with batch() and flush() callers
+    pthread_mutex_t mBatchLock;
+    SensorEventFifo* mFifo[numSensorDrivers];
+    int mFlushPending[numSensorDrivers];
+    // drivers enabled through activate(), only those can be flushed
+    bool mEnabled[numSensorDrivers];
+
+    // For keeping track of usage (only count from system)
+    bool mAccelActive;
+    bool mMagnetActive;
+    bool mOrientationActive;
+
+    void clear();
+    void setupDrivers();
+    int real_activate(int handle, int enabled);
+    void sendWakeMessage();
+    int readBatch(int index, int64_t now);
+    int drainBatches(sensors_event_t* data, int count, int64_t now);
+    int batchTimeout(int64_t now);
+    bool hasFlushPending();
+
+    int handleToDriver(int handle) const;
+    int driverToHandle(int index) const;
+
+    static int64_t getTimestamp() {
+        struct timespec t;
+        t.tv_sec = t.tv_nsec = 0;
+        clock_gettime(CLOCK_MONOTONIC, &t);
+        return int64_t(t.tv_sec)*1000000000LL + t.tv_nsec;
+    }
+};
+
+/*****************************************************************************/
+
+#endif  // ANDROID_SENSORS_POLL_CONTEXT_H
@@ -42,14 +42,6 @@ TemperatureSensor::TemperatureSensor(char* name, float resolution, int minDelay)
     mPendingEvent.sensor = ID_T;
     mPendingEvent.type = SENSOR_TYPE_TEMPERATURE;
     memset(mPendingEvent.data, 0, sizeof(mPendingEvent.data));
-
-    if (data_fd) {
-        strcpy(input_sysfs_path, "/sys/class/input/");
-        strcat(input_sysfs_path, input_name);
-        strcat(input_sysfs_path, "/device/");
-        input_sysfs_path_len = strlen(input_sysfs_path);
-        //enable(0, 1);
-    }
 }
 
 TemperatureSensor::~TemperatureSensor() {
@@ -62,22 +54,17 @@ TemperatureSensor::~TemperatureSensor() {
 int TemperatureSensor::setDelay(int32_t handle, int64_t ns)
 {
     ALOGD("TemperatureSensor::~setDelay(%d, %lld)", handle, ns);
-    int fd;
     
     if (ns < (mMinDelay * 1000000)) {
         ns = (mMinDelay * 1000000); // Minimum on stock
     }
 
-    strcpy(&input_sysfs_path[input_sysfs_path_len], "delay");
-    fd = open(input_sysfs_path, O_RDWR);
-    if (fd >= 0) {
-        char buf[80];
-        sprintf(buf, "%lld", ns / 10000000 * 10); // Some flooring to match stock value
-        write(fd, buf, strlen(buf)+1);
-        close(fd);
-        return 0;
+    char buf[80];
+    sprintf(buf, "%lld", ns / 10000000 * 10); // Some flooring to match stock value
+    if (mSysfs.write("delay", buf, strlen(buf)+1) < 0) {
+        return -1;
     }
-    return -1;
+    return 0;
 }
 
 int TemperatureSensor::enable(int32_t handle, int en)
@@ -85,24 +72,12 @@ int TemperatureSensor::enable(int32_t handle, int en)
     ALOGD("TemperatureSensor::~enable(0, %d)", en);
     int flags = en ? 1 : 0;
     if (flags != mEnabled) {
-        int fd;
-        strcpy(&input_sysfs_path[input_sysfs_path_len], "enable");
-        fd = open(input_sysfs_path, O_RDWR);
-        if (fd >= 0) {
-            char buf[2];
-            int err;
-            buf[1] = 0;
-            if (flags) {
-                buf[0] = '1';
-            } else {
-                buf[0] = '0';
-            }
-            err = write(fd, buf, sizeof(buf));
-            close(fd);
-            mEnabled = flags;
-            return 0;
+        char buf[2] = { flags ? '1' : '0', 0 };
+        if (mSysfs.write("enable", buf, sizeof(buf)) < 0) {
+            return -1;
         }
-        return -1;
+        mEnabled = flags;
+        return 0;
     }
     return 0;
 }
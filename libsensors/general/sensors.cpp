@@ -32,6 +32,7 @@
 #include <utils/Log.h>
 
 #include "sensors.h"
+#include "SensorsPollContext.h"
 
 #include "LightSensor.h"
 //#include "ProximitySensor.h"
@@ -71,6 +72,11 @@
 
 #define MAX_SENSOR_NUM                  16
 
+// software FIFO depth per sensor, reported as fifoMaxEventCount
+#define SENSORS_FIFO_SIZE               256
+// events moved from a batching driver into its FIFO per readEvents() call
+#define SENSORS_FIFO_READ_CHUNK         16
+
 /*****************************************************************************/
 
 /* Support SENSORS Module */
@@ -344,6 +350,7 @@ static int sensors_detect_devices(const struct sensor_t* slist, int ssize,
                     //if (!strcmp(name, (char*)(slist[idx].reserved[0]))) {
                     if (!strcmp(name, slist[idx].stringType)) {
                         memcpy(&clist[count], &slist[idx], sizeof(struct sensor_t));
+                        clist[count].fifoMaxEventCount = SENSORS_FIFO_SIZE;
                         count ++;
                         break;
                     }
@@ -385,79 +392,74 @@ struct sensors_module_t HAL_MODULE_INFO_SYM = {
         get_sensors_list: sensors__get_sensors_list,
 };
 
-struct sensors_poll_context_t {
-    struct sensors_poll_device_t device; // must be first
-
-        sensors_poll_context_t();
-        ~sensors_poll_context_t();
-    int activate(int handle, int enabled);
-    int setDelay(int handle, int64_t ns);
-    int pollEvents(sensors_event_t* data, int count);
-
-private:
-    enum {
-        accel   = 0,
-        magnetic,
-        orietation,
-        light,
-        proximity,
-        gyroscope,
-        temperature,
-        numSensorDrivers,   // max sensor num
-        numFds,     // max fd num
-    };
-
-    static const size_t wake = numFds - 1;
-    static const char WAKE_MESSAGE = 'W';
-    struct pollfd mPollFds[numFds];
-    int mWritePipeFd;
-    SensorBase* mSensors[numSensorDrivers];
-
-    // For keeping track of usage (only count from system)
-    bool mAccelActive;
-    bool mMagnetActive;
-    bool mOrientationActive;
-
-    int real_activate(int handle, int enabled);
-
-    int handleToDriver(int handle) const {
-        switch (handle) {
-            case SENSORS_ACCELERATION_HANDLE:
-                return accel;
-
-    	    case SENSORS_MAGNETIC_FIELD_HANDLE:
-                return magnetic;
-
-    	    case SENSORS_ORIENTATION_HANDLE:
-                return orietation;
-
-    	    case SENSORS_LIGHT_HANDLE:
-                return light;
-
-            case SENSORS_PROXIMITY_HANDLE:
-                return proximity;
-
-            case SENSORS_GYROSCOPE_HANDLE:
-                return gyroscope;
-
-            case SENSORS_TEMPERATURE_HANDLE:
-                return temperature;
-        }
-        return -EINVAL;
+/*****************************************************************************/
+
+int sensors_poll_context_t::handleToDriver(int handle) const {
+    switch (handle) {
+        case SENSORS_ACCELERATION_HANDLE:
+            return accel;
+
+        case SENSORS_MAGNETIC_FIELD_HANDLE:
+            return magnetic;
+
+        case SENSORS_ORIENTATION_HANDLE:
+            return orietation;
+
+        case SENSORS_LIGHT_HANDLE:
+            return light;
+
+        case SENSORS_PROXIMITY_HANDLE:
+            return proximity;
+
+        case SENSORS_GYROSCOPE_HANDLE:
+            return gyroscope;
+
+        case SENSORS_TEMPERATURE_HANDLE:
+            return temperature;
     }
-};
+    return -EINVAL;
+}
+
+int sensors_poll_context_t::driverToHandle(int index) const {
+    switch (index) {
+        case accel:
+            return SENSORS_ACCELERATION_HANDLE;
+
+        case magnetic:
+            return SENSORS_MAGNETIC_FIELD_HANDLE;
+
+        case orietation:
+            return SENSORS_ORIENTATION_HANDLE;
+
+        case light:
+            return SENSORS_LIGHT_HANDLE;
+
+        case proximity:
+            return SENSORS_PROXIMITY_HANDLE;
+
+        case gyroscope:
+            return SENSORS_GYROSCOPE_HANDLE;
+
+        case temperature:
+            return SENSORS_TEMPERATURE_HANDLE;
+    }
+    return -EINVAL;
+}
 
 /*****************************************************************************/
 
-sensors_poll_context_t::sensors_poll_context_t()
+void sensors_poll_context_t::clear()
 {
     int index = 0;
-    struct sensor_t* ss = NULL;
 
     // clear sensors
     for (index = 0; index < numSensorDrivers; index++) {
         mSensors[index] = NULL;
+        mFifo[index] = NULL;
+        mFlushPending[index] = 0;
+        mEnabled[index] = false;
     }
+    pthread_mutex_init(&mBatchLock, NULL);
 
     // clear mPollFds
     for (index = 0; index < numFds; index++) {
@@ -465,6 +467,49 @@ sensors_poll_context_t::sensors_poll_context_t()
         mPollFds[index].fd = -1;
     }
 
+    mAccelActive = false;
+    mMagnetActive = false;
+    mOrientationActive = false;
+}
+
+void sensors_poll_context_t::setupDrivers()
+{
+    int index = 0;
+
+    for (index = 0; index < numSensorDrivers; index++) {
+        if (mSensors[index] != NULL) {
+            mPollFds[index].fd = mSensors[index]->getFd();
+            mPollFds[index].events = POLLIN;
+            mPollFds[index].revents = 0;
+        }
+    }
+
+    // every driver can batch through its own software FIFO
+    for (index = 0; index < numSensorDrivers; index++) {
+        if (mSensors[index] != NULL) {
+            mFifo[index] = new SensorEventFifo(SENSORS_FIFO_SIZE);
+        }
+    }
+
+    int wakeFds[2];
+    int result = pipe(wakeFds);
+    ALOGE_IF(result<0, "error creating wake pipe (%s)", strerror(errno));
+    fcntl(wakeFds[0], F_SETFL, O_NONBLOCK);
+    fcntl(wakeFds[1], F_SETFL, O_NONBLOCK);
+    mWritePipeFd = wakeFds[1];
+
+    mPollFds[wake].fd = wakeFds[0];
+    mPollFds[wake].events = POLLIN;
+    mPollFds[wake].revents = 0;
+}
+
+sensors_poll_context_t::sensors_poll_context_t()
+{
+    int index = 0;
+    struct sensor_t* ss = NULL;
+
+    clear();
+
     // detect sensors
     if (sSensorListNum <= 0) {
         sSensorListNum = sensors_detect_devices(sSensorSupportList,
@@ -481,9 +526,6 @@ sensors_poll_context_t::sensors_poll_context_t()
                 if( mSensors[accel] == NULL) {
                     mSensors[accel] = new AccelerationSensor(const_cast<char *>(ss->stringType),
                                                 ss->resolution, ss->minDelay);
-                    mPollFds[accel].fd = mSensors[accel]->getFd();
-                    mPollFds[accel].events = POLLIN;
-                    mPollFds[accel].revents = 0;
                 }
                 break;
 
@@ -491,9 +533,6 @@ sensors_poll_context_t::sensors_poll_context_t()
                 if( mSensors[magnetic] == NULL) {
                     mSensors[magnetic] = new CompassSensor(const_cast<char *>(ss->stringType),
                                                 ss->resolution, ss->minDelay);
-                    mPollFds[magnetic].fd = mSensors[magnetic]->getFd();
-                    mPollFds[magnetic].events = POLLIN;
-                    mPollFds[magnetic].revents = 0;
                 }
                 break;
 
@@ -501,9 +540,6 @@ sensors_poll_context_t::sensors_poll_context_t()
                 if( mSensors[orietation] == NULL) {
 /*
                     mSensors[orientation] = new OrientationSensor();
-                    mPollFds[orientation].fd = mSensors[orientation]->getFd();
-                    mPollFds[orientation].events = POLLIN;
-                    mPollFds[orientation].revents = 0;
 */
                 }
                 break;
@@ -512,9 +548,6 @@ sensors_poll_context_t::sensors_poll_context_t()
                 if( mSensors[light] == NULL) {
                     mSensors[light] = new LightSensor(const_cast<char *>(ss->stringType),
                                                 ss->resolution, ss->minDelay);
-                    mPollFds[light].fd = mSensors[light]->getFd();
-                    mPollFds[light].events = POLLIN;
-                    mPollFds[light].revents = 0;
                 }
                 break;
 
@@ -522,9 +555,6 @@ sensors_poll_context_t::sensors_poll_context_t()
                 if( mSensors[proximity] == NULL) {
 /*
                     mSensors[proximity] = new ProximitySensor();
-                    mPollFds[proximity].fd = mSensors[proximity]->getFd();
-                    mPollFds[proximity].events = POLLIN;
-                    mPollFds[proximity].revents = 0;
 */
                 }
                 break;
@@ -533,9 +563,6 @@ sensors_poll_context_t::sensors_poll_context_t()
                 if( mSensors[gyroscope] == NULL) {
                     mSensors[gyroscope] = new GyroSensor(const_cast<char *>(ss->stringType),
                                                 ss->resolution, ss->minDelay);
-                    mPollFds[gyroscope].fd = mSensors[gyroscope]->getFd();
-                    mPollFds[gyroscope].events = POLLIN;
-                    mPollFds[gyroscope].revents = 0;
                 }
                 break;
 
@@ -543,28 +570,26 @@ sensors_poll_context_t::sensors_poll_context_t()
                 if( mSensors[temperature] == NULL) {
                     mSensors[temperature] = new TemperatureSensor(const_cast<char *>(ss->stringType),
                                                 ss->resolution, ss->minDelay);
-                    mPollFds[temperature].fd = mSensors[temperature]->getFd();
-                    mPollFds[temperature].events = POLLIN;
-                    mPollFds[temperature].revents = 0;
                 }
                 break;
         }
     }
 
-    int wakeFds[2];
-    int result = pipe(wakeFds);
-    ALOGE_IF(result<0, "error creating wake pipe (%s)", strerror(errno));
-    fcntl(wakeFds[0], F_SETFL, O_NONBLOCK);
-    fcntl(wakeFds[1], F_SETFL, O_NONBLOCK);
-    mWritePipeFd = wakeFds[1];
+    setupDrivers();
+}
 
-    mPollFds[wake].fd = wakeFds[0];
-    mPollFds[wake].events = POLLIN;
-    mPollFds[wake].revents = 0;
+sensors_poll_context_t::sensors_poll_context_t(SensorBase* const* drivers, int num)
+{
+    clear();
 
-    mAccelActive = false;
-    mMagnetActive = false;
-    mOrientationActive = false;
+    for (int handle = 0; handle < num; handle++) {
+        int index = handleToDriver(handle);
+        if (index >= 0) {
+            mSensors[index] = drivers[handle];
+        }
+    }
+
+    setupDrivers();
 }
 
 sensors_poll_context_t::~sensors_poll_context_t() {
@@ -572,9 +597,13 @@ sensors_poll_context_t::~sensors_poll_context_t() {
         if (mSensors[i] != NULL) {
             delete mSensors[i];
         }
+        if (mFifo[i] != NULL) {
+            delete mFifo[i];
+        }
     }
     close(mPollFds[wake].fd);
     close(mWritePipeFd);
+    pthread_mutex_destroy(&mBatchLock);
 }
 
 int sensors_poll_context_t::activate(int handle, int enabled) {
@@ -610,15 +639,31 @@ int sensors_poll_context_t::activate(int handle, int enabled) {
 int sensors_poll_context_t::real_activate(int handle, int enabled) {
     int index = handleToDriver(handle);
     if (index < 0) return index;
+    if (mSensors[index] == NULL) return -EINVAL;
     int err =  mSensors[index]->enable(handle, enabled);
+    if (!err) {
+        pthread_mutex_lock(&mBatchLock);
+        mEnabled[index] = enabled ? true : false;
+        pthread_mutex_unlock(&mBatchLock);
+    }
+    if (!enabled && !err && mFifo[index] != NULL) {
+        // drop the batch of a disabled sensor, it is not reported anymore
+        pthread_mutex_lock(&mBatchLock);
+        mFifo[index]->clear();
+        pthread_mutex_unlock(&mBatchLock);
+    }
     if (enabled && !err) {
-        const char wakeMessage(WAKE_MESSAGE);
-        int result = write(mWritePipeFd, &wakeMessage, 1);
-        ALOGE_IF(result<0, "error sending wake message (%s)", strerror(errno));
+        sendWakeMessage();
     }
     return err;
 }
 
+void sensors_poll_context_t::sendWakeMessage() {
+    const char wakeMessage(WAKE_MESSAGE);
+    int result = write(mWritePipeFd, &wakeMessage, 1);
+    ALOGE_IF(result<0, "error sending wake message (%s)", strerror(errno));
+}
+
 int sensors_poll_context_t::setDelay(int handle, int64_t ns) {
 
     int index = handleToDriver(handle);
@@ -626,12 +671,176 @@ int sensors_poll_context_t::setDelay(int handle, int64_t ns) {
     return mSensors[index]->setDelay(handle, ns);
 }
 
+int sensors_poll_context_t::batch(int handle, int flags, int64_t period_ns, int64_t timeout) {
+    int index = handleToDriver(handle);
+    if (index < 0) return index;
+    if (mSensors[index] == NULL) return -EINVAL;
+
+    // any sensor can batch in software, so a dry run always succeeds
+    if (flags & SENSORS_BATCH_DRY_RUN) return 0;
+
+    int err = mSensors[index]->setDelay(handle, period_ns);
+
+    pthread_mutex_lock(&mBatchLock);
+    mFifo[index]->setLatency(timeout);
+    pthread_mutex_unlock(&mBatchLock);
+
+    // let poll() pick up the new deadline
+    sendWakeMessage();
+    return err;
+}
+
+int sensors_poll_context_t::flush(int handle) {
+    int index = handleToDriver(handle);
+    if (index < 0) return index;
+    if (mSensors[index] == NULL) return -EINVAL;
+
+    pthread_mutex_lock(&mBatchLock);
+    if (!mEnabled[index]) {
+        // nothing to flush, and no flush complete event to send
+        pthread_mutex_unlock(&mBatchLock);
+        return -EINVAL;
+    }
+    mFlushPending[index]++;
+    pthread_mutex_unlock(&mBatchLock);
+
+    sendWakeMessage();
+    return 0;
+}
+
+/*
+ * Move whatever the driver has ready into its FIFO. Returns the number of
+ * events queued, or -1 when the driver is not batching and its events have
+ * to be read directly.
+ */
+int sensors_poll_context_t::readBatch(int index, int64_t now) {
+    sensors_event_t buffer[SENSORS_FIFO_READ_CHUNK];
+    SensorEventFifo* const fifo(mFifo[index]);
+    int room;
+
+    pthread_mutex_lock(&mBatchLock);
+    bool batching = fifo->isBatching();
+    room = fifo->space();
+    pthread_mutex_unlock(&mBatchLock);
+
+    if (!batching)
+        return -1;
+    if (room > SENSORS_FIFO_READ_CHUNK)
+        room = SENSORS_FIFO_READ_CHUNK;
+    if (!room) {
+        // the FIFO is past its watermark and gets drained first
+        return 0;
+    }
+
+    int nb = mSensors[index]->readEvents(buffer, room);
+    if (nb < room) {
+        // no more data for this sensor
+        mPollFds[index].revents = 0;
+    }
+    if (nb > 0) {
+        pthread_mutex_lock(&mBatchLock);
+        fifo->write(buffer, nb, now);
+        pthread_mutex_unlock(&mBatchLock);
+    }
+    return nb < 0 ? 0 : nb;
+}
+
+/*
+ * Hand over the batches that are due, and the flushed ones followed by
+ * their flush complete event.
+ */
+int sensors_poll_context_t::drainBatches(sensors_event_t* data, int count, int64_t now) {
+    int nbEvents = 0;
+
+    pthread_mutex_lock(&mBatchLock);
+    for (int i=0 ; count && i<numSensorDrivers ; i++) {
+        SensorEventFifo* const fifo(mFifo[i]);
+        if (fifo == NULL) {
+            continue;
+        }
+        if (mFlushPending[i] || fifo->isDue(now)) {
+            int nb = fifo->read(data, count);
+            count -= nb;
+            nbEvents += nb;
+            data += nb;
+        }
+        // the flush also covers what the driver still has to be read
+        while (count && mFlushPending[i] && !fifo->size() &&
+                !(mPollFds[i].revents & POLLIN)) {
+            memset(data, 0, sizeof(sensors_event_t));
+            data->version = META_DATA_VERSION;
+            data->type = SENSOR_TYPE_META_DATA;
+            data->meta_data.what = META_DATA_FLUSH_COMPLETE;
+            data->meta_data.sensor = driverToHandle(i);
+            mFlushPending[i]--;
+            count--;
+            nbEvents++;
+            data++;
+        }
+    }
+    pthread_mutex_unlock(&mBatchLock);
+
+    return nbEvents;
+}
+
+bool sensors_poll_context_t::hasFlushPending() {
+    bool pending = false;
+
+    pthread_mutex_lock(&mBatchLock);
+    for (int i=0 ; i<numSensorDrivers ; i++) {
+        if (mFlushPending[i]) {
+            pending = true;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&mBatchLock);
+    return pending;
+}
+
+/*
+ * poll() timeout in ms until the earliest batch is due, -1 if nothing is
+ * queued.
+ */
+int sensors_poll_context_t::batchTimeout(int64_t now) {
+    int64_t deadline = -1;
+
+    pthread_mutex_lock(&mBatchLock);
+    for (int i=0 ; i<numSensorDrivers ; i++) {
+        if (mFifo[i] == NULL) {
+            continue;
+        }
+        if (mFlushPending[i]) {
+            deadline = now;
+            break;
+        }
+        int64_t d = mFifo[i]->getDeadline();
+        if (d >= 0 && (deadline < 0 || d < deadline)) {
+            deadline = d;
+        }
+    }
+    pthread_mutex_unlock(&mBatchLock);
+
+    if (deadline < 0)
+        return -1;
+    if (deadline <= now)
+        return 0;
+    // round up so the batch is due once poll() times out
+    int64_t ms = (deadline - now + 999999) / 1000000;
+    return ms > DELAY_OUT_TIME ? DELAY_OUT_TIME : int(ms);
+}
+
 int sensors_poll_context_t::pollEvents(sensors_event_t* data, int count)
 {
     int nbEvents = 0;
     int n = 0;
 
     do {
+        if (hasFlushPending()) {
+            // a flush covers the events the drivers already have, see
+            // which ones are readable before handing over the batches
+            poll(mPollFds, numSensorDrivers, 0);
+        }
+
         // see if we have some leftover from the last poll()
         for (int i=0 ; count && i<numSensorDrivers ; i++) {
             SensorBase* const sensor(mSensors[i]);
@@ -639,6 +848,10 @@ int sensors_poll_context_t::pollEvents(sensors_event_t* data, int count)
                 continue;
             }
             if ((mPollFds[i].revents & POLLIN) || (sensor->hasPendingEvents())) {
+                if (readBatch(i, getTimestamp()) >= 0) {
+                    // queued, reported once the batch is due
+                    continue;
+                }
                 int nb = sensor->readEvents(data, count);
                 if (nb < count) {
                     // no more data for this sensor
@@ -650,12 +863,19 @@ int sensors_poll_context_t::pollEvents(sensors_event_t* data, int count)
             }
         }
 
+        // batches whose max report latency expired, or that were flushed
+        int nb = drainBatches(data, count, getTimestamp());
+        count -= nb;
+        nbEvents += nb;
+        data += nb;
+
         if (count) {
             // we still have some room, so try to see if we can get
             // some events immediately or just wait if we don't have
-            // anything to return
+            // anything to return, at most until the next batch is due
+            int timeout = nbEvents ? 0 : batchTimeout(getTimestamp());
             do {
-            n = poll(mPollFds, numFds, nbEvents ? 0 : -1);
+            n = poll(mPollFds, numFds, timeout);
             } while (n < 0 && errno == EINTR);
             if (n<0) {
                 ALOGE("poll() failed (%s)", strerror(errno));
@@ -670,8 +890,9 @@ int sensors_poll_context_t::pollEvents(sensors_event_t* data, int count)
                 mPollFds[wake].revents = 0;
             }
         }
-        // if we have events and space, go read them
-    } while (n && count);
+        // if we have events and space, go read them; a poll() timeout
+        // with nothing returned yet means a batch just became due
+    } while (count && (n || !nbEvents));
 
     return nbEvents;
 }
@@ -705,6 +926,18 @@ static int poll__poll(struct sensors_poll_device_t *dev,
     return ctx->pollEvents(data, count);
 }
 
+static int poll__batch(struct sensors_poll_device_1 *dev,
+        int handle, int flags, int64_t period_ns, int64_t timeout) {
+    sensors_poll_context_t *ctx = (sensors_poll_context_t *)dev;
+    return ctx->batch(handle, flags, period_ns, timeout);
+}
+
+static int poll__flush(struct sensors_poll_device_1 *dev,
+        int handle) {
+    sensors_poll_context_t *ctx = (sensors_poll_context_t *)dev;
+    return ctx->flush(handle);
+}
+
 /*****************************************************************************/
 
 /** Open a new instance of a sensor device using name */
@@ -714,15 +947,17 @@ static int open_sensors(const struct hw_module_t* module, const char* id,
         int status = -EINVAL;
         sensors_poll_context_t *dev = new sensors_poll_context_t();
 
-        memset(&dev->device, 0, sizeof(sensors_poll_device_t));
+        memset(&dev->device, 0, sizeof(sensors_poll_device_1));
 
         dev->device.common.tag = HARDWARE_DEVICE_TAG;
-        dev->device.common.version  = 0;
+        dev->device.common.version  = SENSORS_DEVICE_API_VERSION_1_1;
         dev->device.common.module   = const_cast<hw_module_t*>(module);
         dev->device.common.close    = poll__close;
         dev->device.activate        = poll__activate;
         dev->device.setDelay        = poll__setDelay;
         dev->device.poll            = poll__poll;
+        dev->device.batch           = poll__batch;
+        dev->device.flush           = poll__flush;
 
         *device = &dev->device.common;
         status = 0;
@@ -0,0 +1,308 @@
+/*
+ * Drives sensors_poll_context_t with a mock accelerometer whose events come
+ * through a pipe, the way a driver reads its input device. Checks that
+ * unbatched events are returned as they arrive, that batches are held until
+ * their max report latency or the FIFO watermark, that flush() hands over
+ * the batch followed by META_DATA_FLUSH_COMPLETE and wakes up a blocked
+ * poll, and that only an activated sensor can be flushed.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <hardware/sensors.h>
+
+#include <NXTest.h>
+
+#include "../sensors.h"
+#include "../SensorBase.h"
+#include "../SensorsPollContext.h"
+
+#define NS_PER_MS       1000000LL
+
+/* accelerometer reading sensors_event_t records from a pipe */
+class MockSensor : public SensorBase {
+public:
+    int mWriteFd;
+    int mEnabled;
+    int64_t mDelay;
+
+    MockSensor()
+        : SensorBase(NULL, NULL),
+          mWriteFd(-1),
+          mEnabled(0),
+          mDelay(0)
+    {
+        int fds[2];
+        if (pipe(fds) == 0) {
+            fcntl(fds[0], F_SETFL, O_NONBLOCK);
+            dev_fd = fds[0];
+            mWriteFd = fds[1];
+        }
+    }
+
+    virtual ~MockSensor() {
+        if (mWriteFd >= 0) {
+            close(mWriteFd);
+        }
+    }
+
+    virtual int enable(int32_t, int enabled) {
+        mEnabled = enabled ? 1 : 0;
+        return 0;
+    }
+
+    virtual int setDelay(int32_t, int64_t ns) {
+        mDelay = ns;
+        return 0;
+    }
+
+    virtual int readEvents(sensors_event_t* data, int count) {
+        ssize_t n = read(dev_fd, data, count * sizeof(sensors_event_t));
+        if (n < 0)
+            return errno == EAGAIN ? 0 : -errno;
+        return n / sizeof(sensors_event_t);
+    }
+
+    int send(int first, int num) {
+        for (int i = first; i < first + num; i++) {
+            sensors_event_t ev;
+            memset(&ev, 0, sizeof(ev));
+            ev.version = sizeof(sensors_event_t);
+            ev.sensor = ID_A;
+            ev.type = SENSOR_TYPE_ACCELEROMETER;
+            ev.timestamp = i * 10 * NS_PER_MS;
+            ev.acceleration.x = (float)i;
+            if (write(mWriteFd, &ev, sizeof(ev)) != sizeof(ev))
+                return -1;
+        }
+        return 0;
+    }
+};
+
+static int64_t now()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return int64_t(t.tv_sec)*1000000000LL + t.tv_nsec;
+}
+
+static sensors_poll_context_t* createContext(MockSensor** accel)
+{
+    SensorBase* drivers[ID_T + 1] = {};
+    *accel = new MockSensor();
+    drivers[ID_A] = *accel;
+    return new sensors_poll_context_t(drivers, ID_T + 1);
+}
+
+/* num accelerometer events numbered from first, in order */
+static bool eventsMatch(const sensors_event_t* data, int first, int num)
+{
+    for (int i = 0; i < num; i++) {
+        if (data[i].sensor != ID_A ||
+            data[i].type != SENSOR_TYPE_ACCELEROMETER ||
+            data[i].timestamp != (first + i) * 10 * NS_PER_MS ||
+            data[i].acceleration.x != (float)(first + i))
+            return false;
+    }
+    return true;
+}
+
+static bool isFlushComplete(const sensors_event_t& ev, int handle)
+{
+    return ev.type == SENSOR_TYPE_META_DATA &&
+           ev.version == META_DATA_VERSION &&
+           ev.meta_data.what == META_DATA_FLUSH_COMPLETE &&
+           ev.meta_data.sensor == handle;
+}
+
+static void testUnbatched()
+{
+    MockSensor* accel;
+    sensors_poll_context_t* ctx = createContext(&accel);
+    sensors_event_t data[16];
+
+    CHECK(ctx->activate(ID_A, 1) == 0);
+    CHECK(accel->mEnabled);
+    CHECK(accel->send(0, 5) == 0);
+
+    int nb = ctx->pollEvents(data, 16);
+    CHECK(nb == 5);
+    CHECK(eventsMatch(data, 0, 5));
+
+    delete ctx;
+}
+
+static void testLatency()
+{
+    MockSensor* accel;
+    sensors_poll_context_t* ctx = createContext(&accel);
+    sensors_event_t data[16];
+    const int64_t latency = 50 * NS_PER_MS;
+
+    CHECK(ctx->activate(ID_A, 1) == 0);
+    CHECK(ctx->batch(ID_A, 0, 10 * NS_PER_MS, latency) == 0);
+    CHECK(accel->mDelay == 10 * NS_PER_MS);
+    CHECK(accel->send(0, 10) == 0);
+
+    // one wakeup for the whole batch, once it is due
+    int64_t start = now();
+    int nb = ctx->pollEvents(data, 16);
+    CHECK(now() - start >= latency);
+    CHECK(nb == 10);
+    CHECK(eventsMatch(data, 0, 10));
+
+    delete ctx;
+}
+
+static void testWatermark()
+{
+    MockSensor* accel;
+    sensors_poll_context_t* ctx = createContext(&accel);
+    sensors_event_t data[256];
+    const int highWatermark = 256 - 256 / 8;
+
+    CHECK(ctx->activate(ID_A, 1) == 0);
+    CHECK(ctx->batch(ID_A, 0, 10 * NS_PER_MS, 10000 * NS_PER_MS) == 0);
+    CHECK(accel->send(0, highWatermark + 8) == 0);
+
+    // the watermark forces delivery long before the 10 s latency
+    int64_t start = now();
+    int nb = ctx->pollEvents(data, 256);
+    CHECK(now() - start < 1000 * NS_PER_MS);
+    CHECK(nb >= highWatermark && nb <= highWatermark + 8);
+    CHECK(eventsMatch(data, 0, nb));
+
+    // the rest comes with the flush
+    int first = nb;
+    CHECK(ctx->flush(ID_A) == 0);
+    nb = ctx->pollEvents(data, 256);
+    CHECK(nb == highWatermark + 8 - first + 1);
+    CHECK(eventsMatch(data, first, nb - 1));
+    CHECK(nb > 0 && isFlushComplete(data[nb - 1], ID_A));
+
+    delete ctx;
+}
+
+static void testFlush()
+{
+    MockSensor* accel;
+    sensors_poll_context_t* ctx = createContext(&accel);
+    sensors_event_t data[16];
+
+    CHECK(ctx->activate(ID_A, 1) == 0);
+    CHECK(ctx->batch(ID_A, 0, 10 * NS_PER_MS, 10000 * NS_PER_MS) == 0);
+    CHECK(accel->send(0, 5) == 0);
+    CHECK(ctx->flush(ID_A) == 0);
+
+    // the batch first, then its flush complete event
+    int64_t start = now();
+    int nb = ctx->pollEvents(data, 16);
+    CHECK(now() - start < 1000 * NS_PER_MS);
+    CHECK(nb == 6);
+    CHECK(eventsMatch(data, 0, 5));
+    CHECK(isFlushComplete(data[5], ID_A));
+
+    // an empty FIFO is flushed right away
+    CHECK(ctx->flush(ID_A) == 0);
+    CHECK(ctx->flush(ID_A) == 0);
+    nb = ctx->pollEvents(data, 16);
+    CHECK(nb == 2);
+    CHECK(isFlushComplete(data[0], ID_A));
+    CHECK(isFlushComplete(data[1], ID_A));
+
+    delete ctx;
+}
+
+struct poll_thread {
+    sensors_poll_context_t* ctx;
+    sensors_event_t data[16];
+    volatile int nb;
+};
+
+static void* pollThread(void* arg)
+{
+    poll_thread* t = (poll_thread*)arg;
+    t->nb = t->ctx->pollEvents(t->data, 16);
+    return NULL;
+}
+
+static void testFlushWakesPoll()
+{
+    MockSensor* accel;
+    sensors_poll_context_t* ctx = createContext(&accel);
+    poll_thread t;
+    pthread_t thread;
+
+    CHECK(ctx->activate(ID_A, 1) == 0);
+    CHECK(ctx->batch(ID_A, 0, 10 * NS_PER_MS, 10000 * NS_PER_MS) == 0);
+
+    // nothing queued, the poll blocks until the wake pipe is written
+    t.ctx = ctx;
+    t.nb = -1;
+    int ret = pthread_create(&thread, NULL, pollThread, &t);
+    CHECK(ret == 0);
+    if (ret) {
+        delete ctx;
+        return;
+    }
+    usleep(50000);
+    CHECK(t.nb == -1);
+
+    CHECK(ctx->flush(ID_A) == 0);
+    pthread_join(thread, NULL);
+    CHECK(t.nb == 1);
+    CHECK(isFlushComplete(t.data[0], ID_A));
+
+    delete ctx;
+}
+
+static void testFlushInactive()
+{
+    MockSensor* accel;
+    sensors_poll_context_t* ctx = createContext(&accel);
+
+    // not activated yet
+    CHECK(ctx->flush(ID_A) == -EINVAL);
+    // no driver, or no such handle
+    CHECK(ctx->flush(ID_P) == -EINVAL);
+    CHECK(ctx->flush(99) == -EINVAL);
+
+    CHECK(ctx->activate(ID_A, 1) == 0);
+    CHECK(ctx->flush(ID_A) == 0);
+    CHECK(ctx->activate(ID_A, 0) == 0);
+    CHECK(!accel->mEnabled);
+    CHECK(ctx->flush(ID_A) == -EINVAL);
+
+    delete ctx;
+}
+
+int main(int argc, char *argv[])
+{
+    struct {
+        const char* name;
+        void (*run)();
+    } tests[] = {
+        { "unbatched",          testUnbatched },
+        { "max report latency", testLatency },
+        { "FIFO watermark",     testWatermark },
+        { "flush",              testFlush },
+        { "flush wakes poll",   testFlushWakesPoll },
+        { "flush inactive",     testFlushInactive },
+    };
+
+    for (size_t i = 0; i < sizeof(tests) / sizeof(tests[0]); i++) {
+        int failures = testFailures();
+        tests[i].run();
+        printf("%-24s %s\n", tests[i].name, testFailures() == failures ? "ok" : "FAIL");
+    }
+
+    return testResult();
+}
@@ -56,6 +56,7 @@ LOCAL_SRC_FILES += MPLSensor.cpp
 LOCAL_SRC_FILES += MPLSupport.cpp
 LOCAL_SRC_FILES += InputEventReader.cpp
 LOCAL_SRC_FILES += PressureSensor.IIO.secondary.cpp
+LOCAL_SRC_FILES += ../common/SysfsAttributes.cpp
 
 ifneq (,$(filter $(TARGET_BUILD_VARIANT),eng userdebug))
 ifeq ($(COMPILE_INVENSENSE_COMPASS_CAL),0)
@@ -75,6 +76,7 @@ LOCAL_C_INCLUDES += $(LOCAL_PATH)/mlsdk/software/core/mllite
 LOCAL_C_INCLUDES += $(LOCAL_PATH)/mlsdk/software/core/mllite/linux
 LOCAL_C_INCLUDES += $(LOCAL_PATH)/mlsdk/software/core/driver/include
 LOCAL_C_INCLUDES += $(LOCAL_PATH)/mlsdk/software/core/driver/include/linux
+LOCAL_C_INCLUDES += $(LOCAL_PATH)/../common
 
 LOCAL_SHARED_LIBRARIES := liblog
 LOCAL_SHARED_LIBRARIES += libcutils
@@ -152,16 +152,15 @@ int CompassSensor::enable(int32_t handle, int en)
 int CompassSensor::setDelay(int32_t handle, int64_t ns) 
 {
     VFUNC_LOG;
-    int tempFd;
     int res;
 
-    LOGV_IF(SYSFS_VERBOSE, "HAL:sysfs:echo %.0f > %s (%lld)", 
-            1000000000.f / ns, compassSysFs.compass_rate, getTimestamp());
     mDelay = ns;
     if (ns == 0)
         return -1;
-    tempFd = open(compassSysFs.compass_rate, O_RDWR);
-    res = write_attribute_sensor(tempFd, 1000000000.f / ns);
+    LOGV_IF(SYSFS_VERBOSE, "HAL:sysfs:echo %.0f > %s (%lld)", 
+            1000000000.f / ns, compassSysFs.compass_rate, getTimestamp());
+    /* through the cache, inside the master_enable transaction of batch() */
+    res = write_sysfs_int(compassSysFs.compass_rate, (int)(1000000000.f / ns));
     if(res < 0) {
         LOGE("HAL:Compass update delay error");
     }
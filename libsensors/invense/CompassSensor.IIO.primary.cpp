@@ -284,16 +284,15 @@ int CompassSensor::masterEnable(int en)
 int CompassSensor::setDelay(int32_t handle, int64_t ns) 
 {
     VFUNC_LOG;
-    int tempFd;
     int res;
 
     mDelay = ns;
     if (ns == 0)
         return -1;
-    tempFd = open(compassSysFs.compass_rate, O_RDWR);
     LOGV_IF(SYSFS_VERBOSE, "HAL:sysfs:echo %.0f > %s (%lld)", 
             1000000000.f / ns, compassSysFs.compass_rate, getTimestamp());
-    res = write_attribute_sensor(tempFd, 1000000000.f / ns);
+    /* through the cache, inside the master_enable transaction of batch() */
+    res = write_sysfs_int(compassSysFs.compass_rate, (int)(1000000000.f / ns));
     if(res < 0) {
         LOGE("HAL:Compass update delay error");
     }
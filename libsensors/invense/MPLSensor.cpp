@@ -3277,7 +3277,6 @@ int MPLSensor::update_delay(void)
         wanted_3rd_party_sensor = wanted;
 
         int enabled_sensors = mEnabled;
-        int tempFd = -1;
 
         if(mFeatureActiveMask & INV_DMP_BATCH_MODE) {
             // set batch rates
@@ -3293,8 +3292,7 @@ int MPLSensor::update_delay(void)
             /* driver only looks at sampling frequency if DMP is off */
             LOGV_IF(SYSFS_VERBOSE, "HAL:sysfs:echo %.0f > %s (%lld)",
                     1000000000.f / tempWanted, mpu.gyro_fifo_rate, getTimestamp());
-            tempFd = open(mpu.gyro_fifo_rate, O_RDWR);
-            res = write_attribute_sensor(tempFd, 1000000000.f / tempWanted);
+            res = write_sysfs_int(mpu.gyro_fifo_rate, 1000000000.f / tempWanted);
             LOGE_IF(res < 0, "HAL:sampling frequency update delay error");
 
         if (LA_ENABLED || GR_ENABLED || RV_ENABLED
@@ -3358,8 +3356,7 @@ int MPLSensor::update_delay(void)
             LOGV_IF(SYSFS_VERBOSE, "HAL:sysfs:echo %.0f > %s (%lld)",
                     1000000000.f / gyroRate, mpu.gyro_rate,
                     getTimestamp());
-            tempFd = open(mpu.gyro_rate, O_RDWR);
-            res = write_attribute_sensor(tempFd, 1000000000.f / gyroRate);
+            res = write_sysfs_int(mpu.gyro_rate, 1000000000.f / gyroRate);
             if(res < 0) {
                 LOGE("HAL:GYRO update delay error");
             }
@@ -3370,17 +3367,14 @@ int MPLSensor::update_delay(void)
                 LOGV_IF(SYSFS_VERBOSE, "echo %lld > %s (%lld)",
                         wanted_3rd_party_sensor / 1000000L, mpu.accel_rate,
                         getTimestamp());
-                tempFd = open(mpu.accel_rate, O_RDWR);
-                res = write_attribute_sensor(tempFd,
-                        wanted_3rd_party_sensor / 1000000L);
+                res = write_sysfs_int(mpu.accel_rate, wanted_3rd_party_sensor / 1000000L);
                 LOGE_IF(res < 0, "HAL:ACCEL update delay error");
             } else {
                 // mpu accel
                LOGV_IF(SYSFS_VERBOSE, "HAL:sysfs:echo %.0f > %s (%lld)",
                         1000000000.f / accelRate, mpu.accel_rate,
                         getTimestamp());
-                tempFd = open(mpu.accel_rate, O_RDWR);
-                res = write_attribute_sensor(tempFd, 1000000000.f / accelRate);
+                res = write_sysfs_int(mpu.accel_rate, 1000000000.f / accelRate);
                 LOGE_IF(res < 0, "HAL:ACCEL update delay error");
             }
 
@@ -3421,8 +3415,7 @@ int MPLSensor::update_delay(void)
                     "HAL:MPL gyro sample rate: (mpl)=%d us", int(wanted/1000LL));
                 LOGV_IF(SYSFS_VERBOSE, "HAL:sysfs:echo %.0f > %s (%lld)",
                         1000000000.f / wanted, mpu.gyro_rate, getTimestamp());
-                tempFd = open(mpu.gyro_rate, O_RDWR);
-                res = write_attribute_sensor(tempFd, 1000000000.f / wanted);
+                res = write_sysfs_int(mpu.gyro_rate, 1000000000.f / wanted);
                 LOGE_IF(res < 0, "HAL:GYRO update delay error");
             }
 
@@ -3442,14 +3435,13 @@ int MPLSensor::update_delay(void)
                 LOGV_IF(SYSFS_VERBOSE, "HAL:sysfs:echo %.0f > %s (%lld)",
                         1000000000.f / wanted, mpu.accel_rate,
                         getTimestamp());
-                tempFd = open(mpu.accel_rate, O_RDWR);
                 if(USE_THIRD_PARTY_ACCEL == 1) {
                     //BMA250 in ms
-                    res = write_attribute_sensor(tempFd, wanted / 1000000L);
+                    res = write_sysfs_int(mpu.accel_rate, wanted / 1000000L);
                 }
                 else {
                     //MPUxxxx in hz
-                    res = write_attribute_sensor(tempFd, 1000000000.f/wanted);
+                    res = write_sysfs_int(mpu.accel_rate, 1000000000.f/wanted);
                 }
                 LOGE_IF(res < 0, "HAL:ACCEL update delay error");
             }
@@ -5566,11 +5558,9 @@ int MPLSensor::batch(int handle, int flags, int64_t period_ns, int64_t timeout)
         mBatchTimeouts[what] = timeout;
     }
 
-    // reset master enable
-    res = masterEnable(0);
-    if (res < 0) {
-        return res;
-    }
+    // reset master enable, deferred until the first write that changes
+    // the chip setup so re-batching with the same parameters is free
+    begin_sysfs_transaction(mpu.master_enable);
 
     if(((int)mOldBatchEnabledMask != batchMode) || batchMode) {
   
@@ -5696,8 +5686,12 @@ int MPLSensor::batch(int handle, int flags, int64_t period_ns, int64_t timeout)
         LOGE("HAL:ERR can't enable DMP event interrupt");
     }
 
-    if (enabled_sensors || mFeatureActiveMask) {
-        masterEnable(1);
+    LOGV_IF(SYSFS_VERBOSE, "HAL:sysfs:echo %d > %s (%lld)",
+            (enabled_sensors || mFeatureActiveMask) ? 1 : 0,
+            mpu.master_enable, getTimestamp());
+    if (commit_sysfs_transaction((enabled_sensors || mFeatureActiveMask) ? 1 : 0) < 0) {
+        res = -1;
+        LOGE("HAL:ERR can't set master enable");
     }
     return res;
 }
@@ -6104,6 +6098,8 @@ void MPLSensor::setInitial6QuatValue()
 					            mInitial6QuatValue[1],
                                                     mInitial6QuatValue[2],
                                                     mInitial6QuatValue[3]);
+    /* not cached, the chip has to be disabled before it is written */
+    drop_sysfs_guard();
     FILE* fptr = fopen(mpu.six_axis_q_value, "w");
     if(fptr == NULL) {
         LOGE("HAL:could not open six_axis_q_value");
@@ -6160,7 +6156,6 @@ int MPLSensor::setBatchDataRates()
     VFUNC_LOG;
 
     int res = 0;
-    int tempFd = -1;
 
     int64_t gyroRate;
     int64_t accelRate;
@@ -6244,8 +6239,7 @@ int MPLSensor::setBatchDataRates()
     LOGV_IF(SYSFS_VERBOSE, "HAL:sysfs:echo %.0f > %s (%lld)",
             1000000000.f / gyroRate, mpu.gyro_rate,
             getTimestamp());
-    tempFd = open(mpu.gyro_rate, O_RDWR);
-    res = write_attribute_sensor(tempFd, 1000000000.f / gyroRate);
+    res = write_sysfs_int(mpu.gyro_rate, 1000000000.f / gyroRate);
     if(res < 0) {
         LOGE("HAL:GYRO update delay error");
     }
@@ -6254,8 +6248,7 @@ int MPLSensor::setBatchDataRates()
     LOGV_IF(SYSFS_VERBOSE, "HAL:sysfs:echo %.0f > %s (%lld)",
             1000000000.f / accelRate, mpu.accel_rate,
             getTimestamp());
-    tempFd = open(mpu.accel_rate, O_RDWR);
-    res = write_attribute_sensor(tempFd, 1000000000.f / accelRate);
+    res = write_sysfs_int(mpu.accel_rate, 1000000000.f / accelRate);
     LOGE_IF(res < 0, "HAL:ACCEL update delay error");
    
     /* takes care of compass rate */
@@ -6277,7 +6270,6 @@ int MPLSensor::resetDataRates()
     VFUNC_LOG;
     
     int res = 0;
-    int tempFd = -1;
     int64_t wanted = 1000000000LL;
 
     int64_t resetRate;
@@ -6339,16 +6331,14 @@ int MPLSensor::resetDataRates()
     LOGV_IF(SYSFS_VERBOSE, "HAL:sysfs:echo %.0f > %s (%lld)",
             1000000000.f / wanted, mpu.gyro_fifo_rate,
             getTimestamp());
-    tempFd = open(mpu.gyro_fifo_rate, O_RDWR);
-    res = write_attribute_sensor(tempFd, 1000000000.f / wanted);
+    res = write_sysfs_int(mpu.gyro_fifo_rate, 1000000000.f / wanted);
     LOGE_IF(res < 0, "HAL:sampling frequency update delay error");
             
     /* takes care of gyro rate */
     LOGV_IF(SYSFS_VERBOSE, "HAL:sysfs:echo %.0f > %s (%lld)",
             1000000000.f / gyroRate, mpu.gyro_rate,
             getTimestamp());
-    tempFd = open(mpu.gyro_rate, O_RDWR);
-    res = write_attribute_sensor(tempFd, 1000000000.f / gyroRate);
+    res = write_sysfs_int(mpu.gyro_rate, 1000000000.f / gyroRate);
     if(res < 0) {
         LOGE("HAL:GYRO update delay error");
     }
@@ -6357,8 +6347,7 @@ int MPLSensor::resetDataRates()
     LOGV_IF(SYSFS_VERBOSE, "HAL:sysfs:echo %.0f > %s (%lld)",
             1000000000.f / accelRate, mpu.accel_rate,
             getTimestamp());
-    tempFd = open(mpu.accel_rate, O_RDWR);
-    res = write_attribute_sensor(tempFd, 1000000000.f / accelRate);
+    res = write_sysfs_int(mpu.accel_rate, 1000000000.f / accelRate);
     LOGE_IF(res < 0, "HAL:ACCEL update delay error");
 
     /* takes care of compass rate */
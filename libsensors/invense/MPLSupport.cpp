@@ -21,6 +21,8 @@
 #include "mlsdk/software/core/driver/include/log.h"
 #include "SensorBase.h"
 #include <fcntl.h>
+#include <pthread.h>
+#include "SysfsAttributes.h"
 
 #include "./mlsdk/software/core/mllite/linux/ml_sysfs_helper.h"
 #include "./mlsdk/software/core/mllite/linux/ml_load_dmp.h"
@@ -186,34 +188,78 @@ void convert_long_to_hex_char(long* quat, unsigned char* hex, int numElement)
     return;
 }
 
-int write_sysfs_int(char *filename, int var)
+/*
+ * All write_sysfs_*() calls go through one attribute cache: the files stay
+ * open and writes of unchanged values are skipped. The enable and batch
+ * paths used to cost an open/write/close for each of their many writes.
+ */
+static SysfsAttributes sSysfsAttributes(64);
+static pthread_mutex_t sSysfsLock = PTHREAD_MUTEX_INITIALIZER;
+
+static int write_sysfs_cached(char *filename, long long var)
 {
-    int res=0;
-    FILE  *sysfsfp;
+    int res;
 
-    sysfsfp = fopen(filename, "w");
-    if (sysfsfp != NULL) {
-        if (fprintf(sysfsfp, "%d\n", var) < 0 || fclose(sysfsfp) < 0) {
-            res = errno;
-            LOGE("HAL:ERR open file %s to write with error %d", filename, res);
-        }
-    }
-    return -res;
+    pthread_mutex_lock(&sSysfsLock);
+    res = sSysfsAttributes.writeInt(filename, var);
+    pthread_mutex_unlock(&sSysfsLock);
+
+    /* attributes missing on this chip were silently ignored before */
+    if (res == -ENOENT)
+        res = 0;
+    return res;
+}
+
+int write_sysfs_int(char *filename, int var)
+{
+    return write_sysfs_cached(filename, var);
 }
 
 int write_sysfs_longlong(char *filename, int64_t var)
 {
-    int res=0;
-    FILE  *sysfsfp;
+    return write_sysfs_cached(filename, var);
+}
 
-    sysfsfp = fopen(filename, "w");
-    if (sysfsfp != NULL) {
-        if (fprintf(sysfsfp, "%lld\n", var) < 0 || fclose(sysfsfp) < 0) {   
-            res = errno;
-            LOGE("HAL:ERR open file %s to write with error %d", filename, res);
-        }
-    }
-    return -res;
+/**
+ *  @brief  Group dependent sysfs writes behind a master enable.
+ *          The guard is only written to 0 right before the first write
+ *          that changes a value, so a transaction that changes nothing
+ *          leaves the chip alone.
+ *  @param  guard
+ *              the master enable attribute
+ */
+void begin_sysfs_transaction(char *guard)
+{
+    pthread_mutex_lock(&sSysfsLock);
+    sSysfsAttributes.begin(guard);
+    pthread_mutex_unlock(&sSysfsLock);
+}
+
+/**
+ *  @brief  Take the guard down now, before writing attributes that do not
+ *          go through write_sysfs_*().
+ */
+int drop_sysfs_guard(void)
+{
+    int res;
+
+    pthread_mutex_lock(&sSysfsLock);
+    res = sSysfsAttributes.dropGuard();
+    pthread_mutex_unlock(&sSysfsLock);
+    return res;
+}
+
+/**
+ *  @brief  End a transaction, leaving the guard at the given value.
+ */
+int commit_sysfs_transaction(int guard_value)
+{
+    int res;
+
+    pthread_mutex_lock(&sSysfsLock);
+    res = sSysfsAttributes.commit(guard_value);
+    pthread_mutex_unlock(&sSysfsLock);
+    return res;
 }
 
 int fill_dev_full_name_by_prefix(const char* dev_prefix, 
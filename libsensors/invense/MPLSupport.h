@@ -28,6 +28,9 @@ int read_sysfs_int64(char*, int64_t*);
 int read_sysfs_int(char*, int*);
 int write_sysfs_int(char*, int);
 int write_sysfs_longlong(char*, long long);
+void begin_sysfs_transaction(char *guard);
+int drop_sysfs_guard(void);
+int commit_sysfs_transaction(int guard_value);
 int fill_dev_full_name_by_prefix(const char* dev_prefix,
                                  char* dev_full_name, int len);
 void dump_dmp_img(const char *out_file);
@@ -74,13 +74,21 @@ int getPhysForHandle(private_handle_t const *handle, unsigned long *phys)
     int ret = 0;
     switch (handle->format) {
     case HAL_PIXEL_FORMAT_YV12:
-        ret = ion_get_phys(ion_fd, handle->share_fd, &phys[0]);
-        if (ret) {
-             ALOGE("%s: failed to ion_get_phys for handle %p, fd %d", __func__, handle, handle->share_fd);
-             return -EINVAL;
+    case HAL_PIXEL_FORMAT_NEXELL_YV12:
+        // planes at their offset of the fd they live in, Y at 0
+        for (int i = 0; i < 3; i++) {
+            int fd = handle->planeFd(i);
+            if (i > 0 && fd == handle->share_fd) {
+                phys[i] = phys[0] + handle->plane_offset[i];
+                continue;
+            }
+            ret = ion_get_phys(ion_fd, fd, &phys[i]);
+            if (ret) {
+                 ALOGE("%s: failed to ion_get_phys for handle %p, fd %d", __func__, handle, fd);
+                 return -EINVAL;
+            }
+            phys[i] += handle->plane_offset[i];
         }
-        phys[1] = phys[0] + (handle->stride * ALIGN(handle->height, 16));
-        phys[2] = phys[1] + (ALIGN(handle->stride >> 1, 16) * ALIGN(handle->height >> 1, 16));
         break;
 #if 0
         // TODO
@@ -19,6 +19,7 @@
 #include "vr_timeline.h"
 #include "vr_osk_profiling.h"
 #include "vr_kernel_utilization.h"
+#include "vr_job_trace.h"
 #if defined(CONFIG_GPU_TRACEPOINTS) && defined(CONFIG_TRACEPOINTS)
 #include <linux/sched.h>
 #include <trace/events/gpu.h>
@@ -254,6 +255,8 @@ void vr_gp_scheduler_job_done(struct vr_group *group, struct vr_gp_job *job, vr_
 
 	VR_DEBUG_PRINT(3, ("Vr GP scheduler: Job %u (0x%08X) completed (%s)\n", vr_gp_job_get_id(job), job, success ? "success" : "failure"));
 
+	vr_job_trace_gp(VR_JOB_TRACE_EVENT_GP_DONE, job, success);
+
 	/* Release tracker. */
 	schedule_mask |= vr_timeline_tracker_release(&job->tracker);
 
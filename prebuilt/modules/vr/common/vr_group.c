@@ -19,6 +19,7 @@
 #include "vr_broadcast.h"
 #include "vr_scheduler.h"
 #include "vr_osk_profiling.h"
+#include "vr_job_trace.h"
 #include "vr_pm_domain.h"
 #include "vr_pm.h"
 #if defined(CONFIG_GPU_TRACEPOINTS) && defined(CONFIG_TRACEPOINTS)
@@ -549,6 +550,8 @@ void vr_group_start_gp_job(struct vr_group *group, struct vr_gp_job *job)
 
 	vr_gp_job_start(group->gp_core, job);
 
+	vr_job_trace_gp(VR_JOB_TRACE_EVENT_GP_START, job, VR_TRUE);
+
 	_vr_osk_profiling_add_event(VR_PROFILING_EVENT_TYPE_SINGLE |
 	                              VR_PROFILING_MAKE_EVENT_CHANNEL_GP(0) |
 	                              VR_PROFILING_EVENT_REASON_SINGLE_HW_FLUSH,
@@ -618,6 +621,9 @@ void vr_group_start_pp_job(struct vr_group *group, struct vr_pp_job *job, u32 su
 		vr_pp_job_start(group->pp_core, job, sub_job, VR_FALSE);
 	}
 
+	vr_job_trace_pp(VR_JOB_TRACE_EVENT_PP_START, job, sub_job,
+	                vr_group_is_virtual(group) ? VR_JOB_TRACE_CORE_VIRTUAL : vr_pp_core_get_id(group->pp_core), VR_TRUE);
+
 	/* if the group is virtual, loop through physical groups which belong to this group
 	 * and call profiling events for its cores as virtual */
 	if (VR_TRUE == vr_group_is_virtual(group)) {
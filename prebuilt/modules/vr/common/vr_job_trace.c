@@ -0,0 +1,198 @@
+/*
+ * This confidential and proprietary software may be used only as
+ * authorised by a licensing agreement from NEXELL Limited
+ * (C) COPYRIGHT 2013 NEXELL Limited
+ * ALL RIGHTS RESERVED
+ * The entire notice above must be reproduced on all authorised
+ * copies and copies may only be made to the extent permitted
+ * by a licensing agreement from NEXELL Limited.
+ */
+
+#include "vr_job_trace.h"
+#include "vr_kernel_common.h"
+#include "vr_osk.h"
+#include "vr_gp_job.h"
+#include "vr_pp_job.h"
+#include "vr_timeline.h"
+
+#define VR_JOB_TRACE_RING_MASK (VR_JOB_TRACE_RING_SIZE - 1)
+
+vr_bool vr_job_trace_active = VR_FALSE;
+
+static vr_job_trace_event *trace_ring = NULL;
+
+/* Number of slots handed out so far. Slot n lives at trace_ring[n & MASK] and is
+ * complete once its seq field reads n + 1. */
+static _vr_osk_atomic_t trace_write_pos;
+
+/* Position of the first slot still visible to readers, moved forward by clear */
+static u32 trace_read_base = 0;
+
+_vr_osk_errcode_t vr_job_trace_init(void)
+{
+	VR_DEBUG_ASSERT(0 == (VR_JOB_TRACE_RING_SIZE & VR_JOB_TRACE_RING_MASK));
+
+	trace_ring = _vr_osk_valloc(VR_JOB_TRACE_RING_SIZE * sizeof(vr_job_trace_event));
+	if (NULL == trace_ring) {
+		return _VR_OSK_ERR_NOMEM;
+	}
+	_vr_osk_memset(trace_ring, 0, VR_JOB_TRACE_RING_SIZE * sizeof(vr_job_trace_event));
+
+	_vr_osk_atomic_init(&trace_write_pos, 0);
+	trace_read_base = 0;
+	vr_job_trace_active = VR_FALSE;
+
+	return _VR_OSK_ERR_OK;
+}
+
+void vr_job_trace_term(void)
+{
+	vr_job_trace_active = VR_FALSE;
+
+	if (NULL != trace_ring) {
+		_vr_osk_vfree(trace_ring);
+		trace_ring = NULL;
+	}
+
+	_vr_osk_atomic_term(&trace_write_pos);
+}
+
+void vr_job_trace_set_enabled(vr_bool enabled)
+{
+	if (NULL == trace_ring) {
+		return;
+	}
+
+	vr_job_trace_active = enabled;
+	_vr_osk_mem_barrier();
+}
+
+void vr_job_trace_clear(void)
+{
+	trace_read_base = _vr_osk_atomic_read(&trace_write_pos);
+}
+
+static void vr_job_trace_add_event(vr_job_trace_event_type event, u32 job_id, u32 sub_job, u32 core,
+                                   u32 pid, u32 tid, u32 frame_builder_id, u32 flush_id, u32 flags)
+{
+	vr_job_trace_event *record;
+	u32 pos;
+
+	if (NULL == trace_ring) {
+		return;
+	}
+
+	pos = _vr_osk_atomic_inc_return(&trace_write_pos) - 1;
+	record = &trace_ring[pos & VR_JOB_TRACE_RING_MASK];
+
+	/* Invalidate the slot first so a concurrent reader never mixes two records */
+	record->seq = 0;
+	_vr_osk_write_mem_barrier();
+
+	record->timestamp = _vr_osk_time_get_ns();
+	record->event = (u16)event;
+	record->core = (u8)core;
+	record->flags = (u8)flags;
+	record->job_id = job_id;
+	record->sub_job = sub_job;
+	record->pid = pid;
+	record->tid = tid;
+	record->frame_builder_id = frame_builder_id;
+	record->flush_id = flush_id;
+
+	_vr_osk_write_mem_barrier();
+	record->seq = pos + 1;
+}
+
+void vr_job_trace_add_gp_event(vr_job_trace_event_type event, struct vr_gp_job *job, vr_bool success)
+{
+	VR_DEBUG_ASSERT_POINTER(job);
+
+	vr_job_trace_add_event(event, vr_gp_job_get_id(job), 0, 0,
+	                       vr_gp_job_get_pid(job), vr_gp_job_get_tid(job),
+	                       vr_gp_job_get_frame_builder_id(job), vr_gp_job_get_flush_id(job),
+	                       success ? 0 : VR_JOB_TRACE_FLAG_FAILED);
+}
+
+void vr_job_trace_add_pp_event(vr_job_trace_event_type event, struct vr_pp_job *job, u32 sub_job, u32 core, vr_bool success)
+{
+	VR_DEBUG_ASSERT_POINTER(job);
+
+	vr_job_trace_add_event(event, vr_pp_job_get_id(job), sub_job, core,
+	                       vr_pp_job_get_pid(job), vr_pp_job_get_tid(job),
+	                       vr_pp_job_get_frame_builder_id(job), vr_pp_job_get_flush_id(job),
+	                       success ? 0 : VR_JOB_TRACE_FLAG_FAILED);
+}
+
+void vr_job_trace_add_tracker_event(vr_job_trace_event_type gp_event, struct vr_timeline_tracker *tracker)
+{
+	VR_DEBUG_ASSERT_POINTER(tracker);
+
+	switch (tracker->type) {
+	case VR_TIMELINE_TRACKER_GP:
+		vr_job_trace_add_gp_event(gp_event, (struct vr_gp_job *) tracker->job, VR_TRUE);
+		break;
+	case VR_TIMELINE_TRACKER_PP:
+		vr_job_trace_add_pp_event(gp_event + VR_JOB_TRACE_EVENT_PP_SUBMIT - VR_JOB_TRACE_EVENT_GP_SUBMIT,
+		                          (struct vr_pp_job *) tracker->job, 0, 0, VR_TRUE);
+		break;
+	default:
+		/* Soft jobs, fence waits and sync trackers are not traced */
+		break;
+	}
+}
+
+u32 vr_job_trace_snapshot(vr_job_trace_header *header, vr_job_trace_event *events)
+{
+	u32 head, pos, num_events = 0, num_lost = 0;
+
+	VR_DEBUG_ASSERT_POINTER(header);
+	VR_DEBUG_ASSERT_POINTER(events);
+
+	header->magic = VR_JOB_TRACE_MAGIC;
+	header->version = VR_JOB_TRACE_VERSION;
+	header->event_size = sizeof(vr_job_trace_event);
+	header->reserved[0] = 0;
+	header->reserved[1] = 0;
+	header->reserved[2] = 0;
+
+	if (NULL == trace_ring) {
+		header->num_events = 0;
+		header->num_lost = 0;
+		return 0;
+	}
+
+	head = _vr_osk_atomic_read(&trace_write_pos);
+	pos = trace_read_base;
+	if (head - pos > VR_JOB_TRACE_RING_SIZE) {
+		num_lost = head - pos - VR_JOB_TRACE_RING_SIZE;
+		pos = head - VR_JOB_TRACE_RING_SIZE;
+	}
+
+	for (; pos != head; pos++) {
+		vr_job_trace_event *record = &trace_ring[pos & VR_JOB_TRACE_RING_MASK];
+		vr_job_trace_event *copy = &events[num_events];
+
+		if (pos + 1 != record->seq) {
+			/* Still being written, or already overwritten by a newer event */
+			num_lost++;
+			continue;
+		}
+
+		_vr_osk_mem_barrier();
+		_vr_osk_memcpy(copy, record, sizeof(vr_job_trace_event));
+		_vr_osk_mem_barrier();
+
+		if (pos + 1 != record->seq) {
+			num_lost++;
+			continue;
+		}
+
+		num_events++;
+	}
+
+	header->num_events = num_events;
+	header->num_lost = num_lost;
+
+	return num_events;
+}
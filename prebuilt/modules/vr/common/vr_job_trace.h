@@ -0,0 +1,132 @@
+/*
+ * This confidential and proprietary software may be used only as
+ * authorised by a licensing agreement from NEXELL Limited
+ * (C) COPYRIGHT 2013 NEXELL Limited
+ * ALL RIGHTS RESERVED
+ * The entire notice above must be reproduced on all authorised
+ * copies and copies may only be made to the extent permitted
+ * by a licensing agreement from NEXELL Limited.
+ */
+
+#ifndef __VR_JOB_TRACE_H__
+#define __VR_JOB_TRACE_H__
+
+#include "vr_osk.h"
+#include <linux/vr/vr_utgard_job_trace.h>
+
+/**
+ * Fixed-size job lifecycle trace.
+ *
+ * Events are written into a power of two sized ring without taking any locks, so the
+ * hooks can be called from the scheduler upper half as well as with group and timeline
+ * locks held. When the ring is full the oldest events are overwritten.
+ */
+
+/* Number of events kept in the ring, must be a power of two */
+#define VR_JOB_TRACE_RING_SIZE 4096
+
+struct vr_gp_job;
+struct vr_pp_job;
+struct vr_timeline_tracker;
+
+#if defined(VR_JOB_TRACE) && (0 != VR_JOB_TRACE)
+
+extern vr_bool vr_job_trace_active;
+
+/**
+ * Allocate the trace ring. Tracing starts disabled.
+ *
+ * @return _VR_OSK_ERR_OK on success, otherwise failure.
+ */
+_vr_osk_errcode_t vr_job_trace_init(void);
+
+/**
+ * Free the trace ring.
+ */
+void vr_job_trace_term(void);
+
+/**
+ * Enable or disable recording of events.
+ */
+void vr_job_trace_set_enabled(vr_bool enabled);
+
+VR_STATIC_INLINE vr_bool vr_job_trace_enabled(void)
+{
+	return vr_job_trace_active;
+}
+
+/**
+ * Drop all events recorded so far.
+ */
+void vr_job_trace_clear(void);
+
+/**
+ * Copy the recorded events, oldest first, into a caller supplied buffer.
+ *
+ * Events which are overwritten or being written while copying are skipped and
+ * accounted for in the header's num_lost field.
+ *
+ * @param header Filled in with the stream header.
+ * @param events Buffer for at least VR_JOB_TRACE_RING_SIZE events.
+ * @return Number of events copied.
+ */
+u32 vr_job_trace_snapshot(vr_job_trace_header *header, vr_job_trace_event *events);
+
+void vr_job_trace_add_gp_event(vr_job_trace_event_type event, struct vr_gp_job *job, vr_bool success);
+void vr_job_trace_add_pp_event(vr_job_trace_event_type event, struct vr_pp_job *job, u32 sub_job, u32 core, vr_bool success);
+void vr_job_trace_add_tracker_event(vr_job_trace_event_type gp_event, struct vr_timeline_tracker *tracker);
+
+/**
+ * Record a GP job event.
+ */
+VR_STATIC_INLINE void vr_job_trace_gp(vr_job_trace_event_type event, struct vr_gp_job *job, vr_bool success)
+{
+	if (vr_job_trace_enabled()) {
+		vr_job_trace_add_gp_event(event, job, success);
+	}
+}
+
+/**
+ * Record a PP job event.
+ *
+ * @param core Id of the PP core, or VR_JOB_TRACE_CORE_VIRTUAL.
+ */
+VR_STATIC_INLINE void vr_job_trace_pp(vr_job_trace_event_type event, struct vr_pp_job *job, u32 sub_job, u32 core, vr_bool success)
+{
+	if (vr_job_trace_enabled()) {
+		vr_job_trace_add_pp_event(event, job, sub_job, core, success);
+	}
+}
+
+/**
+ * Record a timeline event for the GP or PP job owning a tracker.
+ *
+ * @param gp_event GP flavour of the event, translated to the PP one for PP trackers.
+ * Trackers of other types are ignored.
+ */
+VR_STATIC_INLINE void vr_job_trace_tracker(vr_job_trace_event_type gp_event, struct vr_timeline_tracker *tracker)
+{
+	if (vr_job_trace_enabled()) {
+		vr_job_trace_add_tracker_event(gp_event, tracker);
+	}
+}
+
+#else /* defined(VR_JOB_TRACE) && (0 != VR_JOB_TRACE) */
+
+VR_STATIC_INLINE _vr_osk_errcode_t vr_job_trace_init(void)
+{
+	return _VR_OSK_ERR_OK;
+}
+
+VR_STATIC_INLINE void vr_job_trace_term(void) {}
+VR_STATIC_INLINE vr_bool vr_job_trace_enabled(void)
+{
+	return VR_FALSE;
+}
+VR_STATIC_INLINE void vr_job_trace_gp(vr_job_trace_event_type event, struct vr_gp_job *job, vr_bool success) {}
+VR_STATIC_INLINE void vr_job_trace_pp(vr_job_trace_event_type event, struct vr_pp_job *job, u32 sub_job, u32 core, vr_bool success) {}
+VR_STATIC_INLINE void vr_job_trace_tracker(vr_job_trace_event_type gp_event, struct vr_timeline_tracker *tracker) {}
+
+#endif /* defined(VR_JOB_TRACE) && (0 != VR_JOB_TRACE) */
+
+#endif /* __VR_JOB_TRACE_H__ */
@@ -35,6 +35,7 @@
 #include "vr_timeline.h"
 #include "vr_soft_job.h"
 #include "vr_pm_domain.h"
+#include "vr_job_trace.h"
 #if defined(CONFIG_VR400_PROFILING)
 #include "vr_osk_profiling.h"
 #endif
@@ -891,6 +892,9 @@ _vr_osk_errcode_t vr_initialize_subsystems(void)
 
 	vr_pp_job_initialize();
 
+	err = vr_timeline_initialize();
+	if (_VR_OSK_ERR_OK != err) goto timeline_init_failed;
+
 	err = vr_session_initialize();
 	if (_VR_OSK_ERR_OK != err) goto session_init_failed;
 
@@ -902,6 +906,12 @@ _vr_osk_errcode_t vr_initialize_subsystems(void)
 	}
 #endif
 
+	err = vr_job_trace_init();
+	if (_VR_OSK_ERR_OK != err) {
+		/* Job tracing is a debug aid, carry on without it */
+		VR_PRINT_ERROR(("Failed to initialize job trace, feature will be unavailable\n"));
+	}
+
 	err = vr_memory_initialize();
 	if (_VR_OSK_ERR_OK != err) goto memory_init_failed;
 
@@ -1042,11 +1052,14 @@ set_global_gpu_base_address_failed:
 parse_memory_config_failed:
 	vr_memory_terminate();
 memory_init_failed:
+	vr_job_trace_term();
 #if defined(CONFIG_VR400_PROFILING)
 	_vr_osk_profiling_term();
 #endif
 	vr_session_terminate();
 session_init_failed:
+	vr_timeline_terminate();
+timeline_init_failed:
 	vr_pp_job_terminate();
 	return err;
 }
@@ -1080,6 +1093,7 @@ void vr_terminate_subsystems(void)
 	}
 	vr_pm_terminate();
 	vr_memory_terminate();
+	vr_job_trace_term();
 #if defined(CONFIG_VR400_PROFILING)
 	_vr_osk_profiling_term();
 #endif
@@ -1089,6 +1103,7 @@ void vr_terminate_subsystems(void)
 
 	vr_pp_scheduler_terminate();
 	vr_session_terminate();
+	vr_timeline_terminate();
 
 	vr_pp_job_terminate();
 }
@@ -519,6 +519,49 @@ void *_vr_osk_memcpy( void *dst, const void *src, u32 len );
 void *_vr_osk_memset( void *s, u32 c, u32 n );
 /** @} */ /* end group _vr_osk_memory */
 
+/** @addtogroup _vr_osk_mem_cache
+ * @{ */
+
+/** @brief Create a cache of fixed size objects.
+ *
+ * Objects that are allocated and freed often should come from a cache rather
+ * than from _vr_osk_calloc(), so freed objects can be handed out again without
+ * going through the general purpose allocator.
+ *
+ * @param name Name of the cache, shown by the OS allocator statistics.
+ * @param size Size of each object in bytes.
+ * @return The cache on success, NULL on failure.
+ */
+_vr_osk_mem_cache_t *_vr_osk_mem_cache_create( const char *name, u32 size );
+
+/** @brief Destroy an object cache.
+ *
+ * All objects must have been returned with _vr_osk_mem_cache_free().
+ *
+ * It is legal to destroy the NULL cache.
+ *
+ * @param cache The cache to destroy.
+ */
+void _vr_osk_mem_cache_destroy( _vr_osk_mem_cache_t *cache );
+
+/** @brief Allocate a zeroed object from a cache.
+ *
+ * @param cache The cache to allocate from.
+ * @return The object on success, NULL on failure.
+ */
+void *_vr_osk_mem_cache_zalloc( _vr_osk_mem_cache_t *cache );
+
+/** @brief Return an object to the cache it was allocated from.
+ *
+ * It is legal to free the NULL pointer.
+ *
+ * @param cache The cache the object was allocated from.
+ * @param ptr The object.
+ */
+void _vr_osk_mem_cache_free( _vr_osk_mem_cache_t *cache, void *ptr );
+
+/** @} */ /* end group _vr_osk_mem_cache */
+
 
 /** @brief Checks the amount of memory allocated
  *
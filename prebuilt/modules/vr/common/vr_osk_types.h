@@ -92,6 +92,14 @@ typedef enum {
 
 /** @} */ /* end group _vr_osk_miscellaneous */
 
+/** @defgroup _vr_osk_mem_cache OSK object caches
+ * @{ */
+
+/** @brief Private type for fixed size object caches */
+typedef struct _vr_osk_mem_cache_s _vr_osk_mem_cache_t;
+
+/** @} */ /* end group _vr_osk_mem_cache */
+
 /** @defgroup _vr_osk_wq OSK work queues
  * @{ */
 
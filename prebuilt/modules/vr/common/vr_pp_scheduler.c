@@ -21,6 +21,7 @@
 #include "vr_timeline.h"
 #include "vr_osk_profiling.h"
 #include "vr_kernel_utilization.h"
+#include "vr_job_trace.h"
 #include "vr_session.h"
 #include "vr_pm_domain.h"
 #include "linux/vr/vr_utgard.h"
@@ -990,6 +991,10 @@ void vr_pp_scheduler_job_done(struct vr_group *group, struct vr_pp_job *job, u32
 	                     success ? "success" : "failure"));
 
 	VR_ASSERT_GROUP_LOCKED(group);
+
+	vr_job_trace_pp(VR_JOB_TRACE_EVENT_PP_DONE, job, sub_job,
+	                vr_group_is_virtual(group) ? VR_JOB_TRACE_CORE_VIRTUAL : vr_pp_core_get_id(group->pp_core), success);
+
 	vr_pp_scheduler_lock();
 
 	vr_pp_job_mark_sub_job_completed(job, success);
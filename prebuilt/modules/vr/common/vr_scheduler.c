@@ -21,10 +21,20 @@ static _vr_osk_atomic_t vr_job_cache_order_autonumber;
 static _vr_osk_wq_work_t *pp_scheduler_wq_high_pri = NULL;
 static _vr_osk_wq_work_t *gp_scheduler_wq_high_pri = NULL;
 
+/* Set while a deferred run is queued but has not started yet */
+static _vr_osk_atomic_t pp_scheduler_wq_pending;
+static _vr_osk_atomic_t gp_scheduler_wq_pending;
+
+static _vr_osk_atomic_t vr_scheduler_requests;
+static _vr_osk_atomic_t vr_scheduler_kicks;
+static _vr_osk_atomic_t vr_scheduler_deferred_merged;
+
 static void vr_scheduler_wq_schedule_pp(void *arg)
 {
 	VR_IGNORE(arg);
 
+	/* Clear before scheduling, requests arriving from now on need another run. */
+	_vr_osk_atomic_xchg(&pp_scheduler_wq_pending, 0);
 	vr_pp_scheduler_schedule();
 }
 
@@ -32,6 +42,7 @@ static void vr_scheduler_wq_schedule_gp(void *arg)
 {
 	VR_IGNORE(arg);
 
+	_vr_osk_atomic_xchg(&gp_scheduler_wq_pending, 0);
 	vr_gp_scheduler_schedule();
 }
 
@@ -63,11 +74,22 @@ _vr_osk_errcode_t vr_scheduler_initialize(void)
 		return _VR_OSK_ERR_NOMEM;
 	}
 
+	_vr_osk_atomic_init(&pp_scheduler_wq_pending, 0);
+	_vr_osk_atomic_init(&gp_scheduler_wq_pending, 0);
+	_vr_osk_atomic_init(&vr_scheduler_requests, 0);
+	_vr_osk_atomic_init(&vr_scheduler_kicks, 0);
+	_vr_osk_atomic_init(&vr_scheduler_deferred_merged, 0);
+
 	return _VR_OSK_ERR_OK;
 }
 
 void vr_scheduler_terminate(void)
 {
+	_vr_osk_atomic_term(&vr_scheduler_deferred_merged);
+	_vr_osk_atomic_term(&vr_scheduler_kicks);
+	_vr_osk_atomic_term(&vr_scheduler_requests);
+	_vr_osk_atomic_term(&gp_scheduler_wq_pending);
+	_vr_osk_atomic_term(&pp_scheduler_wq_pending);
 	_vr_osk_wq_delete_work(gp_scheduler_wq_high_pri);
 	_vr_osk_wq_delete_work(pp_scheduler_wq_high_pri);
 	_vr_osk_atomic_term(&vr_job_cache_order_autonumber);
@@ -88,25 +110,52 @@ u32 vr_scheduler_get_new_cache_order(void)
 
 void vr_scheduler_schedule_from_mask(vr_scheduler_mask mask, vr_bool deferred_schedule)
 {
+	if (VR_SCHEDULER_MASK_EMPTY == mask) {
+		return;
+	}
+
+	_vr_osk_atomic_inc(&vr_scheduler_requests);
+
 	if (VR_SCHEDULER_MASK_GP & mask) {
 		/* GP needs scheduling. */
 		if (deferred_schedule) {
-			/* Schedule GP deferred. */
-			_vr_osk_wq_schedule_work_high_pri(gp_scheduler_wq_high_pri);
+			/* Schedule GP deferred, unless a deferred run is already pending. */
+			if (0 == _vr_osk_atomic_xchg(&gp_scheduler_wq_pending, 1)) {
+				_vr_osk_wq_schedule_work_high_pri(gp_scheduler_wq_high_pri);
+				_vr_osk_atomic_inc(&vr_scheduler_kicks);
+			} else {
+				_vr_osk_atomic_inc(&vr_scheduler_deferred_merged);
+			}
 		} else {
 			/* Schedule GP now. */
 			vr_gp_scheduler_schedule();
+			_vr_osk_atomic_inc(&vr_scheduler_kicks);
 		}
 	}
 
 	if (VR_SCHEDULER_MASK_PP & mask) {
 		/* PP needs scheduling. */
 		if (deferred_schedule) {
-			/* Schedule PP deferred. */
-			_vr_osk_wq_schedule_work_high_pri(pp_scheduler_wq_high_pri);
+			/* Schedule PP deferred, unless a deferred run is already pending. */
+			if (0 == _vr_osk_atomic_xchg(&pp_scheduler_wq_pending, 1)) {
+				_vr_osk_wq_schedule_work_high_pri(pp_scheduler_wq_high_pri);
+				_vr_osk_atomic_inc(&vr_scheduler_kicks);
+			} else {
+				_vr_osk_atomic_inc(&vr_scheduler_deferred_merged);
+			}
 		} else {
 			/* Schedule PP now. */
 			vr_pp_scheduler_schedule();
+			_vr_osk_atomic_inc(&vr_scheduler_kicks);
 		}
 	}
 }
+
+void vr_scheduler_get_stats(struct vr_scheduler_stats *stats)
+{
+	VR_DEBUG_ASSERT_POINTER(stats);
+
+	stats->requests = _vr_osk_atomic_read(&vr_scheduler_requests);
+	stats->kicks = _vr_osk_atomic_read(&vr_scheduler_kicks);
+	stats->deferred_merged = _vr_osk_atomic_read(&vr_scheduler_deferred_merged);
+}
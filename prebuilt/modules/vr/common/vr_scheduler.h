@@ -61,11 +61,31 @@ VR_STATIC_INLINE vr_bool vr_scheduler_mask_is_set(vr_scheduler_mask mask, vr_sch
 /**
  * Schedule GP and PP according to bitmask.
  *
+ * Deferred requests for a scheduler that already has a deferred run pending are merged
+ * into that run, so a burst of releases (e.g. several sync fences signaled at once) only
+ * kicks each scheduler once.
+ *
  * @param mask A scheduling bitmask.
  * @param deferred_schedule VR_TRUE if schedule should be deferred, VR_FALSE if not.
  */
 void vr_scheduler_schedule_from_mask(vr_scheduler_mask mask, vr_bool deferred_schedule);
 
+/**
+ * Scheduler kick statistics.
+ */
+struct vr_scheduler_stats {
+	u32 requests;          /**< Non-empty masks passed to vr_scheduler_schedule_from_mask(). */
+	u32 kicks;             /**< GP or PP scheduler runs started or queued as a result. */
+	u32 deferred_merged;   /**< Deferred requests merged into an already pending run. */
+};
+
+/**
+ * Get scheduler kick statistics.
+ *
+ * @param stats Filled in with the current counter values.
+ */
+void vr_scheduler_get_stats(struct vr_scheduler_stats *stats);
+
 /* Enable or disable scheduler hint. */
 extern vr_bool vr_scheduler_hints[VR_SCHEDULER_HINT_MAX];
 
@@ -15,9 +15,18 @@
 #include "vr_soft_job.h"
 #include "vr_timeline_fence_wait.h"
 #include "vr_timeline_sync_fence.h"
+#include "vr_job_trace.h"
 
 #define VR_TIMELINE_SYSTEM_LOCKED(system) (vr_spinlock_reentrant_is_held((system)->spinlock, _vr_osk_get_tid()))
 
+/* Waiters are created and released for every dependency of every job, keep them in a cache. */
+static _vr_osk_mem_cache_t *vr_timeline_waiter_cache = NULL;
+
+static _vr_osk_atomic_t vr_timeline_waiters_allocated;
+static _vr_osk_atomic_t vr_timeline_waiters_reused;
+static _vr_osk_atomic_t vr_timeline_updates;
+static _vr_osk_atomic_t vr_timeline_waiters_released;
+
 static vr_scheduler_mask vr_timeline_system_release_waiter(struct vr_timeline_system *system,
         struct vr_timeline_waiter *waiter);
 
@@ -363,6 +372,7 @@ static void vr_timeline_update_delayed_work(struct vr_timeline *timeline)
 static vr_scheduler_mask vr_timeline_update_oldest_point(struct vr_timeline *timeline)
 {
 	vr_scheduler_mask schedule_mask = VR_SCHEDULER_MASK_EMPTY;
+	vr_bool released = VR_FALSE;
 
 	VR_DEBUG_ASSERT_POINTER(timeline);
 
@@ -407,8 +417,15 @@ static vr_scheduler_mask vr_timeline_update_oldest_point(struct vr_timeline *tim
 		timeline->waiter_tail = waiter->timeline_next;
 
 		/* Release waiter.  This could activate a tracker, if this was
-		 * the last waiter for the tracker. */
+		 * the last waiter for the tracker.  The scheduler masks of all activated
+		 * trackers are merged so the caller kicks the schedulers once per update. */
 		schedule_mask |= vr_timeline_system_release_waiter(timeline->system, waiter);
+		_vr_osk_atomic_inc(&vr_timeline_waiters_released);
+		released = VR_TRUE;
+	}
+
+	if (released) {
+		_vr_osk_atomic_inc(&vr_timeline_updates);
 	}
 
 	return schedule_mask;
@@ -545,6 +562,8 @@ static vr_scheduler_mask vr_timeline_tracker_activate(struct vr_timeline_tracker
 
 	tracker->os_tick_activate = _vr_osk_time_tickcount();
 
+	vr_job_trace_tracker(VR_JOB_TRACE_EVENT_GP_ACTIVATE, tracker);
+
 	if (NULL != tracker->waiter_head) {
 		vr_timeline_system_release_waiter_list(system, tracker->waiter_tail, tracker->waiter_head);
 		tracker->waiter_head = NULL;
@@ -641,6 +660,49 @@ void vr_timeline_fence_copy_uk_fence(struct vr_timeline_fence *fence, _vr_uk_fen
 	fence->sync_fd = uk_fence->sync_fd;
 }
 
+_vr_osk_errcode_t vr_timeline_initialize(void)
+{
+	vr_timeline_waiter_cache = _vr_osk_mem_cache_create("vr_timeline_waiter", sizeof(struct vr_timeline_waiter));
+	if (NULL == vr_timeline_waiter_cache) {
+		return _VR_OSK_ERR_NOMEM;
+	}
+
+	if (_VR_OSK_ERR_OK != vr_timeline_fence_wait_initialize()) {
+		_vr_osk_mem_cache_destroy(vr_timeline_waiter_cache);
+		vr_timeline_waiter_cache = NULL;
+		return _VR_OSK_ERR_NOMEM;
+	}
+
+	_vr_osk_atomic_init(&vr_timeline_waiters_allocated, 0);
+	_vr_osk_atomic_init(&vr_timeline_waiters_reused, 0);
+	_vr_osk_atomic_init(&vr_timeline_updates, 0);
+	_vr_osk_atomic_init(&vr_timeline_waiters_released, 0);
+
+	return _VR_OSK_ERR_OK;
+}
+
+void vr_timeline_terminate(void)
+{
+	_vr_osk_atomic_term(&vr_timeline_waiters_released);
+	_vr_osk_atomic_term(&vr_timeline_updates);
+	_vr_osk_atomic_term(&vr_timeline_waiters_reused);
+	_vr_osk_atomic_term(&vr_timeline_waiters_allocated);
+
+	vr_timeline_fence_wait_terminate();
+	_vr_osk_mem_cache_destroy(vr_timeline_waiter_cache);
+	vr_timeline_waiter_cache = NULL;
+}
+
+void vr_timeline_get_stats(struct vr_timeline_stats *stats)
+{
+	VR_DEBUG_ASSERT_POINTER(stats);
+
+	stats->waiters_allocated = _vr_osk_atomic_read(&vr_timeline_waiters_allocated);
+	stats->waiters_reused = _vr_osk_atomic_read(&vr_timeline_waiters_reused);
+	stats->updates = _vr_osk_atomic_read(&vr_timeline_updates);
+	stats->waiters_released = _vr_osk_atomic_read(&vr_timeline_waiters_released);
+}
+
 struct vr_timeline_system *vr_timeline_system_create(struct vr_session_data *session)
 {
 	u32 i;
@@ -823,7 +885,7 @@ void vr_timeline_system_destroy(struct vr_timeline_system *system)
 		waiter = system->waiter_empty_list;
 		while (NULL != waiter) {
 			next = waiter->tracker_next;
-			_vr_osk_free(waiter);
+			_vr_osk_mem_cache_free(vr_timeline_waiter_cache, waiter);
 			waiter = next;
 		}
 
@@ -883,6 +945,7 @@ static struct vr_timeline_waiter *vr_timeline_system_get_zeroed_waiter(struct vr
 		/* Remove waiter from empty list and zero it */
 		system->waiter_empty_list = waiter->tracker_next;
 		_vr_osk_memset(waiter, 0, sizeof(*waiter));
+		_vr_osk_atomic_inc(&vr_timeline_waiters_reused);
 	}
 
 	/* Return NULL if list was empty. */
@@ -916,8 +979,9 @@ static void vr_timeline_system_allocate_waiters(struct vr_timeline_system *syste
 				continue;
 			}
 		} else {
-			waiter = _vr_osk_calloc(1, sizeof(struct vr_timeline_waiter));
+			waiter = _vr_osk_mem_cache_zalloc(vr_timeline_waiter_cache);
 			if (NULL == waiter) break;
+			_vr_osk_atomic_inc(&vr_timeline_waiters_allocated);
 		}
 		++i;
 		if (NULL == *tail) {
@@ -1130,6 +1194,9 @@ vr_timeline_point vr_timeline_system_add_tracker(struct vr_timeline_system *syst
 	VR_DEBUG_ASSERT(0 < tracker->trigger_ref_count);
 	tracker->system = system;
 
+	/* Must be recorded before the tracker is published, it may be activated and freed below. */
+	vr_job_trace_tracker(VR_JOB_TRACE_EVENT_GP_SUBMIT, tracker);
+
 	vr_spinlock_reentrant_wait(system->spinlock, tid);
 
 	num_waiters = vr_timeline_fence_num_waiters(&tracker->fence);
@@ -317,6 +317,35 @@ VR_STATIC_INLINE vr_bool vr_timeline_is_full(struct vr_timeline *timeline)
 	return VR_TIMELINE_MAX_POINT_SPAN <= (timeline->point_next - timeline->point_oldest);
 }
 
+/**
+ * Timeline allocation and signaling statistics, summed over all sessions.
+ */
+struct vr_timeline_stats {
+	u32 waiters_allocated; /**< Waiters taken from the waiter cache. */
+	u32 waiters_reused;    /**< Waiters taken from a system's empty list, allocation avoided. */
+	u32 updates;           /**< Timeline updates that released at least one waiter. */
+	u32 waiters_released;  /**< Waiters released by those updates. */
+};
+
+/**
+ * Create the object caches shared by all timeline systems.
+ *
+ * @return _VR_OSK_ERR_OK on success, otherwise failure.
+ */
+_vr_osk_errcode_t vr_timeline_initialize(void);
+
+/**
+ * Destroy the object caches shared by all timeline systems.
+ */
+void vr_timeline_terminate(void);
+
+/**
+ * Get timeline statistics.
+ *
+ * @param stats Filled in with the current counter values.
+ */
+void vr_timeline_get_stats(struct vr_timeline_stats *stats);
+
 /**
  * Create a new timeline system.
  *
@@ -14,6 +14,24 @@
 #include "vr_kernel_common.h"
 #include "vr_spinlock_reentrant.h"
 
+static _vr_osk_mem_cache_t *vr_timeline_fence_wait_cache = NULL;
+
+_vr_osk_errcode_t vr_timeline_fence_wait_initialize(void)
+{
+	vr_timeline_fence_wait_cache = _vr_osk_mem_cache_create("vr_fence_wait", sizeof(struct vr_timeline_fence_wait_tracker));
+	if (NULL == vr_timeline_fence_wait_cache) {
+		return _VR_OSK_ERR_NOMEM;
+	}
+
+	return _VR_OSK_ERR_OK;
+}
+
+void vr_timeline_fence_wait_terminate(void)
+{
+	_vr_osk_mem_cache_destroy(vr_timeline_fence_wait_cache);
+	vr_timeline_fence_wait_cache = NULL;
+}
+
 /**
  * Allocate a fence waiter tracker.
  *
@@ -21,7 +39,7 @@
  */
 static struct vr_timeline_fence_wait_tracker *vr_timeline_fence_wait_tracker_alloc(void)
 {
-	return (struct vr_timeline_fence_wait_tracker *) _vr_osk_calloc(1, sizeof(struct vr_timeline_fence_wait_tracker));
+	return (struct vr_timeline_fence_wait_tracker *) _vr_osk_mem_cache_zalloc(vr_timeline_fence_wait_cache);
 }
 
 /**
@@ -33,7 +51,7 @@ static void vr_timeline_fence_wait_tracker_free(struct vr_timeline_fence_wait_tr
 {
 	VR_DEBUG_ASSERT_POINTER(wait);
 	_vr_osk_atomic_term(&wait->refcount);
-	_vr_osk_free(wait);
+	_vr_osk_mem_cache_free(vr_timeline_fence_wait_cache, wait);
 }
 
 /**
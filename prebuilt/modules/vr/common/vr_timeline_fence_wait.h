@@ -46,6 +46,18 @@ struct vr_timeline_fence_wait_tracker {
 	struct vr_timeline_tracker tracker; /**< Timeline tracker. */
 };
 
+/**
+ * Create the fence wait tracker cache.
+ *
+ * @return _VR_OSK_ERR_OK on success, otherwise failure.
+ */
+_vr_osk_errcode_t vr_timeline_fence_wait_initialize(void);
+
+/**
+ * Destroy the fence wait tracker cache.
+ */
+void vr_timeline_fence_wait_terminate(void);
+
 /**
  * Wait for a fence to be signaled, or timeout is reached.
  *
@@ -0,0 +1,82 @@
+/*
+ * This confidential and proprietary software may be used only as
+ * authorised by a licensing agreement from NEXELL Limited
+ * (C) COPYRIGHT 2013 NEXELL Limited
+ * ALL RIGHTS RESERVED
+ * The entire notice above must be reproduced on all authorised
+ * copies and copies may only be made to the extent permitted
+ * by a licensing agreement from NEXELL Limited.
+ */
+
+/**
+ * @file vr_utgard_job_trace.h
+ * Binary format of the job trace stream exported through debugfs (vr/job_trace/events)
+ */
+
+#ifndef __VR_UTGARD_JOB_TRACE_H__
+#define __VR_UTGARD_JOB_TRACE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define VR_JOB_TRACE_MAGIC   0x4A545256 /* "VRTJ" */
+#define VR_JOB_TRACE_VERSION 1
+
+/**
+ * Job lifecycle events.
+ *
+ * SUBMIT   - job handed to the timeline system (fence wait starts)
+ * ACTIVATE - all fence dependencies met, job queued on the scheduler (queue wait starts)
+ * START    - job (or PP sub job) written to the core
+ * DONE     - job (or PP sub job) completed by the core
+ */
+typedef enum {
+	VR_JOB_TRACE_EVENT_GP_SUBMIT   = 0,
+	VR_JOB_TRACE_EVENT_GP_ACTIVATE = 1,
+	VR_JOB_TRACE_EVENT_GP_START    = 2,
+	VR_JOB_TRACE_EVENT_GP_DONE     = 3,
+	VR_JOB_TRACE_EVENT_PP_SUBMIT   = 4,
+	VR_JOB_TRACE_EVENT_PP_ACTIVATE = 5,
+	VR_JOB_TRACE_EVENT_PP_START    = 6,
+	VR_JOB_TRACE_EVENT_PP_DONE     = 7,
+	VR_JOB_TRACE_EVENT_MAX
+} vr_job_trace_event_type;
+
+/* Value of the core field when a PP job runs on the virtual (broadcast) group */
+#define VR_JOB_TRACE_CORE_VIRTUAL 0xFF
+
+/* Flag set in the flags field of DONE events when the job failed */
+#define VR_JOB_TRACE_FLAG_FAILED  (1 << 0)
+
+/**
+ * Stream header, followed by num_events records ordered oldest first.
+ */
+typedef struct vr_job_trace_header {
+	u32 magic;          /**< VR_JOB_TRACE_MAGIC */
+	u32 version;        /**< VR_JOB_TRACE_VERSION */
+	u32 event_size;     /**< sizeof(struct vr_job_trace_event) */
+	u32 num_events;     /**< Number of records following the header */
+	u32 num_lost;       /**< Records overwritten before they could be read */
+	u32 reserved[3];    /**< Pads the header to 32 bytes so the records stay 64-bit aligned */
+} vr_job_trace_header;
+
+typedef struct vr_job_trace_event {
+	u64 timestamp;        /**< Nanoseconds, same clock as _vr_osk_time_get_ns() */
+	u32 seq;              /**< Sequence number, increments by one per record */
+	u16 event;            /**< vr_job_trace_event_type */
+	u8  core;             /**< Core id, or VR_JOB_TRACE_CORE_VIRTUAL */
+	u8  flags;            /**< VR_JOB_TRACE_FLAG_* */
+	u32 job_id;
+	u32 sub_job;
+	u32 pid;
+	u32 tid;
+	u32 frame_builder_id;
+	u32 flush_id;
+} vr_job_trace_event;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __VR_UTGARD_JOB_TRACE_H__ */
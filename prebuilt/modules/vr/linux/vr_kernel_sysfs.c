@@ -49,6 +49,9 @@
 #include "vr_gp_job.h"
 #include "vr_pp_job.h"
 #include "vr_pp_scheduler.h"
+#include "vr_job_trace.h"
+#include "vr_timeline.h"
+#include "vr_scheduler.h"
 
 #define PRIVATE_DATA_COUNTER_MAKE_GP(src) (src)
 #define PRIVATE_DATA_COUNTER_MAKE_PP(src) ((1 << 24) | src)
@@ -898,6 +901,137 @@ static const struct file_operations utilization_pp_fops = {
 	.read = utilization_pp_read,
 };
 
+static ssize_t timeline_stats_read(struct file *filp, char __user *ubuf, size_t cnt, loff_t *ppos)
+{
+	char buf[256];
+	size_t r;
+	struct vr_timeline_stats timeline_stats;
+	struct vr_scheduler_stats scheduler_stats;
+
+	vr_timeline_get_stats(&timeline_stats);
+	vr_scheduler_get_stats(&scheduler_stats);
+
+	r = snprintf(buf, sizeof(buf),
+	             "waiters_allocated: %u\n"
+	             "waiters_reused: %u\n"
+	             "timeline_updates: %u\n"
+	             "waiters_released: %u\n"
+	             "schedule_requests: %u\n"
+	             "schedule_kicks: %u\n"
+	             "schedule_deferred_merged: %u\n",
+	             timeline_stats.waiters_allocated, timeline_stats.waiters_reused,
+	             timeline_stats.updates, timeline_stats.waiters_released,
+	             scheduler_stats.requests, scheduler_stats.kicks, scheduler_stats.deferred_merged);
+	return simple_read_from_buffer(ubuf, cnt, ppos, buf, r);
+}
+
+static const struct file_operations timeline_stats_fops = {
+	.owner = THIS_MODULE,
+	.read = timeline_stats_read,
+};
+
+#if defined(VR_JOB_TRACE) && (0 != VR_JOB_TRACE)
+struct job_trace_snapshot {
+	vr_job_trace_header header;
+	vr_job_trace_event events[VR_JOB_TRACE_RING_SIZE];
+	size_t size;
+};
+
+static ssize_t job_trace_enable_write(struct file *filp, const char __user *ubuf, size_t cnt, loff_t *ppos)
+{
+	unsigned long val;
+	int ret;
+	char buf[32];
+
+	cnt = min(cnt, sizeof(buf) - 1);
+	if (copy_from_user(buf, ubuf, cnt)) {
+		return -EFAULT;
+	}
+	buf[cnt] = '\0';
+
+	ret = strict_strtoul(buf, 10, &val);
+	if (0 != ret) {
+		return ret;
+	}
+
+	vr_job_trace_set_enabled(0 != val ? VR_TRUE : VR_FALSE);
+
+	*ppos += cnt;
+	return cnt;
+}
+
+static ssize_t job_trace_enable_read(struct file *filp, char __user *ubuf, size_t cnt, loff_t *ppos)
+{
+	if (VR_TRUE == vr_job_trace_enabled()) {
+		return simple_read_from_buffer(ubuf, cnt, ppos, "1\n", 2);
+	} else {
+		return simple_read_from_buffer(ubuf, cnt, ppos, "0\n", 2);
+	}
+}
+
+static const struct file_operations job_trace_enable_fops = {
+	.owner = THIS_MODULE,
+	.read  = job_trace_enable_read,
+	.write = job_trace_enable_write,
+};
+
+/* The ring is copied once on open so a reader sees a consistent stream no matter
+ * how small its read() calls are. */
+static int job_trace_events_open(struct inode *inode, struct file *filp)
+{
+	struct job_trace_snapshot *snapshot;
+	u32 num_events;
+
+	if (FMODE_READ & filp->f_mode) {
+		snapshot = _vr_osk_valloc(sizeof(*snapshot));
+		if (NULL == snapshot) {
+			return -ENOMEM;
+		}
+
+		num_events = vr_job_trace_snapshot(&snapshot->header, snapshot->events);
+		snapshot->size = sizeof(vr_job_trace_header) + num_events * sizeof(vr_job_trace_event);
+		filp->private_data = snapshot;
+	}
+
+	return 0;
+}
+
+static ssize_t job_trace_events_read(struct file *filp, char __user *ubuf, size_t cnt, loff_t *ppos)
+{
+	struct job_trace_snapshot *snapshot = filp->private_data;
+
+	/* header and events are laid out back to back */
+	return simple_read_from_buffer(ubuf, cnt, ppos, &snapshot->header, snapshot->size);
+}
+
+/* Any write drops the events recorded so far */
+static ssize_t job_trace_events_write(struct file *filp, const char __user *ubuf, size_t cnt, loff_t *ppos)
+{
+	vr_job_trace_clear();
+
+	*ppos += cnt;
+	return cnt;
+}
+
+static int job_trace_events_release(struct inode *inode, struct file *filp)
+{
+	if (NULL != filp->private_data) {
+		_vr_osk_vfree(filp->private_data);
+		filp->private_data = NULL;
+	}
+
+	return 0;
+}
+
+static const struct file_operations job_trace_events_fops = {
+	.owner = THIS_MODULE,
+	.open = job_trace_events_open,
+	.read = job_trace_events_read,
+	.write = job_trace_events_write,
+	.release = job_trace_events_release,
+};
+#endif /* defined(VR_JOB_TRACE) && (0 != VR_JOB_TRACE) */
+
 static ssize_t user_settings_write(struct file *filp, const char __user *ubuf, size_t cnt, loff_t *ppos)
 {
 	unsigned long val;
@@ -1294,6 +1428,17 @@ int vr_sysfs_register(const char *vr_dev_name)
 			debugfs_create_file("utilization_gp_pp", 0400, vr_debugfs_dir, NULL, &utilization_gp_pp_fops);
 			debugfs_create_file("utilization_gp", 0400, vr_debugfs_dir, NULL, &utilization_gp_fops);
 			debugfs_create_file("utilization_pp", 0400, vr_debugfs_dir, NULL, &utilization_pp_fops);
+			debugfs_create_file("timeline_stats", 0400, vr_debugfs_dir, NULL, &timeline_stats_fops);
+
+#if defined(VR_JOB_TRACE) && (0 != VR_JOB_TRACE)
+			{
+				struct dentry *vr_job_trace_dir = debugfs_create_dir("job_trace", vr_debugfs_dir);
+				if (vr_job_trace_dir != NULL) {
+					debugfs_create_file("enable", 0600, vr_job_trace_dir, NULL, &job_trace_enable_fops);
+					debugfs_create_file("events", 0600, vr_job_trace_dir, NULL, &job_trace_events_fops);
+				}
+			}
+#endif
 
 			vr_profiling_dir = debugfs_create_dir("profiling", vr_debugfs_dir);
 			if (vr_profiling_dir != NULL) {
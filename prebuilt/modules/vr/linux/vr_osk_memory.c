@@ -42,6 +42,30 @@ void inline _vr_osk_vfree( void *ptr )
 	vfree(ptr);
 }
 
+_vr_osk_mem_cache_t *_vr_osk_mem_cache_create( const char *name, u32 size )
+{
+	return (_vr_osk_mem_cache_t *)kmem_cache_create(name, size, 0, SLAB_HWCACHE_ALIGN, NULL);
+}
+
+void _vr_osk_mem_cache_destroy( _vr_osk_mem_cache_t *cache )
+{
+	if (NULL != cache) {
+		kmem_cache_destroy((struct kmem_cache *)cache);
+	}
+}
+
+void *_vr_osk_mem_cache_zalloc( _vr_osk_mem_cache_t *cache )
+{
+	return kmem_cache_zalloc((struct kmem_cache *)cache, GFP_KERNEL);
+}
+
+void _vr_osk_mem_cache_free( _vr_osk_mem_cache_t *cache, void *ptr )
+{
+	if (NULL != ptr) {
+		kmem_cache_free((struct kmem_cache *)cache, ptr);
+	}
+}
+
 void inline *_vr_osk_memcpy( void *dst, const void *src, u32	len )
 {
 	return memcpy(dst, src, len);
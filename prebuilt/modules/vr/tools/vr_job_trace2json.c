@@ -0,0 +1,239 @@
+/*
+ * This confidential and proprietary software may be used only as
+ * authorised by a licensing agreement from NEXELL Limited
+ * (C) COPYRIGHT 2013 NEXELL Limited
+ * ALL RIGHTS RESERVED
+ * The entire notice above must be reproduced on all authorised
+ * copies and copies may only be made to the extent permitted
+ * by a licensing agreement from NEXELL Limited.
+ */
+
+/**
+ * @file vr_job_trace2json.c
+ * Host side converter from the vr job trace stream to Chrome trace JSON.
+ *
+ * On the device:
+ *   echo 1 > /sys/kernel/debug/vr/job_trace/enable
+ *   echo 0 > /sys/kernel/debug/vr/job_trace/events      (drop old events)
+ *   ... run the workload ...
+ *   cat /sys/kernel/debug/vr/job_trace/events > /data/job_trace.bin
+ *
+ * On the host:
+ *   gcc -O2 -I../include -o vr_job_trace2json vr_job_trace2json.c
+ *   ./vr_job_trace2json job_trace.bin > job_trace.json
+ *
+ * The output loads in chrome://tracing and ui.perfetto.dev. Every job gets a
+ * "fence wait" slice (submit to activate), a "queue wait" slice (activate to
+ * first start) and one slice per GP job / PP sub job while it runs on a core.
+ * Jobs whose submit to done time exceeds the frame budget (-b, default 16 ms)
+ * are listed on stderr.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+typedef uint8_t  u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+
+#include <linux/vr/vr_utgard_job_trace.h>
+
+#define TRACK_GP      1
+#define TRACK_PP_BASE 2
+#define TRACK_VIRTUAL (TRACK_PP_BASE + VR_JOB_TRACE_CORE_VIRTUAL)
+
+static const char *event_names[VR_JOB_TRACE_EVENT_MAX] = {
+	"gp_submit", "gp_activate", "gp_start", "gp_done",
+	"pp_submit", "pp_activate", "pp_start", "pp_done",
+};
+
+static int is_pp(const vr_job_trace_event *e)
+{
+	return e->event >= VR_JOB_TRACE_EVENT_PP_SUBMIT;
+}
+
+/* Event kind without the GP/PP distinction: 0 submit, 1 activate, 2 start, 3 done */
+static int kind(const vr_job_trace_event *e)
+{
+	return e->event & 3;
+}
+
+static int same_job(const vr_job_trace_event *a, const vr_job_trace_event *b)
+{
+	return is_pp(a) == is_pp(b) && a->job_id == b->job_id;
+}
+
+/* Search backwards from index for an earlier event of the given kind on the same job */
+static const vr_job_trace_event *find_before(const vr_job_trace_event *events, u32 index,
+                                             const vr_job_trace_event *e, int want_kind, int match_sub_job)
+{
+	while (index-- > 0) {
+		const vr_job_trace_event *c = &events[index];
+		if (!same_job(c, e) || kind(c) != want_kind) continue;
+		if (match_sub_job && c->sub_job != e->sub_job) continue;
+		return c;
+	}
+	return NULL;
+}
+
+static int track_of(const vr_job_trace_event *e)
+{
+	if (!is_pp(e)) return TRACK_GP;
+	return TRACK_PP_BASE + e->core;
+}
+
+static int first_slice = 1;
+
+static void emit_slice(const char *name, u32 pid, int track, u64 start, u64 end,
+                       const vr_job_trace_event *e, u64 base)
+{
+	printf("%s\n  {\"name\":\"%s\",\"ph\":\"X\",\"pid\":%u,\"tid\":%d,"
+	       "\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"job\":%u,\"sub_job\":%u,"
+	       "\"frame_builder_id\":%u,\"flush_id\":%u,\"failed\":%d}}",
+	       first_slice ? "" : ",", name, pid, track,
+	       (double)(start - base) / 1000.0, (double)(end - start) / 1000.0,
+	       e->job_id, e->sub_job, e->frame_builder_id, e->flush_id,
+	       (e->flags & VR_JOB_TRACE_FLAG_FAILED) ? 1 : 0);
+	first_slice = 0;
+}
+
+static void emit_track_name(u32 pid, int track, const char *name)
+{
+	printf("%s\n  {\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%u,\"tid\":%d,"
+	       "\"args\":{\"name\":\"%s\"}}", first_slice ? "" : ",", pid, track, name);
+	first_slice = 0;
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr, "usage: %s [-b budget_ms] job_trace.bin > job_trace.json\n", prog);
+}
+
+int main(int argc, char **argv)
+{
+	const char *path = NULL;
+	double budget_ms = 16.0;
+	vr_job_trace_header header;
+	vr_job_trace_event *events;
+	u64 base;
+	u32 i, num_slow = 0;
+	FILE *fp;
+	int arg;
+
+	for (arg = 1; arg < argc; arg++) {
+		if (!strcmp(argv[arg], "-b") && arg + 1 < argc) {
+			budget_ms = atof(argv[++arg]);
+		} else if (NULL == path) {
+			path = argv[arg];
+		} else {
+			usage(argv[0]);
+			return 1;
+		}
+	}
+	if (NULL == path) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	fp = fopen(path, "rb");
+	if (NULL == fp) {
+		perror(path);
+		return 1;
+	}
+
+	if (1 != fread(&header, sizeof(header), 1, fp) ||
+	    VR_JOB_TRACE_MAGIC != header.magic) {
+		fprintf(stderr, "%s: not a vr job trace\n", path);
+		fclose(fp);
+		return 1;
+	}
+	if (VR_JOB_TRACE_VERSION != header.version || sizeof(vr_job_trace_event) != header.event_size) {
+		fprintf(stderr, "%s: unsupported version %u (event size %u)\n", path, header.version, header.event_size);
+		fclose(fp);
+		return 1;
+	}
+
+	events = calloc(header.num_events ? header.num_events : 1, sizeof(vr_job_trace_event));
+	if (NULL == events) {
+		fclose(fp);
+		return 1;
+	}
+	header.num_events = fread(events, sizeof(vr_job_trace_event), header.num_events, fp);
+	fclose(fp);
+
+	if (header.num_lost) {
+		fprintf(stderr, "warning: %u events were lost, some slices may be missing\n", header.num_lost);
+	}
+
+	base = header.num_events ? events[0].timestamp : 0;
+
+	printf("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+
+	for (i = 0; i < header.num_events; i++) {
+		const vr_job_trace_event *e = &events[i];
+		const vr_job_trace_event *from;
+
+		if (e->event >= VR_JOB_TRACE_EVENT_MAX) continue;
+
+		switch (kind(e)) {
+		case 1: /* activate: fence wait since submit */
+			from = find_before(events, i, e, 0, 0);
+			if (NULL != from && e->timestamp > from->timestamp) {
+				emit_slice(is_pp(e) ? "pp fence wait" : "gp fence wait", e->pid, 0, from->timestamp, e->timestamp, e, base);
+			}
+			break;
+		case 2: /* start: queue wait since activate, only for the first (sub) job start */
+			if (NULL == find_before(events, i, e, 2, 0)) {
+				from = find_before(events, i, e, 1, 0);
+				if (NULL != from) {
+					emit_slice(is_pp(e) ? "pp queue wait" : "gp queue wait", e->pid, 0, from->timestamp, e->timestamp, e, base);
+				}
+			}
+			break;
+		case 3: /* done: running time since start, and end to end latency */
+			from = find_before(events, i, e, 2, 1);
+			if (NULL != from) {
+				emit_slice(is_pp(e) ? "pp job" : "gp job", e->pid, track_of(from), from->timestamp, e->timestamp, e, base);
+			}
+			from = find_before(events, i, e, 0, 0);
+			if (NULL != from && (double)(e->timestamp - from->timestamp) / 1000000.0 > budget_ms) {
+				fprintf(stderr, "%s job %u (pid %u, frame builder %u, flush %u) took %.3f ms from submit to %s\n",
+				        is_pp(e) ? "PP" : "GP", e->job_id, e->pid, e->frame_builder_id, e->flush_id,
+				        (double)(e->timestamp - from->timestamp) / 1000000.0, event_names[e->event]);
+				num_slow++;
+			}
+			break;
+		default:
+			break;
+		}
+	}
+
+	/* Name the tracks of every process seen */
+	for (i = 0; i < header.num_events; i++) {
+		u32 j;
+		for (j = 0; j < i; j++) {
+			if (events[j].pid == events[i].pid) break;
+		}
+		if (j == i) {
+			char name[32];
+			int core;
+			emit_track_name(events[i].pid, 0, "waits");
+			emit_track_name(events[i].pid, TRACK_GP, "GP");
+			for (core = 0; core < 8; core++) {
+				snprintf(name, sizeof(name), "PP%d", core);
+				emit_track_name(events[i].pid, TRACK_PP_BASE + core, name);
+			}
+			emit_track_name(events[i].pid, TRACK_VIRTUAL, "PP virtual");
+		}
+	}
+
+	printf("\n]}\n");
+
+	fprintf(stderr, "%u events, %u over %.1f ms budget\n", header.num_events, num_slow, budget_ms);
+
+	free(events);
+	return 0;
+}
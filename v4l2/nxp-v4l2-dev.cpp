@@ -91,6 +91,44 @@ int V4l2Device::getCtrl(int ctrlId, int *value)
     return 0;
 }
 
+int V4l2Device::setCtrls(const int *ctrlIds, const int *values, int count)
+{
+    if (count <= 0)
+        return 0;
+    if (count > MAX_EXT_CTRLS) {
+        ALOGE("%s: too many controls %d", __func__, count);
+        return -EINVAL;
+    }
+
+    struct v4l2_ext_control ctrl[MAX_EXT_CTRLS];
+    struct v4l2_ext_controls ctrls;
+    bzero(ctrl, sizeof(ctrl[0]) * count);
+    bzero(&ctrls, sizeof(ctrls));
+
+    // controls of one class go together, mixed classes need ctrl_class 0
+    ctrls.ctrl_class = V4L2_CTRL_ID2CLASS(ctrlIds[0]);
+    for (int i = 0; i < count; i++) {
+        ctrl[i].id = ctrlIds[i];
+        ctrl[i].value = values[i];
+        if (V4L2_CTRL_ID2CLASS(ctrlIds[i]) != ctrls.ctrl_class)
+            ctrls.ctrl_class = 0;
+    }
+    ctrls.count = count;
+    ctrls.controls = ctrl;
+
+    int ret = ioctl(FD, VIDIOC_S_EXT_CTRLS, &ctrls);
+    if (ret == 0 || (errno != EINVAL && errno != ENOTTY))
+        return ret;
+
+    // a sensor driver without the control framework only has VIDIOC_S_CTRL
+    for (int i = 0; i < count; i++) {
+        ret = setCtrl(ctrlIds[i], values[i]);
+        if (ret)
+            return ret;
+    }
+    return 0;
+}
+
 V4l2Device::LinkStatus
 V4l2Device::checkLink(int myPad, int remoteEntity, int remotePad)
 {
@@ -402,8 +440,10 @@ int V4l2Video::qBuf(int planeNum, int index0, int *fds0, int *sizes0,
     }
 }
 
+/* offsets: data_offset of each plane, for planes sharing one dma-buf */
 int V4l2Video::qBuf(int planeNum, int index0, int const *fds0, int const *sizes0,
-            int index1, int const *fds1, int const *sizes1, int *syncfd0, int *syncfd1)
+            int index1, int const *fds1, int const *sizes1, int *syncfd0, int *syncfd1,
+            int const *offsets0, int const *offsets1)
 {
     struct v4l2_buffer v4l2_buf;
     struct v4l2_plane planes[NXP_VIDEO_MAX_BUFFER_PLANES];
@@ -424,6 +464,7 @@ int V4l2Video::qBuf(int planeNum, int index0, int const *fds0, int const *sizes0
         for (i = 0; i < planeNum; i++) {
             v4l2_buf.m.planes[i].m.fd = fds0[i];
             v4l2_buf.m.planes[i].length = sizes0[i];
+            v4l2_buf.m.planes[i].data_offset = offsets0 ? offsets0[i] : 0;
         }
 
         int ret =  ioctl(FD, VIDIOC_QBUF, &v4l2_buf);
@@ -447,6 +488,7 @@ int V4l2Video::qBuf(int planeNum, int index0, int const *fds0, int const *sizes0
         for (i = 0; i < planeNum; i++) {
             v4l2_buf.m.planes[i].m.fd = fds0[i];
             v4l2_buf.m.planes[i].length = sizes0[i];
+            v4l2_buf.m.planes[i].data_offset = offsets0 ? offsets0[i] : 0;
         }
 
         int ret = ioctl(FD, VIDIOC_QBUF, &v4l2_buf);
@@ -470,6 +512,7 @@ int V4l2Video::qBuf(int planeNum, int index0, int const *fds0, int const *sizes0
         for (i = 0; i < planeNum; i++) {
             v4l2_buf.m.planes[i].m.fd = fds1[i];
             v4l2_buf.m.planes[i].length = sizes1[i];
+            v4l2_buf.m.planes[i].data_offset = offsets1 ? offsets1[i] : 0;
         }
 
         ret = ioctl(FD, VIDIOC_QBUF, &v4l2_buf);
@@ -24,6 +24,7 @@
 #include <utils/Log.h>
 #endif
 
+#define MAX_EXT_CTRLS 16
 class V4l2Device {
 public:
     typedef enum {
@@ -69,7 +70,8 @@ public:
     virtual int qBuf(int planeNum, int index0, int *fds0, int *sizes0,
             int index1 = 0, int *fds1 = NULL, int *sizes1 = NULL, int *syncfd0 = NULL, int *syncfd1 = NULL) = 0;
     virtual int qBuf(int planeNum, int index0, int const *fds0, int const *sizes0,
-            int index1 = 0, int const *fds1 = NULL, int const *sizes1 = NULL, int *syncfd0 = NULL, int *syncfd1 = NULL) = 0;
+            int index1 = 0, int const *fds1 = NULL, int const *sizes1 = NULL, int *syncfd0 = NULL, int *syncfd1 = NULL,
+            int const *offsets0 = NULL, int const *offsets1 = NULL) = 0;
     virtual int dqBuf(int planeNum, int *index0, int *index1 = NULL) = 0;
     virtual int streamOn() = 0;
     virtual int streamOff() = 0;
@@ -79,6 +81,7 @@ public:
     /* common */
     virtual int setCtrl(int ctrlId, int value);
     virtual int getCtrl(int ctrlId, int *value);
+    virtual int setCtrls(const int *ctrlIds, const int *values, int count);
 
     virtual bool activate();
 
@@ -149,7 +152,8 @@ public:
         return -EINVAL;
     }
     virtual int qBuf(int planeNum, int index0, int const *fds0, int const *sizes0,
-            int index1 = 0, int const *fds1 = NULL, int const *sizes1 = NULL, int *syncfd0 = NULL, int *syncfd1 = NULL) {
+            int index1 = 0, int const *fds1 = NULL, int const *sizes1 = NULL, int *syncfd0 = NULL, int *syncfd1 = NULL,
+            int const *offsets0 = NULL, int const *offsets1 = NULL) {
         return -EINVAL;
     }
     virtual int dqBuf(int planeNum, int *index0, int *index1) {
@@ -199,7 +203,8 @@ public:
     virtual int qBuf(int planeNum, int index0, int *fds0, int *sizes0,
             int index1 = 0, int *fds1 = NULL, int *sizes1 = NULL, int *syncfd0 = NULL, int *syncfd1 = NULL);
     virtual int qBuf(int planeNum, int index0, int const *fds0, int const *sizes0,
-            int index1 = 0, int const *fds1 = NULL, int const *sizes1 = NULL, int *syncfd0 = NULL, int *syncfd1 = NULL);
+            int index1 = 0, int const *fds1 = NULL, int const *sizes1 = NULL, int *syncfd0 = NULL, int *syncfd1 = NULL,
+            int const *offsets0 = NULL, int const *offsets1 = NULL);
     virtual int dqBuf(int planeNum, int *index0, int *index1 = NULL);
     virtual int streamOn();
     virtual int streamOff();
@@ -268,6 +273,9 @@ public:
     virtual int getCtrl(int ctrlId, int *value) {
         return VideoDev->getCtrl(ctrlId, value);
     }
+    virtual int setCtrls(const int *ctrlIds, const int *values, int count) {
+        return VideoDev->setCtrls(ctrlIds, values, count);
+    }
     virtual int reqBuf(int count) {
         return VideoDev->reqBuf(count);
     }
@@ -277,9 +285,10 @@ public:
                 index0, fds0, sizes0, index1, fds1, sizes1, syncfd0, syncfd1);
     }
     virtual int qBuf(int planeNum, int index0, int const *fds0, int const *sizes0,
-            int index1 = 0, int const *fds1 = NULL, int const *sizes1 = NULL, int *syncfd0 = NULL, int *syncfd1 = NULL) {
+            int index1 = 0, int const *fds1 = NULL, int const *sizes1 = NULL, int *syncfd0 = NULL, int *syncfd1 = NULL,
+            int const *offsets0 = NULL, int const *offsets1 = NULL) {
         return VideoDev->qBuf(planeNum,
-                index0, fds0, sizes0, index1, fds1, sizes1, syncfd0, syncfd1);
+                index0, fds0, sizes0, index1, fds1, sizes1, syncfd0, syncfd1, offsets0, offsets1);
     }
     virtual int dqBuf(int planeNum, int *index0, int *index1 = NULL) {
         return VideoDev->dqBuf(planeNum, index0, index1);
@@ -158,10 +158,12 @@ public:
     int getCrop(int id, int *l, int *t, int *w, int *h, int pad = 0);
     int setCtrl(int id, int ctrlID, int value);
     int getCtrl(int id, int ctrlID, int *value);
+    int setCtrls(int id, const int *ctrlIDs, const int *values, int count);
     int reqBuf(int id, int bufCount);
     int qBuf(int id, int planeNum, int index0, int *fds0, int *sizes0, int *syncfd0 = NULL, int index1 = -1, int *fds1 = NULL, int *sizes1 = NULL, int *syncfd1 = NULL);
-    int qBuf(int id, int planeNum, int index0, int const *fds0, int const *sizes0, int *syncfd0 = NULL, int index1 = -1, int const *fds1 = NULL, int const *sizes1 = NULL, int *syncfd1 = NULL);
-    int dqBuf(int id, int planeNum, int *index0, int *index1 = NULL);
+    int qBuf(int id, int planeNum, int index0, int const *fds0, int const *sizes0, int *syncfd0 = NULL, int index1 = -1, int const *fds1 = NULL, int const *sizes1 = NULL, int *syncfd1 = NULL,
+            int const *offsets0 = NULL, int const *offsets1 = NULL);
+    int dqBuf(int id, int planeNum, int *index0, int *index1 = NULL, long long *timestamp = NULL);
     int streamOn(int id);
     int streamOff(int id);
     int getTimeStamp(int id, long long *timestamp);
@@ -1315,6 +1317,17 @@ int V4l2NexellPrivate::getCtrl(int id, int ctrlID, int *value)
     return pInfo->Device->getCtrl(ctrlID, value);
 }
 
+int V4l2NexellPrivate::setCtrls(int id, const int *ctrlIDs, const int *values, int count)
+{
+    DeviceInfo *pInfo = getDevice(id);
+    if (!pInfo || !pInfo->Device) {
+        ALOGE("%s: can't get device for %d", __func__, id);
+        return -EINVAL;
+    }
+
+    return pInfo->Device->setCtrls(ctrlIDs, values, count);
+}
+
 int V4l2NexellPrivate::reqBuf(int id, int bufCount)
 {
     DeviceInfo *pInfo = getDevice(id);
@@ -1340,7 +1353,8 @@ int V4l2NexellPrivate::qBuf(int id, int planeNum, int index0, int *fds0, int *si
         return pInfo->Device->qBuf(planeNum, index0, fds0, sizes0, index1, fds1, sizes1, syncfd0, syncfd1);
 }
 
-int V4l2NexellPrivate::qBuf(int id, int planeNum, int index0, int const *fds0, int const *sizes0, int *syncfd0, int index1, int const *fds1, int const *sizes1, int *syncfd1)
+int V4l2NexellPrivate::qBuf(int id, int planeNum, int index0, int const *fds0, int const *sizes0, int *syncfd0, int index1, int const *fds1, int const *sizes1, int *syncfd1,
+        int const *offsets0, int const *offsets1)
 {
     DeviceInfo *pInfo = getDevice(id);
     if (!pInfo || !pInfo->Device) {
@@ -1349,12 +1363,12 @@ int V4l2NexellPrivate::qBuf(int id, int planeNum, int index0, int const *fds0, i
     }
 
     if (!pInfo->isM2M())
-        return pInfo->Device->qBuf(planeNum, index0, fds0, sizes0, -1, NULL, NULL, syncfd0, NULL);
+        return pInfo->Device->qBuf(planeNum, index0, fds0, sizes0, -1, NULL, NULL, syncfd0, NULL, offsets0, NULL);
     else
-        return pInfo->Device->qBuf(planeNum, index0, fds0, sizes0, index1, fds1, sizes1, syncfd0, syncfd1);
+        return pInfo->Device->qBuf(planeNum, index0, fds0, sizes0, index1, fds1, sizes1, syncfd0, syncfd1, offsets0, offsets1);
 }
 
-int V4l2NexellPrivate::dqBuf(int id, int planeNum, int *index0, int *index1)
+int V4l2NexellPrivate::dqBuf(int id, int planeNum, int *index0, int *index1, long long *timestamp)
 {
     DeviceInfo *pInfo = getDevice(id);
     if (!pInfo || !pInfo->Device) {
@@ -1362,10 +1376,14 @@ int V4l2NexellPrivate::dqBuf(int id, int planeNum, int *index0, int *index1)
         return -EINVAL;
     }
 
-    if (!pInfo->isM2M())
-        return pInfo->Device->dqBuf(planeNum, index0);
-    else
+    if (pInfo->isM2M())
         return pInfo->Device->dqBuf(planeNum, index0, index1);
+
+    int ret = pInfo->Device->dqBuf(planeNum, index0);
+    // saves the device lookup of a getTimeStamp() per frame
+    if (ret >= 0 && timestamp)
+        *timestamp = pInfo->Device->getTimeStamp();
+    return ret;
 }
 
 int V4l2NexellPrivate::streamOn(int id)
@@ -116,123 +116,87 @@ int v4l2_get_ctrl(int id, int ctrl_id, int *value)
     return _priv->getCtrl(id, ctrl_id, value);
 }
 
+int v4l2_set_ctrls(int id, const int *ctrl_ids, const int *values, int count)
+{
+    return _priv->setCtrls(id, ctrl_ids, values, count);
+}
+
 int v4l2_reqbuf(int id, int buf_count)
 {
     return _priv->reqBuf(id, buf_count);
 }
 
 #ifdef ANDROID
+/*
+ * planes of a gralloc buffer, with PRIV_FLAGS_DATA_OFFSET they are all
+ * share_fd at their offsets, otherwise each plane goes as the fd of its slot
+ * from offset 0. Planes the buffer doesn't have go as fd -1 of size 0.
+ */
+static int get_handle_planes(struct private_handle_t const *b, int plane_num, int *fds, int *sizes, int *offsets)
+{
+    if (plane_num > GRALLOC_MAX_PLANES) {
+        ALOGE("%s: %d planes for format 0x%x", __func__, plane_num, b->format);
+        return -EINVAL;
+    }
+    int const shareFds[GRALLOC_MAX_PLANES] = { b->share_fd, b->share_fd1, b->share_fd2 };
+    int num = b->planeNum();
+    for (int i = 0; i < plane_num; i++) {
+        if (i >= num) {
+            fds[i] = -1;
+            sizes[i] = offsets[i] = 0;
+        } else if (b->flags & private_handle_t::PRIV_FLAGS_DATA_OFFSET) {
+            fds[i] = b->share_fd;
+            offsets[i] = b->plane_offset[i];
+            // the length runs from the start of the fd
+            sizes[i] = b->plane_offset[i] + b->plane_size[i];
+        } else {
+            fds[i] = shareFds[i];
+            sizes[i] = b->plane_size[i];
+            offsets[i] = 0;
+        }
+    }
+    return 0;
+}
+
 int v4l2_qbuf(int id, int plane_num, int index0, struct private_handle_t *b0, int index1, struct private_handle_t *b1, int *syncfd0, int *syncfd1)
 {
-    if (b1) {
-        if (plane_num == 1)
+    if (plane_num == 1) {
+        if (b1)
             return _priv->qBuf(id, plane_num, index0, &b0->share_fd, &b0->size, syncfd0, index1, &b1->share_fd, &b1->size, syncfd1);
-        else {
-            int srcFds0[3] = { b0->share_fd, b0->share_fd1, b0->share_fd2 };
-            int srcFds1[3] = { b1->share_fd, b1->share_fd1, b1->share_fd2 };
-            int sizes0[3];
-            sizes0[0] = b0->stride * ALIGN(b0->height, 16);
-            switch (b0->format) {
-            case HAL_PIXEL_FORMAT_YV12:
-                sizes0[1] = ALIGN(b0->stride >> 1, 16) * ALIGN(b0->height >> 1, 16);
-                sizes0[2] = sizes0[1];
-                break;
-            case HAL_PIXEL_FORMAT_YCrCb_420_SP:
-                sizes0[1] = b0->stride * ALIGN(b0->height >> 1, 16);
-                sizes0[2] = 0;
-                break;
-            }
-            int sizes1[3];
-            sizes1[0] = b1->stride * ALIGN(b1->height, 16);
-            switch (b1->format) {
-            case HAL_PIXEL_FORMAT_YV12:
-                sizes1[1] = ALIGN(b1->stride >> 1, 16) * ALIGN(b1->height >> 1, 16);
-                sizes1[2] = sizes1[1];
-                break;
-            case HAL_PIXEL_FORMAT_YCrCb_420_SP:
-                sizes1[1] = b1->stride * ALIGN(b1->height >> 1, 16);
-                sizes1[2] = 0;
-                break;
-            }
-            return _priv->qBuf(id, plane_num, index0, srcFds0, sizes0, syncfd0, index1, srcFds1, sizes1, syncfd1);
-        }
-    } else {
-        if (plane_num == 1)
-            return _priv->qBuf(id, plane_num, index0, &b0->share_fd, &b0->size, syncfd0);
-        else {
-            int srcFds0[3] = { b0->share_fd, b0->share_fd1, b0->share_fd2 };
-            int sizes0[3];
-            sizes0[0] = b0->stride * ALIGN(b0->height, 16);
-            switch (b0->format) {
-            case HAL_PIXEL_FORMAT_YV12:
-                sizes0[1] = ALIGN(b0->stride >> 1, 16) * ALIGN(b0->height >> 1, 16);
-                sizes0[2] = sizes0[1];
-                break;
-            case HAL_PIXEL_FORMAT_YCrCb_420_SP:
-                sizes0[1] = b0->stride * ALIGN(b0->height >> 1, 16);
-                sizes0[2] = 0;
-                break;
-            }
-            return _priv->qBuf(id, plane_num, index0, srcFds0, sizes0, syncfd0);
-        }
+        return _priv->qBuf(id, plane_num, index0, &b0->share_fd, &b0->size, syncfd0);
     }
+
+    int srcFds0[3], sizes0[3], offsets0[3];
+    if (get_handle_planes(b0, plane_num, srcFds0, sizes0, offsets0))
+        return -EINVAL;
+    if (b1) {
+        int srcFds1[3], sizes1[3], offsets1[3];
+        if (get_handle_planes(b1, plane_num, srcFds1, sizes1, offsets1))
+            return -EINVAL;
+        return _priv->qBuf(id, plane_num, index0, srcFds0, sizes0, syncfd0, index1, srcFds1, sizes1, syncfd1, offsets0, offsets1);
+    }
+    return _priv->qBuf(id, plane_num, index0, srcFds0, sizes0, syncfd0, -1, NULL, NULL, NULL, offsets0, NULL);
 }
 
 int v4l2_qbuf(int id, int plane_num, int index0, struct private_handle_t const *b0, int index1, struct private_handle_t const *b1,
         int *syncfd0, int *syncfd1)
 {
-    if (b1) {
-        if (plane_num == 1)
+    if (plane_num == 1) {
+        if (b1)
             return _priv->qBuf(id, plane_num, index0, &b0->share_fd, &b0->size, syncfd0, index1, &b1->share_fd, &b1->size, syncfd1);
-        else {
-            int srcFds0[3] = { b0->share_fd, b0->share_fd1, b0->share_fd2 };
-            int srcFds1[3] = { b1->share_fd, b1->share_fd1, b1->share_fd2 };
-            int sizes0[3];
-            sizes0[0] = b0->stride * ALIGN(b0->height, 16);
-            switch (b0->format) {
-            case HAL_PIXEL_FORMAT_YV12:
-                sizes0[1] = ALIGN(b0->stride >> 1, 16) * ALIGN(b0->height >> 1, 16);
-                sizes0[2] = sizes0[1];
-                break;
-            case HAL_PIXEL_FORMAT_YCrCb_420_SP:
-                sizes0[1] = b0->stride * ALIGN(b0->height >> 1, 16);
-                sizes0[2] = 0;
-                break;
-            }
-            int sizes1[3];
-            sizes1[0] = b1->stride * ALIGN(b1->height, 16);
-            switch (b1->format) {
-            case HAL_PIXEL_FORMAT_YV12:
-                sizes1[1] = ALIGN(b1->stride >> 1, 16) * ALIGN(b1->height >> 1, 16);
-                sizes1[2] = sizes1[1];
-                break;
-            case HAL_PIXEL_FORMAT_YCrCb_420_SP:
-                sizes1[1] = b1->stride * ALIGN(b1->height >> 1, 16);
-                sizes1[2] = 0;
-                break;
-            }
-            return _priv->qBuf(id, plane_num, index0, srcFds0, sizes0, syncfd0, index1, srcFds1, sizes1, syncfd1);
-        }
-    } else {
-        if (plane_num == 1)
-            return _priv->qBuf(id, plane_num, index0, &b0->share_fd, &b0->size, syncfd0);
-        else {
-            int srcFds0[3] = { b0->share_fd, b0->share_fd1, b0->share_fd2 };
-            int sizes0[3];
-            sizes0[0] = b0->stride * ALIGN(b0->height, 16);
-            switch (b0->format) {
-            case HAL_PIXEL_FORMAT_YV12:
-                sizes0[1] = ALIGN(b0->stride >> 1, 16) * ALIGN(b0->height >> 1, 16);
-                sizes0[2] = sizes0[1];
-                break;
-            case HAL_PIXEL_FORMAT_YCrCb_420_SP:
-                sizes0[1] = b0->stride * ALIGN(b0->height >> 1, 16);
-                sizes0[2] = 0;
-                break;
-            }
-            return _priv->qBuf(id, plane_num, index0, srcFds0, sizes0, syncfd0);
-        }
+        return _priv->qBuf(id, plane_num, index0, &b0->share_fd, &b0->size, syncfd0);
     }
+
+    int srcFds0[3], sizes0[3], offsets0[3];
+    if (get_handle_planes(b0, plane_num, srcFds0, sizes0, offsets0))
+        return -EINVAL;
+    if (b1) {
+        int srcFds1[3], sizes1[3], offsets1[3];
+        if (get_handle_planes(b1, plane_num, srcFds1, sizes1, offsets1))
+            return -EINVAL;
+        return _priv->qBuf(id, plane_num, index0, srcFds0, sizes0, syncfd0, index1, srcFds1, sizes1, syncfd1, offsets0, offsets1);
+    }
+    return _priv->qBuf(id, plane_num, index0, srcFds0, sizes0, syncfd0, -1, NULL, NULL, NULL, offsets0, NULL);
 }
 #endif
 
@@ -252,6 +216,11 @@ int v4l2_dqbuf(int id, int plane_num, int *index0, int *index1)
         return _priv->dqBuf(id, plane_num, index0);
 }
 
+int v4l2_dqbuf_timestamp(int id, int plane_num, int *index0, long long *timestamp)
+{
+    return _priv->dqBuf(id, plane_num, index0, NULL, timestamp);
+}
+
 int v4l2_streamon(int id)
 {
     return _priv->streamOn(id);